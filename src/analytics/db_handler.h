@@ -92,7 +92,7 @@ public:
     DbHandler(EventManager *evm, GenDb::GenDbIf::DbErrorHandler err_handler,
         const std::vector<std::string> &cassandra_ips,
         const std::vector<int> &cassandra_ports,
-        std::string name, const TtlMap& ttl_map);
+        std::string name, const TtlMap& ttl_map, size_t writer_count = 1);
     DbHandler(GenDb::GenDbIf *dbif, const TtlMap& ttl_map);
     virtual ~DbHandler();
 
@@ -139,6 +139,7 @@ public:
     bool UnderlayFlowSampleInsert(const UFlowData& flow_data,
         uint64_t timestamp);
     bool GetStats(uint64_t *queue_count, uint64_t *enqueues) const;
+    bool GetStats(std::vector<GenDb::DbQueueInfo> *vdbqi) const;
     bool GetStats(std::vector<GenDb::DbTableInfo> *vdbti,
         GenDb::DbErrors *dbe, std::vector<GenDb::DbTableInfo> *vstats_dbti);
     void GetSandeshStats(std::string *drop_level,
@@ -208,7 +209,7 @@ class DbHandlerInitializer {
         const std::string &timer_task_name, InitializeDoneCb callback,
         const std::vector<std::string> &cassandra_ips,
         const std::vector<int> &cassandra_ports,
-        const DbHandler::TtlMap& ttl_map);
+        const DbHandler::TtlMap& ttl_map, size_t writer_count = 1);
     DbHandlerInitializer(EventManager *evm,
         const std::string &db_name, int db_task_instance,
         const std::string &timer_task_name, InitializeDoneCb callback,
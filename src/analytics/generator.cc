@@ -282,6 +282,9 @@ void SandeshGenerator::SendDbStatistics() {
     gdbstats.set_table_info(vdbti);
     gdbstats.set_errors(vdbe);
     gdbstats.set_statistics_table_info(vstats_dbti);
+    std::vector<GenDb::DbQueueInfo> vdbqi;
+    db_handler_->GetStats(&vdbqi);
+    gdbstats.set_queue_info(vdbqi);
     GeneratorDbStatsUve::Send(gdbstats);
 }
 
@@ -331,7 +331,8 @@ int main(int argc, char *argv[])
             options.ipfix_port(),
             options.partitions(),
             options.dup(),
-            ttl_map);
+            ttl_map,
+            options.cassandra_writer_count());
 
 #if 0
     // initialize python/c++ API
@@ -100,6 +100,10 @@ void Options::Initialize(EventManager &evm,
            opt::value<vector<string> >()->default_value(
                default_cassandra_server_list, "127.0.0.1:9160"),
              "Cassandra server list")
+        ("DEFAULT.cassandra_writer_count",
+            opt::value<uint16_t>()->default_value(1),
+             "Number of parallel Cassandra writers for the global database "
+             "connection")
         ("DEFAULT.kafka_broker_list",
            opt::value<vector<string> >()->default_value(
                default_kafka_broker_list, ""),
@@ -282,6 +286,8 @@ void Options::Process(int argc, char *argv[],
 
     GetOptValue< vector<string> >(var_map, cassandra_server_list_,
                                   "DEFAULT.cassandra_server_list");
+    GetOptValue<uint16_t>(var_map, cassandra_writer_count_,
+                          "DEFAULT.cassandra_writer_count");
     GetOptValue< vector<string> >(var_map, kafka_broker_list_,
                                   "DEFAULT.kafka_broker_list");
     GetOptValue<uint16_t>(var_map, partitions_, "DEFAULT.partitions");
@@ -21,6 +21,9 @@ public:
         return kafka_broker_list_;
     }
     const uint16_t partitions() const { return partitions_; }
+    const uint16_t cassandra_writer_count() const {
+        return cassandra_writer_count_;
+    }
     const std::string collector_server() const { return collector_server_; }
     const uint16_t collector_port() const { return collector_port_; };
     bool collector_protobuf_port(uint16_t *collector_protobuf_port) const {
@@ -115,6 +118,7 @@ private:
     int analytics_flow_ttl_;
     int analytics_statistics_ttl_;
     std::vector<std::string> cassandra_server_list_;
+    uint16_t cassandra_writer_count_;
     std::vector<std::string> kafka_broker_list_;
     uint16_t partitions_;
 
@@ -57,6 +57,7 @@ TEST_F(OptionsTest, NoArguments) {
 
     TASK_UTIL_EXPECT_VECTOR_EQ(default_cassandra_server_list_,
                      options_.cassandra_server_list());
+    EXPECT_EQ(options_.cassandra_writer_count(), 1);
     EXPECT_EQ(options_.redis_server(), "127.0.0.1");
     EXPECT_EQ(options_.redis_port(), default_redis_port);
     EXPECT_EQ(options_.collector_server(), "0.0.0.0");
@@ -218,6 +219,7 @@ TEST_F(OptionsTest, CustomConfigFile) {
         "cassandra_server_list=10.10.10.1:100\n"
         "cassandra_server_list=20.20.20.2:200\n"
         "cassandra_server_list=30.30.30.3:300\n"
+        "cassandra_writer_count=4\n"
         "dup=1\n"
         "hostip=1.2.3.4\n"
         "hostname=test\n"
@@ -266,6 +268,7 @@ TEST_F(OptionsTest, CustomConfigFile) {
     cassandra_server_list.push_back("30.30.30.3:300");
     TASK_UTIL_EXPECT_VECTOR_EQ(options_.cassandra_server_list(),
                      cassandra_server_list);
+    EXPECT_EQ(options_.cassandra_writer_count(), 4);
 
     EXPECT_EQ(options_.redis_server(), "1.2.3.4");
     EXPECT_EQ(options_.redis_port(), 200);
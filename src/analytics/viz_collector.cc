@@ -34,11 +34,12 @@ VizCollector::VizCollector(EventManager *evm, unsigned short listen_port,
             const std::string &brokers,
             int syslog_port, int sflow_port, int ipfix_port,
             uint16_t partitions,
-            bool dup, const DbHandler::TtlMap& ttl_map) :
+            bool dup, const DbHandler::TtlMap& ttl_map,
+            uint16_t db_writer_count) :
     db_initializer_(new DbHandlerInitializer(evm, DbGlobalName(dup), -1,
         std::string("collector:DbIf"),
         boost::bind(&VizCollector::DbInitializeCb, this),
-        cassandra_ips, cassandra_ports, ttl_map)),
+        cassandra_ips, cassandra_ports, ttl_map, db_writer_count)),
     osp_(new OpServerProxy(evm, this, redis_uve_ip, redis_uve_port,
          redis_password, brokers, partitions)),
     ruleeng_(new Ruleeng(db_initializer_->GetDbHandler(), osp_.get())),
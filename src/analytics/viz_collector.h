@@ -37,7 +37,8 @@ public:
             const std::string &brokers,
             int syslog_port, int sflow_port, int ipfix_port,
             uint16_t partitions,
-            bool dup, const DbHandler::TtlMap &ttlmap);
+            bool dup, const DbHandler::TtlMap &ttlmap,
+            uint16_t db_writer_count = 1);
     VizCollector(EventManager *evm, DbHandler *db_handler, Ruleeng *ruleeng,
                  Collector *collector, OpServerProxy *osp);
     ~VizCollector();
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef BASE_MULTIBIT_TRIE_H
+#define BASE_MULTIBIT_TRIE_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include "base/util.h"
+
+//
+// Read optimized longest prefix match index over prefixes of up to 128 bits.
+//
+// The trie consumes the address a byte at a time. Each node covers one
+// byte of the address and holds the prefixes ending within that byte,
+// expanded into the 256 slots of the node, so that a lookup costs one
+// array access per byte instead of one node per bit. Chains of nodes
+// without prefixes are compressed away: a child may sit several bytes
+// below its parent, and stores the address bytes leading to it.
+//
+// The data is not owned by the trie. K is the key class used by
+// Patricia::Tree, providing BitLength() and ByteValue() of the data.
+//
+// Insert and Remove must not be called concurrently with lookups.
+//
+template <class D, class K>
+class MultibitTrie {
+public:
+    static const int kMaxBytes = 16;
+    static const int kStrideBits = 8;
+    static const int kFanout = 1 << kStrideBits;
+
+    MultibitTrie() : root_(new Node(NULL, 0, 0, NULL)), default_(NULL),
+        count_(0), node_count_(1) {
+    }
+
+    ~MultibitTrie() {
+        DeleteNode(root_);
+    }
+
+    void Insert(D *data) {
+        std::size_t len = K::BitLength(data);
+        count_++;
+        if (len == 0) {
+            assert(default_ == NULL);
+            default_ = data;
+            return;
+        }
+
+        uint8_t bytes[kMaxBytes];
+        std::size_t depth = (len - 1) / kStrideBits;
+        GetBytes(data, depth + 1, bytes);
+        Node *node = Locate(bytes, depth);
+        node->prefixes.push_back(data);
+
+        int plen = len - depth * kStrideBits;
+        int start, end;
+        SlotRange(bytes[depth], plen, &start, &end);
+        for (int slot = start; slot < end; slot++) {
+            D *best = node->best[slot];
+            if (best == NULL || PrefixLen(node, best) <= plen) {
+                node->best[slot] = data;
+            }
+        }
+    }
+
+    void Remove(D *data) {
+        std::size_t len = K::BitLength(data);
+        assert(count_ != 0);
+        count_--;
+        if (len == 0) {
+            assert(default_ == data);
+            default_ = NULL;
+            return;
+        }
+
+        uint8_t bytes[kMaxBytes];
+        std::size_t depth = (len - 1) / kStrideBits;
+        GetBytes(data, depth + 1, bytes);
+        Node *node = Find(bytes, depth);
+        assert(node != NULL);
+        typename std::vector<D *>::iterator it =
+            std::find(node->prefixes.begin(), node->prefixes.end(), data);
+        assert(it != node->prefixes.end());
+        *it = node->prefixes.back();
+        node->prefixes.pop_back();
+
+        // The slots of the prefix fall back to the longest shorter prefix
+        // of the node covering them. It covers all of them, if any.
+        int plen = len - depth * kStrideBits;
+        int start, end;
+        SlotRange(bytes[depth], plen, &start, &end);
+        D *cover = NULL;
+        int cover_len = 0;
+        for (typename std::vector<D *>::iterator it = node->prefixes.begin();
+             it != node->prefixes.end(); ++it) {
+            int other_len = PrefixLen(node, *it);
+            if (other_len >= plen || other_len <= cover_len)
+                continue;
+            int other_start, other_end;
+            SlotRange(K::ByteValue(*it, depth), other_len, &other_start,
+                      &other_end);
+            if (other_start <= start && end <= other_end) {
+                cover = *it;
+                cover_len = other_len;
+            }
+        }
+        for (int slot = start; slot < end; slot++) {
+            if (node->best[slot] == data) {
+                node->best[slot] = cover;
+            }
+        }
+
+        Compress(node);
+    }
+
+    // Longest prefix of the trie matching the first nbytes of the address.
+    D *LPMFind(const uint8_t *bytes, std::size_t nbytes) const {
+        D *best = default_;
+        const Node *node = root_;
+        while (node->depth < nbytes) {
+            uint8_t value = bytes[node->depth];
+            if (node->best[value]) {
+                best = node->best[value];
+            }
+            const Node *child = node->child[value];
+            if (child == NULL || child->depth >= nbytes)
+                break;
+            std::size_t skip = node->depth + 1;
+            if (child->depth > skip &&
+                memcmp(child->bytes + skip, bytes + skip,
+                       child->depth - skip) != 0) {
+                break;
+            }
+            node = child;
+        }
+        return best;
+    }
+
+    // Longest prefix matching the complete address of key.
+    D *LPMFind(const D *key) const {
+        uint8_t bytes[kMaxBytes];
+        std::size_t nbytes = K::BitLength(key) / kStrideBits;
+        GetBytes(key, nbytes, bytes);
+        return LPMFind(bytes, nbytes);
+    }
+
+    std::size_t size() const { return count_; }
+    std::size_t node_count() const { return node_count_; }
+
+private:
+    struct Node {
+        Node(Node *parent, uint8_t slot, std::size_t depth,
+             const uint8_t *key) :
+            parent(parent), slot(slot), depth(depth), child_count(0) {
+            memset(best, 0, sizeof(best));
+            memset(child, 0, sizeof(child));
+            memset(bytes, 0, sizeof(bytes));
+            if (key) {
+                memcpy(bytes, key, depth);
+            }
+        }
+
+        D *best[kFanout];           // Longest prefix of the node per slot
+        Node *child[kFanout];
+        Node *parent;
+        uint8_t slot;               // Slot of the node in its parent
+        std::size_t depth;          // Address byte covered by the node
+        uint8_t bytes[kMaxBytes];   // Address bytes leading to the node
+        int child_count;
+        std::vector<D *> prefixes;  // Prefixes ending in the node
+    };
+
+    static void GetBytes(const D *data, std::size_t nbytes, uint8_t *bytes) {
+        for (std::size_t i = 0; i < nbytes; i++) {
+            bytes[i] = K::ByteValue(data, i);
+        }
+    }
+
+    // Length of the prefix within the byte covered by node, 1 to 8 bits.
+    static int PrefixLen(const Node *node, const D *data) {
+        return K::BitLength(data) - node->depth * kStrideBits;
+    }
+
+    static void SlotRange(uint8_t value, int plen, int *start, int *end) {
+        int span = 1 << (kStrideBits - plen);
+        *start = value & ~(span - 1);
+        *end = *start + span;
+    }
+
+    void Link(Node *parent, Node *node) {
+        if (parent->child[node->slot] == NULL)
+            parent->child_count++;
+        parent->child[node->slot] = node;
+        node->parent = parent;
+    }
+
+    // Node covering byte depth of the address, created if needed.
+    Node *Locate(const uint8_t *bytes, std::size_t depth) {
+        Node *node = root_;
+        while (node->depth < depth) {
+            uint8_t value = bytes[node->depth];
+            Node *child = node->child[value];
+            if (child == NULL) {
+                child = new Node(node, value, depth, bytes);
+                node_count_++;
+                Link(node, child);
+                return child;
+            }
+
+            // Bytes skipped between the node and its child must match,
+            // otherwise a node is added where the addresses diverge.
+            std::size_t split = node->depth + 1;
+            while (split < child->depth && split < depth &&
+                   child->bytes[split] == bytes[split]) {
+                split++;
+            }
+            if (split < child->depth) {
+                Node *middle = new Node(node, value, split, bytes);
+                node_count_++;
+                Link(node, middle);
+                child->slot = child->bytes[split];
+                Link(middle, child);
+                child = middle;
+            }
+            node = child;
+        }
+        return node;
+    }
+
+    Node *Find(const uint8_t *bytes, std::size_t depth) const {
+        Node *node = root_;
+        while (node->depth < depth) {
+            node = node->child[bytes[node->depth]];
+            if (node == NULL || node->depth > depth)
+                return NULL;
+        }
+        return node;
+    }
+
+    // Release a node that no longer holds prefixes, or splice it out when
+    // it only leads to a single child.
+    void Compress(Node *node) {
+        while (node != root_ && node->prefixes.empty() &&
+               node->child_count <= 1) {
+            Node *parent = node->parent;
+            if (node->child_count == 1) {
+                Node *child = NULL;
+                for (int slot = 0; child == NULL; slot++) {
+                    child = node->child[slot];
+                }
+                child->slot = node->slot;
+                parent->child[node->slot] = child;
+                child->parent = parent;
+            } else {
+                parent->child[node->slot] = NULL;
+                parent->child_count--;
+            }
+            delete node;
+            node_count_--;
+            node = parent;
+        }
+    }
+
+    void DeleteNode(Node *node) {
+        for (int slot = 0; node->child_count && slot < kFanout; slot++) {
+            if (node->child[slot]) {
+                DeleteNode(node->child[slot]);
+                node->child_count--;
+            }
+        }
+        delete node;
+    }
+
+    Node *root_;
+    D *default_;
+    std::size_t count_;
+    std::size_t node_count_;
+
+    DISALLOW_COPY_AND_ASSIGN(MultibitTrie);
+};
+
+#endif  // BASE_MULTIBIT_TRIE_H
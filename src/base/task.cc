@@ -12,6 +12,7 @@
 #include "tbb/enumerable_thread_specific.h"
 #include "base/logging.h"
 #include "base/task.h"
+#include "base/time_util.h"
 
 #include <sandesh/sandesh_types.h>
 #include <sandesh/sandesh.h>
@@ -28,6 +29,7 @@ using namespace std;
 using tbb::task;
 
 int TaskScheduler::ThreadAmpFactor_ = 1;
+bool TaskScheduler::GroupLocking_ = false;
 class TaskEntry;
 struct TaskDeferEntryCmp;
 
@@ -98,6 +100,7 @@ public:
     void RunWaitQ();
     void RunDeferEntry();
     void TaskExited(Task *t, TaskGroup *group);
+    void UpdateTaskTimes(Task *t, TaskGroup *group, uint64_t slow_threshold);
     TaskStats *GetTaskStats();
     void ClearTaskStats();
     void ClearQueues();
@@ -152,9 +155,12 @@ struct TaskDeferEntryCmp {
 // run_count_   : Number of tasks running in context of this task-group
 // deferq_      : Tasks deferred till run_count_ on this task becomes 0
 // task_entry_  : Default TaskEntry used for task without an instance
+// mutex_       : Mutex protecting the group, shared by all the groups related
+//                through policies. Points to the scheduler mutex unless group
+//                locking is enabled
 class TaskGroup {
 public:
-    TaskGroup(int task_id);
+    TaskGroup(int task_id, tbb::mutex *mutex);
     ~TaskGroup();
 
     TaskEntry *QueryTaskEntry(int task_instance);
@@ -213,6 +219,7 @@ private:
     TaskDeferList           deferq_;    // Tasks deferred till run_count_ is 0
     TaskEntry               *task_entry_;// Task entry for instance(-1)
     TaskEntryList           task_entry_db_;  // task-entries in this group
+    tbb::atomic<tbb::mutex *> mutex_;
 
     TaskStats               stats_;
     DISALLOW_COPY_AND_ASSIGN(TaskGroup);
@@ -229,8 +236,19 @@ tbb::task *TaskImpl::execute() {
     TaskInfo::reference running = task_running.local();
     running = parent_;
     try {
+        parent_->run_start_time_ = ClockMonotonicUsec();
         bool is_complete = parent_->Run();
+        parent_->run_end_time_ = ClockMonotonicUsec();
         running = NULL;
+
+        TaskScheduler *scheduler = TaskScheduler::GetInstance();
+        uint64_t threshold = scheduler->slow_task_threshold();
+        if (threshold && parent_->run_time() > threshold) {
+            LOG(DEBUG, "Slow task " << *parent_ << "("
+                << scheduler->GetTaskName(parent_->GetTaskId()) << ") ran "
+                << parent_->run_time() << " usecs after waiting "
+                << parent_->wait_time() << " usecs");
+        }
         if (is_complete == true) {
             parent_->SetTaskComplete();
         } else {
@@ -294,9 +312,13 @@ int TaskScheduler::GetThreadCount() {
 // part of tbb. So, initialize TBB with one thread more than its default
 TaskScheduler::TaskScheduler() : 
     task_scheduler_(GetThreadCount() + 1),
-    running_(true), seqno_(0), id_max_(0) {
+    group_locking_(GetGroupLocking()), id_max_(0) {
+    running_ = true;
+    seqno_ = 0;
+    slow_task_threshold_ = GetSlowTaskThreshold();
     hw_thread_count_ = GetThreadCount();
-    task_group_db_.resize(TaskScheduler::kVectorGrowSize);
+    task_group_db_.grow_to_at_least(TaskScheduler::kVectorGrowSize);
+    group_db_size_ = task_group_db_.size();
     stop_entry_ = new TaskEntry(-1);
 }
 
@@ -336,17 +358,117 @@ TaskScheduler *TaskScheduler::GetInstance() {
     return singleton_.get();
 }
 
-// Get TaskGroup for a task_id. Grows task_entry_db_ if necessary
+////////////////////////////////////////////////////////////////////////////
+// Implementation for the TaskScheduler locks
+////////////////////////////////////////////////////////////////////////////
+
+// Mutexes are always acquired in the order group_db_mutex_, group mutexes
+// in their order of creation and then the scheduler mutex. The group mutexes
+// are not used unless group locking is enabled.
+TaskScheduler::ExclusiveLock::ExclusiveLock(TaskScheduler *scheduler)
+    : scheduler_(scheduler) {
+    if (scheduler_->group_locking_) {
+        scheduler_->group_db_mutex_.lock();
+        for (GroupMutexList::iterator it = scheduler_->group_mutexes_.begin();
+             it != scheduler_->group_mutexes_.end(); ++it) {
+            it->lock();
+        }
+    }
+    scheduler_->mutex_.lock();
+}
+
+TaskScheduler::ExclusiveLock::~ExclusiveLock() {
+    scheduler_->mutex_.unlock();
+    if (scheduler_->group_locking_) {
+        for (GroupMutexList::reverse_iterator it =
+             scheduler_->group_mutexes_.rbegin();
+             it != scheduler_->group_mutexes_.rend(); ++it) {
+            it->unlock();
+        }
+        scheduler_->group_db_mutex_.unlock();
+    }
+}
+
+// The mutex of a group changes when SetPolicy() merges it with the mutex of
+// another group, so check that the mutex acquired is still the group's.
+//
+// Tasks of all groups are queued to the stop_entry_ when the scheduler is
+// stopped. Stop() and Start() hold the ExclusiveLock, hence running_ does not
+// change while the group mutex is held.
+TaskScheduler::GroupLock::GroupLock(TaskScheduler *scheduler,
+                                    TaskGroup *group) : mutex_(NULL) {
+    if (!scheduler->group_locking_) {
+        mutex_ = &scheduler->mutex_;
+        mutex_->lock();
+        return;
+    }
+
+    while (true) {
+        tbb::mutex *mutex = group->mutex_;
+        mutex->lock();
+        if (mutex == group->mutex_ && scheduler->running_) {
+            mutex_ = mutex;
+            return;
+        }
+        mutex->unlock();
+        if (!scheduler->running_) {
+            exclusive_.reset(new ExclusiveLock(scheduler));
+            return;
+        }
+    }
+}
+
+TaskScheduler::GroupLock::~GroupLock() {
+    if (mutex_) {
+        mutex_->unlock();
+    }
+}
+
+bool TaskScheduler::GetGroupLocking() {
+    char *str = getenv("TASK_SCHEDULER_GROUP_LOCKING");
+    if (str) {
+        return strtol(str, NULL, 0) != 0;
+    }
+    return GroupLocking_;
+}
+
+uint64_t TaskScheduler::GetSlowTaskThreshold() {
+    char *str = getenv("TASK_SLOW_THRESHOLD_USECS");
+    if (str) {
+        return strtoull(str, NULL, 0);
+    }
+    return 0;
+}
+
+// Get TaskGroup for a task_id. Grows task_group_db_ if necessary
+//
+// Existing groups are returned without taking any mutex. A new group must
+// not be created while holding the mutex of a group, as group_db_mutex_ is
+// acquired ahead of group mutexes by ExclusiveLock.
 TaskGroup *TaskScheduler::GetTaskGroup(int task_id) {
     assert(task_id >= 0);
-    int size = task_group_db_.size();
-    if (size <= task_id) {
-        task_group_db_.resize(task_id + TaskScheduler::kVectorGrowSize);
+    if ((size_t)task_id < group_db_size_) {
+        TaskGroup *group = task_group_db_[task_id];
+        if (group != NULL) {
+            return group;
+        }
+    }
+
+    tbb::mutex::scoped_lock lock(group_db_mutex_);
+    if (task_group_db_.size() <= (size_t)task_id) {
+        task_group_db_.grow_to_at_least(task_id +
+                                        TaskScheduler::kVectorGrowSize);
+        group_db_size_ = task_group_db_.size();
     }
 
     TaskGroup *group = task_group_db_[task_id];
     if (group == NULL) {
-        group = new TaskGroup(task_id);
+        tbb::mutex *mutex = &mutex_;
+        if (group_locking_) {
+            mutex = new tbb::mutex;
+            group_mutexes_.push_back(mutex);
+        }
+        group = new TaskGroup(task_id, mutex);
         task_group_db_[task_id] = group;
     }
 
@@ -382,16 +504,22 @@ TaskEntry *TaskScheduler::QueryTaskEntry(int task_id, int task_instance) {
 //      task_db_[tid1] : Rule <tid0, -1> is added to policyq
 //      task_group_db_[tid2, inst2] : Rule <tid0, inst2> is added to policyq
 void TaskScheduler::SetPolicy(int task_id, TaskPolicy &policy) {
-    tbb::mutex::scoped_lock     lock(mutex_);
-
+    // Create the groups before locking the scheduler.
     TaskGroup *group = GetTaskGroup(task_id);
+    for (TaskPolicy::iterator it = policy.begin(); it != policy.end(); ++it) {
+        GetTaskGroup(it->match_id);
+    }
+
+    ExclusiveLock lock(this);
+
     TaskEntry *group_entry = group->GetTaskEntry(-1);
     group->PolicySet();
 
     for (TaskPolicy::iterator it = policy.begin(); it != policy.end(); ++it) {
+        TaskGroup *policy_group = GetTaskGroup(it->match_id);
+        MergeGroupMutex(group, policy_group);
 
         if (it->match_instance == -1) {
-            TaskGroup *policy_group = GetTaskGroup(it->match_id);
             group->AddPolicy(policy_group);
             policy_group->AddPolicy(group);
         } else {
@@ -407,10 +535,30 @@ void TaskScheduler::SetPolicy(int task_id, TaskPolicy &policy) {
     }
 }
 
+// Groups related through a policy can look at and modify each other's state,
+// so they must share a mutex. Move all the groups using the policy group's
+// mutex over to the group's mutex. Must be called with ExclusiveLock held.
+void TaskScheduler::MergeGroupMutex(TaskGroup *group,
+                                    TaskGroup *policy_group) {
+    tbb::mutex *mutex = group->mutex_;
+    tbb::mutex *policy_mutex = policy_group->mutex_;
+    if (mutex == policy_mutex) {
+        return;
+    }
+
+    for (TaskGroupDb::iterator it = task_group_db_.begin();
+         it != task_group_db_.end(); ++it) {
+        TaskGroup *entry = *it;
+        if (entry != NULL && entry->mutex_ == policy_mutex) {
+            entry->mutex_ = mutex;
+        }
+    }
+}
+
 // Enqueue a Task for running. Starts task if all policy rules are met else 
 // puts task in waitq
 void TaskScheduler::Enqueue(Task *t) {
-    tbb::mutex::scoped_lock     lock(mutex_);
+    GroupLock lock(this, GetTaskGroup(t->GetTaskId()));
 
     EnqueueUnLocked(t);
 }
@@ -419,6 +567,7 @@ void TaskScheduler::EnqueueUnLocked(Task *t) {
     // Ensure that task is enqueued only once.
     assert(t->GetSeqno() == 0);
     t->SetSeqNo(++seqno_);
+    t->SetEnqueueTime(ClockMonotonicUsec());
     TaskGroup *group = GetTaskGroup(t->GetTaskId());
 
 
@@ -458,7 +607,7 @@ void TaskScheduler::EnqueueUnLocked(Task *t) {
 // Cancel a Task that can be in RUN/WAIT state.
 // [Note]: The caller needs to ensure that the task exists when Cancel() is invoked. 
 TaskScheduler::CancelReturnCode TaskScheduler::Cancel(Task *t) {
-    tbb::mutex::scoped_lock  lock(mutex_);
+    GroupLock lock(this, GetTaskGroup(t->GetTaskId()));
 
     // If the task is in RUN state, mark the task for cancellation and return.
     if (t->state_ == Task::RUN) {
@@ -508,10 +657,12 @@ TaskScheduler::CancelReturnCode TaskScheduler::Cancel(Task *t) {
 // Method invoked on exit of a Task.
 // Exit of a task can potentially start tasks in pendingq.
 void TaskScheduler::OnTaskExit(Task *t) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    TaskGroup *group = QueryTaskGroup(t->GetTaskId());
+    GroupLock lock(this, group);
 
-    TaskEntry *entry = QueryTaskEntry(t->GetTaskId(), t->GetTaskInstance());
-    entry->TaskExited(t, GetTaskGroup(t->GetTaskId()));
+    TaskEntry *entry = group->QueryTaskEntry(t->GetTaskInstance());
+    entry->UpdateTaskTimes(t, group, slow_task_threshold_);
+    entry->TaskExited(t, group);
 
     //
     // Delete the task it is not marked for recycling or already cancelled.
@@ -535,13 +686,13 @@ void TaskScheduler::OnTaskExit(Task *t) {
 }
 
 void TaskScheduler::Stop() {
-    tbb::mutex::scoped_lock             lock(mutex_);
+    ExclusiveLock lock(this);
 
     running_ = false;
 }
 
 void TaskScheduler::Start() {
-    tbb::mutex::scoped_lock             lock(mutex_);
+    ExclusiveLock lock(this);
 
     running_ = true;
 
@@ -570,7 +721,7 @@ void TaskScheduler::Print() {
 bool TaskScheduler::IsEmpty(bool running_only) {
     TaskGroup *group;
 
-    tbb::mutex::scoped_lock lock(mutex_);
+    ExclusiveLock lock(this);
 
     for (TaskGroupDb::iterator it = task_group_db_.begin();
          it != task_group_db_.end(); ++it) {
@@ -607,6 +758,18 @@ int TaskScheduler::GetTaskId(const string &name) {
     return tid;
 }
 
+// Reverse lookup of the id_map_, meant for logging and introspection only.
+string TaskScheduler::GetTaskName(int task_id) {
+    tbb::reader_writer_lock::scoped_lock_read lock(id_map_mutex_);
+    for (TaskIdMap::const_iterator it = id_map_.begin(); it != id_map_.end();
+         ++it) {
+        if (it->second == task_id) {
+            return it->first;
+        }
+    }
+    return "";
+}
+
 void TaskScheduler::ClearTaskGroupStats(int task_id) {
     TaskGroup *group = GetTaskGroup(task_id);
     if (group == NULL)
@@ -776,8 +939,9 @@ void TaskScheduler::ClearRunningTask() {
 // Implementation for class TaskGroup 
 ////////////////////////////////////////////////////////////////////////////
 
-TaskGroup::TaskGroup(int task_id) : task_id_(task_id), policy_set_(false), 
-    run_count_(0) {
+TaskGroup::TaskGroup(int task_id, tbb::mutex *mutex) : task_id_(task_id),
+    policy_set_(false), run_count_(0) {
+    mutex_ = mutex;
     task_entry_db_.resize(TaskGroup::kVectorGrowSize);
     task_entry_ = new TaskEntry(task_id);
     memset(&stats_, 0, sizeof(stats_));
@@ -1188,6 +1352,22 @@ void TaskEntry::TaskExited(Task *t, TaskGroup *group) {
     }
 }
 
+// Account the wait and run times of a task that just ran, in the stats of
+// the entry and of its group.
+void TaskEntry::UpdateTaskTimes(Task *t, TaskGroup *group,
+                                uint64_t slow_threshold) {
+    uint64_t wait_time = t->wait_time();
+    uint64_t run_time = t->run_time();
+    stats_.wait_time_.Add(wait_time);
+    stats_.run_time_.Add(run_time);
+    group->stats_.wait_time_.Add(wait_time);
+    group->stats_.run_time_.Add(run_time);
+    if (slow_threshold && run_time > slow_threshold) {
+        stats_.slow_count_++;
+        group->stats_.slow_count_++;
+    }
+}
+
 void TaskEntry::ClearQueues() {
     deferq_->clear();
     policyq_.clear();
@@ -1215,17 +1395,39 @@ int TaskEntry::GetTaskDeferEntrySeqno() const {
     return -1;
 }
 
+////////////////////////////////////////////////////////////////////////////
+// Implementation for class TaskHistogram
+////////////////////////////////////////////////////////////////////////////
+
+void TaskHistogram::Add(uint64_t usecs) {
+    int bucket = 0;
+    if (usecs) {
+        bucket = 64 - __builtin_clzll(usecs);
+        if (bucket >= kBucketCount) {
+            bucket = kBucketCount - 1;
+        }
+    }
+    buckets_[bucket]++;
+    count_++;
+    total_usecs_ += usecs;
+    if (usecs > max_usecs_) {
+        max_usecs_ = usecs;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // Implementation for class Task
 ////////////////////////////////////////////////////////////////////////////
 Task::Task(int task_id, int task_instance) : task_id_(task_id),
     task_instance_(task_instance), task_impl_(NULL), state_(INIT), seqno_(0),
-    task_recycle_(false), task_cancel_(false) {
+    task_recycle_(false), task_cancel_(false), enqueue_time_(0),
+    run_start_time_(0), run_end_time_(0) {
 }
 
 Task::Task(int task_id) : task_id_(task_id),
     task_instance_(-1), task_impl_(NULL), state_(INIT), seqno_(0),
-    task_recycle_(false), task_cancel_(false) {
+    task_recycle_(false), task_cancel_(false), enqueue_time_(0),
+    run_start_time_(0), run_end_time_(0) {
 }
 
 // Start execution of task
@@ -1288,6 +1490,45 @@ void TaskScheduler::GetTaskEntrySummary(TaskEntry *entry,
     summary->set_waitq_size(entry->waitq_.size());
 }
 
+static void GetTaskHistogramSandeshData(const TaskHistogram &histogram,
+                                        SandeshTaskHistogram *resp) {
+    resp->set_count(histogram.count_);
+    resp->set_total_usecs(histogram.total_usecs_);
+    resp->set_max_usecs(histogram.max_usecs_);
+
+    // Only report the non-empty buckets, along with their upper bound.
+    std::vector<SandeshTaskHistogramBucket> buckets;
+    for (int i = 0; i < TaskHistogram::kBucketCount; i++) {
+        if (histogram.buckets_[i] == 0) {
+            continue;
+        }
+        SandeshTaskHistogramBucket bucket;
+        if (i < TaskHistogram::kBucketCount - 1) {
+            bucket.set_max_usecs(1ULL << i);
+        } else {
+            bucket.set_max_usecs(0);
+        }
+        bucket.set_count(histogram.buckets_[i]);
+        buckets.push_back(bucket);
+    }
+    resp->set_buckets(buckets);
+}
+
+void TaskScheduler::GetTaskStatsSandeshData(const TaskStats *stats,
+                                            SandeshTaskStats *resp) {
+    resp->set_wait_count(stats->wait_count_);
+    resp->set_run_count(stats->run_count_);
+    resp->set_defer_count(stats->defer_count_);
+    resp->set_slow_count(stats->slow_count_);
+
+    SandeshTaskHistogram wait_time;
+    GetTaskHistogramSandeshData(stats->wait_time_, &wait_time);
+    resp->set_wait_time(wait_time);
+    SandeshTaskHistogram run_time;
+    GetTaskHistogramSandeshData(stats->run_time_, &run_time);
+    resp->set_run_time(run_time);
+}
+
 void TaskScheduler::GetTaskGroupSandeshData(int task_id,
                                             SandeshTaskGroupResp *resp) {
     resp->set_task_id(task_id);
@@ -1391,9 +1632,7 @@ void TaskScheduler::GetTaskEntrySandeshData(int task_id, int instance_id,
     resp->set_defer_list(defer_list);
 
     SandeshTaskStats stats;
-    stats.set_wait_count(entry->GetTaskStats()->wait_count_);
-    stats.set_run_count(entry->GetTaskStats()->run_count_);
-    stats.set_defer_count(entry->GetTaskStats()->defer_count_);
+    GetTaskStatsSandeshData(entry->GetTaskStats(), &stats);
     resp->set_summary_stats(stats);
 
     if (entry->deferq_task_entry_) {
@@ -1445,3 +1684,7 @@ void TaskScheduler::GetTaskSandeshData(int task_id, int instance_id,
 // TBB
 void TaskScheduler::SetThreadAmpFactor(int n)
 { ThreadAmpFactor_ = n; }
+
+void TaskScheduler::SetGroupLocking(bool enable) {
+    GroupLocking_ = enable;
+}
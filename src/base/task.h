@@ -31,9 +31,12 @@
 #ifndef ctrlplane_task_h
 #define ctrlplane_task_h
 
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <map>
 #include <vector>
+#include <tbb/atomic.h>
+#include <tbb/concurrent_vector.h>
 #include <tbb/mutex.h>
 #include <tbb/reader_writer_lock.h>
 #include <tbb/task.h>
@@ -47,11 +50,29 @@ class SandeshTaskGroupResp;
 class SandeshTaskEntryResp;
 class SandeshTaskEntrySummary;
 class SandeshTaskResp;
+class SandeshTaskStats;
+
+// Histogram of task durations in microseconds. Bucket 0 counts durations of
+// 0 usecs and bucket i counts durations in [2^(i-1), 2^i) usecs. The last
+// bucket also counts all the longer durations.
+struct TaskHistogram {
+    static const int kBucketCount = 24;
+
+    void Add(uint64_t usecs);
+
+    uint64_t count_;
+    uint64_t total_usecs_;
+    uint64_t max_usecs_;
+    uint64_t buckets_[kBucketCount];
+};
 
 struct TaskStats {
     int     wait_count_;
     int     run_count_;
     int     defer_count_;
+    int     slow_count_;            // Runs longer than the slow threshold
+    TaskHistogram wait_time_;       // Time from enqueue to start of Run()
+    TaskHistogram run_time_;        // Time spent in Run()
 };
 
 struct TaskExclusion {
@@ -108,6 +129,9 @@ private:
     void SetTaskRecycle() { task_recycle_ = true; };
     void SetTaskComplete() { task_recycle_ = false; };
     void StartTask();
+    void SetEnqueueTime(uint64_t time) { enqueue_time_ = time; }
+    uint64_t wait_time() const { return run_start_time_ - enqueue_time_; }
+    uint64_t run_time() const { return run_end_time_ - run_start_time_; }
 
     int                 task_id_;       // The code path executed by the task.
     int                 task_instance_; // The dataset id within a code path.
@@ -116,6 +140,9 @@ private:
     uint32_t            seqno_;
     bool                task_recycle_;
     bool                task_cancel_;
+    uint64_t            enqueue_time_;  // ClockMonotonicUsec() timestamps
+    uint64_t            run_start_time_;
+    uint64_t            run_end_time_;
 
     DISALLOW_COPY_AND_ASSIGN(Task);
 };
@@ -128,6 +155,14 @@ private:
 // which may now be runnable. It is important that this process is efficient
 // such that exit events do not scan tasks that are not waiting on a particular
 // task id or task instance to have a 0 count.
+//
+// By default the state of all the task groups is protected by a single
+// scheduler mutex. With group locking enabled, each set of task groups that
+// are related through their policies gets its own mutex instead, so that
+// enqueue and exit of tasks in unrelated groups don't contend with each
+// other. The policy semantics are the same in both modes. Operations that
+// look at the state of all the groups (policy changes, Stop/Start, IsEmpty
+// and introspection) acquire all the mutexes.
 class TaskScheduler {
 public:
     TaskScheduler();
@@ -154,6 +189,7 @@ public:
 
     bool GetRunStatus() { return running_; };
     int GetTaskId(const std::string &name);
+    std::string GetTaskName(int task_id);
 
     TaskStats *GetTaskGroupStats(int task_id);
     TaskStats *GetTaskStats(int task_id);
@@ -183,6 +219,20 @@ public:
     // following function allows one to increase max num of threads used by
     // TBB
     static void SetThreadAmpFactor(int n);
+
+    // Enable per task group locking for schedulers created after the call.
+    // Can also be enabled with the TASK_SCHEDULER_GROUP_LOCKING environment
+    // variable.
+    static void SetGroupLocking(bool enable);
+    bool group_locking() const { return group_locking_; }
+
+    // Tasks whose Run() takes longer than the threshold are logged and
+    // counted in the slow_count_ of their stats. 0 disables the check.
+    // The initial value can be set with the TASK_SLOW_THRESHOLD_USECS
+    // environment variable.
+    void SetSlowTaskThreshold(uint64_t usecs) { slow_task_threshold_ = usecs; }
+    uint64_t slow_task_threshold() const { return slow_task_threshold_; }
+
 private:
     friend class SandeshTaskSchedulerReq;
     friend class SandeshTaskGroupReq;
@@ -195,10 +245,37 @@ private:
                             SandeshTaskResp *resp);
     void GetTaskEntrySummary(TaskEntry *entry,
                              SandeshTaskEntrySummary *summary);
+    static void GetTaskStatsSandeshData(const TaskStats *stats,
+                                        SandeshTaskStats *resp);
 private:
     friend class ConcurrencyScope;
-    typedef std::vector<TaskGroup *> TaskGroupDb;
+    typedef tbb::concurrent_vector<tbb::atomic<TaskGroup *> > TaskGroupDb;
     typedef std::map<std::string, int> TaskIdMap;
+    typedef boost::ptr_vector<tbb::mutex> GroupMutexList;
+
+    // Acquires all the scheduler mutexes.
+    class ExclusiveLock {
+    public:
+        explicit ExclusiveLock(TaskScheduler *scheduler);
+        ~ExclusiveLock();
+
+    private:
+        TaskScheduler *scheduler_;
+        DISALLOW_COPY_AND_ASSIGN(ExclusiveLock);
+    };
+
+    // Acquires the mutex protecting the state of a task group, or all the
+    // scheduler mutexes if the scheduler is stopped.
+    class GroupLock {
+    public:
+        GroupLock(TaskScheduler *scheduler, TaskGroup *group);
+        ~GroupLock();
+
+    private:
+        tbb::mutex *mutex_;
+        boost::scoped_ptr<ExclusiveLock> exclusive_;
+        DISALLOW_COPY_AND_ASSIGN(GroupLock);
+    };
 
     static const int        kVectorGrowSize = 16;
     static boost::scoped_ptr<TaskScheduler> singleton_;
@@ -212,14 +289,27 @@ private:
     void WaitForTerminateCompletion();
 
     int CountThreadsPerPid(pid_t pid);
+    static bool GetGroupLocking();
+    static uint64_t GetSlowTaskThreshold();
+    void MergeGroupMutex(TaskGroup *group, TaskGroup *policy_group);
 
     TaskEntry               *stop_entry_;
 
     tbb::task_scheduler_init task_scheduler_;
     tbb::mutex              mutex_;
-    bool                    running_;
-    int                     seqno_;
+    tbb::atomic<bool>       running_;
+    tbb::atomic<int>        seqno_;
+    // Read by running tasks while SetSlowTaskThreshold() may update it
+    tbb::atomic<uint64_t>   slow_task_threshold_;
+
+    // Task groups are looked up without holding any mutex. Groups are
+    // created and task_group_db_ is grown with group_db_mutex_ held, and
+    // group_db_size_ covers only the slots that are fully constructed.
+    bool                    group_locking_;
+    tbb::mutex              group_db_mutex_;
     TaskGroupDb             task_group_db_;
+    tbb::atomic<size_t>     group_db_size_;
+    GroupMutexList          group_mutexes_;
 
     tbb::reader_writer_lock id_map_mutex_;
     TaskIdMap               id_map_;
@@ -230,6 +320,7 @@ private:
     // following variable allows one to increase max num of threads used by
     // TBB
     static int ThreadAmpFactor_;
+    static bool GroupLocking_;
     DISALLOW_COPY_AND_ASSIGN(TaskScheduler);
 };
 
@@ -34,15 +34,9 @@ void DecodeTaskKey(const string &key, int *task_id, int *instance_id,
     sscanf(key.c_str(), "%d:%d:%d", task_id, instance_id, seqno);
 }
 
-static void SetStats(SandeshTaskStats &dest, TaskStats *src) {
-    dest.set_wait_count(src->wait_count_);
-    dest.set_run_count(src->run_count_);
-    dest.set_defer_count(src->defer_count_);
-}
-
 void SandeshTaskSchedulerReq::HandleRequest() const {
     TaskScheduler *scheduler = TaskScheduler::GetInstance();
-    tbb::mutex::scoped_lock lock(scheduler->mutex_);
+    TaskScheduler::ExclusiveLock lock(scheduler);
 
     SandeshTaskSchedulerResp *resp = new SandeshTaskSchedulerResp;
     resp->set_running(scheduler->running_);
@@ -67,7 +61,7 @@ void SandeshTaskSchedulerReq::HandleRequest() const {
 
 void SandeshTaskGroupReq::HandleRequest() const {
     TaskScheduler *scheduler = TaskScheduler::GetInstance();
-    tbb::mutex::scoped_lock lock(scheduler->mutex_);
+    TaskScheduler::ExclusiveLock lock(scheduler);
 
     SandeshTaskGroupResp *resp = new SandeshTaskGroupResp;
     TaskGroup *group = scheduler->QueryTaskGroup(get_task_id());
@@ -75,7 +69,8 @@ void SandeshTaskGroupReq::HandleRequest() const {
     if (group != NULL) {
         resp->set_task_id(get_task_id());
         SandeshTaskStats stats;
-        SetStats(stats, scheduler->GetTaskGroupStats(get_task_id()));
+        TaskScheduler::GetTaskStatsSandeshData(
+            scheduler->GetTaskGroupStats(get_task_id()), &stats);
         resp->set_summary_stats(stats);
         scheduler->GetTaskGroupSandeshData(get_task_id(), resp);
     }
@@ -87,7 +82,7 @@ void SandeshTaskGroupReq::HandleRequest() const {
 
 void SandeshTaskEntryReq::HandleRequest() const {
     TaskScheduler *scheduler = TaskScheduler::GetInstance();
-    tbb::mutex::scoped_lock lock(scheduler->mutex_);
+    TaskScheduler::ExclusiveLock lock(scheduler);
 
     SandeshTaskEntryResp *resp = new SandeshTaskEntryResp;
     int task_id;
@@ -102,7 +97,7 @@ void SandeshTaskEntryReq::HandleRequest() const {
 
 void SandeshTaskReq::HandleRequest() const {
     TaskScheduler *scheduler = TaskScheduler::GetInstance();
-    tbb::mutex::scoped_lock lock(scheduler->mutex_);
+    TaskScheduler::ExclusiveLock lock(scheduler);
 
     SandeshTaskResp *resp = new SandeshTaskResp;
     int task_id;
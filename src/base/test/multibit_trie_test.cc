@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/multibit_trie.h"
+#include "base/patricia.h"
+#include "base/time_util.h"
+#include "base/util.h"
+#include "testing/gunit.h"
+
+class Route {
+public:
+    Route(const uint8_t *addr, int len, int nexthop)
+        : len_(len), nexthop_(nexthop) {
+        memset(addr_, 0, sizeof(addr_));
+        for (int i = 0; i < (len + 7) / 8; i++) {
+            addr_[i] = addr[i];
+        }
+        if (len % 8) {
+            addr_[len / 8] &= 0xff << (8 - len % 8);
+        }
+    }
+
+    class RtKey {
+    public:
+        static std::size_t BitLength(const Route *route) {
+            return route->len_;
+        }
+
+        static char ByteValue(const Route *route, std::size_t i) {
+            return route->addr_[i];
+        }
+    };
+
+    uint8_t addr_[16];
+    int len_;
+    int nexthop_;
+    Patricia::Node rtnode_;
+};
+
+typedef Patricia::Tree<Route, &Route::rtnode_, Route::RtKey> RouteTree;
+typedef MultibitTrie<Route, Route::RtKey> RouteTrie;
+
+static void ToBytes(uint32_t ip, uint8_t *addr) {
+    for (int i = 0; i < 4; i++) {
+        addr[i] = ip >> (24 - i * 8);
+    }
+}
+
+class MultibitTrieTest : public ::testing::Test {
+protected:
+    MultibitTrieTest() : addr_bytes_(4) {
+        srand(1);
+    }
+
+    virtual void TearDown() {
+        while (!routes_.empty()) {
+            Remove(routes_.size() - 1);
+        }
+        EXPECT_EQ(0U, trie_.size());
+        EXPECT_EQ(1U, trie_.node_count());
+    }
+
+    Route *Add(const uint8_t *addr, int len) {
+        Route *route = new Route(addr, len, routes_.size());
+        if (!tree_.Insert(route)) {
+            delete route;
+            return NULL;
+        }
+        trie_.Insert(route);
+        routes_.push_back(route);
+        return route;
+    }
+
+    Route *AddInet(uint32_t ip, int len) {
+        uint8_t addr[4];
+        ToBytes(ip, addr);
+        return Add(addr, len);
+    }
+
+    void Remove(size_t index) {
+        Route *route = routes_[index];
+        routes_[index] = routes_.back();
+        routes_.pop_back();
+        tree_.Remove(route);
+        trie_.Remove(route);
+        delete route;
+    }
+
+    Route *Lookup(uint32_t ip) {
+        uint8_t addr[4];
+        ToBytes(ip, addr);
+        return trie_.LPMFind(addr, sizeof(addr));
+    }
+
+    void RandomAddress(uint8_t *addr) {
+        for (int i = 0; i < addr_bytes_; i++) {
+            addr[i] = rand();
+        }
+        // Keep addresses close, so that prefixes overlap
+        addr[0] &= 0x3;
+    }
+
+    void AddRandom(size_t count) {
+        int max_len = addr_bytes_ * 8;
+        while (count) {
+            uint8_t addr[16];
+            RandomAddress(addr);
+            int len = rand() % (max_len + 1);
+            if (rand() % 2)
+                len = max_len - len / 4;
+            if (Add(addr, len))
+                count--;
+        }
+    }
+
+    // Compare the trie with the Patricia tree on random addresses and on
+    // the addresses of the routes.
+    void Verify(size_t count) {
+        for (size_t i = 0; i < count + routes_.size(); i++) {
+            Route key(NULL, 0, 0);
+            if (i < count) {
+                RandomAddress(key.addr_);
+            } else {
+                memcpy(key.addr_, routes_[i - count]->addr_,
+                       sizeof(key.addr_));
+            }
+            key.len_ = addr_bytes_ * 8;
+            EXPECT_EQ(tree_.LPMFind(&key), trie_.LPMFind(&key));
+        }
+    }
+
+    int addr_bytes_;
+    RouteTree tree_;
+    RouteTrie trie_;
+    std::vector<Route *> routes_;
+};
+
+TEST_F(MultibitTrieTest, Basic) {
+    EXPECT_TRUE(Lookup(0x0a010101) == NULL);
+
+    Route *r8 = AddInet(0x0a000000, 8);
+    Route *r22 = AddInet(0x0a010000, 22);
+    Route *r24 = AddInet(0x0a010100, 24);
+    Route *r32 = AddInet(0x0a010101, 32);
+    EXPECT_EQ(r32, Lookup(0x0a010101));
+    EXPECT_EQ(r24, Lookup(0x0a010102));
+    EXPECT_EQ(r22, Lookup(0x0a010201));
+    EXPECT_EQ(r8, Lookup(0x0a020101));
+    EXPECT_TRUE(Lookup(0x0b010101) == NULL);
+
+    Route *r0 = AddInet(0x00000000, 0);
+    EXPECT_EQ(r0, Lookup(0x0b010101));
+
+    // Removing a prefix exposes the shorter prefixes covering it
+    Remove(2);
+    EXPECT_EQ(r32, Lookup(0x0a010101));
+    EXPECT_EQ(r22, Lookup(0x0a010102));
+    Remove(1);
+    EXPECT_EQ(r8, Lookup(0x0a010102));
+    EXPECT_EQ(r32, Lookup(0x0a010101));
+}
+
+// Nodes without prefixes are compressed away, and added back when a
+// prefix diverges from or ends within the compressed path.
+TEST_F(MultibitTrieTest, PathCompression) {
+    Route *r32 = AddInet(0x0a010101, 32);
+    EXPECT_EQ(2U, trie_.node_count());
+    EXPECT_TRUE(Lookup(0x0a020101) == NULL);
+    EXPECT_TRUE(Lookup(0x0a010102) == NULL);
+
+    Route *r32_2 = AddInet(0x0a020101, 32);
+    EXPECT_EQ(4U, trie_.node_count());
+    // Ends in the node added where the two host routes diverge
+    Route *r16 = AddInet(0x0a010000, 16);
+    EXPECT_EQ(4U, trie_.node_count());
+    EXPECT_EQ(r32, Lookup(0x0a010101));
+    EXPECT_EQ(r32_2, Lookup(0x0a020101));
+    EXPECT_EQ(r16, Lookup(0x0a010102));
+
+    Remove(1);
+    EXPECT_EQ(3U, trie_.node_count());
+    EXPECT_EQ(r32, Lookup(0x0a010101));
+    EXPECT_EQ(r16, Lookup(0x0a0101ff));
+}
+
+TEST_F(MultibitTrieTest, RandomInet) {
+    AddRandom(20000);
+    Verify(20000);
+    for (int i = 0; i < 10000; i++) {
+        Remove(rand() % routes_.size());
+    }
+    Verify(20000);
+    AddRandom(5000);
+    Verify(20000);
+}
+
+TEST_F(MultibitTrieTest, RandomInet6) {
+    addr_bytes_ = 16;
+    AddRandom(5000);
+    Verify(5000);
+    for (int i = 0; i < 2500; i++) {
+        Remove(rand() % routes_.size());
+    }
+    Verify(5000);
+}
+
+// LPM lookup rate: host routes and subnets in 10.0.0.0/8, looked up with
+// random addresses of the subnets. The default size is small; set
+// MULTIBIT_TRIE_TEST_PREFIX_COUNT=1000000 and
+// MULTIBIT_TRIE_TEST_LOOKUP_COUNT=4000000 for a full run.
+TEST_F(MultibitTrieTest, Benchmark) {
+    size_t prefix_count = 16384;
+    size_t lookup_count = 65536;
+    char *str = getenv("MULTIBIT_TRIE_TEST_PREFIX_COUNT");
+    if (str) prefix_count = strtoul(str, NULL, 0);
+    str = getenv("MULTIBIT_TRIE_TEST_LOOKUP_COUNT");
+    if (str) lookup_count = strtoul(str, NULL, 0);
+
+    AddInet(0x00000000, 0);
+    uint32_t subnet = 0x0a000000;
+    while (routes_.size() < prefix_count) {
+        AddInet(subnet, 24);
+        for (uint32_t host = 1; host < 255; host++) {
+            if (rand() % 4 == 0 && routes_.size() < prefix_count) {
+                AddInet(subnet | host, 32);
+            }
+        }
+        subnet += 0x100;
+    }
+
+    std::vector<Route *> keys;
+    for (size_t i = 0; i < 65536; i++) {
+        uint8_t addr[4];
+        ToBytes(0x0a000000 + rand() % (subnet - 0x0a000000), addr);
+        Route *key = new Route(addr, 32, 0);
+        keys.push_back(key);
+        EXPECT_EQ(tree_.LPMFind(key), trie_.LPMFind(key));
+    }
+
+    size_t found = 0;
+    uint64_t start = ClockMonotonicUsec();
+    for (size_t i = 0; i < lookup_count; i++) {
+        if (tree_.LPMFind(keys[i % keys.size()]))
+            found++;
+    }
+    uint64_t tree_usecs = ClockMonotonicUsec() - start;
+
+    start = ClockMonotonicUsec();
+    for (size_t i = 0; i < lookup_count; i++) {
+        if (trie_.LPMFind(keys[i % keys.size()]))
+            found++;
+    }
+    uint64_t trie_usecs = ClockMonotonicUsec() - start;
+    EXPECT_EQ(2 * lookup_count, found);
+
+    std::cout << lookup_count << " lookups in " << routes_.size()
+              << " prefixes: patricia " << tree_usecs / 1000 << " msec, "
+              << "multibit trie " << trie_usecs / 1000 << " msec, "
+              << trie_.node_count() << " trie nodes" << std::endl;
+    STLDeleteValues(&keys);
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -7,6 +7,8 @@
 #include "tbb/task.h"
 #include "base/task.h"
 #include "base/logging.h"
+#include "base/time_util.h"
+#include "base/test/task_test_util.h"
 #include "testing/gunit.h"
 
 void TestWait(int max);
@@ -43,11 +45,26 @@ int                 expected_state[16][16];
 vector<TestTask *>  task_start_seq_actual;
 vector<TestTask *>  task_start_seq_expected;
 
-class TestUT : public ::testing::Test {
+// Tests run once for each scheduler locking mode. Each mode is a separate
+// test case, run in order, so the scheduler is recreated only when switching
+// modes and policies set by a test remain for the tests that follow it.
+class TestUT : public ::testing::TestWithParam<bool> {
 public:
     TestUT() { cout << "Creating TestTask" << endl; };
     void TestBody() {};
+
+    virtual void SetUp() {
+        if (GetParam() != group_locking_) {
+            scheduler->Terminate();
+            TaskScheduler::SetGroupLocking(GetParam());
+            scheduler = TaskScheduler::GetInstance();
+            group_locking_ = GetParam();
+        }
+    }
+
+    static bool group_locking_;
 };
+bool TestUT::group_locking_;
 
 class TestTask : public Task {
 public:
@@ -384,7 +401,7 @@ void MatchGroupStats(int task_id, int defer_count) {
 }
 
 // Task <1, 1> <1, 2> <2, 1> <3, 1> can run in parallel with no policy
-TEST_F(TestUT, test1_1) 
+TEST_P(TestUT, test1_1) 
 {
     int   test_expected_state[16][16] = {
         {STARTED,           ANY,                ANY},
@@ -415,7 +432,7 @@ TEST_F(TestUT, test1_1)
 
 // Task <1, 1> <1, 1> <2, 1> are started.
 // Only one Task of <1, 1> can run at a time
-TEST_F(TestUT, test1_2) 
+TEST_P(TestUT, test1_2) 
 {
     int    test_expected_state[16][16] = {
         {STARTED,           NOT_STARTED,    ANY},
@@ -443,7 +460,7 @@ TEST_F(TestUT, test1_2)
 
 // Task <1, 1> <1, 1> <1, 1> <1, 1> are started.
 // Only one Task of <1, 1> can run at a time
-TEST_F(TestUT, test1_3) 
+TEST_P(TestUT, test1_3) 
 {
     int    test_expected_state[16][16] = {
         {STARTED,   NOT_STARTED,    NOT_STARTED},
@@ -469,7 +486,7 @@ TEST_F(TestUT, test1_3)
 }
 
 // Task <4, 1> <4, 2> <4, 3> can run in parallel with no matching policy
-TEST_F(TestUT, test2_1) 
+TEST_P(TestUT, test2_1) 
 {
     int    test_expected_state[16][16] = {
         {ANY,   ANY,    ANY},
@@ -505,7 +522,7 @@ TEST_F(TestUT, test2_1)
 }
 
 // Task <5, 1> <6, 2> <7, 1> can run in parallel with policy but no task running
-TEST_F(TestUT, test2_2) 
+TEST_P(TestUT, test2_2) 
 {
     int    test_expected_state[16][16] = {
         {ANY,   ANY,    ANY},
@@ -530,7 +547,7 @@ TEST_F(TestUT, test2_2)
 
 // Task <8, 2> cannot run when <10, 1> is running
 // Task <10, 2> can run when <10, 1> is running
-TEST_F(TestUT, test3_0) 
+TEST_P(TestUT, test3_0) 
 {
     int    test_expected_state[16][16] = {
         {STARTED,           NOT_STARTED,    ANY},
@@ -565,7 +582,7 @@ TEST_F(TestUT, test3_0)
 
 // Task <8, 2> cannot run when <12, 2> is running
 // Task <8, 1> can run when <12, 1> is running
-TEST_F(TestUT, test3_1) 
+TEST_P(TestUT, test3_1) 
 {
     int    test_expected_state[16][16] = {
         {STARTED,           NOT_STARTED,    ANY},
@@ -592,7 +609,7 @@ TEST_F(TestUT, test3_1)
 
 // Task <12, 2> cannot run when <8, 2> is running
 // Task <12, 1> can run when <8, 2> is running
-TEST_F(TestUT, test3_2) 
+TEST_P(TestUT, test3_2) 
 {
     int    test_expected_state[16][16] = {
         {STARTED,           NOT_STARTED,    ANY},
@@ -617,7 +634,7 @@ TEST_F(TestUT, test3_2)
 }
 
 // Task <8, 2> cannot run when <12, 2> or <10, 1> is running
-TEST_F(TestUT, test3_3) 
+TEST_P(TestUT, test3_3) 
 {
     int    test_expected_state[16][16] = {
         {STARTED,           ANY,    NOT_STARTED},
@@ -642,7 +659,7 @@ TEST_F(TestUT, test3_3)
 }
 
 // Task <10, 5> cannot run when <8, 2> or <8, 1> is running
-TEST_F(TestUT, test3_4) 
+TEST_P(TestUT, test3_4) 
 {
     int    test_expected_state[16][16] = {
         {STARTED,           ANY,            NOT_STARTED},
@@ -667,7 +684,7 @@ TEST_F(TestUT, test3_4)
 }
 
 // Task <8, 2> cannot run when <10, 1> or <11, 1> is running
-TEST_F(TestUT, test3_5) 
+TEST_P(TestUT, test3_5) 
 {
     int    test_expected_state[16][16] = {
         {STARTED,           ANY,            NOT_STARTED},
@@ -692,7 +709,7 @@ TEST_F(TestUT, test3_5)
 }
 
 // Multiple instances of Task <20, -1> can be run simultaneously
-TEST_F(TestUT, test4_0) 
+TEST_P(TestUT, test4_0) 
 {
     int    test_expected_state[16][16] = {
         {ANY,   ANY,    ANY},
@@ -726,7 +743,7 @@ TEST_F(TestUT, test4_0)
 
 // Multiple instances of Task <21, -1> are running. Task <20, 1> is run only
 // after both <21, -1> exit
-TEST_F(TestUT, test4_1) 
+TEST_P(TestUT, test4_1) 
 {
     int    test_expected_state[16][16] = {
         {ANY,           ANY,        NOT_STARTED},
@@ -750,7 +767,7 @@ TEST_F(TestUT, test4_1)
 }
 
 // Task <20, -1> cannot run till <23, 3> is running
-TEST_F(TestUT, test4_2) 
+TEST_P(TestUT, test4_2) 
 {
     int    test_expected_state[16][16] = {
         {STARTED,       NOT_STARTED,    NOT_STARTED},
@@ -777,7 +794,7 @@ TEST_F(TestUT, test4_2)
 
 // Multiple instances of Task <20, -1> are running. Task <23, 3> is run only
 // after both <20, -1> exit
-TEST_F(TestUT, test4_3) 
+TEST_P(TestUT, test4_3) 
 {
     int    test_expected_state[16][16] = {
         {ANY,           ANY,        NOT_STARTED},
@@ -803,7 +820,7 @@ TEST_F(TestUT, test4_3)
 
 // Multiple instances of Task <20, -1> are running. Task <21, -1> is run only
 // after both <20, -1> exit
-TEST_F(TestUT, test4_4) 
+TEST_P(TestUT, test4_4) 
 {
     int    test_expected_state[16][16] = {
         {ANY,           ANY,        NOT_STARTED},
@@ -830,7 +847,7 @@ TEST_F(TestUT, test4_4)
 // Test start and stop
 // Enqueue multiple instances of <30, -1> when stopped. On start they should
 // executed
-TEST_F(TestUT, test5_0) 
+TEST_P(TestUT, test5_0) 
 {
     int    test_expected_state[16][16] = {
         {ANY,           ANY,        ANY},
@@ -872,7 +889,7 @@ TEST_F(TestUT, test5_0)
 
 // Enqueue two instances of <30, -1> and <31, -1> when stopped. On start they 
 // should executed
-TEST_F(TestUT, test5_1) 
+TEST_P(TestUT, test5_1) 
 {
     int    test_expected_state[16][16] = {
         {ANY,               ANY,                NOT_STARTED},
@@ -908,7 +925,7 @@ TEST_F(TestUT, test5_1)
 
 // Enqueue two instances of <31, -1> and <30, -1> when stopped. On start they 
 // should executed
-TEST_F(TestUT, test5_2) 
+TEST_P(TestUT, test5_2) 
 {
     int    test_expected_state[16][16] = {
         {ANY,               ANY,                NOT_STARTED},
@@ -951,7 +968,7 @@ TEST_F(TestUT, test5_2)
 // <51, 1> is added in the deferq_ of group <50>  
 // <52, 1> is added in the deferq_ of entry <50, 1>
 // <50, 1> exits => <51, 1> is started and <52, 1> is added to the deferq_ of <51, 1> 
-TEST_F(TestUT, test6_0)
+TEST_P(TestUT, test6_0)
 {
     TaskExclusion        rule1[] = {
         TaskExclusion(51),
@@ -990,7 +1007,7 @@ TEST_F(TestUT, test6_0)
 // <55, 1> is added in the deferq_ of entry <53, 1>
 // <54, 1> is added in the deferq_ of group <53>   
 // <53, 1> exits => <55, 1> is started and <54, 1> is added to the deferq_ of <55, 1> 
-TEST_F(TestUT, test6_1)
+TEST_P(TestUT, test6_1)
 {
     TaskExclusion        rule1[] = {
         TaskExclusion(54),
@@ -1020,7 +1037,7 @@ TEST_F(TestUT, test6_1)
 }
 
 // group->run_count_ non-zero
-TEST_F(TestUT, test6_2)
+TEST_P(TestUT, test6_2)
 {
     TaskExclusion        rule[] = {
         TaskExclusion(60),
@@ -1057,7 +1074,7 @@ TEST_F(TestUT, test6_2)
 // <63, 1>, <64, 1>, <65, 1> is added to the deferq_ of <62, 1>
 // <62, 1> exits. <63, 1> starts and <64, 1>, <65, 1> is added to the deferq_ of <63, 1>
 // <63, 1> exits. <64, 1> starts and <65, 1> is added to the deferq_ of <64, 1>
-TEST_F(TestUT, test6_3)
+TEST_P(TestUT, test6_3)
 {
     TaskExclusion        rule1[] = {
         TaskExclusion(63, 1),
@@ -1099,7 +1116,7 @@ TEST_F(TestUT, test6_3)
 // scheduled only after <71, 1> finishes its first run and the
 // second run of <71, 1> is scheduled only after <70, 1> completes
 // its second run.
-TEST_F(TestUT, test7_0)
+TEST_P(TestUT, test7_0)
 {
     TaskExclusion rule[] = { TaskExclusion(71) };
     TaskPolicy policy;
@@ -1122,7 +1139,7 @@ TEST_F(TestUT, test7_0)
 
 // <72, 1> runs thrice. With no dependent task running, 
 // <72, 1> should get rescheduled immediately. 
-TEST_F(TestUT, test7_1)
+TEST_P(TestUT, test7_1)
 {
     task_ptr[0] = new TestTask(72, 1, 0, 1, 3);
     
@@ -1136,7 +1153,7 @@ TEST_F(TestUT, test7_1)
 
 // Cancel the task in INIT state
 // Cancel the task in RUN state - task_recycle_ -> true
-TEST_F(TestUT, test8_0)
+TEST_P(TestUT, test8_0)
 {
     TaskExclusion rule[] = { TaskExclusion(81) };
     TaskPolicy policy;
@@ -1163,7 +1180,7 @@ TEST_F(TestUT, test8_0)
 }
 
 // Cancel task in RUN state - task_recycle_ -> false
-TEST_F(TestUT, test8_1) 
+TEST_P(TestUT, test8_1) 
 {
     task_ptr[0] = new TestTask(80, -1, 0, 1, 1);
     task_ptr[1] = new TestTask(81, -1, 1, 1, 2);
@@ -1180,7 +1197,7 @@ TEST_F(TestUT, test8_1)
 }
 
 // Cancel task in WAIT state - waitq_ != 0 and waitq_ == 0
-TEST_F(TestUT, test8_2)
+TEST_P(TestUT, test8_2)
 {
     TaskExclusion rule1[] = { TaskExclusion(82) };
     TaskExclusion rule2[] = { TaskExclusion(82, 1) };
@@ -1227,7 +1244,7 @@ TEST_F(TestUT, test8_2)
 }
 
 // Cancel task when scheduler is stopped
-TEST_F(TestUT, test8_3)
+TEST_P(TestUT, test8_3)
 {
     task_ptr[0] = new TestTask(85, 1, 0, 1);
     task_ptr[1] = new TestTask(85, 2, 1, 1);
@@ -1255,7 +1272,7 @@ TEST_F(TestUT, test8_3)
 }
 
 // Cancel task which is a first entry in the waitq_ [Update deferq_task_group_]
-TEST_F(TestUT, test8_4)
+TEST_P(TestUT, test8_4)
 {
     TaskExclusion rule1[] = { TaskExclusion(86), TaskExclusion(87) };
     TaskExclusion rule2[] = { TaskExclusion(87), TaskExclusion(88) };
@@ -1284,7 +1301,7 @@ TEST_F(TestUT, test8_4)
 }
 
 // Cancel task which is a first entry in the waitq_ [Update deferq_task_entry_]
-TEST_F(TestUT, test8_5)
+TEST_P(TestUT, test8_5)
 {
     TaskExclusion rule1[] = { TaskExclusion(89, 2), TaskExclusion(90, 2) };
     TaskExclusion rule2[] = { TaskExclusion(90, 2), TaskExclusion(91, 2) };
@@ -1314,7 +1331,7 @@ TEST_F(TestUT, test8_5)
 
 /* Run a task recycled for n number of times and verify that scheduler IsEmpty 
  * never returns true till the task has run fully */
-TEST_F(TestUT, test9_0)
+TEST_P(TestUT, test9_0)
 {
 #define TEST9_0_MAX_RUNS 2000
     task_ptr[0] = new TestTask(90, 1, 0, 2, TEST9_0_MAX_RUNS);
@@ -1337,7 +1354,7 @@ TEST_F(TestUT, test9_0)
 /* Enqueue tasks which will be recycled. Task 0 and task 1 belong to same
  * taskgroup. Verify that run_count of group does not cause scheduler blockage,
  * if a task exits with its recycle set as true */
-TEST_F(TestUT, test9_1)
+TEST_P(TestUT, test9_1)
 {
     task_ptr[0] = new TestTask(92, 1, 0, 2, 2);
     task_ptr[1] = new TestTask(92, 1, 1, 2, 2);
@@ -1353,6 +1370,224 @@ TEST_F(TestUT, test9_1)
     EXPECT_TRUE(scheduler->IsEmpty());
 }
 
+// Counters shared by the tasks of one group in test10_0
+struct ExclusionGroup {
+    ExclusionGroup() { running = runs = done = 0; }
+    tbb::atomic<int> running;
+    tbb::atomic<int> runs;
+    tbb::atomic<int> done;
+};
+
+// Task that checks that no task of the group it is excluded with runs at the
+// same time, and recycles itself num_runs times. If latch is set, the first
+// run stays in the task, checking the exclusion, until the latch is released.
+class ExclusionTask : public Task {
+public:
+    ExclusionTask(int id, ExclusionGroup *group, ExclusionGroup *excluded,
+                  tbb::atomic<int> *violations, int num_runs,
+                  tbb::atomic<bool> *latch = NULL) :
+        Task(id), group_(group), excluded_(excluded),
+        violations_(violations), num_runs_(num_runs), latch_(latch) {
+    }
+
+    bool Run() {
+        group_->running.fetch_and_increment();
+        group_->runs.fetch_and_increment();
+        CheckExclusion();
+        while (latch_ && !*latch_) {
+            usleep(1000);
+            CheckExclusion();
+        }
+        latch_ = NULL;
+        group_->running.fetch_and_decrement();
+        if (--num_runs_) {
+            return false;
+        }
+        group_->done.fetch_and_increment();
+        return true;
+    }
+
+private:
+    void CheckExclusion() {
+        if (excluded_->running != 0) {
+            violations_->fetch_and_increment();
+        }
+    }
+
+    ExclusionGroup *group_;
+    ExclusionGroup *excluded_;
+    tbb::atomic<int> *violations_;
+    int num_runs_;
+    tbb::atomic<bool> *latch_;
+};
+
+/* Enqueue recycled tasks in two groups that exclude each other, along with
+ * tasks in an unrelated group. While a task of the first group is held
+ * running on a latch, the unrelated group runs to completion and the other
+ * group doesn't run at all. Tasks of the two groups never run concurrently */
+TEST_P(TestUT, test10_0)
+{
+    TaskExclusion rule[] = { TaskExclusion(101) };
+    TaskPolicy policy(rule, rule + 1);
+    scheduler->SetPolicy(100, policy);
+
+    ExclusionGroup group_a, group_b, group_c, idle;
+    tbb::atomic<int> violations;
+    violations = 0;
+    tbb::atomic<bool> latch;
+    latch = false;
+
+    scheduler->Enqueue(new ExclusionTask(100, &group_a, &group_b,
+                                         &violations, 1, &latch));
+    TASK_UTIL_EXPECT_EQ(1, group_a.running);
+
+    const int kTaskCount = 16;
+    for (int i = 0; i < kTaskCount; i++) {
+        scheduler->Enqueue(new ExclusionTask(100, &group_a, &group_b,
+                                             &violations, 100));
+        scheduler->Enqueue(new ExclusionTask(101, &group_b, &group_a,
+                                             &violations, 100));
+        scheduler->Enqueue(new ExclusionTask(102, &group_c, &idle,
+                                             &violations, 100));
+    }
+
+    TASK_UTIL_EXPECT_EQ(kTaskCount, group_c.done);
+    EXPECT_EQ(0, group_b.runs);
+    EXPECT_EQ(1, group_a.running);
+
+    latch = true;
+    TASK_UTIL_EXPECT_EQ(kTaskCount + 1, group_a.done);
+    TASK_UTIL_EXPECT_EQ(kTaskCount, group_b.done);
+    EXPECT_EQ(0, violations);
+    task_util::WaitForIdle();
+    EXPECT_TRUE(scheduler->IsEmpty());
+}
+
+// Task that recycles itself num_runs times, without doing any work.
+class BenchmarkTask : public Task {
+public:
+    BenchmarkTask(int id, tbb::atomic<int> *done, int num_runs) :
+        Task(id), done_(done), num_runs_(num_runs) {
+    }
+
+    bool Run() {
+        if (--num_runs_) {
+            return false;
+        }
+        done_->fetch_and_increment();
+        return true;
+    }
+
+private:
+    tbb::atomic<int> *done_;
+    int num_runs_;
+};
+
+/* Measure the throughput of task enqueue and exit with tasks spread across
+ * 1..N unrelated groups. The results are printed only when one of the
+ * TASK_TEST_BENCHMARK variables is set */
+TEST_P(TestUT, test10_1)
+{
+    int max_groups = 8;
+    int tasks_per_group = 8;
+    int num_runs = 10000;
+    bool report = false;
+    char *str = getenv("TASK_TEST_BENCHMARK_GROUP_COUNT");
+    if (str) {
+        max_groups = strtoul(str, NULL, 0);
+        report = true;
+    }
+    str = getenv("TASK_TEST_BENCHMARK_RUN_COUNT");
+    if (str) {
+        num_runs = strtoul(str, NULL, 0);
+        report = true;
+    }
+
+    for (int groups = 1; groups <= max_groups; groups *= 2) {
+        tbb::atomic<int> done;
+        done = 0;
+        uint64_t start = ClockMonotonicUsec();
+        for (int i = 0; i < tasks_per_group; i++) {
+            for (int id = 0; id < groups; id++) {
+                scheduler->Enqueue(new BenchmarkTask(110 + id, &done,
+                                                     num_runs));
+            }
+        }
+        TASK_UTIL_EXPECT_EQ(groups * tasks_per_group, done);
+        uint64_t usecs = ClockMonotonicUsec() - start + 1;
+
+        if (!report) {
+            continue;
+        }
+        uint64_t runs = uint64_t(groups) * tasks_per_group * num_runs;
+        LOG(DEBUG, "Group locking " << scheduler->group_locking() << ", "
+            << groups << " groups: " << runs << " task runs in " << usecs
+            << " usecs, " << runs * 1000000 / usecs << " tasks/sec");
+    }
+    task_util::WaitForIdle();
+    EXPECT_TRUE(scheduler->IsEmpty());
+}
+
+// Task that sleeps for sleep_usecs on each of its num_runs runs.
+class SleepTask : public Task {
+public:
+    SleepTask(int id, int inst, int sleep_usecs, int num_runs) :
+        Task(id, inst), sleep_usecs_(sleep_usecs), num_runs_(num_runs) {
+    }
+
+    bool Run() {
+        usleep(sleep_usecs_);
+        return (--num_runs_ == 0);
+    }
+
+private:
+    int sleep_usecs_;
+    int num_runs_;
+};
+
+/* Verify the wait and run time histograms and the slow task count of a
+ * recycled task */
+TEST_P(TestUT, test10_2)
+{
+    TaskHistogram histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    histogram.Add(0);
+    histogram.Add(1);
+    histogram.Add(1000);
+    histogram.Add(1ULL << 40);
+    EXPECT_EQ(4U, histogram.count_);
+    EXPECT_EQ(1U, histogram.buckets_[0]);
+    EXPECT_EQ(1U, histogram.buckets_[1]);
+    EXPECT_EQ(1U, histogram.buckets_[10]);
+    EXPECT_EQ(1U, histogram.buckets_[TaskHistogram::kBucketCount - 1]);
+    EXPECT_EQ(1ULL << 40, histogram.max_usecs_);
+
+    scheduler->ClearTaskStats(120, 1);
+    scheduler->ClearTaskGroupStats(120);
+    scheduler->SetSlowTaskThreshold(1000);
+    scheduler->Enqueue(new SleepTask(120, 1, 5000, 4));
+    for (int i = 0; i < 1000 && !scheduler->IsEmpty(); i++) {
+        usleep(1000);
+    }
+    scheduler->SetSlowTaskThreshold(0);
+    EXPECT_TRUE(scheduler->IsEmpty());
+
+    TaskStats *stats = scheduler->GetTaskStats(120, 1);
+    EXPECT_EQ(4, stats->run_count_);
+    EXPECT_EQ(4, stats->slow_count_);
+    EXPECT_EQ(4U, stats->wait_time_.count_);
+    EXPECT_EQ(4U, stats->run_time_.count_);
+    EXPECT_LE(4U * 5000, stats->run_time_.total_usecs_);
+    EXPECT_LE(5000U, stats->run_time_.max_usecs_);
+
+    stats = scheduler->GetTaskGroupStats(120);
+    EXPECT_EQ(4, stats->slow_count_);
+    EXPECT_EQ(4U, stats->run_time_.count_);
+}
+
+INSTANTIATE_TEST_CASE_P(Default, TestUT, ::testing::Values(false));
+INSTANTIATE_TEST_CASE_P(GroupLocking, TestUT, ::testing::Values(true));
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -8,6 +8,7 @@
 #include "io/test/event_manager_test.h"
 #include "base/test/task_test_util.h"
 #include "base/logging.h"
+#include "base/time_util.h"
 #include "base/timer.h"
 #include "testing/gunit.h"
 
@@ -27,9 +28,10 @@ public:
         count_++;
     }
 
-    TimerTest(boost::asio::io_service &service, const std::string &name)
+    TimerTest(boost::asio::io_service &service, const std::string &name,
+              Timer::Backend backend = Timer::DefaultBackend)
         : Timer(service, name, Timer::GetTimerTaskId(),
-                Timer::GetTimerInstanceId()) {
+                Timer::GetTimerInstanceId(), false, backend) {
         TimerManager::AddTimer(this);
         count_++;
     }
@@ -346,6 +348,126 @@ TEST_F(TimerUT, reschedule_failed_2) {
     EXPECT_TRUE(TimerManager::DeleteTimer(timer));
 }
 
+TEST_F(TimerUT, wheel_basic_1) {
+    vector<TimerTest *> timers;
+    for (int i = 0; i < 5; i++) {
+        timers.push_back(new TimerTest(*evm_->io_service(), "Wheel-Basic",
+                                       Timer::WheelBackend));
+        EXPECT_EQ(Timer::WheelBackend, timers.back()->backend());
+    }
+    uint64_t start = ClockMonotonicUsec();
+    for (int i = 0; i < 5; i++) {
+        timers[i]->Start(20 * (i + 1), TimerCb);
+    }
+    TASK_UTIL_EXPECT_EQ(5, timer_count_);
+
+    // Timers on the wheel never fire early
+    EXPECT_GE(ClockMonotonicUsec() - start, 100 * 1000);
+    task_util::WaitForIdle();
+    for (int i = 0; i < 5; i++) {
+        EXPECT_TRUE(TimerManager::DeleteTimer(timers[i]));
+    }
+}
+
+TEST_F(TimerUT, wheel_periodic_1) {
+    TimerTest *timer1 = new TimerTest(*evm_->io_service(), "Wheel-Periodic",
+                                      Timer::WheelBackend);
+    timer_count_ = 20;
+    timer1->Start(1, PeriodicTimerCb);
+    TASK_UTIL_EXPECT_EQ(0, timer_count_);
+    task_util::WaitForIdle();
+    EXPECT_TRUE(TimerManager::DeleteTimer(timer1));
+}
+
+TEST_F(TimerUT, wheel_cancel_1) {
+    TimerTest *timer1 = new TimerTest(*evm_->io_service(), "Wheel-Cancel-1",
+                                      Timer::WheelBackend);
+    TimerTest *timer2 = new TimerTest(*evm_->io_service(), "Wheel-Cancel-2",
+                                      Timer::WheelBackend);
+    timer1->Start(20, TimerCb);
+    timer2->Start(5000, TimerCb);
+    EXPECT_TRUE(timer1->Cancel());
+    ValidateTimerCount(0, 100);
+
+    timer1->Start(20, TimerCb);
+    ValidateTimerCount(1, 100);
+
+    // Deleting a timer that is still on the wheel frees it right away
+    task_util::WaitForIdle();
+    EXPECT_TRUE(TimerManager::DeleteTimer(timer1));
+    EXPECT_TRUE(TimerManager::DeleteTimer(timer2));
+    TASK_UTIL_EXPECT_EQ(0, TimerTest::count_);
+}
+
+TEST_F(TimerUT, wheel_default_backend) {
+    TimerManager::SetDefaultBackend(Timer::WheelBackend);
+    TimerTest *timer1 = new TimerTest(*evm_->io_service(), "Wheel-Default");
+    TimerManager::SetDefaultBackend(Timer::AsioBackend);
+    TimerTest *timer2 = new TimerTest(*evm_->io_service(), "Asio-Default");
+    EXPECT_EQ(Timer::WheelBackend, timer1->backend());
+    EXPECT_EQ(Timer::AsioBackend, timer2->backend());
+    timer1->Start(10, TimerCb);
+    timer2->Start(10, TimerCb);
+    ValidateTimerCount(2, 20);
+    task_util::WaitForIdle();
+    EXPECT_TRUE(TimerManager::DeleteTimer(timer1));
+    EXPECT_TRUE(TimerManager::DeleteTimer(timer2));
+}
+
+//
+// Start, cancel and fire a number of active timers with each backend. The
+// default count is small; set TIMER_TEST_SCALE_COUNT=100000 for a full run.
+//
+TEST_F(TimerUT, scale_benchmark) {
+    int timer_count = 1000;
+    char *str = getenv("TIMER_TEST_SCALE_COUNT");
+    if (str) timer_count = strtoul(str, NULL, 0);
+
+    Timer::Backend backends[] = { Timer::AsioBackend, Timer::WheelBackend };
+    const char *names[] = { "asio", "wheel" };
+    for (int b = 0; b < 2; b++) {
+        vector<TimerTest *> timers;
+        timers.reserve(timer_count);
+        for (int i = 0; i < timer_count; i++) {
+            timers.push_back(new TimerTest(*evm_->io_service(), "Scale",
+                                           backends[b]));
+        }
+
+        // Start and cancel with all the timers active
+        uint64_t start = ClockMonotonicUsec();
+        for (int i = 0; i < timer_count; i++) {
+            timers[i]->Start(60000 + i % 1000, TimerCb);
+        }
+        uint64_t start_usecs = ClockMonotonicUsec() - start + 1;
+
+        start = ClockMonotonicUsec();
+        for (int i = 0; i < timer_count; i++) {
+            EXPECT_TRUE(timers[i]->Cancel());
+        }
+        uint64_t cancel_usecs = ClockMonotonicUsec() - start + 1;
+
+        // Let all the timers fire, spread over a second
+        timer_count_ = 0;
+        start = ClockMonotonicUsec();
+        for (int i = 0; i < timer_count; i++) {
+            timers[i]->Start(100 + i % 1000, TimerCb);
+        }
+        TASK_UTIL_EXPECT_EQ(timer_count, timer_count_);
+        uint64_t fire_usecs = ClockMonotonicUsec() - start + 1;
+
+        task_util::WaitForIdle();
+        for (int i = 0; i < timer_count; i++) {
+            EXPECT_TRUE(TimerManager::DeleteTimer(timers[i]));
+        }
+        TASK_UTIL_EXPECT_EQ(0, TimerTest::count_);
+
+        LOG(DEBUG, names[b] << ": " << timer_count << " timers, start " <<
+            timer_count * 1000000ULL / start_usecs << " timers/sec, cancel " <<
+            timer_count * 1000000ULL / cancel_usecs << " timers/sec, fired in "
+            << fire_usecs / 1000 << " msecs");
+    }
+}
+
 int main(int argc, char *argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     // Run timer test with one thread
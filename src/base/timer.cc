@@ -4,6 +4,7 @@
 
 #include "base/timer.h"
 #include "base/timer_impl.h"
+#include "base/timer_wheel.h"
 
 class Timer::TimerTask : public Task {
 public:
@@ -75,8 +76,13 @@ private:
 };
 
 Timer::Timer(boost::asio::io_service &service, const std::string &name,
-          int task_id, int task_instance, bool delete_on_completion)
-        : impl_(new TimerImpl(service)),
+          int task_id, int task_instance, bool delete_on_completion,
+          Backend backend)
+        : wheel_(NULL),
+          wheel_expiry_(0),
+          wheel_time_(0),
+          wheel_seq_no_(0),
+          backend_(backend),
           name_(name),
           handler_(NULL),
           error_handler_(NULL),
@@ -88,6 +94,14 @@ Timer::Timer(boost::asio::io_service &service, const std::string &name,
           seq_no_(0),
           delete_on_completion_(delete_on_completion) {
     refcount_ = 0;
+    if (backend_ == DefaultBackend) {
+        backend_ = TimerManager::default_backend();
+    }
+    if (backend_ == WheelBackend) {
+        wheel_ = &boost::asio::use_service<TimerWheel>(service);
+    } else {
+        impl_.reset(new TimerImpl(service));
+    }
 }
 
 Timer::~Timer() {
@@ -114,6 +128,14 @@ bool Timer::Start(int time, Handler handler, ErrorHandler error_handler) {
     handler_ = handler;
     seq_no_++;
     error_handler_ = error_handler;
+
+    if (wheel_) {
+        SetState(Running);
+        wheel_->Remove(this);
+        wheel_->Add(this, time, seq_no_);
+        return true;
+    }
+
     boost::system::error_code ec;
     impl_->expires_from_now(time, ec);
     if (ec) {
@@ -157,6 +179,12 @@ bool Timer::Cancel() {
         timer_task_ = NULL;
     }
 
+    // Release the wheel's reference right away, unlike the ASIO backend
+    // where the cancelled timer stays in the ASIO queue until it expires.
+    if (wheel_) {
+        wheel_->Remove(this);
+    }
+
     SetState(Cancelled);
     return true;
 }
@@ -191,16 +219,23 @@ void Timer::StartTimerTask(TimerPtr reference, int time, uint32_t seq_no,
 //
 TimerManager::TimerSet TimerManager::timer_ref_;
 tbb::mutex TimerManager::mutex_;
+Timer::Backend TimerManager::default_backend_ = Timer::AsioBackend;
 
 Timer *TimerManager::CreateTimer(
             boost::asio::io_service &service, const std::string &name,
-            int task_id, int task_instance, bool delete_on_completion) {
+            int task_id, int task_instance, bool delete_on_completion,
+            Timer::Backend backend) {
     Timer *timer = new Timer(service, name, task_id, task_instance,
-                             delete_on_completion);
+                             delete_on_completion, backend);
     AddTimer(timer);
     return timer;
 }
 
+void TimerManager::SetDefaultBackend(Timer::Backend backend) {
+    assert(backend != Timer::DefaultBackend);
+    default_backend_ = backend;
+}
+
 void TimerManager::AddTimer(Timer *timer) {
     tbb::mutex::scoped_lock lock(mutex_);
     timer_ref_.insert(TimerPtr(timer));
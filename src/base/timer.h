@@ -6,6 +6,11 @@
 //  Registers an ASIO timer. On ASIO timer expiry, a task will be created to
 //  run the timer. Supports user specified task-id.
 //
+//  Timers can alternatively be backed by the TimerWheel of their io_service,
+//  which keeps all of them on a single ASIO timer. The backend is selected
+//  per timer when it is created, or process wide via
+//  TimerManager::SetDefaultBackend().
+//
 //  Operations supported
 //  - Create a timer by allocating an object of type Timer
 //  - Start a timer
@@ -40,6 +45,7 @@
 
 #include <boost/asio/placeholders.hpp>
 #include <boost/bind.hpp>
+#include <boost/intrusive/list_hook.hpp>
 #include <boost/intrusive_ptr.hpp>
 #include <boost/function.hpp>
 #include <boost/asio.hpp>
@@ -49,6 +55,7 @@
 #include <base/task.h>
 
 class TimerImpl;
+class TimerWheel;
 
 class Timer {
 private:
@@ -60,8 +67,15 @@ public:
     typedef boost::function<void(std::string, std::string, std::string)>
         ErrorHandler;
 
+    enum Backend {
+        DefaultBackend  = 0,    // TimerManager::default_backend()
+        AsioBackend     = 1,    // One ASIO timer per Timer
+        WheelBackend    = 2,    // TimerWheel of the io_service
+    };
+
     Timer(boost::asio::io_service &service, const std::string &name,
-          int task_id, int task_instance, bool delete_on_completion = false);
+          int task_id, int task_instance, bool delete_on_completion = false,
+          Backend backend = DefaultBackend);
     virtual ~Timer();
 
     // Start a timer
@@ -101,6 +115,8 @@ public:
         return delete_on_completion_;
     }
 
+    Backend backend() const { return backend_; }
+
     // Only for state machine test
     // XXX: Don't use in production code
     void Fire() { 
@@ -115,6 +131,7 @@ public:
 private:
     friend class TimerManager;
     friend class TimerTest;
+    friend class TimerWheel;
 
     friend void intrusive_ptr_add_ref(Timer *timer);
     friend void intrusive_ptr_release(Timer *timer);
@@ -144,7 +161,16 @@ private:
         return timer_task_id;
     }
 
-    std::auto_ptr<TimerImpl> impl_;
+    typedef boost::intrusive::list_member_hook<
+        boost::intrusive::link_mode<boost::intrusive::auto_unlink> > WheelHook;
+
+    std::auto_ptr<TimerImpl> impl_;         // NULL for the wheel backend
+    TimerWheel *wheel_;                     // NULL for the ASIO backend
+    WheelHook wheel_node_;                  // Linked while on the wheel
+    uint64_t wheel_expiry_;                 // Wheel tick of expiry
+    int wheel_time_;
+    uint32_t wheel_seq_no_;
+    Backend backend_;
     std::string name_;
     Handler handler_;
     ErrorHandler error_handler_;
@@ -188,9 +214,14 @@ public:
                               const std::string &name,
                               int task_id = Timer::GetTimerTaskId(),
                               int task_instance = Timer::GetTimerInstanceId(),
-                              bool delete_on_completion = false);
+                              bool delete_on_completion = false,
+                              Timer::Backend backend = Timer::DefaultBackend);
     static bool DeleteTimer(Timer *Timer);
 
+    // Backend used by timers created with Timer::DefaultBackend
+    static void SetDefaultBackend(Timer::Backend backend);
+    static Timer::Backend default_backend() { return default_backend_; }
+
 private:
     friend class TimerTest;
 
@@ -206,6 +237,7 @@ private:
 
     static tbb::mutex mutex_;
     static TimerSet timer_ref_;
+    static Timer::Backend default_backend_;
 };
 
 #endif /* TIMER_H_ */
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/timer_wheel.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include "base/time_util.h"
+#include "base/timer_impl.h"
+
+static const uint64_t kTickUsecs = TimerWheel::kTickMsec * 1000;
+
+boost::asio::io_service::id TimerWheel::id;
+
+TimerWheel::TimerWheel(boost::asio::io_service &io_service)
+    : boost::asio::io_service::service(io_service),
+      tick_timer_(new TimerImpl(io_service)),
+      start_usecs_(ClockMonotonicUsec()),
+      next_tick_(0),
+      count_(0),
+      tick_running_(false) {
+}
+
+TimerWheel::~TimerWheel() {
+    assert(count_ == 0);
+}
+
+// Release all the timers still on the wheel. Their callbacks are not invoked.
+void TimerWheel::shutdown_service() {
+    std::vector<Timer::TimerPtr> timers;
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        boost::system::error_code ec;
+        tick_timer_->cancel(ec);
+        for (int level = 0; level < kLevelCount; level++) {
+            for (int index = 0; index < kSlotCount; index++) {
+                TimerList &slot = slots_[level][index];
+                while (!slot.empty()) {
+                    Timer *timer = &slot.front();
+                    slot.pop_front();
+                    timers.push_back(Timer::TimerPtr(timer, false));
+                }
+            }
+        }
+        count_ = 0;
+    }
+}
+
+uint64_t TimerWheel::TickAt(uint64_t usecs) const {
+    return (usecs - start_usecs_) / kTickUsecs;
+}
+
+size_t TimerWheel::size() const {
+    tbb::mutex::scoped_lock lock(mutex_);
+    return count_;
+}
+
+void TimerWheel::Add(Timer *timer, int time, uint32_t seq_no) {
+    uint64_t now = ClockMonotonicUsec();
+    tbb::mutex::scoped_lock lock(mutex_);
+
+    // An empty wheel skips the ticks that elapsed while it was idle.
+    if (count_ == 0 && TickAt(now) > next_tick_) {
+        next_tick_ = TickAt(now);
+    }
+
+    // Round up to a tick boundary
+    uint64_t expiry = (now - start_usecs_ + time * 1000ULL + kTickUsecs - 1) /
+        kTickUsecs;
+    timer->wheel_expiry_ = std::max(expiry, next_tick_);
+    timer->wheel_time_ = time;
+    timer->wheel_seq_no_ = seq_no;
+    intrusive_ptr_add_ref(timer);
+    Insert(timer);
+    count_++;
+
+    if (!tick_running_) {
+        StartTick(now);
+    }
+}
+
+void TimerWheel::Remove(Timer *timer) {
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        if (!timer->wheel_node_.is_linked()) {
+            return;
+        }
+        timer->wheel_node_.unlink();
+        count_--;
+    }
+
+    // The caller holds its own reference.
+    intrusive_ptr_release(timer);
+}
+
+//
+// Link the timer into the slot of the lowest level that covers its expiry.
+// Expiries beyond the range of the top level are parked in the farthest
+// slot of the top level and cascaded again until they come in range.
+//
+void TimerWheel::Insert(Timer *timer) {
+    uint64_t expiry = timer->wheel_expiry_;
+    uint64_t delta = expiry - next_tick_;
+    int level = 0;
+    while (level < kLevelCount - 1 &&
+           delta >= (1ULL << (kLevelBits * (level + 1)))) {
+        level++;
+    }
+    uint64_t range = 1ULL << (kLevelBits * kLevelCount);
+    if (delta >= range) {
+        expiry = next_tick_ + range - 1;
+    }
+    int index = (expiry >> (kLevelBits * level)) & (kSlotCount - 1);
+    slots_[level][index].push_back(*timer);
+}
+
+void TimerWheel::Cascade(int level, int index) {
+    TimerList list;
+    list.splice(list.end(), slots_[level][index]);
+    while (!list.empty()) {
+        Timer *timer = &list.front();
+        list.pop_front();
+        Insert(timer);
+    }
+}
+
+// Run next_tick_, moving the timers that expire on it to the expired list.
+void TimerWheel::RunTick(ExpiredList *expired) {
+    int index = next_tick_ & (kSlotCount - 1);
+    for (int level = 1; index == 0 && level < kLevelCount; level++) {
+        index = (next_tick_ >> (kLevelBits * level)) & (kSlotCount - 1);
+        Cascade(level, index);
+    }
+
+    TimerList &slot = slots_[0][next_tick_ & (kSlotCount - 1)];
+    while (!slot.empty()) {
+        Timer *timer = &slot.front();
+        slot.pop_front();
+        count_--;
+        expired->push_back(Expired(timer));
+    }
+}
+
+void TimerWheel::StartTick(uint64_t now) {
+    uint64_t tick_usecs = start_usecs_ + next_tick_ * kTickUsecs;
+    int time = 0;
+    if (tick_usecs > now) {
+        time = (tick_usecs - now + 999) / 1000;
+    }
+    boost::system::error_code ec;
+    tick_timer_->expires_from_now(time, ec);
+    tick_timer_->async_wait(
+        boost::bind(&TimerWheel::TickHandler, this,
+                    boost::asio::placeholders::error));
+    tick_running_ = true;
+}
+
+void TimerWheel::TickHandler(const boost::system::error_code &ec) {
+    if (ec && ec.value() == boost::asio::error::operation_aborted) {
+        return;
+    }
+
+    ExpiredList expired;
+    {
+        uint64_t now = ClockMonotonicUsec();
+        tbb::mutex::scoped_lock lock(mutex_);
+        tick_running_ = false;
+
+        // Catch up on all the ticks that are due.
+        uint64_t current = TickAt(now);
+        while (count_ && next_tick_ <= current) {
+            RunTick(&expired);
+            next_tick_++;
+        }
+        if (count_) {
+            StartTick(now);
+        }
+    }
+
+    // Schedule the timer tasks outside the wheel mutex, as the timer mutex
+    // is taken before the wheel mutex.
+    boost::system::error_code success;
+    for (ExpiredList::iterator it = expired.begin(); it != expired.end();
+         ++it) {
+        Timer *timer = it->reference.get();
+        timer->StartTimerTask(it->reference, it->time, it->seq_no, success);
+    }
+}
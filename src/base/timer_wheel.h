@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef BASE_TIMER_WHEEL_H_
+#define BASE_TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/intrusive/list.hpp>
+#include <tbb/mutex.h>
+
+#include "base/timer.h"
+#include "base/util.h"
+
+class TimerImpl;
+
+//
+// Hierarchical timing wheel shared by all the wheel backed timers of an
+// io_service.
+//
+// The wheel has kLevelCount levels of kSlotCount slots. Slots of level 0 are
+// one tick apart, and each slot of level n spans a full turn of level n - 1.
+// A timer is linked into the slot of the lowest level that covers its expiry
+// tick, so starting and cancelling a timer is O(1) whatever the number of
+// active timers. When the tick index of a level wraps around, the current
+// slot of the next level is cascaded i.e. its timers are redistributed over
+// the lower levels.
+//
+// A single ASIO timer drives the wheel while it holds any timers. All the
+// timers expiring on a tick are collected in one pass under the wheel mutex
+// and then handed to Timer::StartTimerTask, which schedules their TimerTask
+// exactly as on expiry of an ASIO backed timer. Expiry is rounded up to the
+// next tick so that a timer never fires early.
+//
+// The wheel is an io_service service, created on first use and destroyed
+// along with its io_service.
+//
+class TimerWheel : public boost::asio::io_service::service {
+public:
+    static boost::asio::io_service::id id;
+
+    static const int kTickMsec = 10;
+    static const int kLevelBits = 6;
+    static const int kSlotCount = 1 << kLevelBits;
+    static const int kLevelCount = 4;
+
+    explicit TimerWheel(boost::asio::io_service &io_service);
+    virtual ~TimerWheel();
+
+    // Add and Remove are called with the timer mutex held. The wheel holds
+    // a reference to the timer while the timer is linked.
+    void Add(Timer *timer, int time, uint32_t seq_no);
+    void Remove(Timer *timer);
+
+    // Number of timers on the wheel
+    size_t size() const;
+
+private:
+    typedef boost::intrusive::member_hook<Timer, Timer::WheelHook,
+            &Timer::wheel_node_> TimerListMember;
+    typedef boost::intrusive::list<Timer, TimerListMember,
+            boost::intrusive::constant_time_size<false> > TimerList;
+
+    struct Expired {
+        Expired(Timer *timer)
+            : reference(timer, false), time(timer->wheel_time_),
+              seq_no(timer->wheel_seq_no_) {
+        }
+        Timer::TimerPtr reference;
+        int time;
+        uint32_t seq_no;
+    };
+    typedef std::vector<Expired> ExpiredList;
+
+    virtual void shutdown_service();
+
+    uint64_t TickAt(uint64_t usecs) const;
+    void Insert(Timer *timer);
+    void Cascade(int level, int index);
+    void RunTick(ExpiredList *expired);
+    void StartTick(uint64_t now);
+    void TickHandler(const boost::system::error_code &ec);
+
+    mutable tbb::mutex mutex_;
+    std::auto_ptr<TimerImpl> tick_timer_;
+    uint64_t start_usecs_;      // Start time of tick 0
+    uint64_t next_tick_;        // Next tick to be run
+    size_t count_;
+    bool tick_running_;
+    TimerList slots_[kLevelCount][kSlotCount];
+
+    DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+#endif  // BASE_TIMER_WHEEL_H_
@@ -120,7 +120,13 @@ public:
 
     friend std::size_t hash_value(AsPath const &as_path) {
         size_t hash = 0;
-        boost::hash_combine(hash, as_path.path().ToString());
+        const AsPathSpec &spec = as_path.path();
+        for (size_t i = 0; i < spec.path_segments.size(); i++) {
+            const AsPathSpec::PathSegment *ps = spec.path_segments[i];
+            boost::hash_combine(hash, ps->path_segment_type);
+            boost::hash_range(hash, ps->path_segment.begin(),
+                              ps->path_segment.end());
+        }
         return hash;
     }
 
@@ -154,14 +160,8 @@ inline void intrusive_ptr_release(const AsPath *cpath) {
 
 typedef boost::intrusive_ptr<const AsPath> AsPathPtr;
 
-struct AsPathCompare {
-    bool operator()(const AsPath *lhs, const AsPath *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class AsPathDB : public BgpPathAttributeDB<AsPath, AsPathPtr, AsPathSpec,
-                                           AsPathCompare, AsPathDB> {
+                                           AsPathDB> {
 public:
     explicit AsPathDB(BgpServer *server);
 
@@ -596,6 +596,7 @@ BgpAttr::BgpAttr()
       med_(0), local_pref_(0), atomic_aggregate_(false),
       aggregator_as_num_(0), params_(0) {
     refcount_ = 0;
+    wire_encoding_ = NULL;
 }
 
 BgpAttr::BgpAttr(BgpAttrDB *attr_db)
@@ -603,6 +604,7 @@ BgpAttr::BgpAttr(BgpAttrDB *attr_db)
       nexthop_(), med_(0), local_pref_(0), atomic_aggregate_(false),
       aggregator_as_num_(0), params_(0) {
     refcount_ = 0;
+    wire_encoding_ = NULL;
 }
 
 BgpAttr::BgpAttr(BgpAttrDB *attr_db, const BgpAttrSpec &spec)
@@ -612,6 +614,7 @@ BgpAttr::BgpAttr(BgpAttrDB *attr_db, const BgpAttrSpec &spec)
       atomic_aggregate_(false),
       aggregator_as_num_(0), aggregator_address_(), params_(0) {
     refcount_ = 0;
+    wire_encoding_ = NULL;
     for (std::vector<BgpAttribute *>::const_iterator it = spec.begin();
          it < spec.end(); it++) {
         (*it)->ToCanonical(this);
@@ -637,6 +640,48 @@ BgpAttr::BgpAttr(const BgpAttr &rhs)
       olist_(rhs.olist_),
       leaf_olist_(rhs.leaf_olist_) {
     refcount_ = 0;
+    wire_encoding_ = NULL;
+}
+
+BgpAttr::~BgpAttr() {
+    BgpAttrWireEncoding *encoding = wire_encoding_;
+    while (encoding) {
+        BgpAttrWireEncoding *next = encoding->next;
+        delete encoding;
+        encoding = next;
+    }
+}
+
+const BgpAttrWireEncoding *BgpAttr::GetWireEncoding(uint16_t afi,
+                                                    uint8_t safi) const {
+    for (const BgpAttrWireEncoding *encoding = wire_encoding_; encoding;
+         encoding = encoding->next) {
+        if (encoding->afi == afi && encoding->safi == safi)
+            return encoding;
+    }
+    return NULL;
+}
+
+//
+// Add an encoding to the list in a lock-free manner, as multiple threads
+// may be building UPDATEs with the same attribute. If another thread has
+// already added an encoding for the same afi/safi, the passed in encoding
+// is freed and the existing one is returned.
+//
+const BgpAttrWireEncoding *BgpAttr::AddWireEncoding(
+    BgpAttrWireEncoding *encoding) const {
+    while (true) {
+        BgpAttrWireEncoding *head = wire_encoding_;
+        const BgpAttrWireEncoding *existing =
+            GetWireEncoding(encoding->afi, encoding->safi);
+        if (existing) {
+            delete encoding;
+            return existing;
+        }
+        encoding->next = head;
+        if (wire_encoding_.compare_and_swap(encoding, head) == head)
+            return encoding;
+    }
 }
 
 void BgpAttr::set_as_path(const AsPathSpec *spec) {
@@ -763,39 +808,48 @@ int BgpAttr::CompareTo(const BgpAttr &rhs) const {
     return 0;
 }
 
+static void HashIpAddress(size_t *hash, const IpAddress &address) {
+    if (address.is_v4()) {
+        boost::hash_combine(*hash, address.to_v4().to_ulong());
+    } else {
+        Ip6Address::bytes_type bytes = address.to_v6().to_bytes();
+        boost::hash_range(*hash, bytes.begin(), bytes.end());
+    }
+}
+
+//
+// Hash the attribute without converting any of its fields to strings.
+//
+// The label block and all the interned attributes are compared by pointer
+// in CompareTo(), so they are hashed by pointer as well.
+//
 std::size_t hash_value(BgpAttr const &attr) {
     size_t hash = 0;
 
     boost::hash_combine(hash, attr.origin_);
-    boost::hash_combine(hash, attr.nexthop_.to_string());
+    HashIpAddress(&hash, attr.nexthop_);
     boost::hash_combine(hash, attr.med_);
     boost::hash_combine(hash, attr.local_pref_);
     boost::hash_combine(hash, attr.atomic_aggregate_);
     boost::hash_combine(hash, attr.aggregator_as_num_);
-    boost::hash_combine(hash, attr.aggregator_address_.to_string());
-    boost::hash_combine(hash, attr.originator_id_.to_string());
+    HashIpAddress(&hash, attr.aggregator_address_);
+    boost::hash_combine(hash, attr.originator_id_.to_ulong());
     boost::hash_combine(hash, attr.params_);
-    boost::hash_combine(hash, attr.source_rd_.ToString());
-    boost::hash_combine(hash, attr.esi_.ToString());
-
-    if (attr.label_block_) {
-        boost::hash_combine(hash, attr.label_block_->first());
-        boost::hash_combine(hash, attr.label_block_->last());
-    }
-
-    if (attr.olist_) {
-        boost::hash_range(hash, attr.olist_->elements.begin(),
-                          attr.olist_->elements.end());
-    }
-    if (attr.leaf_olist_) {
-        boost::hash_range(hash, attr.leaf_olist_->elements.begin(),
-                          attr.leaf_olist_->elements.end());
-    }
-
-    if (attr.as_path_) boost::hash_combine(hash, *attr.as_path_);
-    if (attr.community_) boost::hash_combine(hash, *attr.community_);
-    if (attr.ext_community_) boost::hash_combine(hash, *attr.ext_community_);
-    if (attr.origin_vn_path_) boost::hash_combine(hash, *attr.origin_vn_path_);
+    boost::hash_range(hash, attr.source_rd_.GetData(),
+                      attr.source_rd_.GetData() + RouteDistinguisher::kSize);
+    boost::hash_range(hash, attr.esi_.GetData(),
+                      attr.esi_.GetData() + EthernetSegmentId::kSize);
+
+    boost::hash_combine(hash, attr.label_block_.get());
+    boost::hash_combine(hash, attr.olist_.get());
+    boost::hash_combine(hash, attr.leaf_olist_.get());
+    boost::hash_combine(hash, attr.as_path_.get());
+    boost::hash_combine(hash, attr.community_.get());
+    boost::hash_combine(hash, attr.ext_community_.get());
+    boost::hash_combine(hash, attr.origin_vn_path_.get());
+    boost::hash_combine(hash, attr.pmsi_tunnel_.get());
+    boost::hash_combine(hash, attr.edge_discovery_.get());
+    boost::hash_combine(hash, attr.edge_forwarding_.get());
 
     return hash;
 }
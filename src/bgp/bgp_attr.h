@@ -234,7 +234,12 @@ public:
 
     friend std::size_t hash_value(const PmsiTunnel &pmsi_tunnel) {
         size_t hash = 0;
-        boost::hash_combine(hash, pmsi_tunnel.pmsi_tunnel().ToString());
+        const PmsiTunnelSpec &spec = pmsi_tunnel.pmsi_tunnel();
+        boost::hash_combine(hash, spec.tunnel_flags);
+        boost::hash_combine(hash, spec.tunnel_type);
+        boost::hash_combine(hash, spec.label);
+        boost::hash_range(hash, spec.identifier.begin(),
+                          spec.identifier.end());
         return hash;
     }
 
@@ -273,15 +278,8 @@ inline void intrusive_ptr_release(const PmsiTunnel *cpmsi_tunnel) {
 
 typedef boost::intrusive_ptr<PmsiTunnel> PmsiTunnelPtr;
 
-struct PmsiTunnelCompare {
-    bool operator()(const PmsiTunnel *lhs, const PmsiTunnel *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class PmsiTunnelDB : public BgpPathAttributeDB<PmsiTunnel, PmsiTunnelPtr,
                                                PmsiTunnelSpec,
-                                               PmsiTunnelCompare,
                                                PmsiTunnelDB> {
 public:
     explicit PmsiTunnelDB(BgpServer *server);
@@ -324,7 +322,12 @@ public:
 
     friend std::size_t hash_value(const EdgeDiscovery &edge_discovery) {
         size_t hash = 0;
-        boost::hash_combine(hash, edge_discovery.edge_discovery().ToString());
+        for (EdgeList::const_iterator it = edge_discovery.edge_list.begin();
+             it != edge_discovery.edge_list.end(); ++it) {
+            boost::hash_combine(hash, (*it)->address.to_ulong());
+            boost::hash_combine(hash, (*it)->label_block->first());
+            boost::hash_combine(hash, (*it)->label_block->last());
+        }
         return hash;
     }
 
@@ -375,16 +378,9 @@ inline void intrusive_ptr_release(const EdgeDiscovery *cediscovery) {
 
 typedef boost::intrusive_ptr<EdgeDiscovery> EdgeDiscoveryPtr;
 
-struct EdgeDiscoveryCompare {
-    bool operator()(const EdgeDiscovery *lhs, const EdgeDiscovery *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class EdgeDiscoveryDB : public BgpPathAttributeDB<EdgeDiscovery,
                                                   EdgeDiscoveryPtr,
                                                   EdgeDiscoverySpec,
-                                                  EdgeDiscoveryCompare,
                                                   EdgeDiscoveryDB> {
 public:
     explicit EdgeDiscoveryDB(BgpServer *server);
@@ -429,7 +425,13 @@ public:
 
     friend std::size_t hash_value(const EdgeForwarding &edge_forwarding) {
         size_t hash = 0;
-        boost::hash_combine(hash, edge_forwarding.edge_forwarding().ToString());
+        for (EdgeList::const_iterator it = edge_forwarding.edge_list.begin();
+             it != edge_forwarding.edge_list.end(); ++it) {
+            boost::hash_combine(hash, (*it)->inbound_address.to_ulong());
+            boost::hash_combine(hash, (*it)->outbound_address.to_ulong());
+            boost::hash_combine(hash, (*it)->inbound_label);
+            boost::hash_combine(hash, (*it)->outbound_label);
+        }
         return hash;
     }
 
@@ -481,16 +483,9 @@ inline void intrusive_ptr_release(const EdgeForwarding *ceforwarding) {
 
 typedef boost::intrusive_ptr<EdgeForwarding> EdgeForwardingPtr;
 
-struct EdgeForwardingCompare {
-    bool operator()(const EdgeForwarding *lhs, const EdgeForwarding *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class EdgeForwardingDB : public BgpPathAttributeDB<EdgeForwarding,
                                                    EdgeForwardingPtr,
                                                    EdgeForwardingSpec,
-                                                   EdgeForwardingCompare,
                                                    EdgeForwardingDB> {
 public:
     explicit EdgeForwardingDB(BgpServer *server);
@@ -555,7 +550,13 @@ public:
 
     friend std::size_t hash_value(const BgpOList &olist) {
         size_t hash = 0;
-        boost::hash_combine(hash, olist.olist().ToString());
+        boost::hash_combine(hash, olist.olist().subcode);
+        for (Elements::const_iterator it = olist.elements.begin();
+             it != olist.elements.end(); ++it) {
+            boost::hash_combine(hash, (*it)->address.to_ulong());
+            boost::hash_combine(hash, (*it)->label);
+            boost::hash_range(hash, (*it)->encap.begin(), (*it)->encap.end());
+        }
         return hash;
     }
 
@@ -592,16 +593,9 @@ inline void intrusive_ptr_release(const BgpOList *colist) {
 
 typedef boost::intrusive_ptr<BgpOList> BgpOListPtr;
 
-struct BgpOListCompare {
-    bool operator()(const BgpOList *lhs, const BgpOList *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class BgpOListDB : public BgpPathAttributeDB<BgpOList,
                                              BgpOListPtr,
                                              BgpOListSpec,
-                                             BgpOListCompare,
                                              BgpOListDB> {
 public:
     explicit BgpOListDB(BgpServer *server);
@@ -656,6 +650,31 @@ struct BgpAttrParams : public BgpAttribute {
 
 typedef std::vector<BgpAttribute *> BgpAttrSpec;
 
+//
+// Wire format encoding of the path attributes in a BgpAttr for a given
+// afi/safi, as generated by BgpMessage. The encoding does not include any
+// prefixes, so the length offsets point at values that do not account for
+// them yet.
+//
+// Encodings are cached on the interned BgpAttr so that they can be reused
+// by all UPDATE messages, across RibOuts, that advertise the attribute. An
+// entry is immutable once it has been added to the BgpAttr.
+//
+struct BgpAttrWireEncoding {
+    BgpAttrWireEncoding(uint16_t afi, uint8_t safi)
+        : afi(afi), safi(safi), msg_length_offset(-1),
+          attr_length_offset(-1), nlri_length_offset(-1), next(NULL) {
+    }
+
+    uint16_t afi;
+    uint8_t safi;
+    std::vector<uint8_t> data;
+    int msg_length_offset;
+    int attr_length_offset;
+    int nlri_length_offset;
+    BgpAttrWireEncoding *next;
+};
+
 // Canonicalized BGP attribute
 class BgpAttr {
 public:
@@ -663,11 +682,16 @@ public:
     explicit BgpAttr(BgpAttrDB *attr_db);
     explicit BgpAttr(const BgpAttr &rhs);
     BgpAttr(BgpAttrDB *attr_db, const BgpAttrSpec &spec);
-    virtual ~BgpAttr() { }
+    virtual ~BgpAttr();
 
     virtual void Remove();
     int CompareTo(const BgpAttr &rhs) const;
 
+    const BgpAttrWireEncoding *GetWireEncoding(uint16_t afi,
+                                               uint8_t safi) const;
+    const BgpAttrWireEncoding *AddWireEncoding(
+        BgpAttrWireEncoding *encoding) const;
+
     void set_origin(BgpAttrOrigin::OriginType org) { origin_ = org; }
     void set_nexthop(IpAddress nexthop) { nexthop_ = nexthop; }
     void set_med(uint32_t med) { med_ = med; }
@@ -758,6 +782,7 @@ private:
     LabelBlockPtr label_block_;
     BgpOListPtr olist_;
     BgpOListPtr leaf_olist_;
+    mutable tbb::atomic<BgpAttrWireEncoding *> wire_encoding_;
 };
 
 inline int intrusive_ptr_add_ref(const BgpAttr *cattrp) {
@@ -780,14 +805,8 @@ inline void intrusive_ptr_release(const BgpAttr *cattrp) {
 
 typedef boost::intrusive_ptr<const BgpAttr> BgpAttrPtr;
 
-struct BgpAttrCompare {
-    bool operator()(const BgpAttr *lhs, const BgpAttr *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class BgpAttrDB : public BgpPathAttributeDB<BgpAttr, BgpAttrPtr, BgpAttrSpec,
-                                            BgpAttrCompare, BgpAttrDB> {
+                                            BgpAttrDB> {
 public:
     explicit BgpAttrDB(BgpServer *server);
     BgpAttrPtr ReplaceCommunityAndLocate(const BgpAttr *attr,
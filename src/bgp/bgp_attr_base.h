@@ -93,18 +93,117 @@ struct BgpProtoPrefix : public ParseObject {
     uint8_t type;
 };
 
+//
+// Open addressing hash set of attribute pointers, used for each partition
+// of a BgpPathAttributeDB.
+//
+// Entries are kept along with their hash in a power of two sized table and
+// are located by linear probing from the slot selected by the hash. Lookups
+// don't allocate and compare attribute contents via CompareTo() only when
+// the full hashes match. Entries are erased by pointer, using backward shift
+// deletion so that no tombstones are left behind.
+//
+// The set is not thread safe, callers must provide their own locking.
+//
+template <class Type>
+class BgpPathAttributeSet {
+public:
+    BgpPathAttributeSet() : size_(0), slots_(kMinSize) {
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+
+    // Insert attr unless an entry with the same contents is present. Returns
+    // the entry in the set and whether attr was inserted.
+    std::pair<Type *, bool> insert(Type *attr, size_t hash) {
+        if ((size_ + 1) * 4 > slots_.size() * 3)
+            Resize(slots_.size() * 2);
+
+        size_t mask = slots_.size() - 1;
+        for (size_t idx = hash & mask; ; idx = (idx + 1) & mask) {
+            Slot &slot = slots_[idx];
+            if (!slot.attr) {
+                slot.attr = attr;
+                slot.hash = hash;
+                size_++;
+                return std::make_pair(attr, true);
+            }
+            if (slot.hash == hash && slot.attr->CompareTo(*attr) == 0)
+                return std::make_pair(slot.attr, false);
+        }
+    }
+
+    // Erase attr itself, as opposed to an entry with the same contents.
+    bool erase(Type *attr, size_t hash) {
+        size_t mask = slots_.size() - 1;
+        size_t hole = hash & mask;
+        for (; slots_[hole].attr != attr; hole = (hole + 1) & mask) {
+            if (!slots_[hole].attr)
+                return false;
+        }
+
+        // Move back any entry in the rest of the probe sequence which is
+        // allowed to occupy the hole i.e. whose home slot is not in between
+        // the hole and the entry.
+        for (size_t idx = (hole + 1) & mask; slots_[idx].attr;
+             idx = (idx + 1) & mask) {
+            size_t home = slots_[idx].hash & mask;
+            if (((idx - home) & mask) >= ((idx - hole) & mask)) {
+                slots_[hole] = slots_[idx];
+                hole = idx;
+            }
+        }
+        slots_[hole] = Slot();
+        size_--;
+
+        if (slots_.size() > kMinSize && size_ * 8 < slots_.size())
+            Resize(slots_.size() / 2);
+        return true;
+    }
+
+private:
+    static const size_t kMinSize = 16;
+
+    struct Slot {
+        Slot() : attr(NULL), hash(0) { }
+        Type *attr;
+        size_t hash;
+    };
+
+    void Resize(size_t size) {
+        std::vector<Slot> slots(size);
+        size_t mask = size - 1;
+        for (typename std::vector<Slot>::const_iterator it = slots_.begin();
+             it != slots_.end(); ++it) {
+            if (!it->attr)
+                continue;
+            size_t idx = it->hash & mask;
+            while (slots[idx].attr)
+                idx = (idx + 1) & mask;
+            slots[idx] = *it;
+        }
+        slots_.swap(slots);
+    }
+
+    size_t size_;
+    std::vector<Slot> slots_;
+};
+
 //
 // Base class to manage BGP Path Attributes database. This class provides
 // thread safe access to the data base.
 //
 // Lock contention can be tuned by varying the hash table size passed to the
-// constructor.
+// constructor. The attribute hash selects the partition and the slot within
+// the partition's BgpPathAttributeSet.
 //
 // Attribute contents must be hashable via hash_value() and hashed using
-// boost::hash_combine() to partition the attribute database.
+// boost::hash_combine(). The hash must be derived from the same fields that
+// CompareTo() looks at, so that equal attributes always hash alike, and must
+// not depend on any per instance data such as the address of the attribute.
 //
-template <class Type, class TypePtr, class TypeSpec, typename TypeCompare,
-          class TypeDB>
+template <class Type, class TypePtr, class TypeSpec, class TypeDB>
 class BgpPathAttributeDB {
 public:
     explicit BgpPathAttributeDB(int hash_size = GetHashSize())
@@ -125,9 +224,10 @@ public:
 
     void Delete(Type *attr) {
         size_t hash = HashCompute(attr);
+        size_t partition = hash % hash_size_;
 
-        tbb::mutex::scoped_lock lock(mutex_[hash]);
-        set_[hash].erase(attr);
+        tbb::mutex::scoped_lock lock(mutex_[partition]);
+        set_[partition].erase(attr, hash / hash_size_);
     }
 
     // Locate passed in attribute in the data base based on the attr ptr.
@@ -142,12 +242,10 @@ public:
     }
 
 private:
-    const size_t HashCompute(Type *attr) const {
-        if (hash_size_ <= 1) return 0;
-
+    static size_t HashCompute(Type *attr) {
         size_t hash = 0;
         boost::hash_combine(hash, *attr);
-        return hash % hash_size_;
+        return hash;
     }
 
     static size_t GetHashSize() {
@@ -165,28 +263,33 @@ private:
     // existing entry is returned.
     TypePtr LocateInternal(Type *attr) {
         // Hash attribute contents to to avoid potential mutex contention.
+        // The remainder selects the partition and the quotient is used
+        // within the partition, so that all of the partition's slots are
+        // used regardless of the number of partitions.
         size_t hash = HashCompute(attr);
+        size_t partition = hash % hash_size_;
+        hash /= hash_size_;
         while (true) {
             // Grab mutex to keep db access thread safe.
-            tbb::mutex::scoped_lock lock(mutex_[hash]);
-            std::pair<typename Set::iterator, bool> ret;
+            tbb::mutex::scoped_lock lock(mutex_[partition]);
+            std::pair<Type *, bool> ret;
 
             // Try to insert the passed entry into the database.
-            ret = set_[hash].insert(attr);
+            ret = set_[partition].insert(attr, hash);
 
             // Take a reference to prevent this entry from getting deleted.
             // Counter is automatically incremented, hence we get thread safety
             // here.
-            int prev = intrusive_ptr_add_ref(*ret.first);
+            int prev = intrusive_ptr_add_ref(ret.first);
 
             // Check if passed in entry did get into the data base.
             if (ret.second) {
                 // Take intrusive pointer, thereby incrementing the refcount.
-                TypePtr ptr = TypePtr(*ret.first);
+                TypePtr ptr = TypePtr(ret.first);
 
                 // Release redundant refcount taken above to protect this entry
                 // from getting deleted, as we have now bumped up refcount above
-                intrusive_ptr_del_ref(*ret.first);
+                intrusive_ptr_del_ref(ret.first);
                 return ptr;
             }
 
@@ -203,25 +306,25 @@ private:
                 delete attr;
 
                 // Take intrusive pointer, thereby incrementing the refcount.
-                TypePtr ptr = TypePtr(*ret.first);
+                TypePtr ptr = TypePtr(ret.first);
 
                 // Release redundant refcount taken above to protect this entry
                 // from getting deleted, as we have now bumped up refcount above
-                intrusive_ptr_del_ref(*ret.first);
+                intrusive_ptr_del_ref(ret.first);
                 return ptr;
             }
 
             // Decrement the counter bumped up above as we can't use this entry
             // which is above to be deleted. Instead, retry inserting the passed
             // entry again, into the database.
-            intrusive_ptr_del_ref(*ret.first);
+            intrusive_ptr_del_ref(ret.first);
         }
 
         assert(false);
         return NULL;
     }
 
-    typedef std::set<Type *, TypeCompare> Set;
+    typedef BgpPathAttributeSet<Type> Set;
     size_t hash_size_;
     boost::scoped_array<Set> set_;
     boost::scoped_array<tbb::mutex> mutex_;
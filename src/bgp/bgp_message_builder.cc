@@ -4,19 +4,34 @@
 
 #include "bgp/bgp_message_builder.h"
 
+#include <string.h>
+
 #include <vector>
 
 #include "base/parse_object.h"
 #include "bgp/bgp_route.h"
 #include "net/bgp_af.h"
 
-BgpMessage::BgpMessage() {
+tbb::atomic<uint64_t> BgpMessage::attr_cache_hits_;
+tbb::atomic<uint64_t> BgpMessage::attr_cache_misses_;
+
+BgpMessage::BgpMessage()
+    : msg_length_offset_(-1),
+      attr_length_offset_(-1),
+      nlri_length_offset_(-1),
+      datalen_(0) {
 }
 
 BgpMessage::~BgpMessage() {
 }
 
-void BgpMessage::StartReach(const RibOutAttr *roattr, const BgpRoute *route) {
+//
+// Build the wire encoding of the path attributes in the RibOutAttr for the
+// family of the route. The MP_REACH_NLRI attribute is included, but without
+// any prefixes.
+//
+const BgpAttrWireEncoding *BgpMessage::EncodeAttr(const RibOutAttr *roattr,
+                                                  const BgpRoute *route) {
     BgpProto::Update update;
     const BgpAttr *attr = roattr->attr();
 
@@ -118,16 +133,45 @@ void BgpMessage::StartReach(const RibOutAttr *roattr, const BgpRoute *route) {
         BgpAttribute::MPReachNlri, route->Afi(), route->Safi(), nh);
     update.path_attributes.push_back(nlri);
 
-    if (route) {
-        BgpProtoPrefix *prefix = new BgpProtoPrefix;
-        route->BuildProtoPrefix(prefix, attr, roattr->label());
-        nlri->nlri.push_back(prefix);
-        num_reach_route_++;
+    EncodeOffsets encode_offsets;
+    int result = BgpProto::Encode(&update, data_, sizeof(data_),
+            &encode_offsets);
+    assert(result > 0);
+
+    BgpAttrWireEncoding *encoding =
+        new BgpAttrWireEncoding(route->Afi(), route->Safi());
+    encoding->data.assign(data_, data_ + result);
+    encoding->msg_length_offset = encode_offsets.FindOffset("BgpMsgLength");
+    encoding->attr_length_offset =
+        encode_offsets.FindOffset("BgpPathAttribute");
+    encoding->nlri_length_offset =
+        encode_offsets.FindOffset("MpReachUnreachNlri");
+    return attr->AddWireEncoding(encoding);
+}
+
+//
+// Start the message with the cached encoding of the attributes for this
+// family, building it if needed, and then add the prefix for the route.
+//
+void BgpMessage::StartReach(const RibOutAttr *roattr, const BgpRoute *route) {
+    const BgpAttr *attr = roattr->attr();
+    const BgpAttrWireEncoding *encoding =
+        attr->GetWireEncoding(route->Afi(), route->Safi());
+    if (encoding) {
+        attr_cache_hits_++;
+    } else {
+        attr_cache_misses_++;
+        encoding = EncodeAttr(roattr, route);
     }
 
-    datalen_ = BgpProto::Encode(&update, data_, sizeof(data_),
-            &encode_offsets_);
-    assert(datalen_ > 0);
+    datalen_ = encoding->data.size();
+    memcpy(data_, &encoding->data[0], datalen_);
+    msg_length_offset_ = encoding->msg_length_offset;
+    attr_length_offset_ = encoding->attr_length_offset;
+    nlri_length_offset_ = encoding->nlri_length_offset;
+
+    bool success = AddRoute(route, roattr);
+    assert(success);
 }
 
 void BgpMessage::StartUnreach(const BgpRoute *route) {
@@ -144,9 +188,14 @@ void BgpMessage::StartUnreach(const BgpRoute *route) {
         num_unreach_route_++;
     }
 
-    datalen_ = BgpProto::Encode(&update, data_, sizeof(data_),
-            &encode_offsets_);
-    assert(datalen_ > 0);
+    EncodeOffsets encode_offsets;
+    int result = BgpProto::Encode(&update, data_, sizeof(data_),
+            &encode_offsets);
+    assert(result > 0);
+    datalen_ = result;
+    msg_length_offset_ = encode_offsets.FindOffset("BgpMsgLength");
+    attr_length_offset_ = encode_offsets.FindOffset("BgpPathAttribute");
+    nlri_length_offset_ = encode_offsets.FindOffset("MpReachUnreachNlri");
 }
 
 void BgpMessage::Start(const RibOutAttr *roattr, const BgpRoute *route) {
@@ -157,8 +206,7 @@ void BgpMessage::Start(const RibOutAttr *roattr, const BgpRoute *route) {
     }
 }
 
-bool BgpMessage::UpdateLength(const char *tag, int size, int delta) {
-    int offset = encode_offsets_.FindOffset(tag);
+bool BgpMessage::UpdateLength(int offset, int size, int delta) {
     if (offset < 0) {
         return false;
     }
@@ -192,17 +240,17 @@ bool BgpMessage::AddRoute(const BgpRoute *route, const RibOutAttr *roattr) {
     if (result <= 0) return false;
 
     datalen_ += result;
-    if (!UpdateLength("BgpMsgLength", 2, result)) {
+    if (!UpdateLength(msg_length_offset_, 2, result)) {
         assert(false);
         return false;
     }
 
-    if (!UpdateLength("BgpPathAttribute", 2, result)) {
+    if (!UpdateLength(attr_length_offset_, 2, result)) {
         assert(false);
         return false;
     }
 
-    if (!UpdateLength("MpReachUnreachNlri", 2, result)) {
+    if (!UpdateLength(nlri_length_offset_, 2, result)) {
         assert(false);
         return false;
     }
@@ -219,7 +267,8 @@ const uint8_t *BgpMessage::GetData(IPeerUpdate *ipeer_update, size_t *lenp) {
 }
 
 Message *BgpMessageBuilder::Create(const BgpTable *table,
-        const RibOutAttr *roattr, const BgpRoute *route) const {
+        const RibOutAttr *roattr, const BgpRoute *route,
+        MessageCache *cache) const {
     BgpMessage *msg = new BgpMessage();
     msg->Start(roattr, route);
     return msg;
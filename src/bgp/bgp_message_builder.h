@@ -5,9 +5,13 @@
 #ifndef SRC_BGP_BGP_MESSAGE_BUILDER_H_
 #define SRC_BGP_BGP_MESSAGE_BUILDER_H_
 
+#include <tbb/atomic.h>
+
 #include "bgp/bgp_proto.h"
 #include "bgp/message_builder.h"
 
+struct BgpAttrWireEncoding;
+
 class BgpMessage : public Message {
 public:
     BgpMessage();
@@ -17,12 +21,23 @@ public:
     virtual void Finish();
     virtual const uint8_t *GetData(IPeerUpdate *ipeer_update, size_t *lenp);
 
+    // Statistics for the encoded attribute cache.
+    static uint64_t attr_cache_hits() { return attr_cache_hits_; }
+    static uint64_t attr_cache_misses() { return attr_cache_misses_; }
+
 private:
+    const BgpAttrWireEncoding *EncodeAttr(const RibOutAttr *roattr,
+                                          const BgpRoute *route);
     void StartReach(const RibOutAttr *roattr, const BgpRoute *route);
     void StartUnreach(const BgpRoute *route);
-    bool UpdateLength(const char *tag, int size, int delta);
+    bool UpdateLength(int offset, int size, int delta);
+
+    static tbb::atomic<uint64_t> attr_cache_hits_;
+    static tbb::atomic<uint64_t> attr_cache_misses_;
 
-    EncodeOffsets encode_offsets_;
+    int msg_length_offset_;
+    int attr_length_offset_;
+    int nlri_length_offset_;
     uint8_t data_[BgpProto::kMaxMessageSize];
     size_t datalen_;
     DISALLOW_COPY_AND_ASSIGN(BgpMessage);
@@ -33,7 +48,8 @@ public:
     BgpMessageBuilder();
     virtual Message *Create(const BgpTable *table,
                             const RibOutAttr *roattr,
-                            const BgpRoute *route) const;
+                            const BgpRoute *route,
+                            MessageCache *cache) const;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(BgpMessageBuilder);
@@ -96,15 +96,8 @@ inline void intrusive_ptr_release(const OriginVnPath *covnpath) {
 
 typedef boost::intrusive_ptr<const OriginVnPath> OriginVnPathPtr;
 
-struct OriginVnPathCompare {
-    bool operator()(const OriginVnPath *lhs, const OriginVnPath *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class OriginVnPathDB : public BgpPathAttributeDB<OriginVnPath, OriginVnPathPtr,
                                                  OriginVnPathSpec,
-                                                 OriginVnPathCompare,
                                                  OriginVnPathDB> {
 public:
     explicit OriginVnPathDB(BgpServer *server);
@@ -48,7 +48,7 @@ public:
             }
             const IpAddress address() const { return address_; }
             uint32_t label() const { return label_; }
-            std::vector<std::string> encap() const { return encap_; }
+            const std::vector<std::string> &encap() const { return encap_; }
 
             int CompareTo(const NextHop &rhs) const {
                 if (address_ < rhs.address_) return -1;
@@ -87,6 +87,7 @@ public:
     bool IsReachable() const { return attr_out_.get() != NULL; }
     bool operator==(const RibOutAttr &rhs) const { return CompareTo(rhs) == 0; }
     bool operator!=(const RibOutAttr &rhs) const { return CompareTo(rhs) != 0; }
+    bool operator<(const RibOutAttr &rhs) const { return CompareTo(rhs) < 0; }
 
     const NextHopList &nexthop_list() const { return nexthop_list_; }
     const BgpAttr *attr() const { return attr_out_.get(); }
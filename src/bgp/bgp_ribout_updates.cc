@@ -27,6 +27,7 @@ RibOutUpdates::RibOutUpdates(RibOut *ribout) : ribout_(ribout) {
     }
     monitor_.reset(new RibUpdateMonitor(ribout, &queue_vec_));
     builder_ = MessageBuilder::GetInstance(ribout->ExportPolicy().encoding);
+    message_cache_.reset(builder_->CreateCache());
 }
 
 //
@@ -36,6 +37,11 @@ RibOutUpdates::~RibOutUpdates() {
     STLDeleteValues(&queue_vec_);
 }
 
+void RibOutUpdates::SetMessageBuilder(MessageBuilder *builder) {
+    builder_ = builder;
+    message_cache_.reset(builder_->CreateCache());
+}
+
 //
 // Concurrency: Called in the context of the routing table partition task.
 //
@@ -106,7 +112,8 @@ bool RibOutUpdates::DequeueCommon(UpdateMarker *marker, RouteUpdate *rt_update,
 
         // Generate the update and merge additional updates into that message.
         auto_ptr<Message> message(
-            builder_->Create(table, &uinfo->roattr, rt_update->route()));
+            builder_->Create(table, &uinfo->roattr, rt_update->route(),
+                             message_cache_.get()));
         UpdatePack(rt_update->queue_id(), message.get(), uinfo, msgset);
         message->Finish();
 
@@ -5,6 +5,7 @@
 #ifndef SRC_BGP_BGP_RIBOUT_UPDATES_H_
 #define SRC_BGP_BGP_RIBOUT_UPDATES_H_
 
+#include <boost/scoped_ptr.hpp>
 #include <vector>
 
 #include "bgp/bgp_ribout.h"
@@ -12,6 +13,7 @@
 class BgpTable;
 class Message;
 class MessageBuilder;
+class MessageCache;
 class RibUpdateMonitor;
 class RouteUpdate;
 class RouteUpdatePtr;
@@ -67,7 +69,7 @@ public:
     QueueVec &queue_vec() { return queue_vec_; }
 
     // Testing only
-    void SetMessageBuilder(MessageBuilder *builder) { builder_ = builder; }
+    void SetMessageBuilder(MessageBuilder *builder);
 
 private:
     friend class RibOutUpdatesTest;
@@ -97,6 +99,7 @@ private:
 
     RibOut *ribout_;
     MessageBuilder *builder_;
+    boost::scoped_ptr<MessageCache> message_cache_;
     QueueVec queue_vec_;
     boost::scoped_ptr<RibUpdateMonitor> monitor_;
     DISALLOW_COPY_AND_ASSIGN(RibOutUpdates);
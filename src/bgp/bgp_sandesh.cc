@@ -14,6 +14,7 @@
 
 #include "base/util.h"
 #include "bgp/bgp_config.h"
+#include "bgp/bgp_message_builder.h"
 #include "bgp/bgp_multicast.h"
 #include "bgp/bgp_path.h"
 #include "bgp/bgp_peer_membership.h"
@@ -619,8 +620,12 @@ bool ShowRouteSummaryHandler::CallbackS1(const Sandesh *sr,
         }
     }
 
+    ShowTableWalkerStats walker;
+    bsc->bgp_server->database()->GetWalker()->FillStats(&walker);
+
     ShowRouteSummaryResp *resp = new ShowRouteSummaryResp;
     resp->set_tables(table_list);
+    resp->set_walker(walker);
     resp->set_context(req->context());
     resp->Response();
     return true;
@@ -1772,6 +1777,9 @@ public:
         bsc->bgp_server->session_manager()->GetTxSocketStats(peer_socket_stats);
         resp->set_tx_socket_stats(peer_socket_stats);
 
+        resp->set_update_attr_cache_hits(BgpMessage::attr_cache_hits());
+        resp->set_update_attr_cache_misses(BgpMessage::attr_cache_misses());
+
         resp->set_context(req->context());
         resp->Response();
         return true;
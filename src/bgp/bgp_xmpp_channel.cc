@@ -35,11 +35,10 @@
 #include "bgp/scheduling_group.h"
 #include "bgp/security_group/security_group.h"
 #include "bgp/tunnel_encap/tunnel_encap.h"
+#include "bgp/xmpp_item_decoder.h"
 #include "net/bgp_af.h"
 #include "net/mac_address.h"
-#include "schema/xmpp_unicast_types.h"
 #include "schema/xmpp_multicast_types.h"
-#include "schema/xmpp_enet_types.h"
 #include "xml/xml_pugi.h"
 #include "xmpp/xmpp_connection.h"
 #include "xmpp/xmpp_server.h"
@@ -461,7 +460,8 @@ BgpXmppChannel::BgpXmppChannel(XmppChannel *channel, BgpServer *bgp_server,
             TaskScheduler::GetInstance()->GetTaskId("xmpp::StateMachine"),
             channel->connection()->GetIndex(),
             boost::bind(&BgpXmppChannel::MembershipResponseHandler, this, _1)),
-      lb_mgr_(new LabelBlockManager()) {
+      lb_mgr_(new LabelBlockManager()),
+      route_item_(new XmppRouteItem()) {
     channel_->RegisterReceive(peer_id_,
          boost::bind(&BgpXmppChannel::ReceiveUpdate, this, _1));
 }
@@ -964,36 +964,61 @@ void BgpXmppChannel::ProcessMcastItem(string vrf_name,
     table->Enqueue(&req);
 }
 
-void BgpXmppChannel::ProcessItem(string vrf_name,
-                                 const pugi::xml_node &node, bool add_change) {
-    autogen::ItemType item;
-    item.Clear();
+//
+// Fill nexthops from the next-hops of a route item published by the agent
+// and add the tunnel encapsulations of the first next-hop to ext. Returns
+// the index of the first next-hop with an invalid address, or -1.
+//
+static int BuildNextHops(const XmppRouteItem &item, int instance_id,
+                         BgpTable::RequestData::NextHops *nexthops,
+                         ExtCommunitySpec *ext) {
+    uint32_t flags = 0;
+    for (size_t i = 0; i < item.nexthops.size(); i++) {
+        const XmppRouteItem::NextHop &item_nexthop = item.nexthops[i];
+        if (!item_nexthop.address_valid) {
+            return i;
+        }
 
-    if (!item.XmlParse(node)) {
-        BGP_LOG_PEER_INSTANCE(Peer(), vrf_name, SandeshLevel::SYS_WARN,
-                                   BGP_LOG_FLAG_ALL,
-                                   "Invalid message received");
-        return;
-    }
+        BgpTable::RequestData::NextHop nexthop;
+        for (vector<TunnelEncapType::Encap>::const_iterator it =
+             item_nexthop.encaps.begin(); it != item_nexthop.encaps.end();
+             ++it) {
+            TunnelEncap tun_encap(*it);
+            if (i == 0) {
+                ext->communities.push_back(tun_encap.GetExtCommunityValue());
+            }
+            nexthop.tunnel_encapsulations_.push_back(
+                tun_encap.GetExtCommunity());
+        }
 
-    // NLRI ipaddress/mask
-    if (item.entry.nlri.af != BgpAf::IPv4) {
-        BGP_LOG_PEER_INSTANCE(Peer(), vrf_name, SandeshLevel::SYS_WARN,
-                                   BGP_LOG_FLAG_ALL,
-                                   "Unsupported address family");
-        return;
+        // If all of the tunnel encaps published by the agent are invalid,
+        // mark the path as infeasible. If agent has not published any tunnel
+        // encap, default the tunnel encap to "gre"
+        if (item_nexthop.encap_list_size && item_nexthop.encaps.empty()) {
+            flags = BgpPath::NoTunnelEncap;
+        }
+
+        nexthop.flags_ = flags;
+        nexthop.address_ = item_nexthop.address;
+        nexthop.label_ = item_nexthop.label;
+        nexthop.source_rd_ = RouteDistinguisher(
+            item_nexthop.address.to_v4().to_ulong(), instance_id);
+        nexthops->push_back(nexthop);
     }
+    return -1;
+}
 
-    error_code error;
-    Ip4Prefix rt_prefix = Ip4Prefix::FromString(item.entry.nlri.address,
-                                                &error);
-    if (error) {
+void BgpXmppChannel::ProcessItem(string vrf_name,
+                                 const pugi::xml_node &node, bool add_change) {
+    XmppRouteItem &item = *route_item_;
+    string error;
+    if (XmppRouteItemDecoder::DecodeInetItem(node, &item, &error) !=
+        XmppRouteItemDecoder::OK) {
         BGP_LOG_PEER_INSTANCE(Peer(), vrf_name, SandeshLevel::SYS_WARN,
-                                   BGP_LOG_FLAG_ALL,
-                                   "Bad address string: " <<
-                                   item.entry.nlri.address);
+                                   BGP_LOG_FLAG_ALL, error);
         return;
     }
+    const Ip4Prefix &rt_prefix = item.inet_prefix;
 
     RoutingInstanceMgr *instance_mgr = bgp_server_->routing_instance_mgr();
     if (!instance_mgr) {
@@ -1067,86 +1092,28 @@ void BgpXmppChannel::ProcessItem(string vrf_name,
 
     IpAddress nh_address(Ip4Address(0));
     uint32_t label = 0;
-    uint32_t flags = 0;
     ExtCommunitySpec ext;
 
     if (add_change) {
         req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
         BgpAttrSpec attrs;
 
-        if (!item.entry.next_hops.next_hop.empty()) {
-            for (size_t i = 0; i < item.entry.next_hops.next_hop.size(); i++) {
-                InetTable::RequestData::NextHop nexthop;
-
-                IpAddress nhop_address(Ip4Address(0));
-                if (!(XmppDecodeAddress(
-                          item.entry.next_hops.next_hop[i].af,
-                          item.entry.next_hops.next_hop[i].address,
-                          &nhop_address))) {
-                    BGP_LOG_PEER(Message, Peer(), SandeshLevel::SYS_WARN,
-                        BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                        "Error parsing nexthop address:" <<
-                        item.entry.next_hops.next_hop[i].address <<
-                        " family:" << item.entry.next_hops.next_hop[i].af <<
-                        " for unicast route");
-                    return;
-                }
-
-                if (i == 0) {
-                    nh_address = nhop_address;
-                    label = item.entry.next_hops.next_hop[0].label;
-                }
-
-                bool no_valid_tunnel_encap = true;
-
-                // Tunnel Encap list
-                for (vector<string>::const_iterator it =
-                     item.entry.next_hops.next_hop[i].tunnel_encapsulation_list.begin();
-                     it !=
-                     item.entry.next_hops.next_hop[i].tunnel_encapsulation_list.end();
-                     it++) {
-                    TunnelEncap tun_encap(*it);
-                    if (tun_encap.tunnel_encap() == TunnelEncapType::UNSPEC)
-                        continue;
-                    no_valid_tunnel_encap = false;
-                    if (i == 0) {
-                        ext.communities.push_back(
-                            tun_encap.GetExtCommunityValue());
-                    }
-                    nexthop.tunnel_encapsulations_.push_back(
-                        tun_encap.GetExtCommunity());
-
-                    string alt_encap_string = *it + "-contrail";
-                    TunnelEncap alt_tun_encap(alt_encap_string);
-                    if (alt_tun_encap.tunnel_encap() == TunnelEncapType::UNSPEC)
-                        continue;
-                    if (i == 0) {
-                        ext.communities.push_back(
-                            alt_tun_encap.GetExtCommunityValue());
-                    }
-                    nexthop.tunnel_encapsulations_.push_back(
-                        alt_tun_encap.GetExtCommunity());
-                }
-
-                // If all of the tunnel encaps published by the agent are
-                // invalid, mark the path as infeasible. If agent has not
-                // published any tunnel encap, default the tunnel encap to "gre"
-                if (!item.entry.next_hops.next_hop[i].tunnel_encapsulation_list.tunnel_encapsulation.empty() &&
-                    no_valid_tunnel_encap) {
-                    flags = BgpPath::NoTunnelEncap;
-                }
-
-                nexthop.flags_ = flags;
-                nexthop.address_ = nhop_address;
-                nexthop.label_ = item.entry.next_hops.next_hop[i].label;
-                nexthop.source_rd_ = RouteDistinguisher(
-                                         nhop_address.to_v4().to_ulong(),
-                                         instance_id);
-                nexthops.push_back(nexthop);
-            }
+        int bad_nexthop = BuildNextHops(item, instance_id, &nexthops, &ext);
+        if (bad_nexthop >= 0) {
+            BGP_LOG_PEER(Message, Peer(), SandeshLevel::SYS_WARN,
+                BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
+                "Error parsing nexthop address:" <<
+                item.nexthops[bad_nexthop].address_text <<
+                " family:" << item.nexthops[bad_nexthop].af <<
+                " for unicast route");
+            return;
+        }
+        if (!nexthops.empty()) {
+            nh_address = nexthops[0].address_;
+            label = nexthops[0].label_;
         }
 
-        BgpAttrLocalPref local_pref(item.entry.local_preference);
+        BgpAttrLocalPref local_pref(item.local_preference);
         if (local_pref.local_pref != 0)
             attrs.push_back(&local_pref);
 
@@ -1158,17 +1125,15 @@ void BgpXmppChannel::ProcessItem(string vrf_name,
         attrs.push_back(&source_rd);
 
         // SGID list
-        for (vector<int>::iterator it =
-             item.entry.security_group_list.security_group.begin();
-             it != item.entry.security_group_list.security_group.end();
-             it++) {
+        for (vector<int>::const_iterator it = item.security_groups.begin();
+             it != item.security_groups.end(); ++it) {
             SecurityGroup sg(bgp_server_->autonomous_system(), *it);
             ext.communities.push_back(sg.GetExtCommunityValue());
         }
 
         // Seq number
-        if (item.entry.sequence_number) {
-            MacMobility mm(item.entry.sequence_number);
+        if (item.sequence_number) {
+            MacMobility mm(item.sequence_number);
             ext.communities.push_back(mm.GetExtCommunityValue());
         }
 
@@ -1199,7 +1164,7 @@ void BgpXmppChannel::ProcessItem(string vrf_name,
 
     BGP_LOG_PEER_INSTANCE(Peer(), vrf_name,
             SandeshLevel::SYS_DEBUG, BGP_LOG_FLAG_TRACE,
-                               "Inet route " << item.entry.nlri.address <<
+                               "Inet route " << item.address_text <<
                                " with next-hop " << nh_address
                                << " and label " << label
                                <<  " is enqueued for "
@@ -1209,34 +1174,28 @@ void BgpXmppChannel::ProcessItem(string vrf_name,
 
 void BgpXmppChannel::ProcessInet6Item(string vrf_name,
         const pugi::xml_node &node, bool add_change) {
-    autogen::ItemType item;
-    item.Clear();
-
-    if (!item.XmlParse(node)) {
+    XmppRouteItem &item = *route_item_;
+    string error;
+    switch (XmppRouteItemDecoder::DecodeInet6Item(node, &item, &error)) {
+    case XmppRouteItemDecoder::OK:
+        break;
+    case XmppRouteItemDecoder::BAD_XML:
         error_stats().incr_inet6_rx_bad_xml_token_count();
         BGP_LOG_PEER_INSTANCE(Peer(), vrf_name, SandeshLevel::SYS_WARN,
-                              BGP_LOG_FLAG_ALL, "Invalid message received");
+                              BGP_LOG_FLAG_ALL, error);
         return;
-    }
-
-    // NLRI ipaddress/mask
-    if ((item.entry.nlri.af != BgpAf::IPv6) ||
-        (item.entry.nlri.safi != BgpAf::Unicast)) {
+    case XmppRouteItemDecoder::BAD_AFI_SAFI:
         error_stats().incr_inet6_rx_bad_afi_safi_count();
         BGP_LOG_PEER_INSTANCE(Peer(), vrf_name, SandeshLevel::SYS_WARN,
-                              BGP_LOG_FLAG_ALL, "Unsupported address family");
+                              BGP_LOG_FLAG_ALL, error);
         return;
-    }
-
-    error_code error;
-    Inet6Prefix rt_prefix = Inet6Prefix::FromString(item.entry.nlri.address,
-                                                    &error);
-    if (error) {
+    default:
         error_stats().incr_inet6_rx_bad_prefix_count();
         BGP_LOG_PEER_INSTANCE(Peer(), vrf_name, SandeshLevel::SYS_WARN,
-           BGP_LOG_FLAG_ALL, "Bad address string: " << item.entry.nlri.address);
+                              BGP_LOG_FLAG_ALL, error);
         return;
     }
+    const Inet6Prefix &rt_prefix = item.inet6_prefix;
 
     RoutingInstanceMgr *instance_mgr = bgp_server_->routing_instance_mgr();
     if (!instance_mgr) {
@@ -1309,89 +1268,29 @@ void BgpXmppChannel::ProcessInet6Item(string vrf_name,
 
     IpAddress nh_address(Ip4Address(0));
     uint32_t label = 0;
-    uint32_t flags = 0;
     ExtCommunitySpec ext;
 
     if (add_change) {
         req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
         BgpAttrSpec attrs;
 
-        if (!item.entry.next_hops.next_hop.empty()) {
-            for (size_t i = 0; i < item.entry.next_hops.next_hop.size(); ++i) {
-                Inet6Table::RequestData::NextHop nexthop;
-
-                IpAddress nhop_address(Ip4Address(0));
-                if (!(XmppDecodeAddress(
-                          item.entry.next_hops.next_hop[i].af,
-                          item.entry.next_hops.next_hop[i].address,
-                          &nhop_address))) {
-                    error_stats().incr_inet6_rx_bad_nexthop_count();
-                    BGP_LOG_PEER(Message, Peer(), SandeshLevel::SYS_WARN,
-                        BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                        "Error parsing nexthop address:" <<
-                        item.entry.next_hops.next_hop[i].address <<
-                        " family:" << item.entry.next_hops.next_hop[i].af <<
-                        " for unicast route");
-                    return;
-                }
-
-                if (i == 0) {
-                    nh_address = nhop_address;
-                    label = item.entry.next_hops.next_hop[0].label;
-                }
-
-                bool no_valid_tunnel_encap = true;
-
-                // Tunnel Encap list
-                for (vector<string>::const_iterator it =
-                     item.entry.next_hops.next_hop[i].
-                                        tunnel_encapsulation_list.begin();
-                     it !=
-                     item.entry.next_hops.next_hop[i].
-                                        tunnel_encapsulation_list.end();
-                     ++it) {
-                    TunnelEncap tun_encap(*it);
-                    if (tun_encap.tunnel_encap() == TunnelEncapType::UNSPEC)
-                        continue;
-                    no_valid_tunnel_encap = false;
-                    if (i == 0) {
-                        ext.communities.push_back(
-                            tun_encap.GetExtCommunityValue());
-                    }
-                    nexthop.tunnel_encapsulations_.push_back(
-                        tun_encap.GetExtCommunity());
-
-                    string alt_encap_string = *it + "-contrail";
-                    TunnelEncap alt_tun_encap(alt_encap_string);
-                    if (alt_tun_encap.tunnel_encap() == TunnelEncapType::UNSPEC)
-                        continue;
-                    if (i == 0) {
-                        ext.communities.push_back(
-                            alt_tun_encap.GetExtCommunityValue());
-                    }
-                    nexthop.tunnel_encapsulations_.push_back(
-                        alt_tun_encap.GetExtCommunity());
-                }
-
-                // If all of the tunnel encaps published by the agent are
-                // invalid, mark the path as infeasible. If agent has not
-                // published any tunnel encap, default the tunnel encap to "gre"
-                if (!item.entry.next_hops.next_hop[i].tunnel_encapsulation_list.
-                        tunnel_encapsulation.empty() && no_valid_tunnel_encap) {
-                    flags = BgpPath::NoTunnelEncap;
-                }
-
-                nexthop.flags_ = flags;
-                nexthop.address_ = nhop_address;
-                nexthop.label_ = item.entry.next_hops.next_hop[i].label;
-                nexthop.source_rd_ =
-                    RouteDistinguisher(nhop_address.to_v4().to_ulong(),
-                                       instance_id);
-                nexthops.push_back(nexthop);
-            }
+        int bad_nexthop = BuildNextHops(item, instance_id, &nexthops, &ext);
+        if (bad_nexthop >= 0) {
+            error_stats().incr_inet6_rx_bad_nexthop_count();
+            BGP_LOG_PEER(Message, Peer(), SandeshLevel::SYS_WARN,
+                BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
+                "Error parsing nexthop address:" <<
+                item.nexthops[bad_nexthop].address_text <<
+                " family:" << item.nexthops[bad_nexthop].af <<
+                " for unicast route");
+            return;
+        }
+        if (!nexthops.empty()) {
+            nh_address = nexthops[0].address_;
+            label = nexthops[0].label_;
         }
 
-        BgpAttrLocalPref local_pref(item.entry.local_preference);
+        BgpAttrLocalPref local_pref(item.local_preference);
         if (local_pref.local_pref != 0) {
             attrs.push_back(&local_pref);
         }
@@ -1404,16 +1303,14 @@ void BgpXmppChannel::ProcessInet6Item(string vrf_name,
         attrs.push_back(&source_rd);
 
         // SGID list
-        for (vector<int>::iterator it =
-                 item.entry.security_group_list.security_group.begin();
-             it != item.entry.security_group_list.security_group.end();
-             ++it) {
+        for (vector<int>::const_iterator it = item.security_groups.begin();
+             it != item.security_groups.end(); ++it) {
             SecurityGroup sg(bgp_server_->autonomous_system(), *it);
             ext.communities.push_back(sg.GetExtCommunityValue());
         }
 
-        if (item.entry.sequence_number) {
-            MacMobility mm(item.entry.sequence_number);
+        if (item.sequence_number) {
+            MacMobility mm(item.sequence_number);
             ext.communities.push_back(mm.GetExtCommunityValue());
         }
 
@@ -1445,7 +1342,7 @@ void BgpXmppChannel::ProcessInet6Item(string vrf_name,
 
     BGP_LOG_PEER_INSTANCE(Peer(), vrf_name,
         SandeshLevel::SYS_DEBUG, BGP_LOG_FLAG_TRACE, "Inet6 route "
-        << item.entry.nlri.address << " with next-hop " << nh_address
+        << item.address_text << " with next-hop " << nh_address
         << " and label " << label <<  " is enqueued for "
         << (add_change ? "add/change" : "delete"));
     table->Enqueue(&req);
@@ -1454,78 +1351,16 @@ void BgpXmppChannel::ProcessInet6Item(string vrf_name,
 void BgpXmppChannel::ProcessEnetItem(string vrf_name,
                                      const pugi::xml_node &node,
                                      bool add_change) {
-    autogen::EnetItemType item;
-    item.Clear();
-
-    if (!item.XmlParse(node)) {
-        BGP_LOG_PEER_INSTANCE(Peer(), vrf_name, SandeshLevel::SYS_WARN,
-                                   BGP_LOG_FLAG_ALL,
-                                   "Invalid message received");
-        return;
-    }
-
-    // NLRI ipaddress/mask
-    if (item.entry.nlri.af != BgpAf::L2Vpn) {
-        BGP_LOG_PEER_INSTANCE(Peer(), vrf_name, SandeshLevel::SYS_WARN,
-                                   BGP_LOG_FLAG_ALL,
-                                   "Unsupported address family");
-        return;
-    }
-
-    error_code error;
-    MacAddress mac_addr = MacAddress::FromString(item.entry.nlri.mac, &error);
-
-    if (error) {
+    XmppRouteItem &item = *route_item_;
+    string error;
+    if (XmppRouteItemDecoder::DecodeEnetItem(node, &item, &error) !=
+        XmppRouteItemDecoder::OK) {
         BGP_LOG_PEER_INSTANCE(Peer(), vrf_name, SandeshLevel::SYS_WARN,
-                                   BGP_LOG_FLAG_ALL,
-                                   "Bad mac address string: " <<
-                                   item.entry.nlri.mac);
+                                   BGP_LOG_FLAG_ALL, error);
         return;
     }
-
-    Ip4Prefix inet_prefix;
-    Inet6Prefix inet6_prefix;
-    IpAddress ip_addr;
-    if (!mac_addr.IsBroadcast() && !item.entry.nlri.address.empty()) {
-        size_t pos = item.entry.nlri.address.find('/');
-        if (pos == string::npos) {
-            BGP_LOG_PEER_INSTANCE(Peer(), vrf_name,
-                SandeshLevel::SYS_WARN, BGP_LOG_FLAG_ALL,
-                "Missing / in address string: " << item.entry.nlri.address);
-            return;
-        }
-
-        string plen_str = item.entry.nlri.address.substr(pos + 1);
-        if (plen_str == "32") {
-            inet_prefix =
-                Ip4Prefix::FromString(item.entry.nlri.address, &error);
-            if (error || inet_prefix.prefixlen() != 32) {
-                BGP_LOG_PEER_INSTANCE(Peer(), vrf_name,
-                    SandeshLevel::SYS_WARN, BGP_LOG_FLAG_ALL,
-                    "Bad inet address string: " <<
-                    item.entry.nlri.address);
-                return;
-            }
-            ip_addr = inet_prefix.ip4_addr();
-        } else if (plen_str == "128") {
-            inet6_prefix =
-                Inet6Prefix::FromString(item.entry.nlri.address, &error);
-            if (error || inet6_prefix.prefixlen() != 128) {
-                BGP_LOG_PEER_INSTANCE(Peer(), vrf_name,
-                    SandeshLevel::SYS_WARN, BGP_LOG_FLAG_ALL,
-                    "Bad inet6 address string: " <<
-                    item.entry.nlri.address);
-                return;
-            }
-            ip_addr = inet6_prefix.ip6_addr();
-        } else {
-            BGP_LOG_PEER_INSTANCE(Peer(), vrf_name,
-                SandeshLevel::SYS_WARN, BGP_LOG_FLAG_ALL,
-                "Bad prefix length in address string: " <<
-                item.entry.nlri.address);
-            return;
-        }
-    }
+    const MacAddress &mac_addr = item.mac;
+    const IpAddress &ip_addr = item.ip_address;
 
     RoutingInstanceMgr *instance_mgr = bgp_server_->routing_instance_mgr();
     if (!instance_mgr) {
@@ -1599,7 +1434,7 @@ void BgpXmppChannel::ProcessEnetItem(string vrf_name,
         rd = RouteDistinguisher::kZeroRd;
     }
 
-    uint32_t ethernet_tag = item.entry.nlri.ethernet_tag;
+    uint32_t ethernet_tag = item.ethernet_tag;
     EvpnPrefix evpn_prefix(rd, ethernet_tag, mac_addr, ip_addr);
 
     EvpnTable::RequestData::NextHops nexthops;
@@ -1609,86 +1444,27 @@ void BgpXmppChannel::ProcessEnetItem(string vrf_name,
 
     IpAddress nh_address(Ip4Address(0));
     uint32_t label = 0;
-    uint32_t flags = 0;
 
     if (add_change) {
         req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
         BgpAttrSpec attrs;
 
-        if (!item.entry.next_hops.next_hop.empty()) {
-            for (size_t i = 0; i < item.entry.next_hops.next_hop.size(); i++) {
-                EvpnTable::RequestData::NextHop nexthop;
-                IpAddress nhop_address(Ip4Address(0));
-
-                if (!(XmppDecodeAddress(
-                          item.entry.next_hops.next_hop[i].af,
-                          item.entry.next_hops.next_hop[i].address,
-                          &nhop_address))) {
-                    BGP_LOG_PEER(Message, Peer(), SandeshLevel::SYS_WARN,
-                                 BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                                 "Error parsing nexthop address:" <<
-                                 item.entry.next_hops.next_hop[i].address <<
-                                 " family:" <<
-                                 item.entry.next_hops.next_hop[i].af <<
-                                 " for evpn route");
-                    return;
-                }
-                if (i == 0) {
-                    nh_address = nhop_address;
-                    label = item.entry.next_hops.next_hop[0].label;
-                }
-
-                // Tunnel Encap list
-                bool no_valid_tunnel_encap = true;
-                for (vector<string>::const_iterator it =
-                     item.entry.next_hops.next_hop[i].tunnel_encapsulation_list.begin();
-                     it !=
-                     item.entry.next_hops.next_hop[i].tunnel_encapsulation_list.end();
-                     it++) {
-                    TunnelEncap tun_encap(*it);
-                    if (tun_encap.tunnel_encap() == TunnelEncapType::UNSPEC)
-                        continue;
-                    no_valid_tunnel_encap = false;
-                    if (i == 0) {
-                        ext.communities.push_back(
-                            tun_encap.GetExtCommunityValue());
-                    }
-                    nexthop.tunnel_encapsulations_.push_back(
-                        tun_encap.GetExtCommunity());
-
-                    string alt_encap_string = *it + "-contrail";
-                    TunnelEncap alt_tun_encap(alt_encap_string);
-                    if (alt_tun_encap.tunnel_encap() == TunnelEncapType::UNSPEC)
-                        continue;
-                    if (i == 0) {
-                        ext.communities.push_back(
-                            alt_tun_encap.GetExtCommunityValue());
-                    }
-                    nexthop.tunnel_encapsulations_.push_back(
-                        alt_tun_encap.GetExtCommunity());
-                }
-
-                //
-                // If all of the tunnel encaps published by agent is invalid,
-                // mark the path as infeasible
-                // If agent has not published any tunnel encap, default the
-                // tunnel encap to "gre"
-                //
-                if (!item.entry.next_hops.next_hop[i].tunnel_encapsulation_list.tunnel_encapsulation.empty() &&
-                    no_valid_tunnel_encap)
-                    flags = BgpPath::NoTunnelEncap;
-
-                nexthop.flags_ = flags;
-                nexthop.address_ = nhop_address;
-                nexthop.label_ = item.entry.next_hops.next_hop[i].label;
-                nexthop.source_rd_ = RouteDistinguisher(
-                                         nhop_address.to_v4().to_ulong(),
-                                         instance_id);
-                nexthops.push_back(nexthop);
-            }
+        int bad_nexthop = BuildNextHops(item, instance_id, &nexthops, &ext);
+        if (bad_nexthop >= 0) {
+            BGP_LOG_PEER(Message, Peer(), SandeshLevel::SYS_WARN,
+                BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
+                "Error parsing nexthop address:" <<
+                item.nexthops[bad_nexthop].address_text <<
+                " family:" << item.nexthops[bad_nexthop].af <<
+                " for evpn route");
+            return;
+        }
+        if (!nexthops.empty()) {
+            nh_address = nexthops[0].address_;
+            label = nexthops[0].label_;
         }
 
-        BgpAttrLocalPref local_pref(item.entry.local_preference);
+        BgpAttrLocalPref local_pref(item.local_preference);
         if (local_pref.local_pref != 0) {
             attrs.push_back(&local_pref);
         }
@@ -1701,15 +1477,14 @@ void BgpXmppChannel::ProcessEnetItem(string vrf_name,
         attrs.push_back(&source_rd);
 
         // SGID list
-        for (vector<int>::iterator it =
-             item.entry.security_group_list.security_group.begin();
-             it != item.entry.security_group_list.security_group.end(); ++it) {
+        for (vector<int>::const_iterator it = item.security_groups.begin();
+             it != item.security_groups.end(); ++it) {
             SecurityGroup sg(bgp_server_->autonomous_system(), *it);
             ext.communities.push_back(sg.GetExtCommunityValue());
         }
 
-        if (item.entry.sequence_number) {
-            MacMobility mm(item.entry.sequence_number);
+        if (item.sequence_number) {
+            MacMobility mm(item.sequence_number);
             ext.communities.push_back(mm.GetExtCommunityValue());
         }
 
@@ -1718,14 +1493,14 @@ void BgpXmppChannel::ProcessEnetItem(string vrf_name,
 
         PmsiTunnelSpec pmsi_spec;
         if (mac_addr.IsBroadcast()) {
-            if (!item.entry.replicator_address.empty()) {
+            if (*item.replicator_text != '\0') {
                 IpAddress replicator_address;
-                if (!XmppDecodeAddress(BgpAf::IPv4,
-                    item.entry.replicator_address, &replicator_address)) {
+                if (!XmppRouteItemDecoder::DecodeReplicatorAddress(item,
+                        &replicator_address)) {
                     BGP_LOG_PEER(Message, Peer(), SandeshLevel::SYS_WARN,
                                  BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
                                  "Error parsing replicator address: " <<
-                                 item.entry.replicator_address <<
+                                 item.replicator_text <<
                                  " for evpn route");
                     return;
                 }
@@ -1735,11 +1510,11 @@ void BgpXmppChannel::ProcessEnetItem(string vrf_name,
                 pmsi_spec.SetIdentifier(replicator_address.to_v4());
             } else {
                 pmsi_spec.tunnel_type = PmsiTunnelSpec::IngressReplication;
-                if (item.entry.assisted_replication_supported) {
+                if (item.assisted_replication_supported) {
                     pmsi_spec.tunnel_flags |= PmsiTunnelSpec::ARReplicator;
                     pmsi_spec.tunnel_flags |= PmsiTunnelSpec::LeafInfoRequired;
                 }
-                if (!item.entry.edge_replication_not_supported) {
+                if (!item.edge_replication_not_supported) {
                     pmsi_spec.tunnel_flags |=
                         PmsiTunnelSpec::EdgeReplicationSupported;
                 }
@@ -1773,8 +1548,8 @@ void BgpXmppChannel::ProcessEnetItem(string vrf_name,
 
     BGP_LOG_PEER_INSTANCE(Peer(), vrf_name,
             SandeshLevel::SYS_DEBUG, BGP_LOG_FLAG_TRACE,
-                               "Evpn route " << item.entry.nlri.mac << ","
-                               << item.entry.nlri.address
+                               "Evpn route " << item.mac_text << ","
+                               << item.address_text
                                << " with next-hop " << nh_address
                                << " and label " << label
                                <<  " is enqueued for "
@@ -1782,10 +1557,10 @@ void BgpXmppChannel::ProcessEnetItem(string vrf_name,
     table->Enqueue(&req);
 }
 
-void BgpXmppChannel::DequeueRequest(const string &table_name,
-                                    DBRequest *request) {
-    auto_ptr<DBRequest> ptr(request);
-
+// Enqueue the requests that were deferred till the table was subscribed.
+// They are handed to the table as one batch.
+void BgpXmppChannel::DequeueRequests(const string &table_name,
+                                     const vector<DBRequest *> &requests) {
     BgpTable *table = static_cast<BgpTable *>
         (bgp_server_->database()->FindTable(table_name));
     if (table == NULL || table->IsDeleted()) {
@@ -1800,7 +1575,7 @@ void BgpXmppChannel::DequeueRequest(const string &table_name,
         return;
     }
 
-    table->Enqueue(ptr.get());
+    table->EnqueueBulk(requests);
 }
 
 bool BgpXmppChannel::ResumeClose() {
@@ -1902,10 +1677,13 @@ bool BgpXmppChannel::MembershipResponseHandler(string table_name) {
             rib->set_instance_id(state.instance_id);
     }
 
+    vector<DBRequest *> requests;
     for (DeferQ::iterator it = defer_q_.find(vrf_n_table);
          it != defer_q_.end() && it->first.second == table_name; ++it) {
-        DequeueRequest(table_name, it->second);
+        requests.push_back(it->second);
     }
+    DequeueRequests(table_name, requests);
+    STLDeleteValues(&requests);
 
     // Erase all elements for the table
     defer_q_.erase(vrf_n_table);
@@ -13,6 +13,7 @@
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/queue_task.h"
 #include "bgp/bgp_ribout.h"
@@ -33,6 +34,7 @@ class BgpXmppChannelMock;
 class BgpXmppChannelManager;
 class BgpXmppChannelManagerMock;
 class XmppSession;
+struct XmppRouteItem;
 
 class BgpXmppChannel {
 public:
@@ -184,7 +186,8 @@ private:
     void UnregisterTable(BgpTable *table);
     bool MembershipResponseHandler(std::string table_name);
     void MembershipRequestCallback(IPeer *ipeer, BgpTable *table);
-    void DequeueRequest(const std::string &table_name, DBRequest *request);
+    void DequeueRequests(const std::string &table_name,
+                         const std::vector<DBRequest *> &requests);
     bool XmppDecodeAddress(int af, const std::string &address,
                            IpAddress *addrp);
     bool ResumeClose();
@@ -220,6 +223,9 @@ private:
     // Label block manager for multicast labels.
     LabelBlockManagerPtr lb_mgr_;
 
+    // Route item decoded from received messages, reused for every item.
+    boost::scoped_ptr<XmppRouteItem> route_item_;
+
     DISALLOW_COPY_AND_ASSIGN(BgpXmppChannel);
 };
 
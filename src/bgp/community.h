@@ -97,14 +97,8 @@ inline void intrusive_ptr_release(const Community *ccomm) {
 
 typedef boost::intrusive_ptr<const Community> CommunityPtr;
 
-struct CommunityCompare {
-    bool operator()(const Community *lhs, const Community *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class CommunityDB : public BgpPathAttributeDB<Community, CommunityPtr,
-                                              CommunitySpec, CommunityCompare,
+                                              CommunitySpec,
                                               CommunityDB> {
 public:
     explicit CommunityDB(BgpServer *server);
@@ -271,15 +265,8 @@ inline void intrusive_ptr_release(const ExtCommunity *cextcomm) {
 
 typedef boost::intrusive_ptr<const ExtCommunity> ExtCommunityPtr;
 
-struct ExtCommunityCompare {
-    bool operator()(const ExtCommunity *lhs, const ExtCommunity *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class ExtCommunityDB : public BgpPathAttributeDB<ExtCommunity, ExtCommunityPtr,
                                                  ExtCommunitySpec,
-                                                 ExtCommunityCompare,
                                                  ExtCommunityDB> {
 public:
     explicit ExtCommunityDB(BgpServer *server);
@@ -31,11 +31,25 @@ protected:
     uint32_t num_unreach_route_;
 };
 
+//
+// State that a MessageBuilder keeps across the messages it builds for one
+// RibOut, e.g. encodings that can be reused. It is owned by the RibOutUpdates
+// and only accessed from the bgp::SendTask of the RibOut.
+//
+class MessageCache {
+public:
+    virtual ~MessageCache() { }
+};
+
 class MessageBuilder {
 public:
+    // The cache is the one returned by CreateCache for the RibOut that the
+    // message is built for. It may be NULL.
     virtual Message *Create(const BgpTable *table,
                             const RibOutAttr *roattr,
-                            const BgpRoute *route) const = 0;
+                            const BgpRoute *route,
+                            MessageCache *cache) const = 0;
+    virtual MessageCache *CreateCache() const { return NULL; }
     static MessageBuilder *GetInstance(RibExportPolicy::Encoding encoding);
 
 private:
@@ -423,7 +423,7 @@ struct SchedulingGroup::WorkPeer : public SchedulingGroup::WorkBase {
 class SchedulingGroup::Worker : public Task {
 public:
     explicit Worker(SchedulingGroup *group)
-        : Task(send_task_id_), group_(group) {
+        : Task(send_task_id_, group->task_instance()), group_(group) {
     }
 
     virtual bool Run() {
@@ -455,7 +455,8 @@ private:
     SchedulingGroup *group_;
 };
 
-SchedulingGroup::SchedulingGroup() : running_(false), worker_task_(NULL) {
+SchedulingGroup::SchedulingGroup()
+    : running_(false), worker_task_(NULL), task_instance_(-1) {
     if (send_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         send_task_id_ = scheduler->GetTaskId("bgp::SendTask");
@@ -1238,8 +1239,7 @@ void SchedulingGroupManager::Join(RibOut *ribout, IPeerUpdate *peer) {
     if (i1 == peer_map_.end()) {
         if (i2 == ribout_map_.end()) {
             // Create new empty group
-            sg = BgpObjectFactory::Create<SchedulingGroup>();
-            groups_.push_back(sg);
+            sg = CreateGroup();
             ribout_map_.insert(make_pair(ribout, sg));
         } else {
             // Add peer to existing group
@@ -1291,8 +1291,7 @@ void SchedulingGroupManager::Leave(RibOut *ribout, IPeerUpdate *peer) {
 
     // Get rid of the group itself if it's empty.
     if (sg->empty()) {
-        groups_.remove(sg);
-        delete sg;
+        DeleteGroup(sg);
         return;
     }
 
@@ -1356,6 +1355,32 @@ void SchedulingGroupManager::Move(
     }
 }
 
+//
+// Create a new empty scheduling group and assign it the lowest free task
+// instance.
+//
+SchedulingGroup *SchedulingGroupManager::CreateGroup() {
+    CHECK_CONCURRENCY("bgp::PeerMembership");
+
+    SchedulingGroup *sg = BgpObjectFactory::Create<SchedulingGroup>();
+    size_t task_instance = task_instances_.find_first_clear();
+    task_instances_.set(task_instance);
+    sg->set_task_instance(task_instance);
+    groups_.push_back(sg);
+    return sg;
+}
+
+//
+// Delete the scheduling group and release its task instance for reuse.
+//
+void SchedulingGroupManager::DeleteGroup(SchedulingGroup *sg) {
+    CHECK_CONCURRENCY("bgp::PeerMembership");
+
+    groups_.remove(sg);
+    task_instances_.reset(sg->task_instance());
+    delete sg;
+}
+
 //
 // Merge the two scheduling groups and return a pointer to the combined one.
 //
@@ -1371,8 +1396,7 @@ SchedulingGroup *SchedulingGroupManager::Merge(
     // Now update the state in the first SchedulingGroup and delete the
     // second one.
     sg->Merge(sg2);
-    groups_.remove(sg2);
-    delete sg2;
+    DeleteGroup(sg2);
 
     return sg;
 }
@@ -1386,8 +1410,7 @@ void SchedulingGroupManager::Split(
         SchedulingGroup *sg, const RibOutList &rg1, const RibOutList &rg2) {
     CHECK_CONCURRENCY("bgp::PeerMembership");
 
-    SchedulingGroup *sg2 = BgpObjectFactory::Create<SchedulingGroup>();
-    groups_.push_back(sg2);
+    SchedulingGroup *sg2 = CreateGroup();
 
     // Note that calling the Split method results in the creation of all
     // necessary PeerState and RibOutState in sg2. Hence, there's no typo
@@ -55,6 +55,13 @@ class GroupPeerSet : public BitSet {
 // WorkRibOut entry after adding a RouteUpdate to an empty UpdateQueue, and
 // the IPeer class which create a WorkPeer entry when it becomes unblocked.
 //
+// The Worker runs as a bgp::SendTask with the task instance of the group.
+// SchedulingGroups share no RibOut or IPeerUpdate state, so Workers of
+// different groups run in parallel, while the scheduler guarantees that at
+// most one Worker runs per group. The SchedulingGroupManager allocates the
+// instances and reuses them as groups get deleted, so the number of task
+// instances is bounded by the number of groups.
+//
 class SchedulingGroup {
 public:
     typedef std::vector<RibOut *> RibOutList;
@@ -103,6 +110,12 @@ public:
     void clear();
     bool empty() const;
 
+    // Task instance of the Worker, -1 if none is assigned.
+    int task_instance() const { return task_instance_; }
+    void set_task_instance(int task_instance) {
+        task_instance_ = task_instance;
+    }
+
 protected:
     bool running_;
 
@@ -161,6 +174,7 @@ private:
     tbb::mutex mutex_;
     WorkQueue work_queue_;
     Worker *worker_task_;
+    int task_instance_;
 
     PeerStateMap peer_state_imap_;
     RibStateMap rib_state_imap_;
@@ -179,7 +193,8 @@ private:
 // allow fast lookup.
 //
 // It also maintains a non-intrusive list of SchedulingGroup. This is used to
-// iterate through all SchedulingGroups.
+// iterate through all SchedulingGroups, and a BitSet of the bgp::SendTask
+// instances assigned to the SchedulingGroups.
 //
 // The send ready WorkQueue is needed to process send ready notifications for
 // IPeers in the context of the bgp send task. Comments for SendReadyCallback
@@ -222,7 +237,11 @@ private:
 
     void Move(SchedulingGroup *group, SchedulingGroup *dst);
 
+    SchedulingGroup *CreateGroup();
+    void DeleteGroup(SchedulingGroup *sg);
+
     GroupList groups_;
+    BitSet task_instances_;
     PeerMap peer_map_;
     RibOutMap ribout_map_;
 
@@ -12,6 +12,7 @@
 #include "base/logging.h"
 #include "base/task.h"
 #include "base/test/task_test_util.h"
+#include "base/time_util.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_server.h"
 #include "bgp/origin-vn/origin_vn.h"
@@ -2098,6 +2099,111 @@ TEST_F(BgpAttrTest, EdgeForwardingDBConcurrency) {
                     EdgeForwardingSpec>(edge_forwarding_db_);
 }
 
+//
+// Verify that many distinct attributes can be located, looked up again and
+// released in an order different from the insertion order.
+//
+TEST_F(BgpAttrTest, BgpAttrDBScale) {
+    const int kAttrCount = 4096;
+    std::vector<BgpAttrPtr> attrs;
+
+    for (int idx = 0; idx < kAttrCount; ++idx) {
+        BgpAttrSpec spec;
+        BgpAttrNextHop nexthop(0x0a000000 + idx);
+        spec.push_back(&nexthop);
+        BgpAttrLocalPref local_pref(idx % 7);
+        spec.push_back(&local_pref);
+        attrs.push_back(attr_db_->Locate(spec));
+    }
+    EXPECT_EQ(kAttrCount, attr_db_->Size());
+
+    for (int idx = 0; idx < kAttrCount; ++idx) {
+        BgpAttrSpec spec;
+        BgpAttrNextHop nexthop(0x0a000000 + idx);
+        spec.push_back(&nexthop);
+        BgpAttrLocalPref local_pref(idx % 7);
+        spec.push_back(&local_pref);
+        EXPECT_EQ(attrs[idx], attr_db_->Locate(spec));
+    }
+    EXPECT_EQ(kAttrCount, attr_db_->Size());
+
+    for (int step = 0; step < 4; ++step) {
+        for (int idx = step; idx < kAttrCount; idx += 4) {
+            attrs[idx].reset();
+        }
+        EXPECT_EQ(kAttrCount - (step + 1) * kAttrCount / 4, attr_db_->Size());
+    }
+}
+
+//
+// Measure Locate/Release throughput of the attribute databases from
+// multiple threads. Each thread locates attributes from a set shared by all
+// threads, each with its own olist, and releases them right away, so that
+// lookups, inserts and deletes are all exercised.
+//
+struct BenchmarkThreadArgs {
+    BgpAttrDB *db;
+    int thread_index;
+    int iterations;
+    int attr_count;
+};
+
+static void *BenchmarkThreadRun(void *objp) {
+    BenchmarkThreadArgs *args = reinterpret_cast<BenchmarkThreadArgs *>(objp);
+    for (int iter = 0; iter < args->iterations; ++iter) {
+        int idx = (args->thread_index + iter) % args->attr_count;
+        BgpAttrSpec spec;
+        BgpAttrNextHop nexthop(0x0a000000 + idx);
+        spec.push_back(&nexthop);
+        BgpAttrLocalPref local_pref(100);
+        spec.push_back(&local_pref);
+        BgpOListSpec olist_spec(BgpAttribute::OList);
+        olist_spec.elements.push_back(
+            BgpOListElem(Ip4Address(0x14000000 + idx), 1000 + idx));
+        spec.push_back(&olist_spec);
+        BgpAttrPtr attr = args->db->Locate(spec);
+        EXPECT_EQ(Ip4Address(0x0a000000 + idx), attr->nexthop().to_v4());
+    }
+    return NULL;
+}
+
+// The default size is small; set BGP_ATTR_TEST_BENCHMARK_THREAD_COUNT=8 and
+// BGP_ATTR_TEST_BENCHMARK_ITERATIONS=100000 for a full run.
+TEST_F(BgpAttrTest, LocateReleaseBenchmark) {
+    int thread_count = 4;
+    int iterations = 1000;
+    int attr_count = 64;
+    char *str = getenv("BGP_ATTR_TEST_BENCHMARK_THREAD_COUNT");
+    if (str) thread_count = strtoul(str, NULL, 0);
+    str = getenv("BGP_ATTR_TEST_BENCHMARK_ITERATIONS");
+    if (str) iterations = strtoul(str, NULL, 0);
+    str = getenv("BGP_ATTR_TEST_BENCHMARK_ATTR_COUNT");
+    if (str) attr_count = strtoul(str, NULL, 0);
+
+    std::vector<BenchmarkThreadArgs> args(thread_count);
+    std::vector<pthread_t> thread_ids;
+    uint64_t start = ClockMonotonicUsec();
+    for (int i = 0; i < thread_count; i++) {
+        args[i].db = attr_db_;
+        args[i].thread_index = i;
+        args[i].iterations = iterations;
+        args[i].attr_count = attr_count;
+        pthread_t tid;
+        if (!pthread_create(&tid, NULL, &BenchmarkThreadRun, &args[i])) {
+            thread_ids.push_back(tid);
+        }
+    }
+    BOOST_FOREACH(pthread_t tid, thread_ids) { pthread_join(tid, NULL); }
+    uint64_t usecs = ClockMonotonicUsec() - start + 1;
+
+    uint64_t locates = uint64_t(thread_ids.size()) * iterations;
+    LOG(DEBUG, "Locate/Release " << locates << " attributes from " <<
+        thread_ids.size() << " threads in " << usecs << " usecs, " <<
+        locates * 1000000 / usecs << " per sec");
+    EXPECT_EQ(0, attr_db_->Size());
+    EXPECT_EQ(0, olist_db_->Size());
+}
+
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
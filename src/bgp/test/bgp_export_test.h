@@ -134,10 +134,11 @@ public:
 
     virtual Message *Create(const BgpTable *table,
                             const RibOutAttr *attr,
-                            const BgpRoute *route) const {
+                            const BgpRoute *route,
+                            MessageCache *cache) const {
         msg_count_++;
         if (use_bgp_messages) {
-            return BgpMessageBuilder::Create(table, attr, route);
+            return BgpMessageBuilder::Create(table, attr, route, cache);
         } else {
             return new MessageMock();
         }
@@ -185,6 +185,66 @@ TEST_F(BgpMsgBuilderTest, Build) {
     delete ext_community;
     delete result;
 }
+
+//
+// Verify that the encoded attributes are cached on the BgpAttr and that
+// messages built from the cache are identical to the original.
+//
+TEST_F(BgpMsgBuilderTest, AttrCache) {
+    BgpAttrSpec attr;
+    BgpAttrNextHop nexthop(0xabcdef01);
+    attr.push_back(&nexthop);
+    BgpAttrLocalPref lp(2);
+    attr.push_back(&lp);
+
+    RibOutAttr rib_out_attr;
+    rib_out_attr.set_attr(server_.attr_db()->Locate(attr));
+    EXPECT_TRUE(rib_out_attr.attr()->GetWireEncoding(
+        BgpAf::IPv4, BgpAf::Vpn) == NULL);
+
+    InetVpnPrefix p1 = InetVpnPrefix::FromString("12345:2:1.1.1.1/24");
+    InetVpnRoute route(p1);
+    BgpPath *path =
+        new BgpPath(peer_, BgpPath::BGP_XMPP, rib_out_attr.attr(), 0, 0);
+    route.InsertPath(path);
+
+    uint64_t hits = BgpMessage::attr_cache_hits();
+    uint64_t misses = BgpMessage::attr_cache_misses();
+
+    BgpMessage message1;
+    message1.Start(&rib_out_attr, &route);
+    EXPECT_EQ(hits, BgpMessage::attr_cache_hits());
+    EXPECT_EQ(misses + 1, BgpMessage::attr_cache_misses());
+    EXPECT_TRUE(rib_out_attr.attr()->GetWireEncoding(
+        BgpAf::IPv4, BgpAf::Vpn) != NULL);
+
+    BgpMessage message2;
+    message2.Start(&rib_out_attr, &route);
+    EXPECT_EQ(hits + 1, BgpMessage::attr_cache_hits());
+    EXPECT_EQ(misses + 1, BgpMessage::attr_cache_misses());
+    EXPECT_EQ(1, message2.num_reach_routes());
+
+    size_t length1, length2;
+    const uint8_t *data1 = message1.GetData(NULL, &length1);
+    const uint8_t *data2 = message2.GetData(NULL, &length2);
+    ASSERT_EQ(length1, length2);
+    EXPECT_EQ(0, memcmp(data1, data2, length1));
+
+    const BgpProto::Update *result = static_cast<const BgpProto::Update *>(
+        BgpProto::Decode(data2, length2));
+    ASSERT_TRUE(result != NULL);
+    BgpMpNlri *nlri =
+        static_cast<BgpMpNlri *>(*(result->path_attributes.end() - 1));
+    EXPECT_EQ(1, nlri->nlri.size());
+    BgpProtoPrefix prefix;
+    route.BuildProtoPrefix(&prefix, 0);
+    EXPECT_EQ(prefix.prefixlen, nlri->nlri[0]->prefixlen);
+    EXPECT_EQ(prefix.prefix, nlri->nlri[0]->prefix);
+
+    route.RemovePath(peer_);
+    delete result;
+}
+
 }  // namespace
 
 static void SetUp() {
@@ -12,6 +12,7 @@
 #include "base/logging.h"
 #include "base/task.h"
 #include "base/task_annotations.h"
+#include "base/time_util.h"
 #include "base/util.h"
 #include "base/test/task_test_util.h"
 #include "bgp/bgp_attr.h"
@@ -122,7 +123,8 @@ public:
     };
     virtual Message *Create(const BgpTable *table,
                             const RibOutAttr *attr,
-                            const BgpRoute *route) const {
+                            const BgpRoute *route,
+                            MessageCache *cache) const {
         return new MessageMock();
     }
 };
@@ -529,6 +531,92 @@ TEST_F(BgpUpdate2RibTest, WithBlock) {
     STLDeleteValues(&routes);
 }
 
+//
+// Time to drain the updates of a number of scheduling groups, each with its
+// own RibOut and peers. The Workers of the groups run in parallel. The
+// default size is small; set BGP_UPDATE_TEST_GROUP_COUNT=16 and
+// BGP_UPDATE_TEST_ROUTE_COUNT=10000 for a full run.
+//
+class BgpUpdateGroupTest : public BgpUpdateTest {
+protected:
+    typedef BgpUpdateTest Base;
+
+    BgpUpdateGroupTest() : group_count_(4), route_count_(1000) {
+        char *str = getenv("BGP_UPDATE_TEST_GROUP_COUNT");
+        if (str) group_count_ = strtoul(str, NULL, 0);
+        str = getenv("BGP_UPDATE_TEST_ROUTE_COUNT");
+        if (str) route_count_ = strtoul(str, NULL, 0);
+    }
+
+    virtual void SetUp() {
+        Base::SetUp();
+
+        for (size_t i = 0; i < group_count_; i++) {
+            RibOut *ribout = new RibOut(inetvpn_table_, &mgr_,
+                                        RibExportPolicy());
+            ribout->updates()->SetMessageBuilder(&builder_);
+            ribouts_.push_back(ribout);
+            for (int j = 0; j < kPeerCount; j++) {
+                BgpTestPeer *peer = new BgpTestPeer();
+                peers_.push_back(peer);
+                RibOutRegister(ribout, peer);
+            }
+        }
+    }
+
+    void EnqueueRoutes(RibOut *ribout, vector<InetVpnRoute *> *routes) {
+        ConcurrencyScope scope("db::DBTable");
+        InetVpnPrefix prefix(InetVpnPrefix::FromString("0:0:192.168.24.0/24"));
+        for (size_t i = 0; i < route_count_; i++) {
+            InetVpnRoute *rt = new InetVpnRoute(prefix);
+            routes->push_back(rt);
+            RouteUpdate *update =
+                BuildUpdate(rt, *ribout, attr_[i % kAttrCount]);
+            ribout->updates()->Enqueue(rt, update);
+        }
+    }
+
+    size_t group_count_;
+    size_t route_count_;
+    boost::ptr_vector<RibOut> ribouts_;
+};
+
+TEST_F(BgpUpdateGroupTest, Drain) {
+    std::set<int> task_instances;
+    for (size_t i = 0; i < ribouts_.size(); i++) {
+        SchedulingGroup *sg = ribouts_[i].GetSchedulingGroup();
+        ASSERT_TRUE(sg != NULL);
+        task_instances.insert(sg->task_instance());
+    }
+    EXPECT_EQ(group_count_, task_instances.size());
+
+    vector<vector<InetVpnRoute *> > routes(group_count_);
+    TaskScheduler::GetInstance()->Stop();
+    for (size_t i = 0; i < ribouts_.size(); i++) {
+        EnqueueRoutes(&ribouts_[i], &routes[i]);
+    }
+    uint64_t start = ClockMonotonicUsec();
+    TaskScheduler::GetInstance()->Start();
+    task_util::WaitForIdle();
+    uint64_t elapsed = ClockMonotonicUsec() - start;
+
+    for (size_t i = 0; i < ribouts_.size(); i++) {
+        TASK_UTIL_EXPECT_TRUE(ribouts_[i].updates()->Empty());
+    }
+    for (size_t i = kPeerCount; i < peers_.size(); i++) {
+        EXPECT_NE(0, peers_[i].update_count());
+    }
+    LOG(DEBUG, group_count_ << " groups, " << route_count_
+        << " routes per group: drained in " << elapsed / 1000 << " msec");
+
+    for (size_t i = 0; i < ribouts_.size(); i++) {
+        BOOST_FOREACH(BgpRoute *route, routes[i]) {
+            DeleteRouteState(&ribouts_[i], route);
+        }
+        STLDeleteValues(&routes[i]);
+    }
+}
+
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <pugixml/pugixml.hpp>
+
+#include <sstream>
+
+#include "base/logging.h"
+#include "base/time_util.h"
+#include "bgp/inet/inet_route.h"
+#include "bgp/tunnel_encap/tunnel_encap.h"
+#include "bgp/xmpp_item_decoder.h"
+#include "net/bgp_af.h"
+#include "schema/xmpp_enet_types.h"
+#include "schema/xmpp_unicast_types.h"
+#include "testing/gunit.h"
+
+using namespace std;
+using pugi::xml_document;
+using pugi::xml_node;
+
+namespace {
+
+static string NextHopXml(const string &address, int label,
+                         const vector<string> &encaps) {
+    ostringstream oss;
+    oss << "<next-hop><af>1</af><address>" << address << "</address>"
+        << "<label>" << label << "</label><tunnel-encapsulation-list>";
+    for (size_t i = 0; i < encaps.size(); ++i) {
+        oss << "<tunnel-encapsulation>" << encaps[i]
+            << "</tunnel-encapsulation>";
+    }
+    oss << "</tunnel-encapsulation-list></next-hop>";
+    return oss.str();
+}
+
+static string InetItemXml(int af, int safi, const string &address,
+                          const string &nexthops) {
+    ostringstream oss;
+    oss << "<item id=\"" << address << "\">"
+        << "<entry xmlns=\"http://ietf.org/protocol/bgpvpn\">"
+        << "<nlri><af>" << af << "</af><safi>" << safi << "</safi>"
+        << "<address>" << address << "</address></nlri>"
+        << "<next-hops>" << nexthops << "</next-hops>"
+        << "<version>1</version>"
+        << "<virtual-network>default-domain:demo:vn1</virtual-network>"
+        << "<sequence-number>7</sequence-number>"
+        << "<security-group-list><security-group>8000001</security-group>"
+        << "<security-group>8000002</security-group></security-group-list>"
+        << "<local-preference>200</local-preference>"
+        << "</entry></item>";
+    return oss.str();
+}
+
+static string EnetItemXml(const string &mac, const string &address,
+                          const string &nexthops,
+                          const string &replicator) {
+    ostringstream oss;
+    oss << "<item id=\"" << mac << "," << address << "\">"
+        << "<entry xmlns=\"http://ietf.org/protocol/bgpvpn\">"
+        << "<nlri><af>25</af><safi>242</safi>"
+        << "<ethernet-tag>100</ethernet-tag>"
+        << "<mac>" << mac << "</mac>"
+        << "<address>" << address << "</address></nlri>"
+        << "<next-hops>" << nexthops << "</next-hops>"
+        << "<local-preference>100</local-preference>"
+        << "<edge-replication-not-supported>true"
+        << "</edge-replication-not-supported>"
+        << "<assisted-replication-supported>false"
+        << "</assisted-replication-supported>"
+        << "<replicator-address>" << replicator << "</replicator-address>"
+        << "</entry></item>";
+    return oss.str();
+}
+
+//
+// Decode an inet item the way BgpXmppChannel::ProcessItem used to, through
+// the autogen ItemType. Serves as the baseline for correctness and
+// performance comparisons.
+//
+static bool AutogenDecode(const xml_node &node, Ip4Prefix *prefix,
+                          vector<IpAddress> *addresses,
+                          vector<TunnelEncap::bytes_type> *encaps) {
+    autogen::ItemType item;
+    item.Clear();
+    if (!item.XmlParse(node))
+        return false;
+    if (item.entry.nlri.af != BgpAf::IPv4)
+        return false;
+
+    boost::system::error_code error;
+    *prefix = Ip4Prefix::FromString(item.entry.nlri.address, &error);
+    if (error)
+        return false;
+
+    for (size_t i = 0; i < item.entry.next_hops.next_hop.size(); i++) {
+        const autogen::NextHopType &nexthop = item.entry.next_hops.next_hop[i];
+        addresses->push_back(IpAddress::from_string(nexthop.address, error));
+        if (error)
+            return false;
+        for (vector<string>::const_iterator it =
+             nexthop.tunnel_encapsulation_list.begin();
+             it != nexthop.tunnel_encapsulation_list.end(); ++it) {
+            TunnelEncap tun_encap(*it);
+            if (tun_encap.tunnel_encap() == TunnelEncapType::UNSPEC)
+                continue;
+            encaps->push_back(tun_encap.GetExtCommunity());
+            TunnelEncap alt_tun_encap(*it + "-contrail");
+            if (alt_tun_encap.tunnel_encap() == TunnelEncapType::UNSPEC)
+                continue;
+            encaps->push_back(alt_tun_encap.GetExtCommunity());
+        }
+    }
+    return true;
+}
+
+class BgpXmppItemDecoderTest : public ::testing::Test {
+protected:
+    xml_node Load(const string &xml) {
+        EXPECT_TRUE(xdoc_.load_buffer(xml.data(), xml.size()));
+        return xdoc_.first_child();
+    }
+
+    xml_document xdoc_;
+    XmppRouteItem item_;
+    string error_;
+};
+
+TEST_F(BgpXmppItemDecoderTest, Inet) {
+    vector<string> encaps;
+    encaps.push_back("gre");
+    encaps.push_back("udp");
+    encaps.push_back("bogus");
+    string nexthops = NextHopXml("10.1.1.1", 10000, encaps) +
+        NextHopXml("10.1.1.2", 10001, vector<string>());
+    xml_node node = Load(InetItemXml(BgpAf::IPv4, BgpAf::Unicast,
+                                     "192.168.1.0/24", nexthops));
+
+    EXPECT_EQ(XmppRouteItemDecoder::OK,
+              XmppRouteItemDecoder::DecodeInetItem(node, &item_, &error_));
+    EXPECT_EQ(BgpAf::IPv4, item_.af);
+    EXPECT_EQ(BgpAf::Unicast, item_.safi);
+    EXPECT_EQ("192.168.1.0/24", item_.inet_prefix.ToString());
+    EXPECT_EQ(200, item_.local_preference);
+    EXPECT_EQ(7, item_.sequence_number);
+    ASSERT_EQ(2, item_.security_groups.size());
+    EXPECT_EQ(8000001, item_.security_groups[0]);
+    EXPECT_EQ(8000002, item_.security_groups[1]);
+
+    ASSERT_EQ(2, item_.nexthops.size());
+    const XmppRouteItem::NextHop &nh0 = item_.nexthops[0];
+    EXPECT_TRUE(nh0.address_valid);
+    EXPECT_EQ("10.1.1.1", nh0.address.to_string());
+    EXPECT_EQ(10000, nh0.label);
+    EXPECT_EQ(3, nh0.encap_list_size);
+    ASSERT_EQ(3, nh0.encaps.size());
+    EXPECT_EQ(TunnelEncapType::MPLS_O_GRE, nh0.encaps[0]);
+    EXPECT_EQ(TunnelEncapType::MPLS_O_UDP, nh0.encaps[1]);
+    EXPECT_EQ(TunnelEncapType::MPLS_O_UDP_CONTRAIL, nh0.encaps[2]);
+    const XmppRouteItem::NextHop &nh1 = item_.nexthops[1];
+    EXPECT_EQ("10.1.1.2", nh1.address.to_string());
+    EXPECT_EQ(0, nh1.encap_list_size);
+
+    // Same prefix, addresses and encapsulations as the autogen path
+    Ip4Prefix prefix;
+    vector<IpAddress> addresses;
+    vector<TunnelEncap::bytes_type> tunnel_encaps;
+    EXPECT_TRUE(AutogenDecode(node, &prefix, &addresses, &tunnel_encaps));
+    EXPECT_EQ(prefix, item_.inet_prefix);
+    ASSERT_EQ(2, addresses.size());
+    EXPECT_EQ(addresses[0], nh0.address);
+    EXPECT_EQ(addresses[1], nh1.address);
+    ASSERT_EQ(nh0.encaps.size(), tunnel_encaps.size());
+    for (size_t i = 0; i < tunnel_encaps.size(); ++i) {
+        EXPECT_TRUE(TunnelEncap(nh0.encaps[i]).GetExtCommunity() ==
+                    tunnel_encaps[i]);
+    }
+}
+
+TEST_F(BgpXmppItemDecoderTest, InetErrors) {
+    string nexthops = NextHopXml("10.1.1.1", 10000, vector<string>());
+    xml_node node = Load(InetItemXml(BgpAf::IPv6, BgpAf::Unicast,
+                                     "192.168.1.0/24", nexthops));
+    EXPECT_EQ(XmppRouteItemDecoder::BAD_AFI_SAFI,
+              XmppRouteItemDecoder::DecodeInetItem(node, &item_, &error_));
+
+    node = Load(InetItemXml(BgpAf::IPv4, BgpAf::Unicast, "192.168.1.0",
+                            nexthops));
+    EXPECT_EQ(XmppRouteItemDecoder::BAD_PREFIX,
+              XmppRouteItemDecoder::DecodeInetItem(node, &item_, &error_));
+    EXPECT_EQ("Bad address string: 192.168.1.0", error_);
+
+    node = Load(InetItemXml(BgpAf::IPv4, BgpAf::Unicast, "192.168.300.0/24",
+                            nexthops));
+    EXPECT_EQ(XmppRouteItemDecoder::BAD_PREFIX,
+              XmppRouteItemDecoder::DecodeInetItem(node, &item_, &error_));
+
+    // Bad label value
+    node = Load(InetItemXml(BgpAf::IPv4, BgpAf::Unicast, "192.168.1.0/24",
+        "<next-hop><af>1</af><address>10.1.1.1</address>"
+        "<label>x10</label></next-hop>"));
+    EXPECT_EQ(XmppRouteItemDecoder::BAD_XML,
+              XmppRouteItemDecoder::DecodeInetItem(node, &item_, &error_));
+
+    // Bad next-hop addresses are only flagged
+    node = Load(InetItemXml(BgpAf::IPv4, BgpAf::Unicast, "192.168.1.0/24",
+                            NextHopXml("10.1.1", 10000, vector<string>())));
+    EXPECT_EQ(XmppRouteItemDecoder::OK,
+              XmppRouteItemDecoder::DecodeInetItem(node, &item_, &error_));
+    ASSERT_EQ(1, item_.nexthops.size());
+    EXPECT_FALSE(item_.nexthops[0].address_valid);
+    EXPECT_STREQ("10.1.1", item_.nexthops[0].address_text);
+}
+
+TEST_F(BgpXmppItemDecoderTest, Inet6) {
+    string nexthops = NextHopXml("10.1.1.1", 10000, vector<string>());
+    xml_node node = Load(InetItemXml(BgpAf::IPv6, BgpAf::Unicast,
+                                     "2001:db8::/64", nexthops));
+    EXPECT_EQ(XmppRouteItemDecoder::OK,
+              XmppRouteItemDecoder::DecodeInet6Item(node, &item_, &error_));
+    EXPECT_EQ("2001:db8::/64", item_.inet6_prefix.ToString());
+
+    node = Load(InetItemXml(BgpAf::IPv6, BgpAf::Mcast, "2001:db8::/64",
+                            nexthops));
+    EXPECT_EQ(XmppRouteItemDecoder::BAD_AFI_SAFI,
+              XmppRouteItemDecoder::DecodeInet6Item(node, &item_, &error_));
+
+    node = Load(InetItemXml(BgpAf::IPv6, BgpAf::Unicast, "2001:db8::/129",
+                            nexthops));
+    EXPECT_EQ(XmppRouteItemDecoder::BAD_PREFIX,
+              XmppRouteItemDecoder::DecodeInet6Item(node, &item_, &error_));
+}
+
+TEST_F(BgpXmppItemDecoderTest, Enet) {
+    vector<string> encaps;
+    encaps.push_back("vxlan");
+    string nexthops = NextHopXml("10.1.1.1", 20, encaps);
+    xml_node node = Load(EnetItemXml("00:01:02:03:04:05", "10.1.2.3/32",
+                                     nexthops, ""));
+    EXPECT_EQ(XmppRouteItemDecoder::OK,
+              XmppRouteItemDecoder::DecodeEnetItem(node, &item_, &error_));
+    EXPECT_EQ("00:01:02:03:04:05", item_.mac.ToString());
+    EXPECT_EQ("10.1.2.3", item_.ip_address.to_string());
+    EXPECT_EQ(100, item_.ethernet_tag);
+    EXPECT_TRUE(item_.edge_replication_not_supported);
+    EXPECT_FALSE(item_.assisted_replication_supported);
+    ASSERT_EQ(1, item_.nexthops.size());
+    ASSERT_EQ(2, item_.nexthops[0].encaps.size());
+    EXPECT_EQ(TunnelEncapType::VXLAN, item_.nexthops[0].encaps[0]);
+    EXPECT_EQ(TunnelEncapType::VXLAN_CONTRAIL, item_.nexthops[0].encaps[1]);
+
+    node = Load(EnetItemXml("00:01:02:03:04:05", "2001:db8::1/128",
+                            nexthops, ""));
+    EXPECT_EQ(XmppRouteItemDecoder::OK,
+              XmppRouteItemDecoder::DecodeEnetItem(node, &item_, &error_));
+    EXPECT_EQ("2001:db8::1", item_.ip_address.to_string());
+
+    // The address of broadcast items is ignored
+    node = Load(EnetItemXml("ff:ff:ff:ff:ff:ff", "junk", nexthops,
+                            "10.1.1.9"));
+    EXPECT_EQ(XmppRouteItemDecoder::OK,
+              XmppRouteItemDecoder::DecodeEnetItem(node, &item_, &error_));
+    EXPECT_TRUE(item_.mac.IsBroadcast());
+    IpAddress replicator;
+    EXPECT_TRUE(XmppRouteItemDecoder::DecodeReplicatorAddress(item_,
+                                                              &replicator));
+    EXPECT_EQ("10.1.1.9", replicator.to_string());
+
+    node = Load(EnetItemXml("00:01:02:03:04", "", nexthops, ""));
+    EXPECT_EQ(XmppRouteItemDecoder::BAD_PREFIX,
+              XmppRouteItemDecoder::DecodeEnetItem(node, &item_, &error_));
+    node = Load(EnetItemXml("00:01:02:03:04:05", "10.1.2.3", nexthops, ""));
+    EXPECT_EQ(XmppRouteItemDecoder::BAD_PREFIX,
+              XmppRouteItemDecoder::DecodeEnetItem(node, &item_, &error_));
+    EXPECT_EQ("Missing / in address string: 10.1.2.3", error_);
+    node = Load(EnetItemXml("00:01:02:03:04:05", "10.1.2.0/24", nexthops,
+                            ""));
+    EXPECT_EQ(XmppRouteItemDecoder::BAD_PREFIX,
+              XmppRouteItemDecoder::DecodeEnetItem(node, &item_, &error_));
+}
+
+//
+// Compare items/sec of the decoder against the autogen path, on a single
+// thread, for a message with many inet items.
+//
+TEST_F(BgpXmppItemDecoderTest, Benchmark) {
+    int item_count = 1000;
+    int message_count = 100;
+    char *str = getenv("XMPP_ITEM_DECODER_TEST_MESSAGE_COUNT");
+    if (str) message_count = strtoul(str, NULL, 0);
+
+    vector<string> encaps;
+    encaps.push_back("gre");
+    encaps.push_back("udp");
+    string nexthops = NextHopXml("10.1.1.1", 10000, encaps);
+    string xml("<items node=\"1/1/default-domain:demo:vn1\">");
+    for (int idx = 0; idx < item_count; ++idx) {
+        Ip4Prefix prefix(Ip4Address(0x14000000 + idx), 32);
+        xml += InetItemXml(BgpAf::IPv4, BgpAf::Unicast, prefix.ToString(),
+                           nexthops);
+    }
+    xml += "</items>";
+    xml_node items = Load(xml);
+
+    size_t decoder_count = 0;
+    uint64_t start = ClockMonotonicUsec();
+    for (int msg = 0; msg < message_count; ++msg) {
+        for (xml_node node = items.first_child(); node;
+             node = node.next_sibling()) {
+            if (XmppRouteItemDecoder::DecodeInetItem(node, &item_, &error_) ==
+                XmppRouteItemDecoder::OK) {
+                decoder_count++;
+            }
+        }
+    }
+    uint64_t decoder_usecs = ClockMonotonicUsec() - start + 1;
+
+    size_t autogen_count = 0;
+    start = ClockMonotonicUsec();
+    for (int msg = 0; msg < message_count; ++msg) {
+        for (xml_node node = items.first_child(); node;
+             node = node.next_sibling()) {
+            Ip4Prefix prefix;
+            vector<IpAddress> addresses;
+            vector<TunnelEncap::bytes_type> tunnel_encaps;
+            if (AutogenDecode(node, &prefix, &addresses, &tunnel_encaps)) {
+                autogen_count++;
+            }
+        }
+    }
+    uint64_t autogen_usecs = ClockMonotonicUsec() - start + 1;
+
+    size_t total = item_count * message_count;
+    EXPECT_EQ(total, decoder_count);
+    EXPECT_EQ(total, autogen_count);
+    cout << total << " items: decoder "
+         << total * 1000000ULL / decoder_usecs << " items/sec, autogen "
+         << total * 1000000ULL / autogen_usecs << " items/sec" << endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
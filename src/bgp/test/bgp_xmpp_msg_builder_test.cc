@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <pugixml/pugixml.hpp>
+
+#include <sstream>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/task_annotations.h"
+#include "base/time_util.h"
+#include "base/test/task_test_util.h"
+#include "testing/gunit.h"
+
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_config.h"
+#include "bgp/bgp_factory.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_ribout.h"
+#include "bgp/bgp_server.h"
+#include "bgp/bgp_table.h"
+#include "bgp/inet/inet_route.h"
+#include "bgp/routing-instance/routing_instance.h"
+#include "bgp/xmpp_message_builder.h"
+#include "control-node/control_node.h"
+#include "io/event_manager.h"
+#include "schema/xmpp_unicast_types.h"
+#include "xmpp/xmpp_init.h"
+
+using namespace std;
+using pugi::xml_document;
+using pugi::xml_node;
+
+namespace {
+
+class PeerUpdateMock : public IPeerUpdate {
+public:
+    explicit PeerUpdateMock(const string &name) : name_(name) { }
+    virtual string ToString() const { return name_; }
+    virtual bool SendUpdate(const uint8_t *msg, size_t msgsize) {
+        return true;
+    }
+
+private:
+    string name_;
+};
+
+//
+// Reference DOM based encoding of a unicast message. This is how
+// BgpXmppMessage used to build inet items and serves as the baseline for
+// correctness and performance comparisons.
+//
+static string DomEncode(const BgpTable *table, const RibOutAttr *roattr,
+                        const vector<InetRoute *> &routes,
+                        const string &to) {
+    xml_document xdoc;
+    xml_node message = xdoc.append_child("message");
+    message.append_attribute("from") = XmppInit::kControlNodeJID;
+    message.append_attribute("to") = to.c_str();
+    xml_node event = message.append_child("event");
+    event.append_attribute("xmlns") = "http://jabber.org/protocol/pubsub";
+    xml_node xitems = event.append_child("items");
+
+    stringstream ss;
+    ss << routes[0]->Afi() << "/" << int(routes[0]->XmppSafi()) << "/" <<
+          table->routing_instance()->name();
+    xitems.append_attribute("node") = ss.str().c_str();
+
+    BOOST_FOREACH(const InetRoute *route, routes) {
+        autogen::ItemType item;
+        item.entry.nlri.af = route->Afi();
+        item.entry.nlri.safi = route->XmppSafi();
+        item.entry.nlri.address = route->ToString();
+        item.entry.version = 1;
+        item.entry.virtual_network = "unresolved";
+        item.entry.local_preference = roattr->attr()->local_pref();
+        item.entry.sequence_number = 0;
+        BOOST_FOREACH(RibOutAttr::NextHop nexthop, roattr->nexthop_list()) {
+            autogen::NextHopType item_nexthop;
+            item_nexthop.af = route->NexthopAfi();
+            item_nexthop.address = nexthop.address().to_v4().to_string();
+            item_nexthop.label = nexthop.label();
+            item_nexthop.tunnel_encapsulation_list.tunnel_encapsulation.
+                push_back("gre");
+            item.entry.next_hops.next_hop.push_back(item_nexthop);
+        }
+        xml_node node = xitems.append_child("item");
+        node.append_attribute("id") = route->ToXmppIdString().c_str();
+        item.Encode(&node);
+    }
+
+    ostringstream oss;
+    xdoc.save(oss);
+    return oss.str();
+}
+
+class BgpXmppMsgBuilderTest : public testing::Test {
+protected:
+    BgpXmppMsgBuilderTest()
+        : server_(&evm_),
+          instance_config_(BgpConfigManager::kMasterInstance),
+          table_(NULL) {
+    }
+
+    virtual void SetUp() {
+        ConcurrencyScope scope("bgp::Config");
+        RoutingInstance *rti =
+            server_.routing_instance_mgr()->CreateRoutingInstance(
+                &instance_config_);
+        table_ = rti->GetTable(Address::INET);
+
+        BgpAttrSpec spec;
+        BgpAttrNextHop nexthop(0x0a0b0c0d);
+        spec.push_back(&nexthop);
+        BgpAttrLocalPref local_pref(200);
+        spec.push_back(&local_pref);
+        roattr_ = RibOutAttr(server_.attr_db()->Locate(spec).get(), 10000);
+    }
+
+    virtual void TearDown() {
+        STLDeleteValues(&routes_);
+        roattr_.clear();
+        server_.Shutdown();
+        task_util::WaitForIdle();
+    }
+
+    void AddRoutes(int count) {
+        for (int idx = 0; idx < count; ++idx) {
+            Ip4Prefix prefix(Ip4Address(0x14000000 + idx), 32);
+            routes_.push_back(new InetRoute(prefix));
+        }
+    }
+
+    Message *BuildMessage(MessageCache *cache = NULL) {
+        Message *message =
+            builder_.Create(table_, &roattr_, routes_[0], cache);
+        for (size_t idx = 1; idx < routes_.size(); ++idx) {
+            message->AddRoute(routes_[idx], &roattr_);
+        }
+        message->Finish();
+        return message;
+    }
+
+    EventManager evm_;
+    BgpServer server_;
+    BgpInstanceConfig instance_config_;
+    BgpTable *table_;
+    RibOutAttr roattr_;
+    vector<InetRoute *> routes_;
+    BgpXmppMessageBuilder builder_;
+};
+
+//
+// Verify that the directly written message parses to the same items as
+// the DOM encoded one.
+//
+TEST_F(BgpXmppMsgBuilderTest, InetReach) {
+    AddRoutes(8);
+    auto_ptr<Message> message(BuildMessage());
+    EXPECT_EQ(8, message->num_reach_routes());
+
+    PeerUpdateMock peer("agent-a");
+    size_t length;
+    const uint8_t *data = message->GetData(&peer, &length);
+    string direct(reinterpret_cast<const char *>(data), length);
+
+    xml_document xdoc;
+    ASSERT_TRUE(xdoc.load_buffer(direct.data(), direct.size()));
+    xml_node xmsg = xdoc.child("message");
+    EXPECT_STREQ(XmppInit::kControlNodeJID,
+                 xmsg.attribute("from").value());
+    EXPECT_STREQ("agent-a/bgp-peer", xmsg.attribute("to").value());
+    xml_node xitems = xmsg.child("event").child("items");
+    EXPECT_EQ(string("1/1/") + BgpConfigManager::kMasterInstance,
+              xitems.attribute("node").value());
+
+    size_t idx = 0;
+    for (xml_node xitem = xitems.child("item"); xitem;
+         xitem = xitem.next_sibling("item"), ++idx) {
+        ASSERT_LT(idx, routes_.size());
+        EXPECT_EQ(routes_[idx]->ToXmppIdString(),
+                  xitem.attribute("id").value());
+        autogen::ItemType item;
+        item.Clear();
+        EXPECT_TRUE(item.XmlParse(xitem));
+        EXPECT_EQ(BgpAf::IPv4, item.entry.nlri.af);
+        EXPECT_EQ(routes_[idx]->ToString(), item.entry.nlri.address);
+        EXPECT_EQ(1, item.entry.version);
+        EXPECT_EQ("unresolved", item.entry.virtual_network);
+        EXPECT_EQ(200, item.entry.local_preference);
+        ASSERT_EQ(1, item.entry.next_hops.next_hop.size());
+        const autogen::NextHopType &nh = item.entry.next_hops.next_hop[0];
+        EXPECT_EQ("10.11.12.13", nh.address);
+        EXPECT_EQ(10000, nh.label);
+        ASSERT_EQ(1, nh.tunnel_encapsulation_list.tunnel_encapsulation.size());
+        EXPECT_EQ("gre", nh.tunnel_encapsulation_list.tunnel_encapsulation[0]);
+    }
+    EXPECT_EQ(routes_.size(), idx);
+
+    // The 'to' part is replaced for subsequent peers.
+    PeerUpdateMock peer2("agent-b");
+    data = message->GetData(&peer2, &length);
+    string direct2(reinterpret_cast<const char *>(data), length);
+    EXPECT_EQ(string::npos, direct2.find("agent-a"));
+    EXPECT_NE(string::npos, direct2.find("to=\"agent-b/bgp-peer\""));
+    EXPECT_EQ(direct.size(), direct2.size());
+}
+
+TEST_F(BgpXmppMsgBuilderTest, InetUnreach) {
+    AddRoutes(4);
+    RibOutAttr roattr;
+    auto_ptr<Message> message(
+        builder_.Create(table_, &roattr, routes_[0], NULL));
+    for (size_t idx = 1; idx < routes_.size(); ++idx) {
+        message->AddRoute(routes_[idx], &roattr);
+    }
+    EXPECT_EQ(4, message->num_unreach_routes());
+
+    PeerUpdateMock peer("agent-a");
+    size_t length;
+    const uint8_t *data = message->GetData(&peer, &length);
+    xml_document xdoc;
+    ASSERT_TRUE(xdoc.load_buffer(data, length));
+    xml_node xitems = xdoc.child("message").child("event").child("items");
+    size_t idx = 0;
+    for (xml_node xretract = xitems.child("retract"); xretract;
+         xretract = xretract.next_sibling("retract"), ++idx) {
+        EXPECT_EQ(routes_[idx]->ToXmppIdString(),
+                  xretract.attribute("id").value());
+    }
+    EXPECT_EQ(routes_.size(), idx);
+}
+
+//
+// Messages built with the attribute encoding from the cache are the same as
+// the ones encoded from scratch.
+//
+TEST_F(BgpXmppMsgBuilderTest, AttrCache) {
+    AddRoutes(4);
+    boost::scoped_ptr<MessageCache> cache(builder_.CreateCache());
+    ASSERT_TRUE(cache.get() != NULL);
+
+    PeerUpdateMock peer("agent-a");
+    size_t length;
+    auto_ptr<Message> message(BuildMessage());
+    const uint8_t *data = message->GetData(&peer, &length);
+    string expected(reinterpret_cast<const char *>(data), length);
+
+    for (int idx = 0; idx < 3; ++idx) {
+        auto_ptr<Message> cached(BuildMessage(cache.get()));
+        data = cached->GetData(&peer, &length);
+        EXPECT_EQ(expected,
+                  string(reinterpret_cast<const char *>(data), length));
+    }
+}
+
+//
+// The peer name is escaped in the 'to' attribute, both when the message is
+// first encoded and when the 'to' part is replaced.
+//
+TEST_F(BgpXmppMsgBuilderTest, EscapeTo) {
+    AddRoutes(2);
+    auto_ptr<Message> message(BuildMessage());
+
+    const char *names[] = { "agent\"&<a>", "agent'&<b>" };
+    for (size_t idx = 0; idx < sizeof(names) / sizeof(names[0]); ++idx) {
+        PeerUpdateMock peer(names[idx]);
+        size_t length;
+        const uint8_t *data = message->GetData(&peer, &length);
+        xml_document xdoc;
+        ASSERT_TRUE(xdoc.load_buffer(data, length));
+        EXPECT_EQ(string(names[idx]) + "/bgp-peer",
+                  xdoc.child("message").attribute("to").value());
+    }
+}
+
+//
+// Compare messages/sec of the direct writer against the DOM encoding.
+//
+TEST_F(BgpXmppMsgBuilderTest, Benchmark) {
+    int route_count = 256;
+    int message_count = 200;
+    char *str = getenv("XMPP_MSG_BUILDER_TEST_MESSAGE_COUNT");
+    if (str) message_count = strtoul(str, NULL, 0);
+    AddRoutes(route_count);
+
+    PeerUpdateMock peer("agent-a");
+    size_t direct_bytes = 0;
+    uint64_t start = ClockMonotonicUsec();
+    for (int idx = 0; idx < message_count; ++idx) {
+        auto_ptr<Message> message(BuildMessage());
+        size_t length;
+        message->GetData(&peer, &length);
+        direct_bytes += length;
+    }
+    uint64_t direct_usecs = ClockMonotonicUsec() - start + 1;
+
+    size_t dom_bytes = 0;
+    start = ClockMonotonicUsec();
+    for (int idx = 0; idx < message_count; ++idx) {
+        string repr = DomEncode(table_, &roattr_, routes_,
+                                peer.ToString() + "/bgp-peer");
+        dom_bytes += repr.size();
+    }
+    uint64_t dom_usecs = ClockMonotonicUsec() - start + 1;
+
+    EXPECT_GT(direct_bytes, 0);
+    EXPECT_GT(dom_bytes, 0);
+    LOG(DEBUG, message_count << " messages with " << route_count
+        << " routes: direct " << message_count * 1000000ULL / direct_usecs
+        << " msgs/sec (" << direct_bytes << " bytes), "
+        << "dom " << message_count * 1000000ULL / dom_usecs
+        << " msgs/sec (" << dom_bytes << " bytes)");
+}
+
+}  // namespace
+
+static void SetUp() {
+    ControlNode::SetDefaultSchedulingPolicy();
+}
+
+static void TearDown() {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Terminate();
+}
+
+int main(int argc, char **argv) {
+    bgp_log_test::init();
+    ::testing::InitGoogleTest(&argc, argv);
+    SetUp();
+    int result = RUN_ALL_TESTS();
+    TearDown();
+    return result;
+}
@@ -447,10 +447,54 @@ TEST_F(SchedulingGroupManagerTest, TwoTablesMultiplePeers) {
     peers.push_back(peer);
     Register(&tbl1, peer);
     Register(&tbl2, peer);
-    
+
     STLDeleteValues(&peers);
 }
 
+// Each group gets its own task instance. Instances of deleted or merged
+// groups are reused, and a split group gets a new one.
+TEST_F(SchedulingGroupManagerTest, TaskInstance) {
+    auto_ptr<RibOut> rp1(new RibOut(inetvpn_table_, &sgman_,
+                                    RibExportPolicy()));
+    auto_ptr<RibOut> rp2(new RibOut(inetvpn_table_, &sgman_,
+                                    RibExportPolicy()));
+    auto_ptr<RibOut> rp3(new RibOut(inetvpn_table_, &sgman_,
+                                    RibExportPolicy()));
+    auto_ptr<BgpTestPeer> p1(new BgpTestPeer());
+    auto_ptr<BgpTestPeer> p2(new BgpTestPeer());
+    auto_ptr<BgpTestPeer> p3(new BgpTestPeer());
+
+    Join(rp1.get(), p1.get());
+    Join(rp2.get(), p2.get());
+    Join(rp3.get(), p3.get());
+    EXPECT_EQ(3, sgman_.size());
+    EXPECT_EQ(0, rp1->GetSchedulingGroup()->task_instance());
+    EXPECT_EQ(1, rp2->GetSchedulingGroup()->task_instance());
+    EXPECT_EQ(2, rp3->GetSchedulingGroup()->task_instance());
+
+    // Merge the first two groups, instance 1 is free.
+    Join(rp2.get(), p1.get());
+    EXPECT_EQ(2, sgman_.size());
+    EXPECT_EQ(0, rp2->GetSchedulingGroup()->task_instance());
+
+    // Split them again, the new group reuses instance 1.
+    Leave(rp2.get(), p1.get());
+    EXPECT_EQ(3, sgman_.size());
+    EXPECT_EQ(0, rp1->GetSchedulingGroup()->task_instance());
+    EXPECT_EQ(1, rp2->GetSchedulingGroup()->task_instance());
+
+    // Delete the first group, instance 0 is reused by the next group.
+    Leave(rp1.get(), p1.get());
+    EXPECT_EQ(2, sgman_.size());
+    Join(rp1.get(), p1.get());
+    EXPECT_EQ(0, rp1->GetSchedulingGroup()->task_instance());
+
+    Leave(rp1.get(), p1.get());
+    Leave(rp2.get(), p2.get());
+    Leave(rp3.get(), p3.get());
+    EXPECT_EQ(0, sgman_.size());
+}
+
 // Parameterize number of entries in the work queue and the order in which
 // the entries are added.
 
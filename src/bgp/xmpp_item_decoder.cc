@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/xmpp_item_decoder.h"
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pugixml/pugixml.hpp>
+
+#include "net/bgp_af.h"
+
+using pugi::xml_node;
+using std::string;
+
+XmppRouteItem::NextHop::NextHop()
+    : af(0), address_text(""), address_valid(false), label(0),
+      encap_list_size(0) {
+}
+
+XmppRouteItem::XmppRouteItem() {
+    Clear();
+}
+
+void XmppRouteItem::Clear() {
+    af = 0;
+    safi = 0;
+    address_text = "";
+    inet_prefix = Ip4Prefix();
+    inet6_prefix = Inet6Prefix();
+    ethernet_tag = 0;
+    mac_text = "";
+    mac = MacAddress();
+    ip_address = IpAddress();
+    nexthops.clear();
+    local_preference = 0;
+    sequence_number = 0;
+    security_groups.clear();
+    edge_replication_not_supported = false;
+    assisted_replication_supported = false;
+    replicator_text = "";
+}
+
+template <typename IntType>
+static bool DecodeInteger(const xml_node &node, IntType *value) {
+    const char *text = node.child_value();
+    char *end;
+    long long result = strtoll(text, &end, 10);
+    while (isspace(*end)) {
+        end++;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    *value = static_cast<IntType>(result);
+    return true;
+}
+
+static bool DecodeBoolean(const xml_node &node, bool *value) {
+    const char *text = node.child_value();
+    if (strcmp(text, "true") == 0 || strcmp(text, "1") == 0) {
+        *value = true;
+    } else if (*text == '\0' || strcmp(text, "false") == 0 ||
+               strcmp(text, "0") == 0) {
+        *value = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//
+// Split "address/prefixlen" into a NUL terminated copy of the address and
+// the prefix length. The address buffer must have room for the padding of
+// partial IPv4 addresses.
+//
+static bool SplitPrefix(const char *text, char *address, size_t size,
+                        int *prefixlen) {
+    const char *slash = strchr(text, '/');
+    if (slash == NULL) {
+        return false;
+    }
+    size_t len = slash - text;
+    if (len + sizeof(".0.0.0") > size) {
+        return false;
+    }
+    memcpy(address, text, len);
+    address[len] = '\0';
+    *prefixlen = atoi(slash + 1);
+    return true;
+}
+
+// Same as Ip4PrefixParse, without building temporary strings.
+static bool DecodeIp4Prefix(const char *text, Ip4Prefix *prefix) {
+    char address[INET_ADDRSTRLEN + 8];
+    int prefixlen;
+    if (!SplitPrefix(text, address, sizeof(address), &prefixlen)) {
+        return false;
+    }
+
+    int dots = 0;
+    for (const char *c = address; *c; c++) {
+        if (*c == '.') dots++;
+    }
+    for (; dots < 3; dots++) {
+        strcat(address, ".0");
+    }
+
+    boost::system::error_code error;
+    Ip4Address addr = Ip4Address::from_string(address, error);
+    if (error) {
+        return false;
+    }
+    *prefix = Ip4Prefix(addr, prefixlen);
+    return true;
+}
+
+// Same as Inet6PrefixParse, without building temporary strings.
+static bool DecodeInet6Prefix(const char *text, Inet6Prefix *prefix) {
+    char address[INET6_ADDRSTRLEN + 8];
+    int prefixlen;
+    if (!SplitPrefix(text, address, sizeof(address), &prefixlen)) {
+        return false;
+    }
+    if (prefixlen < 0 || prefixlen > Address::kMaxV6PrefixLen) {
+        return false;
+    }
+
+    boost::system::error_code error;
+    Ip6Address addr = Ip6Address::from_string(address, error);
+    if (error) {
+        return false;
+    }
+    *prefix = Inet6Prefix(addr, prefixlen);
+    return true;
+}
+
+void XmppRouteItemDecoder::DecodeTunnelEncap(const char *text,
+                                             XmppRouteItem::NextHop *nexthop) {
+    // Encapsulation names are short enough to not need an allocation.
+    string encap(text);
+    TunnelEncapType::Encap id = TunnelEncapType::TunnelEncapFromString(encap);
+    if (id == TunnelEncapType::UNSPEC) {
+        return;
+    }
+    nexthop->encaps.push_back(id);
+
+    encap.append("-contrail");
+    id = TunnelEncapType::TunnelEncapFromString(encap);
+    if (id == TunnelEncapType::UNSPEC) {
+        return;
+    }
+    nexthop->encaps.push_back(id);
+}
+
+bool XmppRouteItemDecoder::DecodeNextHop(const xml_node &node,
+                                         XmppRouteItem::NextHop *nexthop) {
+    for (xml_node child = node.first_child(); child;
+         child = child.next_sibling()) {
+        const char *name = child.name();
+        if (strcmp(name, "af") == 0) {
+            if (!DecodeInteger(child, &nexthop->af))
+                return false;
+        } else if (strcmp(name, "address") == 0) {
+            nexthop->address_text = child.child_value();
+        } else if (strcmp(name, "label") == 0) {
+            if (!DecodeInteger(child, &nexthop->label))
+                return false;
+        } else if (strcmp(name, "tunnel-encapsulation-list") == 0) {
+            for (xml_node encap = child.child("tunnel-encapsulation"); encap;
+                 encap = encap.next_sibling("tunnel-encapsulation")) {
+                nexthop->encap_list_size++;
+                DecodeTunnelEncap(encap.child_value(), nexthop);
+            }
+        }
+    }
+
+    if (nexthop->af == BgpAf::IPv4) {
+        boost::system::error_code error;
+        nexthop->address = IpAddress::from_string(nexthop->address_text,
+                                                  error);
+        nexthop->address_valid = !error;
+    }
+    return true;
+}
+
+bool XmppRouteItemDecoder::DecodeNextHops(const xml_node &node,
+                                          XmppRouteItem *item) {
+    for (xml_node child = node.child("next-hop"); child;
+         child = child.next_sibling("next-hop")) {
+        item->nexthops.push_back(XmppRouteItem::NextHop());
+        if (!DecodeNextHop(child, &item->nexthops.back()))
+            return false;
+    }
+    return true;
+}
+
+bool XmppRouteItemDecoder::DecodeNlri(const xml_node &node,
+                                      XmppRouteItem *item, bool enet) {
+    for (xml_node child = node.first_child(); child;
+         child = child.next_sibling()) {
+        const char *name = child.name();
+        if (strcmp(name, "af") == 0) {
+            if (!DecodeInteger(child, &item->af))
+                return false;
+        } else if (strcmp(name, "safi") == 0) {
+            if (!DecodeInteger(child, &item->safi))
+                return false;
+        } else if (strcmp(name, "address") == 0) {
+            item->address_text = child.child_value();
+        } else if (enet && strcmp(name, "ethernet-tag") == 0) {
+            if (!DecodeInteger(child, &item->ethernet_tag))
+                return false;
+        } else if (enet && strcmp(name, "mac") == 0) {
+            item->mac_text = child.child_value();
+        }
+    }
+    return true;
+}
+
+bool XmppRouteItemDecoder::DecodeEntry(const xml_node &node,
+                                       XmppRouteItem *item, bool enet) {
+    for (xml_node child = node.first_child(); child;
+         child = child.next_sibling()) {
+        const char *name = child.name();
+        bool success = true;
+        if (strcmp(name, "nlri") == 0) {
+            success = DecodeNlri(child, item, enet);
+        } else if (strcmp(name, "next-hops") == 0) {
+            success = DecodeNextHops(child, item);
+        } else if (strcmp(name, "local-preference") == 0) {
+            success = DecodeInteger(child, &item->local_preference);
+        } else if (strcmp(name, "sequence-number") == 0) {
+            success = DecodeInteger(child, &item->sequence_number);
+        } else if (strcmp(name, "security-group-list") == 0) {
+            for (xml_node sg = child.child("security-group"); sg && success;
+                 sg = sg.next_sibling("security-group")) {
+                int value;
+                success = DecodeInteger(sg, &value);
+                item->security_groups.push_back(value);
+            }
+        } else if (!enet) {
+            continue;
+        } else if (strcmp(name, "edge-replication-not-supported") == 0) {
+            success = DecodeBoolean(child,
+                                    &item->edge_replication_not_supported);
+        } else if (strcmp(name, "assisted-replication-supported") == 0) {
+            success = DecodeBoolean(child,
+                                    &item->assisted_replication_supported);
+        } else if (strcmp(name, "replicator-address") == 0) {
+            item->replicator_text = child.child_value();
+        }
+        if (!success)
+            return false;
+    }
+    return true;
+}
+
+XmppRouteItemDecoder::Result XmppRouteItemDecoder::DecodeInetItem(
+        const xml_node &node, XmppRouteItem *item, string *error) {
+    item->Clear();
+    if (!DecodeEntry(node.child("entry"), item, false)) {
+        *error = "Invalid message received";
+        return BAD_XML;
+    }
+    if (item->af != BgpAf::IPv4) {
+        *error = "Unsupported address family";
+        return BAD_AFI_SAFI;
+    }
+    if (!DecodeIp4Prefix(item->address_text, &item->inet_prefix)) {
+        *error = string("Bad address string: ") + item->address_text;
+        return BAD_PREFIX;
+    }
+    return OK;
+}
+
+XmppRouteItemDecoder::Result XmppRouteItemDecoder::DecodeInet6Item(
+        const xml_node &node, XmppRouteItem *item, string *error) {
+    item->Clear();
+    if (!DecodeEntry(node.child("entry"), item, false)) {
+        *error = "Invalid message received";
+        return BAD_XML;
+    }
+    if (item->af != BgpAf::IPv6 || item->safi != BgpAf::Unicast) {
+        *error = "Unsupported address family";
+        return BAD_AFI_SAFI;
+    }
+    if (!DecodeInet6Prefix(item->address_text, &item->inet6_prefix)) {
+        *error = string("Bad address string: ") + item->address_text;
+        return BAD_PREFIX;
+    }
+    return OK;
+}
+
+XmppRouteItemDecoder::Result XmppRouteItemDecoder::DecodeEnetItem(
+        const xml_node &node, XmppRouteItem *item, string *error) {
+    item->Clear();
+    if (!DecodeEntry(node.child("entry"), item, true)) {
+        *error = "Invalid message received";
+        return BAD_XML;
+    }
+    if (item->af != BgpAf::L2Vpn) {
+        *error = "Unsupported address family";
+        return BAD_AFI_SAFI;
+    }
+
+    boost::system::error_code ec;
+    item->mac = MacAddress::FromString(item->mac_text, &ec);
+    if (ec) {
+        *error = string("Bad mac address string: ") + item->mac_text;
+        return BAD_PREFIX;
+    }
+
+    if (item->mac.IsBroadcast() || *item->address_text == '\0') {
+        return OK;
+    }
+
+    const char *slash = strchr(item->address_text, '/');
+    if (slash == NULL) {
+        *error = string("Missing / in address string: ") +
+            item->address_text;
+        return BAD_PREFIX;
+    }
+    if (strcmp(slash + 1, "32") == 0) {
+        if (!DecodeIp4Prefix(item->address_text, &item->inet_prefix) ||
+            item->inet_prefix.prefixlen() != 32) {
+            *error = string("Bad inet address string: ") + item->address_text;
+            return BAD_PREFIX;
+        }
+        item->ip_address = item->inet_prefix.ip4_addr();
+    } else if (strcmp(slash + 1, "128") == 0) {
+        if (!DecodeInet6Prefix(item->address_text, &item->inet6_prefix) ||
+            item->inet6_prefix.prefixlen() != 128) {
+            *error = string("Bad inet6 address string: ") +
+                item->address_text;
+            return BAD_PREFIX;
+        }
+        item->ip_address = item->inet6_prefix.ip6_addr();
+    } else {
+        *error = string("Bad prefix length in address string: ") +
+            item->address_text;
+        return BAD_PREFIX;
+    }
+    return OK;
+}
+
+bool XmppRouteItemDecoder::DecodeReplicatorAddress(const XmppRouteItem &item,
+                                                   IpAddress *address) {
+    boost::system::error_code error;
+    *address = IpAddress::from_string(item.replicator_text, error);
+    return !error;
+}
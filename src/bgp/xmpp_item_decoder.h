@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef SRC_BGP_XMPP_ITEM_DECODER_H_
+#define SRC_BGP_XMPP_ITEM_DECODER_H_
+
+#include <string>
+#include <vector>
+
+#include "bgp/inet/inet_route.h"
+#include "bgp/inet6/inet6_route.h"
+#include "net/address.h"
+#include "net/mac_address.h"
+#include "net/tunnel_encap_type.h"
+
+namespace pugi {
+class xml_node;
+}
+
+//
+// Route item published by an agent, decoded in a single walk of the pugixml
+// nodes of the item.
+//
+// The autogen ItemType and EnetItemType classes copy every element of the
+// item into a std::string, which BgpXmppChannel then converts again into
+// prefixes, addresses and tunnel encapsulations. XmppRouteItem holds the
+// final values instead. Text that is only needed for logging points into
+// the stanza and is valid as long as the stanza is.
+//
+struct XmppRouteItem {
+    struct NextHop {
+        NextHop();
+
+        int af;
+        const char *address_text;
+        bool address_valid;             // IPv4 address family and address
+        IpAddress address;
+        uint32_t label;
+
+        // Number of tunnel-encapsulation elements in the item.
+        size_t encap_list_size;
+
+        // Valid encapsulations in item order, each followed by its contrail
+        // variant if there is one.
+        std::vector<TunnelEncapType::Encap> encaps;
+    };
+    typedef std::vector<NextHop> NextHopList;
+
+    XmppRouteItem();
+    void Clear();
+
+    // NLRI
+    int af;
+    int safi;
+    const char *address_text;
+    Ip4Prefix inet_prefix;              // Inet items
+    Inet6Prefix inet6_prefix;           // Inet6 items
+    uint32_t ethernet_tag;              // Enet items
+    const char *mac_text;
+    MacAddress mac;
+    IpAddress ip_address;
+
+    NextHopList nexthops;
+    uint32_t local_preference;
+    uint32_t sequence_number;
+    std::vector<int> security_groups;
+
+    // Enet items only
+    bool edge_replication_not_supported;
+    bool assisted_replication_supported;
+    const char *replicator_text;
+};
+
+class XmppRouteItemDecoder {
+public:
+    enum Result {
+        OK,
+        BAD_XML,            // Malformed element value
+        BAD_AFI_SAFI,       // Unexpected NLRI address family
+        BAD_PREFIX,         // NLRI address or mac can not be decoded
+    };
+
+    // Decode an inet or inet6 item. On failure, error describes the reason.
+    // Next-hop addresses are only validated, see NextHop::address_valid.
+    static Result DecodeInetItem(const pugi::xml_node &node,
+                                 XmppRouteItem *item, std::string *error);
+    static Result DecodeInet6Item(const pugi::xml_node &node,
+                                  XmppRouteItem *item, std::string *error);
+
+    // Decode an enet item, including the optional IP address in its NLRI.
+    static Result DecodeEnetItem(const pugi::xml_node &node,
+                                 XmppRouteItem *item, std::string *error);
+
+    // Decode the IPv4 replicator address of an enet item.
+    static bool DecodeReplicatorAddress(const XmppRouteItem &item,
+                                        IpAddress *address);
+
+private:
+    static bool DecodeEntry(const pugi::xml_node &node, XmppRouteItem *item,
+                            bool enet);
+    static bool DecodeNlri(const pugi::xml_node &node, XmppRouteItem *item,
+                           bool enet);
+    static bool DecodeNextHops(const pugi::xml_node &node,
+                               XmppRouteItem *item);
+    static bool DecodeNextHop(const pugi::xml_node &node,
+                              XmppRouteItem::NextHop *nexthop);
+    static void DecodeTunnelEncap(const char *text,
+                                  XmppRouteItem::NextHop *nexthop);
+};
+
+#endif  // SRC_BGP_XMPP_ITEM_DECODER_H_
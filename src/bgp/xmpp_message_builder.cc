@@ -6,7 +6,9 @@
 
 #include <boost/foreach.hpp>
 #include <pugixml/pugixml.hpp>
+#include <stdio.h>
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -22,7 +24,6 @@
 #include "bgp/origin-vn/origin_vn.h"
 #include "bgp/security_group/security_group.h"
 #include "net/bgp_af.h"
-#include "schema/xmpp_unicast_types.h"
 #include "schema/xmpp_multicast_types.h"
 #include "schema/xmpp_enet_types.h"
 #include "xmpp/xmpp_init.h"
@@ -35,12 +36,127 @@ using std::string;
 using std::stringstream;
 using std::vector;
 
+//
+// Helpers to write XML text directly into a string. Used to encode unicast
+// items without building an intermediate DOM.
+//
+static void XmlPutValue(string *repr, const string &value) {
+    if (value.find_first_of("&<>\"'") == string::npos) {
+        repr->append(value);
+        return;
+    }
+    for (string::const_iterator it = value.begin(); it != value.end(); ++it) {
+        switch (*it) {
+        case '&': repr->append("&amp;"); break;
+        case '<': repr->append("&lt;"); break;
+        case '>': repr->append("&gt;"); break;
+        case '"': repr->append("&quot;"); break;
+        case '\'': repr->append("&apos;"); break;
+        default: repr->push_back(*it); break;
+        }
+    }
+}
+
+template <typename IntType>
+static void XmlPutValue(string *repr, IntType value) {
+    char buf[24];
+    int len = snprintf(buf, sizeof(buf), "%lld",
+                       static_cast<long long>(value));
+    repr->append(buf, len);
+}
+
+template <typename ValueType>
+static void XmlPutElement(string *repr, const char *tag,
+                          const ValueType &value) {
+    repr->push_back('<');
+    repr->append(tag);
+    repr->push_back('>');
+    XmlPutValue(repr, value);
+    repr->append("</");
+    repr->append(tag);
+    repr->push_back('>');
+}
+
+static void XmlPutAttribute(string *repr, const char *name,
+                            const string &value) {
+    repr->push_back(' ');
+    repr->append(name);
+    repr->append("=\"");
+    XmlPutValue(repr, value);
+    repr->push_back('"');
+}
+
+//
+// Encodings of the attribute portion of unicast items for one RibOut. Besides
+// the RibOutAttr, the encoding depends on the virtual network name and the AS
+// number of the server, which may change with the configuration, so they are
+// part of the key. Entries hold a reference on the BgpAttr of the RibOutAttr,
+// so the cache is flushed when it grows to kMaxEntries.
+//
+class BgpXmppAttrCache : public MessageCache {
+public:
+    static const size_t kMaxEntries = 1024;
+
+    BgpXmppAttrCache() { }
+    virtual ~BgpXmppAttrCache() { }
+
+    bool Find(const RibOutAttr &roattr, const string &virtual_network,
+              as_t as_number, string *repr) const {
+        Map::const_iterator loc =
+            map_.find(Key(roattr, virtual_network, as_number));
+        if (loc == map_.end())
+            return false;
+        *repr = loc->second;
+        return true;
+    }
+
+    void Insert(const RibOutAttr &roattr, const string &virtual_network,
+                as_t as_number, const string &repr) {
+        if (map_.size() >= kMaxEntries)
+            map_.clear();
+        map_.insert(std::make_pair(Key(roattr, virtual_network, as_number),
+                                   repr));
+    }
+
+private:
+    struct Key {
+        Key(const RibOutAttr &roattr, const string &virtual_network,
+            as_t as_number)
+            : roattr(roattr),
+              virtual_network(virtual_network),
+              as_number(as_number) {
+        }
+        bool operator<(const Key &rhs) const {
+            if (roattr != rhs.roattr)
+                return roattr < rhs.roattr;
+            if (virtual_network != rhs.virtual_network)
+                return virtual_network < rhs.virtual_network;
+            return as_number < rhs.as_number;
+        }
+
+        RibOutAttr roattr;
+        string virtual_network;
+        as_t as_number;
+    };
+    typedef std::map<Key, string> Map;
+
+    Map map_;
+
+    DISALLOW_COPY_AND_ASSIGN(BgpXmppAttrCache);
+};
+
 class BgpXmppMessage : public Message {
 public:
-    BgpXmppMessage(const BgpTable *table, const RibOutAttr *roattr)
+    BgpXmppMessage(const BgpTable *table, const RibOutAttr *roattr,
+                   BgpXmppAttrCache *cache)
         : table_(table),
+          cache_(cache),
           is_reachable_(roattr->IsReachable()),
-          sequence_number_(0) {
+          direct_(table->family() == Address::INET ||
+                  table->family() == Address::INET6),
+          sequence_number_(0),
+          repr_part1_(0),
+          repr_part2_(0) {
     }
     virtual ~BgpXmppMessage() { }
     void Start(const RibOutAttr *roattr, const BgpRoute *route);
@@ -49,8 +165,11 @@ public:
     virtual const uint8_t *GetData(IPeerUpdate *peer, size_t *lenp);
 
 private:
-    void EncodeNextHop(const BgpRoute *route, RibOutAttr::NextHop nexthop,
-                       autogen::ItemType *item);
+    static const size_t kItemsReserveSize = 4096;
+
+    void EncodeNextHop(const BgpRoute *route,
+                       const RibOutAttr::NextHop &nexthop);
+    void EncodeAttr(const BgpRoute *route, const RibOutAttr *roattr);
     void AddIpReach(const BgpRoute *route, const RibOutAttr *roattr);
     void AddIpUnreach(const BgpRoute *route);
     bool AddInetRoute(const BgpRoute *route, const RibOutAttr *roattr);
@@ -96,8 +215,23 @@ private:
     }
     string GetVirtualNetwork(const BgpRoute *route) const;
 
+    const uint8_t *GetDirectData(const string &to, size_t *lenp);
+    const uint8_t *GetDomData(const string &to, size_t *lenp);
+
     const BgpTable *table_;
+    BgpXmppAttrCache *cache_;
     bool is_reachable_;
+
+    // Unicast items are written directly as XML text into items_. All the
+    // routes in a message share the same RibOutAttr, so the portion of the
+    // item that depends only on the attribute is encoded once in attr_repr_
+    // and appended to each item. The encoding is also reused from cache_
+    // across the messages for the RibOut.
+    bool direct_;
+    string node_;
+    string items_;
+    string attr_repr_;
+
     xml_document xdoc_;
     xml_node xitems_;
     uint32_t sequence_number_;
@@ -112,14 +246,6 @@ private:
 };
 
 void BgpXmppMessage::Start(const RibOutAttr *roattr, const BgpRoute *route) {
-    // Build the DOM tree
-    xml_node message = xdoc_.append_child("message");
-    message.append_attribute("from") = XmppInit::kControlNodeJID;
-
-    xml_node event = message.append_child("event");
-    event.append_attribute("xmlns") = "http://jabber.org/protocol/pubsub";
-    xitems_ = event.append_child("items");
-
     if (is_reachable_) {
         const BgpAttr *attr = roattr->attr();
         ProcessExtCommunity(attr->ext_community());
@@ -132,19 +258,35 @@ void BgpXmppMessage::Start(const RibOutAttr *roattr, const BgpRoute *route) {
     stringstream ss;
     ss << route->Afi() << "/" << int(route->XmppSafi()) << "/" <<
           table_->routing_instance()->name();
-    string node(ss.str());
+    node_ = ss.str();
+
+    if (direct_) {
+        items_.reserve(kItemsReserveSize);
+        if (is_reachable_)
+            EncodeAttr(route, roattr);
+        if (table_->family() == Address::INET6) {
+            AddInet6Route(route, roattr);
+        } else {
+            AddInetRoute(route, roattr);
+        }
+        return;
+    }
+
+    // Build the DOM tree
+    xml_node message = xdoc_.append_child("message");
+    message.append_attribute("from") = XmppInit::kControlNodeJID;
+
+    xml_node event = message.append_child("event");
+    event.append_attribute("xmlns") = "http://jabber.org/protocol/pubsub";
+    xitems_ = event.append_child("items");
+
+    const string &node = node_;
     if (table_->family() == Address::ERMVPN) {
         xitems_.append_attribute("node") = node.c_str();
         AddMcastRoute(route, roattr);
     } else if (table_->family() == Address::EVPN) {
         xitems_.append_attribute("node") = node.c_str();
         AddEnetRoute(route, roattr);
-    } else if (table_->family() == Address::INET6) {
-        xitems_.append_attribute("node") = node.c_str();
-        AddInet6Route(route, roattr);
-    } else {
-        xitems_.append_attribute("node") = node.c_str();
-        AddInetRoute(route, roattr);
     }
 }
 
@@ -161,60 +303,87 @@ bool BgpXmppMessage::AddRoute(const BgpRoute *route, const RibOutAttr *roattr) {
 }
 
 void BgpXmppMessage::EncodeNextHop(const BgpRoute *route,
-                                   RibOutAttr::NextHop nexthop,
-                                   autogen::ItemType *item) {
-    autogen::NextHopType item_nexthop;
-
-    item_nexthop.af = route->NexthopAfi();
-    item_nexthop.address = nexthop.address().to_v4().to_string();
-    item_nexthop.label = nexthop.label();
+                                   const RibOutAttr::NextHop &nexthop) {
+    attr_repr_.append("<next-hop>");
+    XmlPutElement(&attr_repr_, "af", route->NexthopAfi());
+    XmlPutElement(&attr_repr_, "address",
+                  nexthop.address().to_v4().to_string());
+    XmlPutElement(&attr_repr_, "label", nexthop.label());
 
     // If encap list is empty use mpls over gre as default encap.
-    vector<string> &encap_list =
-        item_nexthop.tunnel_encapsulation_list.tunnel_encapsulation;
-    if (nexthop.encap().empty()) {
-        encap_list.push_back(string("gre"));
+    attr_repr_.append("<tunnel-encapsulation-list>");
+    const vector<string> &encap_list = nexthop.encap();
+    if (encap_list.empty()) {
+        XmlPutElement(&attr_repr_, "tunnel-encapsulation", string("gre"));
     } else {
-        encap_list = nexthop.encap();
+        BOOST_FOREACH(const string &encap, encap_list) {
+            XmlPutElement(&attr_repr_, "tunnel-encapsulation", encap);
+        }
     }
-
-    item->entry.next_hops.next_hop.push_back(item_nexthop);
+    attr_repr_.append("</tunnel-encapsulation-list>");
+    attr_repr_.append("</next-hop>");
 }
 
-void BgpXmppMessage::AddIpReach(const BgpRoute *route,
+//
+// Encode the portion of a unicast item that follows the nlri. It depends
+// only on the RibOutAttr and is shared by all the routes in the message.
+//
+void BgpXmppMessage::EncodeAttr(const BgpRoute *route,
                                 const RibOutAttr *roattr) {
-    autogen::ItemType item;
-
-    item.entry.nlri.af = route->Afi();
-    item.entry.nlri.safi = route->XmppSafi();
-    item.entry.nlri.address = route->ToString();
-    item.entry.version = 1;
-    item.entry.virtual_network = GetVirtualNetwork(route);
-    item.entry.local_preference = roattr->attr()->local_pref();
-    item.entry.sequence_number = sequence_number_;
-
     assert(!roattr->nexthop_list().empty());
 
+    string virtual_network = GetVirtualNetwork(route);
+    as_t as_number = table_->server()->autonomous_system();
+    if (cache_ && cache_->Find(*roattr, virtual_network, as_number,
+                               &attr_repr_)) {
+        return;
+    }
+
     //
     // Encode all next-hops in the list
     //
-    BOOST_FOREACH(RibOutAttr::NextHop nexthop, roattr->nexthop_list()) {
-        EncodeNextHop(route, nexthop, &item);
+    attr_repr_.append("<next-hops>");
+    BOOST_FOREACH(const RibOutAttr::NextHop &nexthop,
+                  roattr->nexthop_list()) {
+        EncodeNextHop(route, nexthop);
     }
+    attr_repr_.append("</next-hops>");
+
+    XmlPutElement(&attr_repr_, "version", 1);
+    XmlPutElement(&attr_repr_, "virtual-network", virtual_network);
+    XmlPutElement(&attr_repr_, "sequence-number", sequence_number_);
 
+    attr_repr_.append("<security-group-list>");
     for (vector<int>::iterator it = security_group_list_.begin();
          it !=  security_group_list_.end(); ++it) {
-        item.entry.security_group_list.security_group.push_back(*it);
+        XmlPutElement(&attr_repr_, "security-group", *it);
     }
+    attr_repr_.append("</security-group-list>");
 
-    xml_node node = xitems_.append_child("item");
-    node.append_attribute("id") = route->ToXmppIdString().c_str();
-    item.Encode(&node);
+    XmlPutElement(&attr_repr_, "local-preference",
+                  roattr->attr()->local_pref());
+    attr_repr_.append("</entry></item>");
+
+    if (cache_)
+        cache_->Insert(*roattr, virtual_network, as_number, attr_repr_);
+}
+
+void BgpXmppMessage::AddIpReach(const BgpRoute *route,
+                                const RibOutAttr *roattr) {
+    items_.append("<item");
+    XmlPutAttribute(&items_, "id", route->ToXmppIdString());
+    items_.append("><entry><nlri>");
+    XmlPutElement(&items_, "af", route->Afi());
+    XmlPutElement(&items_, "safi", route->XmppSafi());
+    XmlPutElement(&items_, "address", route->ToString());
+    items_.append("</nlri>");
+    items_.append(attr_repr_);
 }
 
 void BgpXmppMessage::AddIpUnreach(const BgpRoute *route) {
-    xml_node node = xitems_.append_child("retract");
-    node.append_attribute("id") = route->ToXmppIdString().c_str();
+    items_.append("<retract");
+    XmlPutAttribute(&items_, "id", route->ToXmppIdString());
+    items_.append("/>");
 }
 
 bool BgpXmppMessage::AddInetRoute(const BgpRoute *route,
@@ -389,19 +558,55 @@ const uint8_t *BgpXmppMessage::GetData(IPeerUpdate *peer, size_t *lenp) {
 
     // If the message has already been constructed, just replace the 'to' part.
     if (!repr_.empty()) {
-        repr_new_ = string(repr_, 0, repr_part1_) + "to=\"" + str + "\">" +
-                    string(repr_, repr_part2_);
+        repr_new_.reserve(repr_.size() + str.size());
+        repr_new_.assign(repr_, 0, repr_part1_);
+        repr_new_.append("to=\"");
+        XmlPutValue(&repr_new_, str);
+        repr_new_.append("\">");
+        repr_new_.append(repr_, repr_part2_, string::npos);
 
         *lenp = repr_new_.size();
         return reinterpret_cast<const uint8_t *>(repr_new_.c_str());
     }
 
+    if (direct_)
+        return GetDirectData(str, lenp);
+    return GetDomData(str, lenp);
+}
+
+//
+// Wrap the directly encoded items in the message and event elements. The
+// layout of the result matches what the DOM path produces, so that either
+// representation can have its 'to' part replaced in the same way.
+//
+const uint8_t *BgpXmppMessage::GetDirectData(const string &to, size_t *lenp) {
+    repr_.reserve(items_.size() + node_.size() + to.size() + 256);
+    repr_.append("<?xml version=\"1.0\"?>\n<message");
+    XmlPutAttribute(&repr_, "from", XmppInit::kControlNodeJID);
+    repr_.push_back(' ');
+    repr_part1_ = repr_.size();
+    repr_.append("to=\"");
+    XmlPutValue(&repr_, to);
+    repr_.append("\">");
+    repr_part2_ = repr_.size();
+    repr_.append("\n\t<event xmlns=\"http://jabber.org/protocol/pubsub\">");
+    repr_.append("\n\t\t<items");
+    XmlPutAttribute(&repr_, "node", node_);
+    repr_.push_back('>');
+    repr_.append(items_);
+    repr_.append("</items>\n\t</event>\n</message>\n");
+
+    *lenp = repr_.size();
+    return reinterpret_cast<const uint8_t *>(repr_.c_str());
+}
+
+const uint8_t *BgpXmppMessage::GetDomData(const string &to, size_t *lenp) {
     xml_node message =  xdoc_.child("message");
     xml_attribute attr_to = message.attribute("to");
     if (!attr_to) {
         attr_to = message.append_attribute("to");
     }
-    attr_to.set_value(str.c_str());
+    attr_to.set_value(to.c_str());
     ostringstream oss;
     xdoc_.save(oss);
     repr_ = oss.str();
@@ -425,11 +630,17 @@ string BgpXmppMessage::GetVirtualNetwork(const BgpRoute *route) const {
 
 Message *BgpXmppMessageBuilder::Create(const BgpTable *table,
                                        const RibOutAttr *roattr,
-                                       const BgpRoute *route) const {
-    BgpXmppMessage *msg = new BgpXmppMessage(table, roattr);
+                                       const BgpRoute *route,
+                                       MessageCache *cache) const {
+    BgpXmppMessage *msg = new BgpXmppMessage(table, roattr,
+        static_cast<BgpXmppAttrCache *>(cache));
     msg->Start(roattr, route);
     return msg;
 }
 
+MessageCache *BgpXmppMessageBuilder::CreateCache() const {
+    return new BgpXmppAttrCache;
+}
+
 BgpXmppMessageBuilder::BgpXmppMessageBuilder() {
 }
@@ -12,7 +12,9 @@ public:
     BgpXmppMessageBuilder();
     virtual Message *Create(const BgpTable *table,
                             const RibOutAttr *roattr,
-                            const BgpRoute *route) const;
+                            const BgpRoute *route,
+                            MessageCache *cache) const;
+    virtual MessageCache *CreateCache() const;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(BgpXmppMessageBuilder);
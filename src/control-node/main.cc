@@ -467,6 +467,8 @@ int main(int argc, char *argv[]) {
     DBGraph config_graph;
     IFMapServer ifmap_server(&config_db, &config_graph, evm.io_service());
     IFMap_Initialize(&ifmap_server);
+    // Send the config of (re)connecting agents in bulk.
+    ifmap_server.set_initial_sync(true);
 
     BgpIfmapConfigManager *config_manager =
             static_cast<BgpIfmapConfigManager *>(bgp_server->config_manager());
@@ -568,6 +570,11 @@ int main(int argc, char *argv[]) {
                 boost::bind(&IFMapServerParser::Receive, ifmap_parser,
                             &config_db, _1, _2, _3), evm.io_service(),
                 ds_client);
+    // Parse poll responses while they are being read.
+    ifmapmgr->set_pollchunkcb(
+        boost::bind(&IFMapServerParser::ReceiveChunk, ifmap_parser,
+                    &config_db, _1, _2, _3, _4),
+        boost::bind(&IFMapServerParser::ResetChunks, ifmap_parser));
     ifmap_server.set_ifmap_manager(ifmapmgr);
 
     CpuLoadData::Init();
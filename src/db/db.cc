@@ -37,6 +37,10 @@ int DB::PartitionCount() {
     return partition_count_;
 }
 
+void DB::SetPartitionCount(int count) {
+    partition_count_ = count;
+}
+
 DB::DB() : walker_(new DBTableWalker()) {
     for (int i = 0; i < PartitionCount(); i++) {
         partitions_.push_back(new DBPartition(i));
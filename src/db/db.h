@@ -49,6 +49,9 @@ public:
     void SetGraph(const std::string &name, DBGraph *graph);
 
     static int PartitionCount();
+    // Override the number of partitions, 0 restoring the default. Only valid
+    // when no DB exists.
+    static void SetPartitionCount(int count);
     static void RegisterFactory(const std::string &prefix,
                                 CreateFunction create_fn);
     static void ClearFactoryRegistry();
@@ -4,6 +4,8 @@
 
 #include "db/db_entry.h"
 
+#include <algorithm>
+
 #include <tbb/mutex.h>
 
 #include "base/time_util.h"
@@ -11,35 +13,68 @@
 
 using namespace std;
 
+// Number of slots by which state_ grows. Listeners typically register when
+// the process starts and then set state in increasing id order, so growing
+// in small chunks avoids reallocating the array for every listener.
+static const int kStateGrowSize = 4;
+
+// Listeners are allowed to set a NULL state, which still keeps the entry
+// from being removed. Such a state is stored as a pointer to this marker
+// since a NULL slot means that the listener has no state.
+static DBState null_state_marker;
+
 DBEntryBase::DBEntryBase()
-        : tpart_(NULL), flags(0), last_change_at_(UTCTimestampUsec()) {
+        : tpart_(NULL), state_(NULL), state_size_(0), state_count_(0),
+          flags(0), last_change_at_(UTCTimestampUsec()) {
     onremoveq_ = false;
 }
 
 DBEntryBase::~DBEntryBase() {
+    FreeState();
+}
+
+void DBEntryBase::ResizeState(ListenerId listener) {
+    assert(listener >= 0 && listener < 0xFFFF - kStateGrowSize);
+    int size = (listener / kStateGrowSize + 1) * kStateGrowSize;
+    DBState **state = new DBState *[size];
+    if (state_size_) {
+        copy(state_, state_ + state_size_, state);
+    }
+    fill(state + state_size_, state + size, static_cast<DBState *>(NULL));
+    delete [] state_;
+    state_ = state;
+    state_size_ = size;
+}
+
+void DBEntryBase::FreeState() {
+    delete [] state_;
+    state_ = NULL;
+    state_size_ = 0;
+    state_count_ = 0;
 }
 
 void DBEntryBase::SetState(DBTableBase *tbl_base, ListenerId listener,
                            DBState *state) {
     DBTablePartBase *tpart = tbl_base->GetTablePartition(this);
     tbb::mutex::scoped_lock lock(tpart->dbstate_mutex());
-    pair<StateMap::iterator, bool> res = state_.insert(
-        make_pair(listener, state));
-    if (!res.second) {
-        res.first->second = state;
-    } else {
+    if (listener >= state_size_) {
+        ResizeState(listener);
+    }
+    if (state_[listener] == NULL) {
         assert(!IsDeleted());
+        state_count_++;
     }
+    state_[listener] = state ? state : &null_state_marker;
 }
 
 DBState *DBEntryBase::GetState(DBTableBase *tbl_base, ListenerId listener) {
     DBTablePartBase *tpart = tbl_base->GetTablePartition(this);
     tbb::mutex::scoped_lock lock(tpart->dbstate_mutex());
-    StateMap::iterator loc = state_.find(listener);
-    if (loc != state_.end()) {
-        return loc->second;
+    if (listener < 0 || listener >= state_size_) {
+        return NULL;
     }
-    return NULL;
+    DBState *state = state_[listener];
+    return (state == &null_state_marker) ? NULL : state;
 }
 
 const DBState *DBEntryBase::GetState(const DBTableBase *tbl_base,
@@ -47,11 +82,11 @@ const DBState *DBEntryBase::GetState(const DBTableBase *tbl_base,
     DBTableBase *table = const_cast<DBTableBase *>(tbl_base);
     DBTablePartBase *tpart = table->GetTablePartition(this);
     tbb::mutex::scoped_lock lock(tpart->dbstate_mutex());
-    StateMap::const_iterator loc = state_.find(listener);
-    if (loc != state_.end()) {
-        return loc->second;
+    if (listener < 0 || listener >= state_size_) {
+        return NULL;
     }
-    return NULL;
+    DBState *state = state_[listener];
+    return (state == &null_state_marker) ? NULL : state;
 }
 
 //
@@ -71,8 +106,13 @@ const DBState *DBEntryBase::GetState(const DBTableBase *tbl_base,
 void DBEntryBase::ClearState(DBTableBase *tbl_base, ListenerId listener) {
     DBTablePartBase *tpart = tbl_base->GetTablePartition(this);
     tbb::mutex::scoped_lock lock(tpart->dbstate_mutex());
-    state_.erase(listener);
-    if (state_.empty() && IsDeleted() && !is_onlist()) {
+    if (listener >= 0 && listener < state_size_ && state_[listener]) {
+        state_[listener] = NULL;
+        if (--state_count_ == 0) {
+            FreeState();
+        }
+    }
+    if (state_count_ == 0 && IsDeleted() && !is_onlist()) {
         assert(!IsOnRemoveQ());
         tbl_base->EnqueueRemove(this);
     }
@@ -80,7 +120,7 @@ void DBEntryBase::ClearState(DBTableBase *tbl_base, ListenerId listener) {
 
 bool DBEntryBase::is_state_empty(DBTablePartBase *tpart) {
     tbb::mutex::scoped_lock lock(tpart->dbstate_mutex());
-    return state_.empty(); 
+    return (state_count_ == 0);
 }
 
 void DBEntryBase::set_last_change_at_to_now() {
@@ -5,8 +5,6 @@
 #ifndef ctrlplane_db_entry_h
 #define ctrlplane_db_entry_h
 
-#include <map>
-
 #include <tbb/atomic.h>
 
 #include "db/db_table.h"
@@ -71,9 +69,20 @@ private:
         Onlist       = 1 << 0,
         DeleteMarked = 1 << 1,
     };
-    typedef std::map<ListenerId, DBState *> StateMap;
+
+    // Make room in state_ for the given listener id.
+    void ResizeState(ListenerId listener);
+    void FreeState();
+
     DBTablePartBase *tpart_;
-    StateMap state_;
+    // DBState of each listener, indexed by ListenerId. Listener ids are small
+    // integers allocated by DBTableBase (lowest free id first), so a dense
+    // array takes a single allocation per entry and a lookup is an index
+    // operation. The array is allocated on the first SetState and freed when
+    // the last state is cleared.
+    DBState **state_;
+    uint16_t state_size_;   // number of slots in state_
+    uint16_t state_count_;  // number of non-NULL slots in state_
     uint8_t flags;
     tbb::atomic<bool> onremoveq_;
     uint64_t last_change_at_; // time at which entry was last 'changed'
@@ -4,12 +4,14 @@
 
 #include "db/db_partition.h"
 
+#include <stdlib.h>
 #include <list>
 #include <tbb/atomic.h>
 #include <tbb/concurrent_queue.h>
 #include <tbb/mutex.h>
 
 #include "base/task.h"
+#include "base/time_util.h"
 #include "db/db_client.h"
 #include "db/db_entry.h"
 
@@ -17,6 +19,7 @@ using tbb::concurrent_queue;
 using tbb::atomic;
 
 int DBPartition::db_partition_task_id_ = -1;
+uint64_t DBPartition::yield_usecs_ = DBPartition::kDefaultYieldUsecs;
 
 struct RequestQueueEntry {
     // Constructor takes ownership of DBRequest key, data.
@@ -42,6 +45,7 @@ public:
     static const int kThreshold = 1024;
     typedef concurrent_queue<RequestQueueEntry *> RequestQueue;
     typedef concurrent_queue<RemoveQueueEntry *> RemoveQueue;
+    typedef std::vector<RequestQueueEntry *> RequestEntryList;
     typedef std::list<DBTablePartBase *> TablePartList;
 
     explicit WorkQueue(int partition_id) 
@@ -64,6 +68,16 @@ public:
         return request_count_.fetch_and_increment() < (kThreshold - 1);
     }
 
+    bool EnqueueRequests(const RequestEntryList &req_entries) {
+        for (RequestEntryList::const_iterator iter = req_entries.begin();
+             iter != req_entries.end(); ++iter) {
+            request_queue_.push(*iter);
+        }
+        MaybeStartRunner();
+        long count = req_entries.size();
+        return request_count_.fetch_and_add(count) + count < kThreshold;
+    }
+
     bool DequeueRequest(RequestQueueEntry **req_entry) {
         bool success = request_queue_.try_pop(*req_entry);
         if (success) {
@@ -130,9 +144,15 @@ void DBPartition::SetQueueDisable(bool disable) {
     work_queue_->set_disable(disable);
 }
 
+//
+// The runner yields once it has run for DBPartition::yield_usecs(), rather
+// than after a fixed number of requests, so that cheap requests are
+// processed in large batches while expensive ones don't hold the partition
+// for long. The clock is only read every kCheckIterations requests.
+//
 class DBPartition::QueueRunner : public Task {
 public:
-    static const int kMaxIterations = 32;
+    static const int kCheckIterations = 16;
     QueueRunner(WorkQueue *queue) 
         : Task(db_partition_task_id_, queue->db_partition_id()), 
           queue_(queue) {
@@ -140,6 +160,8 @@ public:
 
     virtual bool Run() {
         int count = 0;
+        uint64_t start = ClockMonotonicUsec();
+        uint64_t budget = DBPartition::yield_usecs();
 
         //
         // Skip if the queue is disabled from running
@@ -156,7 +178,8 @@ public:
                 rm_entry->db_entry->ClearOnRemoveQ();
             }
             delete rm_entry;
-            if (++count == kMaxIterations) {
+            if (++count % kCheckIterations == 0 &&
+                ClockMonotonicUsec() - start >= budget) {
                 return false;
             }
         }
@@ -165,7 +188,8 @@ public:
         while (queue_->DequeueRequest(&req_entry)) {
             req_entry->tpart->Process(req_entry->client, &req_entry->request);
             delete req_entry;
-            if (++count == kMaxIterations) {
+            if (++count % kCheckIterations == 0 &&
+                ClockMonotonicUsec() - start >= budget) {
                 return false;
             }
         }
@@ -218,6 +242,11 @@ DBPartition::DBPartition(int partition_id)
     if (db_partition_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         db_partition_task_id_ = scheduler->GetTaskId("db::DBTable");
+
+        char *str = getenv("DB_PARTITION_YIELD_USECS");
+        if (str) {
+            yield_usecs_ = strtoull(str, NULL, 0);
+        }
     }
 }
 
@@ -232,6 +261,20 @@ bool DBPartition::EnqueueRequest(DBTablePartBase *tpart, DBClient *client,
     return work_queue_->EnqueueRequest(entry);
 }
 
+bool DBPartition::EnqueueRequests(DBTablePartBase *tpart, DBClient *client,
+                                  const RequestList &requests) {
+    if (requests.empty()) {
+        return true;
+    }
+    WorkQueue::RequestEntryList entries;
+    entries.reserve(requests.size());
+    for (RequestList::const_iterator iter = requests.begin();
+         iter != requests.end(); ++iter) {
+        entries.push_back(new RequestQueueEntry(tpart, client, *iter));
+    }
+    return work_queue_->EnqueueRequests(entries);
+}
+
 void DBPartition::EnqueueRemove(DBTablePartBase *tpart, DBEntryBase *db_entry) {
     RemoveQueueEntry *entry = new RemoveQueueEntry(tpart, db_entry);
     db_entry->SetOnRemoveQ();
@@ -5,6 +5,9 @@
 #ifndef ctrlplane_db_partition_h
 #define ctrlplane_db_partition_h
 
+#include <stdint.h>
+#include <vector>
+
 #include <boost/function.hpp>
 
 #include "base/util.h"
@@ -20,6 +23,10 @@ class DBTablePartBase;
 class DBPartition {
 public:
     typedef boost::function<void(void)> Callback;
+    typedef std::vector<DBRequest *> RequestList;
+
+    // Default time after which the partition runner yields.
+    static const uint64_t kDefaultYieldUsecs = 1000;
 
     explicit DBPartition(int partition_id);
     ~DBPartition();
@@ -29,6 +36,14 @@ public:
     bool EnqueueRequest(DBTablePartBase *tpart, DBClient *client,
                         DBRequest *req);
 
+    // Enqueue a batch of requests for the same table partition. Takes
+    // ownership of the data of each request. Equivalent to calling
+    // EnqueueRequest for every request, but the work queue is updated and
+    // the runner scheduled once for the whole batch.
+    // Returns false if the client should stop enqueuing updates.
+    bool EnqueueRequests(DBTablePartBase *tpart, DBClient *client,
+                         const RequestList &requests);
+
     void EnqueueRemove(DBTablePartBase *tpart, DBEntryBase *db_entry);
 
     // Enqueue table on change list.
@@ -36,11 +51,17 @@ public:
     bool IsDBQueueEmpty() const;
     void SetQueueDisable(bool disable);
 
+    // Time budget of a partition runner, after which it yields to the
+    // other tasks. Can be overridden with DB_PARTITION_YIELD_USECS.
+    static uint64_t yield_usecs() { return yield_usecs_; }
+    static void set_yield_usecs(uint64_t usecs) { yield_usecs_ = usecs; }
+
 private:
     class WorkQueue;
     class QueueRunner;
     std::auto_ptr<WorkQueue> work_queue_;
     static int db_partition_task_id_;
+    static uint64_t yield_usecs_;
     DISALLOW_COPY_AND_ASSIGN(DBPartition);
 };
 
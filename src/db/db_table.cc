@@ -154,6 +154,31 @@ bool DBTableBase::Enqueue(DBRequest *req) {
     return partition->EnqueueRequest(tpart, NULL, req);
 }
 
+bool DBTableBase::EnqueueBulk(const std::vector<DBRequest *> &requests) {
+    int count = DB::PartitionCount();
+    std::vector<DBPartition::RequestList> batches(count);
+    std::vector<DBTablePartBase *> tparts(count, NULL);
+    for (std::vector<DBRequest *>::const_iterator iter = requests.begin();
+         iter != requests.end(); ++iter) {
+        DBTablePartBase *tpart = GetTablePartition((*iter)->key.get());
+        tparts[tpart->index()] = tpart;
+        batches[tpart->index()].push_back(*iter);
+    }
+
+    bool result = true;
+    for (int index = 0; index < count; index++) {
+        if (batches[index].empty()) {
+            continue;
+        }
+        DBPartition *partition = db_->GetPartition(index);
+        if (!partition->EnqueueRequests(tparts[index], NULL,
+                                        batches[index])) {
+            result = false;
+        }
+    }
+    return result;
+}
+
 void DBTableBase::EnqueueRemove(DBEntryBase *db_entry) {
     DBTablePartBase *tpart = GetTablePartition(db_entry);
     DBPartition *partition = db_->GetPartition(tpart->index());
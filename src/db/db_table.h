@@ -61,6 +61,9 @@ public:
 
     // Enqueue a request to the table. Takes ownership of the data.
     bool Enqueue(DBRequest *req);
+    // Enqueue a batch of requests, handing the requests of each partition
+    // to its work queue in one operation. Takes ownership of the data.
+    bool EnqueueBulk(const std::vector<DBRequest *> &requests);
     void EnqueueRemove(DBEntryBase *db_entry);
 
     // Determine the table partition depending on the record key.
@@ -4,28 +4,42 @@
 
 #include "db/db_table_walker.h"
 
+#include <algorithm>
 #include <list>
 #include <tbb/atomic.h>
 #include <boost/bind.hpp>
 
 #include "base/logging.h"
 #include "base/task.h"
+#include "base/time_util.h"
 #include "db/db.h"
 #include "db/db_partition.h"
 #include "db/db_table.h"
 #include "db/db_table_partition.h"
+#include "db/db_types.h"
 
 int DBTableWalker::walker_task_id_ = -1;
+uint64_t DBTableWalker::yield_usecs_ = DBTableWalker::kDefaultYieldUsecs;
 
 DBTableWalker::DBTableWalker() {
     if (walker_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         // Using same task id as DBPartition
         walker_task_id_ = scheduler->GetTaskId("db::DBTable");
+
+        char *str = getenv("DB_WALKER_YIELD_USECS");
+        if (str) {
+            yield_usecs_ = strtoull(str, NULL, 0);
+        }
     }
     walk_request_count_ = 0;
     walk_complete_count_ = 0;
     walk_cancel_count_ = 0;
+    walk_coalesce_count_ = 0;
+    walk_total_usecs_ = 0;
+    walk_max_usecs_ = 0;
+    walk_yield_count_ = 0;
+    walk_entry_count_ = 0;
     work_queue_ = new WorkQueue<Walker *>
         (walker_task_id_, Task::kTaskInstanceAny,
          boost::bind(&DBTableWalker::WalkDone, this, _1));
@@ -36,12 +50,20 @@ DBTableWalker::~DBTableWalker() {
     delete work_queue_;
 }
 
+//
+// A Walker is allocated for each walk request. The walker of the request
+// that started a pass over the table is the leader of the pass: it owns the
+// workers and the list of the requests that joined the pass.
+//
 class DBTableWalker::Walker {
 public:
     Walker(WalkId id, DBTableWalker *wkmgr, DBTable *table,
-           const DBRequestKey *key, WalkFn walker, 
+           const DBRequestKey *key, WalkFn walker,
            WalkCompleteFn walk_done);
 
+    // Enqueue a worker for each table partition.
+    void StartWorkers();
+
     void StopWalk() {
         should_stop_.fetch_and_store(true);
     }
@@ -65,12 +87,24 @@ public:
 
     // check whether iteraton is completed on all Table Partition
     tbb::atomic<long> status_;
+
+    // Time of the walk request
+    uint64_t request_usecs_;
+
+    // Leader of the pass this request is part of
+    Walker *leader_;
+
+    // The following are only used on the leader of a pass.
+    // Requests that joined the pass. Frozen once started_ is set.
+    WalkerList riders_;
+    bool started_;
+    tbb::atomic<uint64_t> entry_count_;
 };
 
 class DBTableWalker::Worker : public Task {
 public:
-    Worker(Walker *walker, int db_partition_id, const DBRequestKey *key) 
-        : Task(walker_task_id_, db_partition_id), walker_(walker), 
+    Worker(Walker *walker, int db_partition_id, const DBRequestKey *key)
+        : Task(walker_task_id_, db_partition_id), walker_(walker),
           key_start_(key) {
         tbl_partition_ = static_cast<DBTablePartition *>(
             walker_->table_->GetTablePartition(db_partition_id));
@@ -79,8 +113,17 @@ public:
     virtual bool Run();
 
 private:
+    // Invoke the walk function of the requests that are still walking this
+    // partition. Returns false when there are none left.
+    bool Walk(DBEntry *entry);
+
     DBTableWalker::Walker *walker_;
 
+    // Requests sharing the pass, and whether each is done with this
+    // partition.
+    WalkerList requests_;
+    std::vector<bool> done_;
+
     // Store the last visited node to continue walk
     std::auto_ptr<DBRequestKey> walk_ctx_;
 
@@ -107,12 +150,41 @@ static void db_walker_wait() {
     }
 }
 
+bool DBTableWalker::Worker::Walk(DBEntry *entry) {
+    bool more = false;
+    for (size_t i = 0; i < requests_.size(); i++) {
+        Walker *request = requests_[i];
+        if (done_[i] || request->should_stop_) {
+            continue;
+        }
+        if (request->walker_fn_(tbl_partition_, entry)) {
+            more = true;
+        } else {
+            done_[i] = true;
+        }
+    }
+    return more;
+}
+
 bool DBTableWalker::Worker::Run() {
     int count = 0;
+    uint64_t start_usecs = ClockMonotonicUsec();
     DBRequestKey *key_resume;
 
-    // Check whether Walker was requested to be cancelled
-    if (walker_->should_stop_) {
+    if (requests_.empty()) {
+        walker_->wkmgr_->StartPass(walker_, &requests_);
+        done_.resize(requests_.size());
+    }
+
+    // Check whether all the requests were cancelled
+    bool stopped = true;
+    for (size_t i = 0; i < requests_.size(); i++) {
+        if (!requests_[i]->should_stop_) {
+            stopped = false;
+            break;
+        }
+    }
+    if (stopped) {
         goto walk_done;
     }
 
@@ -138,18 +210,20 @@ bool DBTableWalker::Worker::Run() {
 
     for (DBEntry *next = NULL; entry; entry = next) {
         next = tbl_partition_->GetNext(entry);
-        // Check whether Walker was requested to be cancelled
-        if (walker_->should_stop_) {
-            break; 
-        }
-        if (count == GetIterationToYield()) {
+        if (count != 0 && (count == GetIterationToYield() ||
+            (count % kCheckIterations == 0 &&
+             ClockMonotonicUsec() - start_usecs >= yield_usecs()))) {
             // store the context
             walk_ctx_ = entry->GetDBRequestKey();
+            walker_->entry_count_ += count;
+            walker_->wkmgr_->walk_entry_count_ += count;
+            walker_->wkmgr_->walk_yield_count_++;
             return false;
         }
 
-        // Invoke walker function
-        bool more = walker_->walker_fn_(tbl_partition_, entry);
+        // Invoke walker functions, stopping when all the requests are
+        // cancelled or done
+        bool more = Walk(entry);
         if (!more) {
             break;
         }
@@ -157,6 +231,8 @@ bool DBTableWalker::Worker::Run() {
         db_walker_wait();
         count++;
     }
+    walker_->entry_count_ += count;
+    walker_->wkmgr_->walk_entry_count_ += count;
 
 walk_done:
     // Check whether all other walks on the table is completed
@@ -172,39 +248,57 @@ DBTableWalker::Walker::Walker(WalkId id, DBTableWalker *wkmgr,
                               DBTable *table, const DBRequestKey *key,
                               WalkFn walker, WalkCompleteFn walk_done)
     : id_(id), wkmgr_(wkmgr), table_(table),
-      key_start_(const_cast<DBRequestKey *>(key)), 
-      walker_fn_(walker), done_fn_(walk_done) {
-    int num_worker = DB::PartitionCount(); 
+      key_start_(const_cast<DBRequestKey *>(key)),
+      walker_fn_(walker), done_fn_(walk_done),
+      request_usecs_(ClockMonotonicUsec()), leader_(this), started_(false) {
     should_stop_ = false;
+    status_ = 0;
+    entry_count_ = 0;
+}
+
+void DBTableWalker::Walker::StartWorkers() {
+    int num_worker = DB::PartitionCount();
     status_ = num_worker;
     for (int i = 0; i < num_worker; i++) {
-        Worker *task = new Worker(this, i, key);
+        Worker *task = new Worker(this, i, key_start_.get());
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         scheduler->Enqueue(task);
     }
 }
 
-DBTableWalker::WalkId DBTableWalker::WalkTable(DBTable *table, 
-                                               const DBRequestKey *key_start, 
-                                               WalkFn walkerfn , 
+DBTableWalker::WalkId DBTableWalker::WalkTable(DBTable *table,
+                                               const DBRequestKey *key_start,
+                                               WalkFn walkerfn ,
                                                WalkCompleteFn walk_complete) {
     tbb::mutex::scoped_lock lock(walkers_mutex_);
     walk_request_count_++;
     size_t i = walker_map_.find_first();
     if (i == walker_map_.npos) {
         i = walkers_.size();
-        Walker *walker = new Walker(i, this, table, key_start, 
-                                    walkerfn, walk_complete);
-        walkers_.push_back(walker);
+        walkers_.push_back(NULL);
     } else {
         walker_map_.reset(i);
         if (walker_map_.none()) {
             walker_map_.clear();
         }
-        Walker *walker = new Walker(i, this, table, key_start, 
-                                    walkerfn, walk_complete);
-        walkers_[i] = walker;
     }
+    Walker *walker = new Walker(i, this, table, key_start,
+                                walkerfn, walk_complete);
+    walkers_[i] = walker;
+
+    // Join a full walk of the table that has not started yet.
+    if (key_start == NULL) {
+        PendingMap::iterator loc = pending_walks_.find(table);
+        if (loc != pending_walks_.end()) {
+            Walker *leader = loc->second;
+            walker->leader_ = leader;
+            leader->riders_.push_back(walker);
+            walk_coalesce_count_++;
+            return i;
+        }
+        pending_walks_.insert(std::make_pair(table, walker));
+    }
+    walker->StartWorkers();
     return i;
 }
 
@@ -215,6 +309,20 @@ void DBTableWalker::WalkCancel(WalkId id) {
     // Purge to be called after task has stopped
 }
 
+void DBTableWalker::StartPass(Walker *walker, WalkerList *requests) {
+    tbb::mutex::scoped_lock lock(walkers_mutex_);
+    if (!walker->started_) {
+        walker->started_ = true;
+        PendingMap::iterator loc = pending_walks_.find(walker->table_);
+        if (loc != pending_walks_.end() && loc->second == walker) {
+            pending_walks_.erase(loc);
+        }
+    }
+    requests->push_back(walker);
+    requests->insert(requests->end(), walker->riders_.begin(),
+                     walker->riders_.end());
+}
+
 void DBTableWalker::PurgeWalker(WalkId id) {
     tbb::mutex::scoped_lock lock(walkers_mutex_);
     Walker *walker = walkers_[id];
@@ -235,17 +343,71 @@ void DBTableWalker::PurgeWalker(WalkId id) {
     }
 }
 
+// Called with the leader of a pass once all the workers are done.
 bool DBTableWalker::WalkDone(DBTableWalker::Walker *walker) {
-    // Invoke Walker_Complete callback
-    if (!walker->should_stop_) {
-        walker->wkmgr_->update_walk_complete_count(+1);
-    }
-    if (walker->done_fn_ != NULL) {
-        if (!walker->should_stop_) {
-            walker->done_fn_(walker->table_);
+    WalkerList requests;
+    requests.push_back(walker);
+    requests.insert(requests.end(), walker->riders_.begin(),
+                    walker->riders_.end());
+
+    uint64_t now = ClockMonotonicUsec();
+    for (WalkerList::iterator it = requests.begin(); it != requests.end();
+         ++it) {
+        Walker *request = *it;
+        if (request->should_stop_) {
+            continue;
+        }
+        uint64_t usecs = now - request->request_usecs_;
+        {
+            tbb::mutex::scoped_lock lock(walkers_mutex_);
+            walk_complete_count_++;
+            walk_total_usecs_ += usecs;
+            walk_max_usecs_ = std::max(walk_max_usecs_, usecs);
+        }
+        // Invoke Walker_Complete callback
+        if (request->done_fn_ != NULL) {
+            request->done_fn_(request->table_);
         }
     }
-    // Release the memory for walker and bitmap
-    walker->wkmgr_->PurgeWalker(walker->id_);
+
+    // Release the memory for walkers and bitmap. The leader goes last as
+    // it owns the list of riders.
+    for (WalkerList::reverse_iterator it = requests.rbegin();
+         it != requests.rend(); ++it) {
+        PurgeWalker((*it)->id_);
+    }
     return true;
 }
+
+void DBTableWalker::FillStats(ShowTableWalkerStats *stats) {
+    tbb::mutex::scoped_lock lock(walkers_mutex_);
+    stats->set_walk_requests(walk_request_count_);
+    stats->set_walk_completes(walk_complete_count_);
+    stats->set_walk_cancels(walk_cancel_count_);
+    stats->set_walk_coalesced(walk_coalesce_count_);
+    stats->set_walk_yields(walk_yield_count_);
+    stats->set_entries_walked(walk_entry_count_);
+    stats->set_average_walk_usecs(walk_complete_count_ ?
+        walk_total_usecs_ / walk_complete_count_ : 0);
+    stats->set_max_walk_usecs(walk_max_usecs_);
+
+    uint64_t now = ClockMonotonicUsec();
+    std::vector<ShowTableWalk> walks;
+    for (WalkerList::iterator it = walkers_.begin(); it != walkers_.end();
+         ++it) {
+        Walker *walker = *it;
+        if (walker == NULL || walker->leader_ != walker) {
+            continue;
+        }
+        ShowTableWalk walk;
+        walk.set_id(walker->id_);
+        walk.set_table(walker->table_->name());
+        walk.set_requests(walker->riders_.size() + 1);
+        walk.set_started(walker->started_);
+        walk.set_entries_walked(walker->entry_count_);
+        walk.set_partitions_pending(walker->status_);
+        walk.set_elapsed_usecs(now - walker->request_usecs_);
+        walks.push_back(walk);
+    }
+    stats->set_walks(walks);
+}
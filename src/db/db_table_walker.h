@@ -5,8 +5,11 @@
 #ifndef ctrlplane_db_table_walker_h
 #define ctrlplane_db_table_walker_h
 
+#include <map>
+
 #include <boost/function.hpp>
 #include <boost/dynamic_bitset.hpp>
+#include <tbb/atomic.h>
 #include <tbb/task.h>
 
 #include "base/logging.h"
@@ -14,8 +17,19 @@
 #include "db/db_table.h"
 #include "db/db_table_partition.h"
 
+class ShowTableWalkerStats;
+
 // A DB contains a TableWalker that is able to iterate though all the
 // entries in a certain routing table.
+//
+// Walk requests for the whole of a table are coalesced: a request made
+// while another full walk of the same table is queued but not yet started
+// joins it, and both walk functions are invoked on each entry in a single
+// pass. Each request keeps its own WalkId, and is completed or cancelled
+// independently of the others.
+//
+// Workers yield after running for yield_usecs() rather than after a fixed
+// number of entries.
 class DBTableWalker {
 public:
 
@@ -33,6 +47,9 @@ public:
 
     static const WalkId kInvalidWalkerId = -1;
 
+    // Default time after which a walk worker yields.
+    static const uint64_t kDefaultYieldUsecs = 1000;
+
     // Start a walk request on the specified table. If non null, 'key_start'
     // specifies the starting point for the walk. The walk is performed in
     // all table shards in parallel.
@@ -53,12 +70,27 @@ public:
         walk_complete_count_ += inc;
     }
     uint64_t walk_cancel_count() { return walk_cancel_count_; }
+    uint64_t walk_coalesce_count() { return walk_coalesce_count_; }
+    uint64_t walk_yield_count() { return walk_yield_count_; }
+    uint64_t walk_entry_count() { return walk_entry_count_; }
+
+    // Fill the counters, the latency of completed walks and the progress of
+    // the walks in progress.
+    void FillStats(ShowTableWalkerStats *stats);
+
+    // Time budget of a walk worker. Can be overridden with
+    // DB_WALKER_YIELD_USECS.
+    static uint64_t yield_usecs() { return yield_usecs_; }
+    static void set_yield_usecs(uint64_t usecs) { yield_usecs_ = usecs; }
 
 private:
-    static const int kIterationToYield = 1024;
+    // Entries walked between reads of the clock.
+    static const int kCheckIterations = 16;
 
+    // Besides the time budget, yield after this number of entries if non
+    // zero.
     static const int GetIterationToYield() {
-        static int iter_ = kIterationToYield;
+        static int iter_ = 0;
         static bool init_ = false;
 
         if (!init_) {
@@ -82,6 +114,11 @@ private:
 
     typedef std::vector<Walker *> WalkerList;
     typedef boost::dynamic_bitset<> WalkerMap;
+    typedef std::map<DBTable *, Walker *> PendingMap;
+
+    // Freeze the requests sharing the pass of walker, when its first worker
+    // starts running.
+    void StartPass(Walker *walker, WalkerList *requests);
 
     // Purge the walker after the walk is completed/cancelled
     void PurgeWalker(WalkId id);
@@ -92,11 +129,20 @@ private:
     WalkerList walkers_;
     WalkerMap walker_map_;
 
+    // Full table walks that have not started yet, by table.
+    PendingMap pending_walks_;
+
     uint64_t walk_request_count_;
     uint64_t walk_complete_count_;
     uint64_t walk_cancel_count_;
+    uint64_t walk_coalesce_count_;
+    uint64_t walk_total_usecs_;
+    uint64_t walk_max_usecs_;
+    tbb::atomic<uint64_t> walk_yield_count_;
+    tbb::atomic<uint64_t> walk_entry_count_;
 
     static int walker_task_id_;
+    static uint64_t yield_usecs_;
     WorkQueue<Walker *> *work_queue_;
 };
 #endif
@@ -5,7 +5,11 @@
 #include <boost/intrusive/avl_set.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <tbb/atomic.h>
+#if defined(__linux__)
+#include <malloc.h>
+#endif
 
 #include "db/db.h"
 #include "db/db_table.h"
@@ -245,6 +249,83 @@ void VlanTablePart::Process(DBClient *client, DBRequest *req) {
 
 #include "db_test_cmn.h"
 
+#if defined(__linux__)
+static size_t HeapInUse() {
+    struct mallinfo info = mallinfo();
+    return static_cast<unsigned int>(info.uordblks);
+}
+
+//
+// Measure the heap used to keep DBState for N listeners on each of a large
+// number of entries. The std::map<ListenerId, DBState *> that used to hold
+// the states is measured the same way as a reference. The default size is
+// small; set DB_STATE_TEST_ENTRY_COUNT=1000000 for a full run.
+//
+TEST_F(DBTest, StateMemory) {
+    size_t entry_count = 10000;
+    int listener_count = 10;
+    char *str = getenv("DB_STATE_TEST_ENTRY_COUNT");
+    if (str) entry_count = strtoul(str, NULL, 0);
+    str = getenv("DB_STATE_TEST_LISTENER_COUNT");
+    if (str) listener_count = strtoul(str, NULL, 0);
+
+    std::vector<DBTableBase::ListenerId> ids;
+    for (int i = 0; i < listener_count; i++) {
+        ids.push_back(itbl->Register(
+            boost::bind(&DBTest::DBTestListener, this, _1, _2)));
+    }
+    VlanState state(0);
+
+    std::vector<Vlan *> entries;
+    entries.reserve(entry_count);
+    for (size_t idx = 0; idx < entry_count; idx++) {
+        entries.push_back(new Vlan(idx & 0xFFFF));
+    }
+    size_t start = HeapInUse();
+    BOOST_FOREACH(Vlan *vlan, entries) {
+        BOOST_FOREACH(DBTableBase::ListenerId id, ids) {
+            vlan->SetState(itbl, id, &state);
+        }
+    }
+    size_t state_bytes = HeapInUse() - start;
+
+    BOOST_FOREACH(Vlan *vlan, entries) {
+        BOOST_FOREACH(DBTableBase::ListenerId id, ids) {
+            EXPECT_EQ(&state, vlan->GetState(itbl, id));
+        }
+    }
+
+    typedef std::map<DBTableBase::ListenerId, DBState *> StateMap;
+    std::vector<StateMap> maps(entry_count);
+    start = HeapInUse();
+    BOOST_FOREACH(StateMap &map, maps) {
+        BOOST_FOREACH(DBTableBase::ListenerId id, ids) {
+            map.insert(std::make_pair(id, &state));
+        }
+    }
+    size_t map_bytes = HeapInUse() - start;
+    maps.clear();
+
+    std::cout << entry_count << " entries with " << listener_count
+              << " listeners: " << sizeof(DBEntryBase) << " + "
+              << state_bytes / entry_count << " bytes per entry, std::map "
+              << sizeof(StateMap) << " + " << map_bytes / entry_count
+              << " bytes per entry" << std::endl;
+    EXPECT_LT(state_bytes, map_bytes);
+
+    BOOST_FOREACH(Vlan *vlan, entries) {
+        BOOST_FOREACH(DBTableBase::ListenerId id, ids) {
+            vlan->ClearState(itbl, id);
+        }
+        EXPECT_TRUE(vlan->is_state_empty(itbl->GetTablePartition(vlan)));
+    }
+    STLDeleteValues(&entries);
+    BOOST_FOREACH(DBTableBase::ListenerId id, ids) {
+        itbl->Unregister(id);
+    }
+}
+#endif
+
 void RegisterFactory() {
     DB::RegisterFactory("db.test.vlan.0", &VlanTable::CreateTable);
     DB::RegisterFactory("db.test.vlan.1", &VlanTable::CreateTable);
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include <boost/bind.hpp>
+#include <tbb/atomic.h>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/time_util.h"
+#include "base/test/task_test_util.h"
+#include "db/db.h"
+#include "db/db_entry.h"
+#include "db/db_table.h"
+#include "db/db_table_walker.h"
+#include "testing/gunit.h"
+
+struct WalkTestKey : public DBRequestKey {
+    explicit WalkTestKey(uint32_t id) : id(id) { }
+    uint32_t id;
+};
+
+struct WalkTestData : public DBRequestData {
+};
+
+class WalkTestEntry : public DBEntry {
+public:
+    explicit WalkTestEntry(uint32_t id) : id_(id) { }
+
+    virtual bool IsLess(const DBEntry &rhs) const {
+        const WalkTestEntry &other = static_cast<const WalkTestEntry &>(rhs);
+        return id_ < other.id_;
+    }
+    virtual void SetKey(const DBRequestKey *key) {
+        id_ = static_cast<const WalkTestKey *>(key)->id;
+    }
+    virtual KeyPtr GetDBRequestKey() const {
+        return KeyPtr(new WalkTestKey(id_));
+    }
+    virtual std::string ToString() const { return "WalkTestEntry"; }
+
+    uint32_t id() const { return id_; }
+
+private:
+    uint32_t id_;
+    DISALLOW_COPY_AND_ASSIGN(WalkTestEntry);
+};
+
+class WalkTestTable : public DBTable {
+public:
+    explicit WalkTestTable(DB *db) : DBTable(db, "walk.test.0") { }
+
+    virtual std::auto_ptr<DBEntry> AllocEntry(const DBRequestKey *key) const {
+        const WalkTestKey *tkey = static_cast<const WalkTestKey *>(key);
+        return std::auto_ptr<DBEntry>(new WalkTestEntry(tkey->id));
+    }
+    virtual size_t Hash(const DBEntry *entry) const {
+        return static_cast<const WalkTestEntry *>(entry)->id();
+    }
+    virtual size_t Hash(const DBRequestKey *key) const {
+        return static_cast<const WalkTestKey *>(key)->id;
+    }
+    virtual DBEntry *Add(const DBRequest *req) {
+        const WalkTestKey *key = static_cast<const WalkTestKey *>(
+            req->key.get());
+        return new WalkTestEntry(key->id);
+    }
+    virtual bool OnChange(DBEntry *entry, const DBRequest *req) {
+        return false;
+    }
+    virtual bool Delete(DBEntry *entry, const DBRequest *req) {
+        return true;
+    }
+
+    static DBTableBase *CreateTable(DB *db, const std::string &name) {
+        WalkTestTable *table = new WalkTestTable(db);
+        table->Init();
+        return table;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(WalkTestTable);
+};
+
+class DBTableWalkerTest : public ::testing::Test {
+protected:
+    static const int kMaxWalks = 8;
+
+    DBTableWalkerTest() : walker_(db_.GetWalker()), entry_count_(0) {
+        table_ = static_cast<WalkTestTable *>(db_.CreateTable("walk.test.0"));
+        for (int i = 0; i < kMaxWalks; i++) {
+            walk_count_[i] = 0;
+            done_count_[i] = 0;
+        }
+    }
+
+    virtual void TearDown() {
+        Populate(0, false);
+        task_util::WaitForIdle();
+        EXPECT_EQ(0, table_->Size());
+    }
+
+    // Add or delete count entries, in batches.
+    void Populate(size_t count, bool add) {
+        if (!add) {
+            count = entry_count_;
+        }
+        std::vector<DBRequest *> batch;
+        for (size_t idx = 0; idx < count; idx++) {
+            DBRequest *request = new DBRequest(add ?
+                DBRequest::DB_ENTRY_ADD_CHANGE : DBRequest::DB_ENTRY_DELETE);
+            request->key.reset(new WalkTestKey(idx));
+            if (add) {
+                request->data.reset(new WalkTestData());
+            }
+            batch.push_back(request);
+            if (batch.size() == 1024 || idx == count - 1) {
+                table_->EnqueueBulk(batch);
+                STLDeleteValues(&batch);
+            }
+        }
+        task_util::WaitForIdle(300);
+        entry_count_ = add ? count : 0;
+    }
+
+    bool WalkFn(int index, DBTablePartBase *tpart, DBEntryBase *entry) {
+        walk_count_[index]++;
+        return true;
+    }
+
+    void WalkDoneFn(int index, DBTableBase *table) {
+        done_count_[index]++;
+    }
+
+    DBTableWalker::WalkId StartWalk(int index, const DBRequestKey *key) {
+        return walker_->WalkTable(table_, key,
+            boost::bind(&DBTableWalkerTest::WalkFn, this, index, _1, _2),
+            boost::bind(&DBTableWalkerTest::WalkDoneFn, this, index, _1));
+    }
+
+    DB db_;
+    DBTableWalker *walker_;
+    WalkTestTable *table_;
+    size_t entry_count_;
+    tbb::atomic<long> walk_count_[kMaxWalks];
+    tbb::atomic<long> done_count_[kMaxWalks];
+};
+
+// Full table walks requested before the first one starts share its pass.
+TEST_F(DBTableWalkerTest, Coalesce) {
+    Populate(1000, true);
+    uint64_t coalesce_count = walker_->walk_coalesce_count();
+    uint64_t entry_count = walker_->walk_entry_count();
+
+    TaskScheduler::GetInstance()->Stop();
+    StartWalk(0, NULL);
+    StartWalk(1, NULL);
+    StartWalk(2, NULL);
+    // A walk with a start key is not coalesced.
+    StartWalk(3, new WalkTestKey(500));
+    TaskScheduler::GetInstance()->Start();
+    task_util::WaitForIdle();
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(1000, walk_count_[i]);
+        EXPECT_EQ(1, done_count_[i]);
+    }
+    EXPECT_EQ(500, walk_count_[3]);
+    EXPECT_EQ(1, done_count_[3]);
+    EXPECT_EQ(coalesce_count + 2, walker_->walk_coalesce_count());
+    EXPECT_EQ(entry_count + 1000 + 500, walker_->walk_entry_count());
+
+    // Walks requested once the previous pass completed start a new pass.
+    StartWalk(4, NULL);
+    task_util::WaitForIdle();
+    EXPECT_EQ(1000, walk_count_[4]);
+    EXPECT_EQ(1, done_count_[4]);
+}
+
+// Cancelling a request does not affect the others sharing its pass, even
+// when the cancelled request started the pass.
+TEST_F(DBTableWalkerTest, CancelCoalesced) {
+    Populate(1000, true);
+    uint64_t complete_count = walker_->walk_complete_count();
+
+    TaskScheduler::GetInstance()->Stop();
+    DBTableWalker::WalkId id0 = StartWalk(0, NULL);
+    DBTableWalker::WalkId id1 = StartWalk(1, NULL);
+    StartWalk(2, NULL);
+    walker_->WalkCancel(id0);
+    walker_->WalkCancel(id1);
+    TaskScheduler::GetInstance()->Start();
+    task_util::WaitForIdle();
+
+    EXPECT_EQ(0, walk_count_[0]);
+    EXPECT_EQ(0, done_count_[0]);
+    EXPECT_EQ(0, walk_count_[1]);
+    EXPECT_EQ(0, done_count_[1]);
+    EXPECT_EQ(1000, walk_count_[2]);
+    EXPECT_EQ(1, done_count_[2]);
+    EXPECT_EQ(complete_count + 1, walker_->walk_complete_count());
+}
+
+// Time N full walks of a large table, as separate passes and coalesced.
+TEST_F(DBTableWalkerTest, Benchmark) {
+    size_t entry_count = 1000000;
+    int walk_count = 4;
+    char *str = getenv("DB_WALKER_TEST_ENTRY_COUNT");
+    if (str) entry_count = strtoul(str, NULL, 0);
+    str = getenv("DB_WALKER_TEST_WALK_COUNT");
+    if (str) walk_count = std::min(strtol(str, NULL, 0), (long) kMaxWalks);
+    Populate(entry_count, true);
+
+    for (int coalesce = 0; coalesce < 2; coalesce++) {
+        uint64_t yield_count = walker_->walk_yield_count();
+        for (int i = 0; i < walk_count; i++) {
+            walk_count_[i] = 0;
+        }
+
+        // A start key prevents coalescing, while still walking the whole
+        // table.
+        TaskScheduler::GetInstance()->Stop();
+        for (int i = 0; i < walk_count; i++) {
+            StartWalk(i, coalesce ? NULL : new WalkTestKey(0));
+        }
+        uint64_t start = ClockMonotonicUsec();
+        TaskScheduler::GetInstance()->Start();
+        task_util::WaitForIdle(300);
+        uint64_t elapsed = ClockMonotonicUsec() - start;
+
+        for (int i = 0; i < walk_count; i++) {
+            EXPECT_EQ(entry_count, (size_t) walk_count_[i]);
+        }
+        std::cout << walk_count << (coalesce ? " coalesced" : " separate")
+                  << " walks of " << entry_count << " entries: "
+                  << elapsed / 1000 << " msec, "
+                  << walker_->walk_yield_count() - yield_count << " yields"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    DB::RegisterFactory("walk.test.0", &WalkTestTable::CreateTable);
+    return RUN_ALL_TESTS();
+}
@@ -2,6 +2,9 @@
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
 
+#include <algorithm>
+#include <iostream>
+
 #include <boost/intrusive/avl_set.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/bind.hpp>
@@ -15,6 +18,7 @@
 #include "db/db_table_walker.h"
 
 #include "base/logging.h"
+#include "base/time_util.h"
 #include "base/task_annotations.h"
 #include "testing/gunit.h"
 
@@ -243,6 +247,100 @@ TEST_F(DBTest, SkipDelete) {
     itbl->Unregister(tid_);
 }
 
+class DBBenchmarkTest : public ::testing::Test {
+protected:
+    DBBenchmarkTest() {
+        notification_count_ = 0;
+    }
+
+    virtual void TearDown() {
+        DB::SetPartitionCount(0);
+    }
+
+    void Listener(DBTablePartBase *root, DBEntryBase *entry) {
+        notification_count_++;
+    }
+
+    //
+    // Add count entries to a table of a DB with the specified number of
+    // partitions, enqueuing the requests one at a time if batch_size is 1
+    // and in batches of batch_size requests otherwise. Returns the number
+    // of requests processed per second.
+    //
+    double Run(int partition_count, size_t count, size_t batch_size) {
+        DB::SetPartitionCount(partition_count);
+        DB db;
+        VlanTable *table =
+            static_cast<VlanTable *>(db.CreateTable("db.test.vlan.0"));
+        DBTableBase::ListenerId id = table->Register(
+            boost::bind(&DBBenchmarkTest::Listener, this, _1, _2));
+        notification_count_ = 0;
+
+        // Build the requests ahead of time so that only their enqueue and
+        // processing is measured.
+        std::vector<DBRequest *> requests;
+        for (size_t idx = 0; idx < count; idx++) {
+            DBRequest *request = new DBRequest(DBRequest::DB_ENTRY_ADD_CHANGE);
+            request->key.reset(new VlanTableReqKey(idx));
+            request->data.reset(new VlanTableReqData("DB Test Vlan"));
+            requests.push_back(request);
+        }
+
+        uint64_t start = ClockMonotonicUsec();
+        if (batch_size == 1) {
+            for (size_t idx = 0; idx < count; idx++) {
+                table->Enqueue(requests[idx]);
+            }
+        } else {
+            std::vector<DBRequest *> batch;
+            for (size_t idx = 0; idx < count; idx += batch_size) {
+                size_t end = std::min(idx + batch_size, count);
+                batch.assign(requests.begin() + idx, requests.begin() + end);
+                table->EnqueueBulk(batch);
+            }
+        }
+        task_util::WaitForIdle();
+        uint64_t elapsed = ClockMonotonicUsec() - start;
+
+        EXPECT_EQ(count, table->Size());
+        EXPECT_EQ(count, (size_t) notification_count_);
+        STLDeleteValues(&requests);
+
+        for (size_t idx = 0; idx < count; idx++) {
+            DBRequest request(DBRequest::DB_ENTRY_DELETE);
+            request.key.reset(new VlanTableReqKey(idx));
+            table->Enqueue(&request);
+        }
+        task_util::WaitForIdle();
+        EXPECT_EQ(0, table->Size());
+        table->Unregister(id);
+
+        return count * 1000000.0 / std::max(elapsed, (uint64_t) 1);
+    }
+
+    tbb::atomic<long> notification_count_;
+};
+
+// Compare the throughput of single and bulk enqueue at 1, 4 and 16
+// partitions.
+TEST_F(DBBenchmarkTest, Enqueue) {
+    size_t count = 50000;
+    size_t batch_size = 256;
+    char *str = getenv("DB_TEST_BENCHMARK_REQUEST_COUNT");
+    if (str) count = std::min(strtoul(str, NULL, 0), 65536UL);
+    str = getenv("DB_TEST_BENCHMARK_BATCH_SIZE");
+    if (str) batch_size = std::max(strtoul(str, NULL, 0), 2UL);
+
+    const int partitions[] = { 1, 4, 16 };
+    for (size_t i = 0; i < sizeof(partitions) / sizeof(partitions[0]); i++) {
+        double single = Run(partitions[i], count, 1);
+        double bulk = Run(partitions[i], count, batch_size);
+        std::cout << partitions[i] << " partitions, " << count <<
+            " requests: single " << (uint64_t) single << " req/s, bulk " <<
+            (uint64_t) bulk << " req/s" << std::endl;
+    }
+}
+
 void RegisterFactory() {
     DB::RegisterFactory("db.test.vlan.0", &VlanTable::CreateTable);
     DB::RegisterFactory("db.test.vlan.1", &VlanTable::CreateTable);
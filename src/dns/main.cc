@@ -245,6 +245,11 @@ int main(int argc, char *argv[]) {
                 boost::bind(&IFMapServerParser::Receive, ifmap_parser,
                             &config_db, _1, _2, _3),
                         Dns::GetEventManager()->io_service(), ds_client);
+    // Parse poll responses while they are being read.
+    ifmapmgr->set_pollchunkcb(
+        boost::bind(&IFMapServerParser::ReceiveChunk, ifmap_parser,
+                    &config_db, _1, _2, _3, _4),
+        boost::bind(&IFMapServerParser::ResetChunks, ifmap_parser));
     ifmap_server.set_ifmap_manager(ifmapmgr);
 
     Dns::GetEventManager()->Run();
@@ -4,6 +4,7 @@
 
 #include <boost/bind.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/pointer_cast.hpp>
 
 #include "analytics/diffstats.h"
@@ -559,10 +560,7 @@ public:
         if (cdbif_->cleanup_task_ == NULL) {
             return true;
         }
-        if (cdbif_->cdbq_.get() != NULL) {
-            cdbif_->cdbq_->Shutdown();
-            cdbif_->cdbq_.reset();
-        }
+        cdbif_->Db_ShutdownWriterQueues();
         cdbif_->cleanup_task_ = NULL;
         return true;
     }
@@ -583,19 +581,8 @@ public:
 
     virtual bool Run() {
         tbb::mutex::scoped_lock lock(cdbif_->cdbq_mutex_);
-        if (cdbif_->cdbq_.get() != NULL) {
-            cdbif_->cdbq_->Shutdown();
-        }
+        cdbif_->Db_CreateWriterQueues(task_id_);
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
-        cdbif_->cdbq_.reset(new CdbIfQueue(
-            scheduler->GetTaskId(task_id_), cdbif_->task_instance_,
-            boost::bind(&CdbIf::Db_AsyncAddColumn, cdbif_, _1)));
-        cdbif_->cdbq_->SetStartRunnerFunc(
-            boost::bind(&CdbIf::Db_IsInitDone, cdbif_));
-        cdbif_->cdbq_->SetExitCallback(boost::bind(&CdbIf::Db_BatchAddColumn,
-            cdbif_, _1));
-        cdbif_->Db_SetQueueWaterMarkInternal(cdbif_->cdbq_.get(),
-            cdbif_->cdbq_wm_info_);
         if (cdbif_->cleanup_task_) {
             scheduler->Cancel(cdbif_->cleanup_task_);
             cdbif_->cleanup_task_ = NULL;
@@ -613,7 +600,7 @@ private:
 CdbIf::CdbIf(DbErrorHandler errhandler,
         const std::vector<std::string> &cassandra_ips,
         const std::vector<int> &cassandra_ports, int ttl,
-        std::string name, bool only_sync) :
+        std::string name, bool only_sync, size_t writer_count) :
     socket_(new TSocketPool(cassandra_ips, cassandra_ports)),
     transport_(new TFramedTransport(socket_)),
     protocol_(new TBinaryProtocol(transport_)),
@@ -633,6 +620,7 @@ CdbIf::CdbIf(DbErrorHandler errhandler,
         boost::dynamic_pointer_cast<TSocket>(socket_);
     tsocket->setConnTimeout(connectionTimeout);
 
+    Db_CreateWriters(writer_count, cassandra_ips, cassandra_ports);
     db_init_done_ = false;
 }
 
@@ -644,6 +632,20 @@ CdbIf::CdbIf() :
     task_instance_(-1),
     prev_task_instance_(-1),
     task_instance_initialized_(false) {
+    Db_CreateWriters(1, std::vector<std::string>(), std::vector<int>());
+    db_init_done_ = false;
+}
+
+CdbIf::CdbIf(size_t writer_count) :
+    init_task_(NULL),
+    cleanup_task_(NULL),
+    cassandra_ttl_(-1),
+    only_sync_(false),
+    task_instance_(-1),
+    prev_task_instance_(-1),
+    task_instance_initialized_(false) {
+    Db_CreateWriters(writer_count, std::vector<std::string>(),
+        std::vector<int>());
     db_init_done_ = false;
 }
 
@@ -652,6 +654,12 @@ CdbIf::~CdbIf() {
     if (transport_) {
         transport_->close();
     }
+    for (CdbIfWriterList::iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        if (it->transport_) {
+            it->transport_->close();
+        }
+    }
     TaskScheduler *scheduler = TaskScheduler::GetInstance();
     if (init_task_) {
         scheduler->Cancel(init_task_);
@@ -671,16 +679,91 @@ void CdbIf::Db_SetInitDone(bool init_done) {
     db_init_done_ = init_done;
 }
 
+//
+// Writers other than the first one get their own connection, so that
+// batches from different writers are sent to Cassandra in parallel
+//
+void CdbIf::Db_CreateWriters(size_t writer_count,
+        const std::vector<std::string> &cassandra_ips,
+        const std::vector<int> &cassandra_ports) {
+    if (writer_count == 0) {
+        writer_count = 1;
+    }
+    for (size_t idx = 0; idx < writer_count; idx++) {
+        CdbIfWriter *writer = new CdbIfWriter(idx);
+        if (idx == 0 || cassandra_ips.empty()) {
+            writer->client_ = client_.get();
+        } else {
+            writer->socket_.reset(new TSocketPool(cassandra_ips,
+                cassandra_ports));
+            writer->transport_.reset(new TFramedTransport(writer->socket_));
+            writer->protocol_.reset(new TBinaryProtocol(writer->transport_));
+            writer->writer_client_.reset(
+                new CassandraClient(writer->protocol_));
+            writer->client_ = writer->writer_client_.get();
+            boost::shared_ptr<TSocket> tsocket =
+                boost::dynamic_pointer_cast<TSocket>(writer->socket_);
+            tsocket->setConnTimeout(connectionTimeout);
+        }
+        writers_.push_back(writer);
+    }
+}
+
+//
+// Called with cdbq_mutex_ held. All writer queues run in the DB task
+// instance. The init and cleanup tasks exclude them only for a valid
+// instance; with instance -1 they are not excluded, as for the single
+// queue before
+//
+void CdbIf::Db_CreateWriterQueues(const std::string &task_id) {
+    Db_ShutdownWriterQueues();
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    for (CdbIfWriterList::iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        CdbIfWriter *writer = &*it;
+        writer->queue_.reset(new CdbIfQueue(
+            scheduler->GetTaskId(task_id), task_instance_,
+            boost::bind(&CdbIf::Db_WriterAddColumn, this, writer, _1)));
+        writer->queue_->SetStartRunnerFunc(
+            boost::bind(&CdbIf::Db_IsInitDone, this));
+        writer->queue_->SetExitCallback(
+            boost::bind(&CdbIf::Db_WriterBatchAddColumn, this, writer, _1));
+        Db_SetQueueWaterMarkInternal(writer, cdbq_wm_info_);
+    }
+}
+
+// Called with cdbq_mutex_ held
+void CdbIf::Db_ShutdownWriterQueues() {
+    for (CdbIfWriterList::iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        if (it->queue_.get() != NULL) {
+            it->queue_->Shutdown();
+            it->queue_.reset();
+        }
+    }
+}
+
 bool CdbIf::Db_Init(const std::string& task_id, int task_instance) {
     std::ostringstream ostr;
     ostr << task_id << ":" << task_instance;
     std::string errstr(ostr.str());
-    CDBIF_BEGIN_TRY {
-        transport_->open();
-    } CDBIF_END_TRY_RETURN_FALSE(errstr)
+    if (transport_) {
+        CDBIF_BEGIN_TRY {
+            transport_->open();
+        } CDBIF_END_TRY_RETURN_FALSE(errstr)
+    }
     if (only_sync_) {
         return true;
     }
+    for (CdbIfWriterList::iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        if (!it->transport_) {
+            continue;
+        }
+        CDBIF_BEGIN_TRY {
+            it->transport_->open();
+        } CDBIF_END_TRY_RETURN_FALSE(errstr)
+    }
     tbb::mutex::scoped_lock lock(cdbq_mutex_);
     // Initialize task instance
     if (!task_instance_initialized_) {
@@ -711,12 +794,23 @@ void CdbIf::Db_UninitUnlocked(const std::string& task_id, int task_instance) {
     std::ostringstream ostr;
     ostr << task_id << ":" << task_instance;
     std::string errstr(ostr.str());
-    CDBIF_BEGIN_TRY {
-        transport_->close();
-    } CDBIF_END_TRY_LOG(errstr)
+    if (transport_) {
+        CDBIF_BEGIN_TRY {
+            transport_->close();
+        } CDBIF_END_TRY_LOG(errstr)
+    }
     if (only_sync_) {
         return;
     }
+    for (CdbIfWriterList::iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        if (!it->transport_) {
+            continue;
+        }
+        CDBIF_BEGIN_TRY {
+            it->transport_->close();
+        } CDBIF_END_TRY_LOG(errstr)
+    }
     if (!cleanup_task_) {
         cleanup_task_ = new CleanupTask(task_id, task_instance, this);
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
@@ -741,22 +835,45 @@ int CdbIf::Db_GetPort() const {
     return tsocket->getPort();
 }
 
-void CdbIf::Db_SetQueueWaterMarkInternal(CdbIfQueue *queue,
+void CdbIf::Db_SetQueueWaterMarkInternal(CdbIfWriter *writer,
     DbQueueWaterMarkInfo &wmi) {
-    CdbIfQueue::WaterMarkInfo wm(wmi.get<1>(), wmi.get<2>());
+    CdbIfQueue::WaterMarkInfo wm(wmi.get<1>(),
+        boost::bind(&CdbIf::Db_WriterQueueWaterMarkCb, this, writer,
+            wmi.get<0>(), wmi.get<2>(), _1));
     if (wmi.get<0>()) {
-        queue->SetHighWaterMark(wm);
+        writer->queue_->SetHighWaterMark(wm);
     } else {
-        queue->SetLowWaterMark(wm);
+        writer->queue_->SetLowWaterMark(wm);
     }
 }
 
-void CdbIf::Db_SetQueueWaterMarkInternal(CdbIfQueue *queue,
+void CdbIf::Db_SetQueueWaterMarkInternal(CdbIfWriter *writer,
     std::vector<DbQueueWaterMarkInfo> &vwmi) {
     for (std::vector<DbQueueWaterMarkInfo>::iterator it =
          vwmi.begin(); it != vwmi.end(); it++) {
-        Db_SetQueueWaterMarkInternal(queue, *it);
+        Db_SetQueueWaterMarkInternal(writer, *it);
+    }
+}
+
+//
+// Water marks apply to each writer queue. The user callback follows the
+// longest queue: a crossing on a queue that is shorter than another queue
+// was at its last crossing is not reported, as the longer queue already
+// determines the level
+//
+void CdbIf::Db_WriterQueueWaterMarkCb(CdbIfWriter *writer, bool high,
+    DbQueueWaterMarkCb cb, size_t queue_count) {
+    if (high) {
+        writer->high_water_mark_hits_++;
+    }
+    writer->water_mark_queue_count_ = queue_count;
+    for (CdbIfWriterList::const_iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        if (&*it != writer && it->water_mark_queue_count_ > queue_count) {
+            return;
+        }
     }
+    cb(queue_count);
 }
 
 void CdbIf::Db_SetQueueWaterMark(bool high, size_t queue_count,
@@ -764,18 +881,24 @@ void CdbIf::Db_SetQueueWaterMark(bool high, size_t queue_count,
     DbQueueWaterMarkInfo wm(high, queue_count, cb);
     cdbq_wm_info_.push_back(wm);
     tbb::mutex::scoped_lock lock(cdbq_mutex_);
-    if (cdbq_.get() == NULL) {
-        return;
+    for (CdbIfWriterList::iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        if (it->queue_.get() != NULL) {
+            Db_SetQueueWaterMarkInternal(&*it, wm);
+        }
     }
-    Db_SetQueueWaterMarkInternal(cdbq_.get(), wm);
 }
 
 void CdbIf::Db_ResetQueueWaterMarks() {
     cdbq_wm_info_.clear();
     tbb::mutex::scoped_lock lock(cdbq_mutex_);
-    if (cdbq_.get() != NULL) {
-        cdbq_->ResetHighWaterMark();
-        cdbq_->ResetLowWaterMark();
+    for (CdbIfWriterList::iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        it->water_mark_queue_count_ = 0;
+        if (it->queue_.get() != NULL) {
+            it->queue_->ResetHighWaterMark();
+            it->queue_->ResetLowWaterMark();
+        }
     }
 }
 
@@ -809,6 +932,15 @@ bool CdbIf::Db_SetTablespace(const std::string& tablespace) {
         client_->set_keyspace(tablespace);
         tablespace_ = tablespace;
     } CDBIF_END_TRY_RETURN_FALSE(tablespace)
+    for (CdbIfWriterList::iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        if (!it->writer_client_) {
+            continue;
+        }
+        CDBIF_BEGIN_TRY {
+            it->writer_client_->set_keyspace(tablespace);
+        } CDBIF_END_TRY_RETURN_FALSE(tablespace)
+    }
 
     KsDef retval;
     CDBIF_BEGIN_TRY {
@@ -1222,7 +1354,8 @@ bool CdbIf::Db_AddColumnfamily(const GenDb::NewCf& cf) {
     return true;
 }
 
-bool CdbIf::Db_AsyncAddColumn(CdbIfColList &cl) {
+bool CdbIf::Db_AsyncAddColumn(CassandraMutationMap *mutation_map,
+    CdbIfColList &cl) {
     GenDb::ColList *new_colp(cl.gendb_cl);
     if (new_colp == NULL) {
         stats_.IncrementErrors(
@@ -1236,9 +1369,9 @@ bool CdbIf::Db_AsyncAddColumn(CdbIfColList &cl) {
     std::string key_value;
     DbDataValueVecToString(key_value, new_colp->rowkey_.size() != 1,
                            new_colp->rowkey_);
-    CassandraMutationMap::iterator cmm_it = mutation_map_.find(key_value);
-    if (cmm_it == mutation_map_.end()) {
-        cmm_it = mutation_map_.insert(
+    CassandraMutationMap::iterator cmm_it = mutation_map->find(key_value);
+    if (cmm_it == mutation_map->end()) {
+        cmm_it = mutation_map->insert(
             std::pair<std::string, CFMutationMap>(key_value,
                 CFMutationMap())).first;
     } 
@@ -1330,25 +1463,82 @@ bool CdbIf::Db_AsyncAddColumn(CdbIfColList &cl) {
     return true;
 }
 
-void CdbIf::Db_BatchAddColumn(bool done) {
+bool CdbIf::Db_WriterAddColumn(CdbIfWriter *writer, CdbIfColList &cl) {
+    return Db_AsyncAddColumn(&writer->mutation_map_, cl);
+}
+
+bool CdbIf::Db_BatchMutate(CassandraClient *client,
+    CassandraMutationMap &mutation_map) {
     CDBIF_BEGIN_TRY {
-        client_->batch_mutate(mutation_map_,
+        client->batch_mutate(mutation_map,
             org::apache::cassandra::ConsistencyLevel::ONE);
-    } CDBIF_END_TRY_LOG_INTERNAL(integerToString(mutation_map_.size()),
-          false, false, true, CdbIfStats::CDBIF_STATS_ERR_WRITE_BATCH_COLUMN,
+    } CDBIF_END_TRY_RETURN_FALSE_INTERNAL(
+          integerToString(mutation_map.size()), false, false, true,
+          CdbIfStats::CDBIF_STATS_ERR_WRITE_BATCH_COLUMN,
           CdbIfStats::CDBIF_STATS_CF_OP_NONE)
-    mutation_map_.clear();
+    return true;
+}
+
+// Exit callback of the writer queue, sends the mutations batched in this run
+void CdbIf::Db_WriterBatchAddColumn(CdbIfWriter *writer, bool done) {
+    if (writer->mutation_map_.empty()) {
+        return;
+    }
+    uint64_t mutations = 0;
+    for (CassandraMutationMap::const_iterator it =
+         writer->mutation_map_.begin(); it != writer->mutation_map_.end();
+         ++it) {
+        for (CFMutationMap::const_iterator jt = it->second.begin();
+             jt != it->second.end(); ++jt) {
+            mutations += jt->second.size();
+        }
+    }
+    Db_BatchMutate(writer->client_, writer->mutation_map_);
+    writer->batches_++;
+    writer->mutations_ += mutations;
+    writer->mutation_map_.clear();
+}
+
+//
+// Writer for a row key. All columns of a row must go through the same
+// writer to be applied in order
+//
+struct DbDataValueHasher : public boost::static_visitor<> {
+    explicit DbDataValueHasher(size_t *seed) : seed_(seed) {
+    }
+    void operator()(const boost::blank &value) const {
+    }
+    template <typename T>
+    void operator()(const T &value) const {
+        boost::hash_combine(*seed_, value);
+    }
+    size_t *seed_;
+};
+
+size_t CdbIf::Db_GetWriterIndex(const GenDb::DbDataValueVec &rowkey) const {
+    if (writers_.size() == 1) {
+        return 0;
+    }
+    size_t seed = 0;
+    DbDataValueHasher hasher(&seed);
+    for (GenDb::DbDataValueVec::const_iterator it = rowkey.begin();
+         it != rowkey.end(); ++it) {
+        boost::apply_visitor(hasher, *it);
+    }
+    return seed % writers_.size();
 }
 
 bool CdbIf::Db_AddColumn(std::auto_ptr<GenDb::ColList> cl) {
+    size_t index = Db_GetWriterIndex(cl->rowkey_);
     tbb::mutex::scoped_lock lock(cdbq_mutex_);
-    if (!Db_IsInitDone() || !cdbq_.get()) {
+    CdbIfQueue *queue = writers_[index].queue_.get();
+    if (!Db_IsInitDone() || !queue) {
         UpdateCfWriteFailStats(cl->cfname_);
         return false;
     }
     CdbIfColList qentry;
     qentry.gendb_cl = cl.release();
-    cdbq_->Enqueue(qentry);
+    queue->Enqueue(qentry);
     return true;
 }
 
@@ -1356,12 +1546,13 @@ bool CdbIf::Db_AddColumnSync(std::auto_ptr<GenDb::ColList> cl) {
     CdbIfColList qentry;
     std::string cfname(cl->cfname_);
     qentry.gendb_cl = cl.release();
-    bool success = Db_AsyncAddColumn(qentry);
+    bool success = Db_AsyncAddColumn(&mutation_map_, qentry);
     if (!success) {
         UpdateCfWriteFailStats(cfname);
         return success;
     }
-    Db_BatchAddColumn(true);
+    Db_BatchMutate(client_.get(), mutation_map_);
+    mutation_map_.clear();
     return true;
 }
 
@@ -1623,12 +1814,34 @@ bool CdbIf::Db_GetRangeSlicesInternal(GenDb::ColList& col_list,
 }
 
 bool CdbIf::Db_GetQueueStats(uint64_t *queue_count, uint64_t *enqueues) const {
-    if (cdbq_.get() != NULL) {
-        *queue_count = cdbq_->Length();
-        *enqueues = cdbq_->NumEnqueues();
-    } else {
-        *queue_count = 0;
-        *enqueues = 0;
+    *queue_count = 0;
+    *enqueues = 0;
+    tbb::mutex::scoped_lock lock(cdbq_mutex_);
+    for (CdbIfWriterList::const_iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        if (it->queue_.get() != NULL) {
+            *queue_count += it->queue_->Length();
+            *enqueues += it->queue_->NumEnqueues();
+        }
+    }
+    return true;
+}
+
+bool CdbIf::Db_GetQueueStats(std::vector<DbQueueInfo> *vdbqi) const {
+    tbb::mutex::scoped_lock lock(cdbq_mutex_);
+    for (CdbIfWriterList::const_iterator it = writers_.begin();
+         it != writers_.end(); ++it) {
+        DbQueueInfo dbqi;
+        dbqi.set_writer(it->index_);
+        if (it->queue_.get() != NULL) {
+            dbqi.set_queue_count(it->queue_->Length());
+            dbqi.set_enqueues(it->queue_->NumEnqueues());
+        }
+        dbqi.set_batches(it->batches_);
+        dbqi.set_mutations(it->mutations_);
+        dbqi.set_high_water_mark_hits(it->high_water_mark_hits_);
+        dbqi.set_water_mark_queue_count(it->water_mark_queue_count_);
+        vdbqi->push_back(dbqi);
     }
     return true;
 }
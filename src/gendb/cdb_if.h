@@ -10,6 +10,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/ptr_container/ptr_unordered_map.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 
 #include <protocol/TBinaryProtocol.h>
 #include <transport/TSocketPool.h>
@@ -24,8 +25,10 @@ class CdbIf : public GenDb::GenDbIf {
 public:
     CdbIf(DbErrorHandler, const std::vector<std::string>&,
         const std::vector<int>&, int ttl, std::string name,
-        bool only_sync);
+        bool only_sync, size_t writer_count = 1);
     CdbIf();
+    // Writers without a Cassandra connection, used by tests
+    explicit CdbIf(size_t writer_count);
     ~CdbIf();
     // Init/Uninit
     virtual bool Db_Init(const std::string& task_id, int task_instance);
@@ -59,6 +62,7 @@ public:
     // Queue
     virtual bool Db_GetQueueStats(uint64_t *queue_count,
         uint64_t *enqueues) const;
+    virtual bool Db_GetQueueStats(std::vector<GenDb::DbQueueInfo> *vdbqi) const;
     virtual void Db_SetQueueWaterMark(bool high, size_t queue_count,
         DbQueueWaterMarkCb cb);
     virtual void Db_ResetQueueWaterMarks();
@@ -69,6 +73,18 @@ public:
     virtual std::string Db_GetHost() const;
     virtual int Db_GetPort() const;
 
+    size_t Db_GetWriterCount() const { return writers_.size(); }
+
+protected:
+    typedef std::vector<org::apache::cassandra::Mutation> MutationList;
+    typedef std::map<std::string, MutationList> CFMutationMap;
+    typedef std::map<std::string, CFMutationMap> CassandraMutationMap;
+
+    // Send a batch of mutations to Cassandra
+    virtual bool Db_BatchMutate(
+        org::apache::cassandra::CassandraClient *client,
+        CassandraMutationMap &mutation_map);
+
 private:
     friend class CdbIfTest;
     class InitTask;
@@ -159,9 +175,12 @@ private:
     bool Db_GetColumnfamily(CdbIfCfInfo **info, const std::string& cfname);
     bool Db_FindColumnfamily(const std::string& cfname);
     // Column
-    bool Db_AsyncAddColumn(CdbIfColList &cl);
-    bool Db_AsyncAddColumnLocked(CdbIfColList &cl);
-    void Db_BatchAddColumn(bool done);
+    struct CdbIfWriter;
+    bool Db_AsyncAddColumn(CassandraMutationMap *mutation_map,
+        CdbIfColList &cl);
+    bool Db_WriterAddColumn(CdbIfWriter *writer, CdbIfColList &cl);
+    void Db_WriterBatchAddColumn(CdbIfWriter *writer, bool done);
+    size_t Db_GetWriterIndex(const GenDb::DbDataValueVec &rowkey) const;
     // Read
     static const int kMaxQueryRows = 5000;
     // API to get range of column data for a range of rows 
@@ -231,12 +250,52 @@ private:
     void UpdateCfReadFailStats(const std::string &cf_name);
 
     typedef WorkQueue<CdbIfColList> CdbIfQueue;
+
+    // A writer drains one of the write queues over its own connection to
+    // Cassandra, batching the mutations per row and column family. Column
+    // lists are assigned to writers by row key, so all writes to a row are
+    // applied in order by the same writer. The first writer shares the
+    // connection used for schema operations and reads
+    struct CdbIfWriter {
+        explicit CdbIfWriter(size_t index) :
+            index_(index),
+            client_(NULL) {
+            batches_ = 0;
+            mutations_ = 0;
+            high_water_mark_hits_ = 0;
+            water_mark_queue_count_ = 0;
+        }
+        size_t index_;
+        boost::shared_ptr<apache::thrift::transport::TTransport> socket_;
+        boost::shared_ptr<apache::thrift::transport::TTransport> transport_;
+        boost::shared_ptr<apache::thrift::protocol::TProtocol> protocol_;
+        boost::scoped_ptr<org::apache::cassandra::CassandraClient>
+            writer_client_;
+        org::apache::cassandra::CassandraClient *client_;
+        boost::scoped_ptr<CdbIfQueue> queue_;
+        CassandraMutationMap mutation_map_;
+        tbb::atomic<uint64_t> batches_;
+        tbb::atomic<uint64_t> mutations_;
+        tbb::atomic<uint64_t> high_water_mark_hits_;
+        // Queue count at the last water mark crossing
+        tbb::atomic<size_t> water_mark_queue_count_;
+    };
+    typedef boost::ptr_vector<CdbIfWriter> CdbIfWriterList;
+
+    void Db_CreateWriters(size_t writer_count,
+        const std::vector<std::string> &cassandra_ips,
+        const std::vector<int> &cassandra_ports);
+    void Db_CreateWriterQueues(const std::string &task_id);
+    void Db_ShutdownWriterQueues();
+
     typedef boost::tuple<bool, size_t, DbQueueWaterMarkCb>
         DbQueueWaterMarkInfo;
-    void Db_SetQueueWaterMarkInternal(CdbIfQueue *queue,
+    void Db_SetQueueWaterMarkInternal(CdbIfWriter *writer,
         std::vector<DbQueueWaterMarkInfo> &vwmi);
-    void Db_SetQueueWaterMarkInternal(CdbIfQueue *queue,
+    void Db_SetQueueWaterMarkInternal(CdbIfWriter *writer,
         DbQueueWaterMarkInfo &wmi);
+    void Db_WriterQueueWaterMarkCb(CdbIfWriter *writer, bool high,
+        DbQueueWaterMarkCb cb, size_t queue_count);
 
     boost::shared_ptr<apache::thrift::transport::TTransport> socket_;
     boost::shared_ptr<apache::thrift::transport::TTransport> transport_;
@@ -245,7 +304,7 @@ private:
     DbErrorHandler errhandler_;
     tbb::atomic<bool> db_init_done_;
     std::string tablespace_;
-    boost::scoped_ptr<CdbIfQueue> cdbq_;
+    CdbIfWriterList writers_;
     std::string name_;
     mutable tbb::mutex cdbq_mutex_;
     InitTask *init_task_;
@@ -255,9 +314,7 @@ private:
     int task_instance_;
     int prev_task_instance_;
     bool task_instance_initialized_;
-    typedef std::vector<org::apache::cassandra::Mutation> MutationList;
-    typedef std::map<std::string, MutationList> CFMutationMap;
-    typedef std::map<std::string, CFMutationMap> CassandraMutationMap;
+    // Mutations for Db_AddColumnSync
     CassandraMutationMap mutation_map_;
     mutable tbb::mutex smutex_;
     CdbIfStats stats_;
@@ -10,8 +10,9 @@ using namespace GenDb;
 GenDbIf *GenDbIf::GenDbIfImpl(GenDbIf::DbErrorHandler hdlr,
         const std::vector<std::string> &cassandra_ips,
         const std::vector<int> &cassandra_ports,
-        int analytics_ttl, std::string name, bool only_sync) {
+        int analytics_ttl, std::string name, bool only_sync,
+        size_t writer_count) {
     return (new CdbIf(hdlr, cassandra_ips, cassandra_ports, analytics_ttl,
-        name, only_sync));
+        name, only_sync, writer_count));
 }
 
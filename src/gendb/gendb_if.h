@@ -163,6 +163,8 @@ public:
     // Queue
     virtual bool Db_GetQueueStats(uint64_t *queue_count,
         uint64_t *enqueues) const = 0;
+    // Per writer queue stats
+    virtual bool Db_GetQueueStats(std::vector<DbQueueInfo> *vdbqi) const = 0;
     virtual void Db_SetQueueWaterMark(bool high, size_t queue_count,
         DbQueueWaterMarkCb cb) = 0;
     virtual void Db_ResetQueueWaterMarks() = 0;
@@ -176,7 +178,8 @@ public:
     static GenDbIf *GenDbIfImpl(DbErrorHandler hdlr, 
         const std::vector<std::string> &cassandra_ips,
         const std::vector<int> &cassandra_ports,
-        int analytics_ttl, std::string name, bool only_sync);
+        int analytics_ttl, std::string name, bool only_sync,
+        size_t writer_count = 1);
 };
 
 } // namespace GenDb
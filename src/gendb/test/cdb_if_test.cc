@@ -9,6 +9,10 @@
 #include "testing/gunit.h"
 
 #include "base/logging.h"
+#include "base/task.h"
+#include "base/time_util.h"
+#include "base/string_util.h"
+#include "base/test/task_test_util.h"
 #include "../cdb_if.h"
 
 using namespace GenDb;
@@ -330,9 +334,157 @@ TEST_F(CdbIfTest, Stats) {
     EXPECT_EQ(edbe_diffs, adbe_diffs); 
 }
 
+//
+// CdbIf that records the batches instead of sending them to Cassandra.
+// Each batch is delayed to model the round trip to the server
+//
+class CdbIfLoadMock : public CdbIf {
+public:
+    CdbIfLoadMock(size_t writer_count, int batch_delay_usecs) :
+        CdbIf(writer_count),
+        batch_delay_usecs_(batch_delay_usecs) {
+        mutations_ = 0;
+        order_errors_ = 0;
+    }
+
+    uint64_t mutations() const { return mutations_; }
+    uint64_t order_errors() const { return order_errors_; }
+
+protected:
+    // Columns of a row carry consecutive sequence numbers as names, check
+    // that they arrive in order
+    virtual bool Db_BatchMutate(
+        org::apache::cassandra::CassandraClient *client,
+        CassandraMutationMap &mutation_map) {
+        uint64_t count = 0;
+        {
+            tbb::mutex::scoped_lock lock(mutex_);
+            for (CassandraMutationMap::const_iterator it =
+                 mutation_map.begin(); it != mutation_map.end(); ++it) {
+                uint32_t &last_seq(last_seq_[it->first]);
+                for (CFMutationMap::const_iterator jt = it->second.begin();
+                     jt != it->second.end(); ++jt) {
+                    for (MutationList::const_iterator mt = jt->second.begin();
+                         mt != jt->second.end(); ++mt) {
+                        uint32_t seq = 0;
+                        stringToInteger(
+                            mt->column_or_supercolumn.column.name, seq);
+                        if (seq != last_seq + 1) {
+                            order_errors_++;
+                        }
+                        last_seq = seq;
+                        count++;
+                    }
+                }
+            }
+        }
+        usleep(batch_delay_usecs_);
+        mutations_ += count;
+        return true;
+    }
+
+private:
+    int batch_delay_usecs_;
+    tbb::mutex mutex_;
+    std::map<std::string, uint32_t> last_seq_;
+    tbb::atomic<uint64_t> mutations_;
+    tbb::atomic<uint64_t> order_errors_;
+};
+
+class CdbIfLoadTest : public ::testing::Test {
+protected:
+    static const int kBatchDelayUsecs = 2000;
+
+    CdbIfLoadTest() :
+        row_count_(64),
+        column_count_(200) {
+        char *str = getenv("CDBIF_TEST_LOAD_ROW_COUNT");
+        if (str) row_count_ = strtoul(str, NULL, 0);
+        str = getenv("CDBIF_TEST_LOAD_COLUMN_COUNT");
+        if (str) column_count_ = strtoul(str, NULL, 0);
+    }
+
+    std::auto_ptr<GenDb::ColList> CreateColList(int row, uint32_t seq) {
+        std::auto_ptr<GenDb::ColList> cl(new GenDb::ColList);
+        cl->cfname_ = "LoadTestTable";
+        cl->rowkey_.push_back(static_cast<uint32_t>(row));
+        cl->rowkey_.push_back(std::string("LoadTestKey"));
+        cl->columns_.push_back(new GenDb::NewCol(integerToString(seq),
+            static_cast<uint64_t>(row), 0));
+        return cl;
+    }
+
+    // Write column_count_ columns to each of row_count_ rows, interleaving
+    // the rows, and return the time taken in usecs
+    uint64_t RunLoad(size_t writer_count) {
+        CdbIfLoadMock dbif(writer_count, kBatchDelayUsecs);
+        EXPECT_EQ(writer_count, dbif.Db_GetWriterCount());
+        EXPECT_TRUE(dbif.Db_Init("cdbif::LoadTest", -1));
+        dbif.Db_SetInitDone(true);
+        // Writer queues are created by the init task
+        task_util::WaitForIdle();
+
+        uint64_t expected = row_count_ * column_count_;
+        uint64_t start = ClockMonotonicUsec();
+        for (int seq = 1; seq <= column_count_; seq++) {
+            for (int row = 0; row < row_count_; row++) {
+                EXPECT_TRUE(dbif.Db_AddColumn(CreateColList(row, seq)));
+            }
+        }
+        for (int i = 0; i < 60000 && dbif.mutations() < expected; i++) {
+            usleep(1000);
+        }
+        uint64_t usecs = ClockMonotonicUsec() - start + 1;
+        task_util::WaitForIdle();
+        EXPECT_EQ(expected, dbif.mutations());
+        EXPECT_EQ(0, dbif.order_errors());
+
+        std::vector<GenDb::DbQueueInfo> vdbqi;
+        EXPECT_TRUE(dbif.Db_GetQueueStats(&vdbqi));
+        EXPECT_EQ(writer_count, vdbqi.size());
+        uint64_t enqueues = 0, mutations = 0;
+        for (size_t i = 0; i < vdbqi.size(); i++) {
+            EXPECT_EQ(i, vdbqi[i].get_writer());
+            EXPECT_EQ(0, vdbqi[i].get_queue_count());
+            // Rows are spread over all the writers
+            EXPECT_NE(0, vdbqi[i].get_enqueues());
+            enqueues += vdbqi[i].get_enqueues();
+            mutations += vdbqi[i].get_mutations();
+        }
+        EXPECT_EQ(expected, enqueues);
+        EXPECT_EQ(expected, mutations);
+
+        dbif.Db_Uninit("cdbif::LoadTest", -1);
+        task_util::WaitForIdle();
+        return usecs;
+    }
+
+    int row_count_;
+    int column_count_;
+};
+
+TEST_F(CdbIfLoadTest, SingleWriter) {
+    uint64_t usecs = RunLoad(1);
+    LOG(DEBUG, "1 writer: " << row_count_ * column_count_ * 1000000ULL /
+        usecs << " columns/sec");
+}
+
+//
+// Writers run in parallel with task instance -1, so with a fixed round
+// trip per batch the throughput grows with the number of writers
+//
+TEST_F(CdbIfLoadTest, MultipleWriters) {
+    uint64_t usecs_1 = RunLoad(1);
+    uint64_t usecs_4 = RunLoad(4);
+    LOG(DEBUG, "1 writer: " << row_count_ * column_count_ * 1000000ULL /
+        usecs_1 << " columns/sec, 4 writers: " <<
+        row_count_ * column_count_ * 1000000ULL / usecs_4 << " columns/sec");
+}
+
 int main(int argc, char **argv) {
     LoggingInit();
     ::testing::InitGoogleTest(&argc, argv);
-    return RUN_ALL_TESTS();
+    int result = RUN_ALL_TESTS();
+    TaskScheduler::GetInstance()->Terminate();
+    return result;
 }
-
@@ -3,6 +3,7 @@
  */
 
 #include "ifmap_channel.h"
+#include <algorithm>
 #include <sstream>
 #include <string>
 
@@ -45,6 +46,7 @@
 
 const int IFMapChannel::kSocketCloseTimeout = 2 * 1000;
 const uint64_t IFMapChannel::kRetryConnectionMax = 2;
+const size_t IFMapChannel::kPollBodyChunkSize = 1024 * 1024;
 
 using namespace boost::assign;
 using namespace std;
@@ -126,7 +128,10 @@ IFMapChannel::IFMapChannel(IFMapManager *manager, const std::string& user,
       ssrc_socket_(new SslStream((*manager->io_service()), ctx_)),
       arc_socket_(new SslStream((*manager->io_service()), ctx_)),
       username_(user), password_(passwd), state_machine_(NULL),
-      response_state_(NONE), sequence_number_(0), recv_msg_cnt_(0),
+      response_state_(NONE), poll_body_streamed_(false),
+      poll_body_failed_(false), poll_body_remaining_(0),
+      poll_body_type_(POLL_BODY_UNKNOWN),
+      sequence_number_(0), recv_msg_cnt_(0),
       sent_msg_cnt_(0), reconnect_attempts_(0), connection_status_(NOCONN),
       connection_status_change_at_(UTCTimestampUsec()) {
 
@@ -234,6 +239,11 @@ void IFMapChannel::ReconnectPreparationInMainThr() {
 
 void IFMapChannel::ReconnectPreparation() {
     CHECK_CONCURRENCY("ifmap::StateMachine");
+    // Drop the part of a streamed poll response that the parser has buffered.
+    if (poll_body_streamed_ && poll_body_remaining_ && !poll_body_failed_) {
+        (manager_->pollchunkresetcb())();
+    }
+    poll_body_streamed_ = false;
     io_strand_.post(
         boost::bind(&IFMapChannel::ReconnectPreparationInMainThr, this));
 }
@@ -576,6 +586,29 @@ void IFMapChannel::PollResponseWait() {
 int IFMapChannel::ReadPollResponse() {
 
     CHECK_CONCURRENCY("ifmap::StateMachine");
+    // The body has already been given to the parser, chunk by chunk.
+    if (poll_body_streamed_) {
+        poll_body_streamed_ = false;
+        response_state_ = NONE;
+        if (poll_body_type_ == POLL_BODY_ERROR) {
+            IFMAP_PEER_WARN(IFMapServerConnection,
+                "Error received instead of PollResult. Quitting.", "");
+            return -1;
+        } else if (poll_body_failed_) {
+            if (poll_body_type_ == POLL_BODY_UNKNOWN) {
+                IFMAP_PEER_WARN(IFMapServerConnection,
+                    "Unexpected message received instead of PollResult. "
+                    "Quitting.", "");
+            } else {
+                IFMAP_PEER_WARN(IFMapServerConnection,
+                    "Incorrectly formatted Poll response. Quitting.", "");
+            }
+            return -1;
+        }
+        increment_recv_msg_cnt();
+        return 0;
+    }
+
     // Append the new bytes read, if any, to the stringstream
     reply_ss_ << &reply_;
     std::string reply_str = reply_ss_.str();
@@ -685,6 +718,23 @@ void IFMapChannel::ProcResponse(const boost::system::error_code& error,
                      header_length, "Content length is", content_len,
                      "Total bytes read are", reply_str.length());
 
+    // Hand the body of a poll response to the parser as it is read, rather
+    // than after all of it has been read.
+    if (response_state_ == POLLRESPONSE && manager_->pollchunkcb() &&
+        (header_length + content_len) >= reply_str.length()) {
+        poll_body_streamed_ = true;
+        poll_body_failed_ = false;
+        poll_body_remaining_ = content_len;
+        poll_body_type_ = POLL_BODY_UNKNOWN;
+        poll_body_head_.clear();
+        reply_ss_.str(std::string());
+        reply_ss_.clear();
+        ProcPollBody(reply_str.data() + header_length,
+                     reply_str.length() - header_length);
+        ContinuePollBody();
+        return;
+    }
+
     // If both header and body are completely read, goto the next state
     if ((header_length + content_len) == reply_str.length()) {
         callback(error, header_length);
@@ -698,6 +748,87 @@ void IFMapChannel::ProcResponse(const boost::system::error_code& error,
     }
 }
 
+// Will run in the context of the main task
+void IFMapChannel::PollBodyReadInMainThr(size_t bytes_to_read) {
+    CHECK_CONCURRENCY_MAIN_THR();
+    boost::asio::async_read(*arc_socket_.get(), reply_,
+        boost::asio::transfer_exactly(bytes_to_read),
+        boost::bind(&IFMapStateMachine::ProcPollRespBodyRead, state_machine_,
+                    boost::asio::placeholders::error,
+                    boost::asio::placeholders::bytes_transferred));
+}
+
+// Find out from the start of a streamed body whether the response is a poll
+// result or an error, as ReadPollResponse does for a complete response. Only
+// the tail that may hold the start of a split element name is kept between
+// chunks.
+IFMapChannel::PollBodyType IFMapChannel::ScanPollBody(const char *data,
+                                                      size_t length) {
+    if (poll_body_type_ != POLL_BODY_UNKNOWN) {
+        return poll_body_type_;
+    }
+    poll_body_head_.append(data, length);
+    size_t error = std::min(poll_body_head_.find("errorResult"),
+                            poll_body_head_.find("endSessionResult"));
+    size_t poll = poll_body_head_.find("pollResult");
+    if (error < poll) {
+        poll_body_type_ = POLL_BODY_ERROR;
+    } else if (poll != string::npos) {
+        poll_body_type_ = POLL_BODY_RESULT;
+    }
+
+    static const size_t kKeep = sizeof("endSessionResult") - 2;
+    if (poll_body_type_ != POLL_BODY_UNKNOWN) {
+        poll_body_head_.clear();
+    } else if (poll_body_head_.size() > kKeep) {
+        poll_body_head_.erase(0, poll_body_head_.size() - kKeep);
+    }
+    return poll_body_type_;
+}
+
+void IFMapChannel::ProcPollBody(const char *data, size_t length) {
+    CHECK_CONCURRENCY("ifmap::StateMachine");
+    poll_body_remaining_ -= length;
+    IFMAP_PEER_LOG_POLL_RESP(IFMapServerConnection,
+                   GetSizeAsString(length, " bytes in chunk. ") +
+                   GetSizeAsString(poll_body_remaining_, " bytes remaining. ") +
+                   "PollResponse chunk is: \n", std::string(data, length));
+
+    // An error result is not given to the parser, drop what it has buffered.
+    if (ScanPollBody(data, length) == POLL_BODY_ERROR) {
+        (manager_->pollchunkresetcb())();
+        poll_body_failed_ = true;
+        return;
+    }
+    bool last = (poll_body_remaining_ == 0);
+    if (!(manager_->pollchunkcb())(data, length, last, sequence_number_)) {
+        poll_body_failed_ = true;
+    }
+}
+
+// Read the next chunk of the body, unless the response is complete or cannot
+// be parsed, in which case ReadPollResponse decides the next state.
+void IFMapChannel::ContinuePollBody() {
+    CHECK_CONCURRENCY("ifmap::StateMachine");
+    if (poll_body_remaining_ == 0 || poll_body_failed_) {
+        state_machine_->ProcPollResponseRead(error_code(), 0);
+        return;
+    }
+    size_t bytes_to_read = std::min(poll_body_remaining_, kPollBodyChunkSize);
+    io_strand_.post(boost::bind(&IFMapChannel::PollBodyReadInMainThr, this,
+                                bytes_to_read));
+}
+
+// Called when the next chunk of a streamed poll response body has been read.
+void IFMapChannel::ReadPollBody() {
+    CHECK_CONCURRENCY("ifmap::StateMachine");
+    size_t length = reply_.size();
+    ProcPollBody(boost::asio::buffer_cast<const char *>(reply_.data()),
+                 length);
+    reply_.consume(length);
+    ContinuePollBody();
+}
+
 IFMapChannel::SslStream *IFMapChannel::GetSocket(ResponseState response_state) {
     switch (response_state) {
     case NEWSESSION:
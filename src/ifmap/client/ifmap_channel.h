@@ -85,6 +85,8 @@ public:
 
     virtual int ReadPollResponse();
 
+    void ReadPollBody();
+
     void ProcResponse(const boost::system::error_code& error,
                       size_t header_length);
     uint64_t get_sequence_number() { return sequence_number_; }
@@ -169,10 +171,14 @@ public:
                                      const std::string &port);
 
 private:
+    friend class IFMapChannelTest;
+
     // 45 seconds i.e. 30 + (3*5)s
     static const int kSessionKeepaliveIdleTime = 30; // in seconds
     static const int kSessionKeepaliveInterval = 3; // in seconds
     static const int kSessionKeepaliveProbes = 5; // count
+    // Size of the reads of a poll response body that is streamed to the parser
+    static const size_t kPollBodyChunkSize;
 
     enum ResponseState {
         NONE = 0,
@@ -180,6 +186,11 @@ private:
         SUBSCRIBE = 2,
         POLLRESPONSE = 3
     };
+    enum PollBodyType {
+        POLL_BODY_UNKNOWN = 0,
+        POLL_BODY_RESULT = 1,
+        POLL_BODY_ERROR = 2
+    };
     enum ConnectionStatus {
         NOCONN = 0,
         DOWN = 1,
@@ -209,6 +220,10 @@ private:
     void SendPollRequestInMainThr(std::string poll_msg);
     void PollResponseWaitInMainThr();
     void ProcResponseInMainThr(size_t bytes_to_read);
+    virtual void PollBodyReadInMainThr(size_t bytes_to_read);
+    PollBodyType ScanPollBody(const char *data, size_t length);
+    void ProcPollBody(const char *data, size_t length);
+    void ContinuePollBody();
 
     IFMapManager *manager_;
     boost::asio::ip::tcp::resolver resolver_;
@@ -227,6 +242,11 @@ private:
     boost::asio::streambuf reply_;
     std::ostringstream reply_ss_;
     ResponseState response_state_;
+    bool poll_body_streamed_;
+    bool poll_body_failed_;
+    size_t poll_body_remaining_;
+    PollBodyType poll_body_type_;
+    std::string poll_body_head_;  // start of the body, until its type is known
     uint64_t sequence_number_;
     uint64_t recv_msg_cnt_;
     uint64_t sent_msg_cnt_;
@@ -23,6 +23,13 @@ class IFMapManager {
 public:
     typedef boost::function<bool(const char *data, size_t length,
                                  uint64_t sequence_number)> PollReadCb;
+    // Receives the body of a poll response in chunks, as it is read from the
+    // socket. last is set on the final chunk of the response.
+    typedef boost::function<bool(const char *data, size_t length, bool last,
+                                 uint64_t sequence_number)> PollChunkCb;
+    // Drops the chunks given to PollChunkCb for a response whose last chunk
+    // will not be received, e.g. because the connection went down.
+    typedef boost::function<void()> PollChunkResetCb;
 
     IFMapManager();
     IFMapManager(IFMapServer *ifmap_server, const std::string& url,
@@ -43,6 +50,13 @@ public:
     IFMapChannel *channel() { return channel_.get(); }
     IFMapStateMachine *state_machine() { return state_machine_.get(); }
     PollReadCb pollreadcb() { return pollreadcb_; }
+    // When set, poll responses are given to pollchunkcb instead of pollreadcb.
+    void set_pollchunkcb(PollChunkCb chunkcb, PollChunkResetCb resetcb) {
+        pollchunkcb_ = chunkcb;
+        pollchunkresetcb_ = resetcb;
+    }
+    PollChunkCb pollchunkcb() { return pollchunkcb_; }
+    PollChunkResetCb pollchunkresetcb() { return pollchunkresetcb_; }
     void SetChannel(IFMapChannel *channel);
     IFMapServer *ifmap_server() { return ifmap_server_; }
     std::string get_host_port() {
@@ -61,6 +75,8 @@ public:
 private:
 
     PollReadCb pollreadcb_;
+    PollChunkCb pollchunkcb_;
+    PollChunkResetCb pollchunkresetcb_;
     boost::asio::io_service *io_service_;
     boost::scoped_ptr<IFMapChannel> channel_;
     boost::scoped_ptr<IFMapStateMachine> state_machine_;
@@ -73,6 +73,13 @@ struct EvReadFailed : sc::event<EvReadFailed> {
     }
 };
 
+struct EvPollBodyRead : sc::event<EvPollBodyRead> {
+    EvPollBodyRead() { }
+    static const char * Name() {
+        return "EvPollBodyRead";
+    }
+};
+
 struct EvConnectionCleaned : sc::event<EvConnectionCleaned> {
     EvConnectionCleaned() { }
     static const char * Name() {
@@ -624,12 +631,14 @@ struct SendPoll : sc::state<SendPoll, IFMapStateMachine> {
 // Wait for a response from the server to the poll request. On
 // successfully receiving a response, check if we received a kosher response.
 // If not, start over. If we did, give the received poll response to the
-// parser.  Also, if the read fails, start over.
+// parser.  Also, if the read fails, start over. If the manager has a chunk
+// callback, the body is instead given to the parser while it is being read.
 struct PollResponseWait :
     sc::state<PollResponseWait, IFMapStateMachine> {
     typedef mpl::list<
         sc::custom_reaction<EvReadSuccess>,
         sc::custom_reaction<EvReadFailed>,
+        sc::custom_reaction<EvPollBodyRead>,
         sc::custom_reaction<EvProcResponseSuccess>,
         sc::custom_reaction<EvProcResponseFailed>,
         sc::custom_reaction<EvConnectionResetReq>
@@ -653,6 +662,12 @@ struct PollResponseWait :
     sc::result react(const EvReadFailed &event) {
         return transit<SsrcStart>();
     }
+    sc::result react(const EvPollBodyRead &event) {
+        // the next chunk of a streamed response body has been read
+        IFMapStateMachine *sm = &context<IFMapStateMachine>();
+        sm->channel()->ReadPollBody();
+        return discard_event();
+    }
     sc::result react(const EvProcResponseSuccess &event) {
         IFMapStateMachine *sm = &context<IFMapStateMachine>();
         sm->channel()->ProcResponse(event.error_, event.bytes_);
@@ -893,6 +908,20 @@ void IFMapStateMachine::ProcPollResponseRead(
     }
 }
 
+// current state: PollResponseWait
+void IFMapStateMachine::ProcPollRespBodyRead(
+        const boost::system::error_code& error, size_t bytes_transferred) {
+    CHECK_CONCURRENCY_MAIN_THR();
+    if (error) {
+        if (ProcErrorAndIgnore(error)) {
+            return;
+        }
+        EnqueueEvent(ifsm::EvReadFailed());
+    } else {
+        EnqueueEvent(ifsm::EvPollBodyRead());
+    }
+}
+
 // current state:
 // NewSessionResponseWait, SubscribeResponseWait, PollResponseWait
 void IFMapStateMachine::ProcResponse(
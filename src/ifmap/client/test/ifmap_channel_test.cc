@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "ifmap/client/ifmap_channel.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/task_annotations.h"
+#include "base/timer_impl.h"
+#include "base/test/task_test_util.h"
+#include "db/db.h"
+#include "db/db_graph.h"
+#include "io/event_manager.h"
+#include "ifmap/client/ifmap_manager.h"
+#include "ifmap/client/ifmap_state_machine.h"
+#include "ifmap/ifmap_server.h"
+
+#include <boost/asio/placeholders.hpp>
+#include <boost/bind.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "testing/gunit.h"
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::InvokeWithoutArgs;
+using ::testing::Return;
+
+using namespace std;
+
+// Channel that does not use the network. The responses are put in the read
+// buffer of the channel by the test, which then drives the real response
+// processing through the state machine.
+class IFMapChannelStreamMock : public IFMapChannel {
+public:
+    explicit IFMapChannelStreamMock(IFMapManager *manager) :
+        IFMapChannel(manager, "user", "passwd", "") {
+    }
+
+    MOCK_METHOD0(DoResolve, void());
+    MOCK_METHOD1(DoConnect, void(bool));
+    MOCK_METHOD1(DoSslHandshake, void(bool));
+    MOCK_METHOD0(SendNewSessionRequest, void());
+    MOCK_METHOD0(NewSessionResponseWait, void());
+    MOCK_METHOD0(ExtractPubSessionId, int());
+    MOCK_METHOD0(SendSubscribe, void());
+    MOCK_METHOD0(SubscribeResponseWait, void());
+    MOCK_METHOD0(ReadSubscribeResponseStr, int());
+    MOCK_METHOD0(SendPollRequest, void());
+    MOCK_METHOD0(PollResponseWait, void());
+    MOCK_METHOD1(PollBodyReadInMainThr, void(size_t));
+};
+
+class IFMapChannelTest : public ::testing::Test {
+protected:
+    static const size_t kReturnBytes = 100;
+
+    IFMapChannelTest() :
+            ifmap_server_(&db_, &graph_, evm_.io_service()),
+            ifmap_manager_(&ifmap_server_, "https://10.1.2.3:8443", "user",
+                           "passwd", "", NULL, evm_.io_service()),
+            channel_(new IFMapChannelStreamMock(&ifmap_manager_)),
+            first_read_(0), offset_(0), fail_offset_(0), read_fail_count_(0),
+            resets_(0), last_chunks_(0) {
+        ifmap_manager_.SetChannel(channel_);
+        ifmap_manager_.set_pollchunkcb(
+            boost::bind(&IFMapChannelTest::ReceiveChunk, this, _1, _2, _3, _4),
+            boost::bind(&IFMapChannelTest::ResetChunks, this));
+    }
+
+    // Sets up the channel to connect and send the first poll request. The
+    // response to it is body_, of which first_read_ bytes arrive together
+    // with the header.
+    void ExpectPoll(int poll_count) {
+        boost::system::error_code ec;
+        EXPECT_CALL(*channel_, DoResolve())
+            .Times(1)
+            .WillOnce(InvokeWithoutArgs(boost::bind(
+                &IFMapStateMachine::ProcResolveResponse, state_machine(), ec)));
+        EXPECT_CALL(*channel_, DoConnect(_))
+            .Times(2)
+            .WillRepeatedly(InvokeWithoutArgs(boost::bind(
+                &IFMapStateMachine::ProcConnectResponse, state_machine(), ec)));
+        EXPECT_CALL(*channel_, DoSslHandshake(_))
+            .Times(2)
+            .WillRepeatedly(InvokeWithoutArgs(boost::bind(
+                &IFMapStateMachine::ProcHandshakeResponse, state_machine(),
+                ec)));
+        EXPECT_CALL(*channel_, SendNewSessionRequest())
+            .WillOnce(InvokeWithoutArgs(boost::bind(
+                &IFMapStateMachine::ProcNewSessionWrite, state_machine(), ec,
+                kReturnBytes)));
+        EXPECT_CALL(*channel_, NewSessionResponseWait())
+            .WillOnce(InvokeWithoutArgs(boost::bind(
+                &IFMapStateMachine::ProcNewSessionResponse, state_machine(),
+                ec, kReturnBytes)));
+        EXPECT_CALL(*channel_, ExtractPubSessionId()).WillOnce(Return(0));
+        EXPECT_CALL(*channel_, SendSubscribe())
+            .WillOnce(InvokeWithoutArgs(boost::bind(
+                &IFMapStateMachine::ProcSubscribeWrite, state_machine(), ec,
+                kReturnBytes)));
+        EXPECT_CALL(*channel_, SubscribeResponseWait())
+            .WillOnce(InvokeWithoutArgs(boost::bind(
+                &IFMapStateMachine::ProcSubscribeResponse, state_machine(),
+                ec, kReturnBytes)));
+        EXPECT_CALL(*channel_, ReadSubscribeResponseStr())
+            .WillOnce(Return(0));
+        // The second poll request, if any, ends the test.
+        EXPECT_CALL(*channel_, SendPollRequest())
+            .Times(poll_count)
+            .WillOnce(InvokeWithoutArgs(boost::bind(
+                &IFMapStateMachine::ProcPollWrite, state_machine(), ec,
+                kReturnBytes)))
+            .WillRepeatedly(Return());
+        EXPECT_CALL(*channel_, PollResponseWait())
+            .WillOnce(InvokeWithoutArgs(boost::bind(
+                &IFMapChannelTest::PollResponse, this)));
+    }
+
+    void Run() {
+        ifmap_manager_.Start("10.1.2.3", "8443");
+        EventWaitMs(100);
+    }
+
+    static void on_timeout(const boost::system::error_code &error,
+                           bool *trigger) {
+        if (error) {
+            return;
+        }
+        *trigger = true;
+    }
+
+    void EventWaitMs(int ms_timeout) {
+        bool is_expired = false;
+        boost::system::error_code ec;
+        TimerImpl timer(*(evm_.io_service()));
+        timer.expires_from_now(ms_timeout, ec);
+        timer.async_wait(boost::bind(&IFMapChannelTest::on_timeout,
+                         boost::asio::placeholders::error, &is_expired));
+        while (!is_expired) {
+            evm_.RunOnce();
+            task_util::WaitForIdle();
+        }
+    }
+
+    // Puts the header and the start of the body in the read buffer, as if
+    // they had been read by PollResponseWait.
+    void PollResponse() {
+        channel_->response_state_ = IFMapChannel::POLLRESPONSE;
+        ostringstream header;
+        header << "HTTP/1.1 200 OK\r\nContent-Length: " << body_.size()
+               << "\r\n\r\n";
+        offset_ = min(first_read_, body_.size());
+        ostream os(&channel_->reply_);
+        os << header.str() << body_.substr(0, offset_);
+        state_machine()->ProcResponse(boost::system::error_code(),
+                                      header.str().size());
+    }
+
+    // Reads the next part of the body. The read number read_fail_count_, if
+    // set, fails as if the connection went down.
+    void PollBodyRead(size_t bytes_to_read) {
+        reads_.push_back(bytes_to_read);
+        if (reads_.size() == read_fail_count_) {
+            boost::system::error_code ec(boost::system::errc::connection_reset,
+                                         boost::system::system_category());
+            state_machine()->ProcPollRespBodyRead(ec, 0);
+            return;
+        }
+        ostream os(&channel_->reply_);
+        os << body_.substr(offset_, bytes_to_read);
+        offset_ += bytes_to_read;
+        state_machine()->ProcPollRespBodyRead(boost::system::error_code(),
+                                              bytes_to_read);
+    }
+
+    // Chunk callback. Parsing fails once fail_offset_ bytes, if set, have
+    // been received.
+    bool ReceiveChunk(const char *data, size_t length, bool last,
+                      uint64_t sequence_number) {
+        received_.append(data, length);
+        chunks_.push_back(length);
+        if (last) {
+            last_chunks_++;
+        }
+        return (fail_offset_ == 0 || received_.size() < fail_offset_);
+    }
+
+    void ResetChunks() {
+        resets_++;
+    }
+
+    void ExpectBodyReads() {
+        EXPECT_CALL(*channel_, PollBodyReadInMainThr(_))
+            .WillRepeatedly(Invoke(boost::bind(
+                &IFMapChannelTest::PollBodyRead, this, _1)));
+    }
+
+    // Poll result of about size bytes.
+    static string PollResult(size_t size) {
+        string result(
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<env:Envelope xmlns:env=\"http://www.w3.org/2003/05/soap-envelope\""
+            " xmlns:ifmap=\"http://www.trustedcomputinggroup.org/2010/IFMAP/2\">"
+            "<env:Body><ifmap:response><pollResult>"
+            "<searchResult name=\"root\">\n");
+        for (size_t i = 0; result.size() < size; i++) {
+            ostringstream oss;
+            oss << "<resultItem><identity name=\"contrail:virtual-network:vn"
+                << i << "\" type=\"other\"/></resultItem>\n";
+            result += oss.str();
+        }
+        result += "</searchResult></pollResult></ifmap:response></env:Body>"
+                  "</env:Envelope>\n";
+        return result;
+    }
+
+    IFMapStateMachine *state_machine() {
+        return ifmap_manager_.state_machine();
+    }
+    size_t chunk_size() const { return IFMapChannel::kPollBodyChunkSize; }
+    bool streamed() const { return channel_->poll_body_streamed_; }
+
+    EventManager evm_;
+    DB db_;
+    DBGraph graph_;
+    IFMapServer ifmap_server_;
+    IFMapManager ifmap_manager_;
+    IFMapChannelStreamMock *channel_;
+
+    string body_;
+    size_t first_read_;
+    size_t offset_;
+    size_t fail_offset_;
+    size_t read_fail_count_;
+    vector<size_t> reads_;
+
+    string received_;
+    vector<size_t> chunks_;
+    int resets_;
+    int last_chunks_;
+};
+
+// The complete body is read together with the header.
+TEST_F(IFMapChannelTest, BodyInHeaderRead) {
+    body_ = PollResult(1024);
+    first_read_ = body_.size();
+    ExpectPoll(2);
+    EXPECT_CALL(*channel_, PollBodyReadInMainThr(_)).Times(0);
+    Run();
+
+    EXPECT_EQ(1U, chunks_.size());
+    EXPECT_EQ(1, last_chunks_);
+    EXPECT_TRUE(received_ == body_);
+    EXPECT_EQ(0, resets_);
+    EXPECT_EQ(1U, channel_->get_recv_msg_cnt());
+    EXPECT_FALSE(streamed());
+}
+
+// The rest of the body is read, and given to the parser, one chunk at a time.
+TEST_F(IFMapChannelTest, BodyInSeveralReads) {
+    body_ = PollResult(2 * chunk_size() + 4096);
+    first_read_ = 100;
+    ExpectPoll(2);
+    ExpectBodyReads();
+    Run();
+
+    ASSERT_EQ(3U, reads_.size());
+    EXPECT_EQ(chunk_size(), reads_[0]);
+    EXPECT_EQ(chunk_size(), reads_[1]);
+    EXPECT_EQ(body_.size() - first_read_ - 2 * chunk_size(), reads_[2]);
+    ASSERT_EQ(4U, chunks_.size());
+    EXPECT_EQ(first_read_, chunks_[0]);
+    EXPECT_EQ(1, last_chunks_);
+    EXPECT_TRUE(received_ == body_);
+    EXPECT_EQ(0, resets_);
+    EXPECT_EQ(1U, channel_->get_recv_msg_cnt());
+}
+
+// A parse failure stops the reads of the body and starts a new session. The
+// parser drops its state itself, so it is not reset.
+TEST_F(IFMapChannelTest, ParseFailure) {
+    body_ = PollResult(3 * chunk_size());
+    first_read_ = 100;
+    fail_offset_ = chunk_size();
+    ExpectPoll(1);
+    ExpectBodyReads();
+    Run();
+
+    EXPECT_EQ(1U, reads_.size());
+    EXPECT_EQ(2U, chunks_.size());
+    EXPECT_EQ(0, last_chunks_);
+    EXPECT_EQ(0, resets_);
+    EXPECT_FALSE(streamed());
+}
+
+// A connection failure while the body is read resets the parser, without
+// giving it a last chunk.
+TEST_F(IFMapChannelTest, ReconnectMidBody) {
+    body_ = PollResult(3 * chunk_size());
+    first_read_ = 100;
+    read_fail_count_ = 2;
+    ExpectPoll(1);
+    ExpectBodyReads();
+    Run();
+
+    EXPECT_EQ(2U, reads_.size());
+    EXPECT_EQ(2U, chunks_.size());
+    EXPECT_EQ(0, last_chunks_);
+    EXPECT_EQ(1, resets_);
+    EXPECT_FALSE(streamed());
+}
+
+// An error result is not given to the parser, and starts a new session.
+TEST_F(IFMapChannelTest, ErrorResult) {
+    body_ =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<env:Envelope xmlns:env=\"http://www.w3.org/2003/05/soap-envelope\" "
+        "xmlns:ifmap=\"http://www.trustedcomputinggroup.org/2010/IFMAP/2\">"
+        "<env:Body><ifmap:response><errorResult errorCode=\"InvalidSessionID\">"
+        "<errorString>Session expired</errorString></errorResult>"
+        "</ifmap:response></env:Body></env:Envelope>\n";
+    // The element name is split between the two reads.
+    first_read_ = body_.find("errorResult") + 5;
+    ExpectPoll(1);
+    ExpectBodyReads();
+    Run();
+
+    EXPECT_EQ(1U, reads_.size());
+    EXPECT_EQ(1U, chunks_.size());
+    EXPECT_EQ(first_read_, received_.size());
+    EXPECT_EQ(1, resets_);
+    EXPECT_FALSE(streamed());
+}
+
+int main(int argc, char **argv) {
+    ConcurrencyChecker::disable_ = true;
+    LoggingInit();
+    ::testing::InitGoogleMock(&argc, argv);
+    bool success = RUN_ALL_TESTS();
+    return success;
+}
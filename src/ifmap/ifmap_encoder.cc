@@ -5,6 +5,7 @@
 #include "ifmap/ifmap_encoder.h"
 
 #include <sstream>
+#include <pugixml/pugixml.hpp>
 #include "ifmap/ifmap_link.h"
 #include "ifmap/ifmap_object.h"
 #include "ifmap/ifmap_update.h"
@@ -12,94 +13,128 @@
 using namespace pugi;
 using namespace std;
 
-IFMapMessage::IFMapMessage() : op_type_(NONE), node_count_(0),
-    objects_per_message_(kObjectsPerMessage) {
-    // init empty document
-    Open();
+static const char kMessageHeader[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<iq type=\"set\" from=\"network-control@contrailsystems.com\" to=\"";
+static const char kConfigOpen[] = "/config\"><config>";
+static const char kMessageTrailer[] = "</config></iq>\n";
+
+// Escape the characters that are not allowed in a double quoted attribute.
+static void AppendEscaped(const string &value, string *out) {
+    for (string::const_iterator iter = value.begin(); iter != value.end();
+         ++iter) {
+        switch (*iter) {
+        case '&':
+            out->append("&amp;");
+            break;
+        case '<':
+            out->append("&lt;");
+            break;
+        case '>':
+            out->append("&gt;");
+            break;
+        case '"':
+            out->append("&quot;");
+            break;
+        default:
+            out->push_back(*iter);
+            break;
+        }
+    }
 }
 
-void IFMapMessage::Open() {
-    xml_node iq = doc_.append_child("iq");
-    // set iq (type, from, to) attributes
-    iq.append_attribute("type") = "set";
-    iq.append_attribute("from") = "network-control@contrailsystems.com"; 
-    iq.append_attribute("to") = "";
-    config_ = iq.append_child("config");
+IFMapMessage::IFMapMessage() : op_type_(NONE), node_count_(0),
+    objects_per_message_(kObjectsPerMessage),
+    message_bytes_(kMessageBytes),
+    encode_cache_hits_(0), encode_cache_misses_(0) {
 }
 
 void IFMapMessage::Close() {
-    ostringstream oss;
-    doc_.save(oss);
-    str_ = oss.str();
+    assert(op_type_ != NONE);
+    str_.clear();
+    str_.reserve(sizeof(kMessageHeader) + receiver_.size() +
+                 sizeof(kConfigOpen) + body_.size() +
+                 sizeof(kMessageTrailer) + 16);
+    str_.append(kMessageHeader);
+    AppendEscaped(receiver_, &str_);
+    str_.append(kConfigOpen);
+    str_.append(body_);
+    str_.append((op_type_ == UPDATE) ? "</update>" : "</delete>");
+    str_.append(kMessageTrailer);
 }
 
 void IFMapMessage::SetReceiverInMsg(const std::string &cli_identifier) {
-    xml_node iq = doc_.child("iq");
-    assert(iq);
-    xml_attribute iqattr = iq.attribute("to");
-    assert(iqattr);
-    std::string str(cli_identifier);
-    str += "/config";
-    iqattr.set_value(str.c_str());
+    receiver_ = cli_identifier;
 }
 
 void IFMapMessage::SetObjectsPerMessage(int num) {
     objects_per_message_ = num;
 }
 
-void IFMapMessage::EncodeUpdate(const IFMapUpdate *update) {
-    // update is either of type UPDATE OR DELETE
-    if (update->IsUpdate()) {
-        if (op_type_ != UPDATE) {
-            op_node_ = config_.append_child("update");
-            op_type_ = UPDATE;
-        }
-        if (update->data().type == IFMapObjectPtr::NODE) {
-            EncodeNode(update);
-        } else if (update->data().type == IFMapObjectPtr::LINK) {
-            EncodeLink(update);
+void IFMapMessage::SetMessageBytes(size_t bytes) {
+    message_bytes_ = bytes;
+}
+
+// Serialize the node or link in the update, without the enclosing update or
+// delete element. The result depends only on the update and is therefore
+// valid for every client that the update is advertised to.
+void IFMapMessage::Encode(const IFMapUpdate *update, string *encoded) {
+    xml_document doc;
+    xml_node parent = doc.append_child("config");
+    if (update->data().type == IFMapObjectPtr::NODE) {
+        IFMapNode *node = update->data().u.node;
+        if (update->IsUpdate()) {
+            node->EncodeNodeDetail(&parent);
         } else {
-            assert(0);
+            node->EncodeNode(&parent);
         }
+    } else if (update->data().type == IFMapObjectPtr::LINK) {
+        xml_node link_node = parent.append_child("link");
+        const IFMapLink *link = update->data().u.link;
+        IFMapNode::EncodeNode(link->left_id(), &link_node);
+        IFMapNode::EncodeNode(link->right_id(), &link_node);
+        link->EncodeLinkInfo(&link_node);
     } else {
-        if (op_type_ != DELETE) {
-            op_node_ = config_.append_child("delete");
-            op_type_ = DELETE;
-        }
-        if (update->data().type == IFMapObjectPtr::NODE) {
-            EncodeNode(update);
-        } else if (update->data().type == IFMapObjectPtr::LINK) {
-            EncodeLink(update);
-        } else {
-            assert(0);
-        }
+        assert(0);
     }
-    node_count_++;
-}
 
-void IFMapMessage::EncodeNode(const IFMapUpdate *update) {
-    IFMapNode *node = update->data().u.node;
-    if (update->IsUpdate()) {
-        node->EncodeNodeDetail(&op_node_);
-    } else {
-        node->EncodeNode(&op_node_);
-    }    
+    ostringstream oss;
+    for (xml_node child = parent.first_child(); child;
+         child = child.next_sibling()) {
+        child.print(oss, "", format_raw);
+    }
+    *encoded = oss.str();
 }
 
-void IFMapMessage::EncodeLink(const IFMapUpdate *update) {
-    xml_node link_node = op_node_.append_child("link");
-
-    const IFMapLink *link = update->data().u.link;
+void IFMapMessage::EncodeUpdate(IFMapUpdate *update) {
+    // update is either of type UPDATE OR DELETE
+    Op op_type = update->IsUpdate() ? UPDATE : DELETE;
+    if (op_type_ != op_type) {
+        if (op_type_ != NONE) {
+            body_.append((op_type_ == UPDATE) ? "</update>" : "</delete>");
+        }
+        body_.append((op_type == UPDATE) ? "<update>" : "<delete>");
+        op_type_ = op_type;
+    }
 
-    IFMapNode::EncodeNode(link->left_id(), &link_node);
-    IFMapNode::EncodeNode(link->right_id(), &link_node);
-    link->EncodeLinkInfo(&link_node);
+    if (update->encoded().empty()) {
+        Encode(update, update->mutable_encoded());
+        encode_cache_misses_++;
+    } else {
+        encode_cache_hits_++;
+    }
+    body_.append(update->encoded());
 
+    // A link accounts for its 2 nodes.
+    if (update->data().type == IFMapObjectPtr::LINK) {
+        node_count_++;
+    }
     node_count_++;
 }
 
 bool IFMapMessage::IsFull() {
-    return ((node_count_ >= objects_per_message_) ? true : false);
+    return ((node_count_ >= objects_per_message_) ||
+            (body_.size() >= message_bytes_));
 }
 
 bool IFMapMessage::IsEmpty() {
@@ -107,10 +142,10 @@ bool IFMapMessage::IsEmpty() {
 }
 
 void IFMapMessage::Reset() {
-    doc_.reset();
+    body_.clear();
+    receiver_.clear();
     node_count_ = 0;
     op_type_ = NONE;
-    Open();
 }
 
 const char * IFMapMessage::c_str() const {
@@ -5,27 +5,41 @@
 #ifndef __ctrlplane__ifmap_encoder__
 #define __ctrlplane__ifmap_encoder__
 
-#include <pugixml/pugixml.hpp>
+#include <stdint.h>
+#include <string>
 
 class IFMapNode;
 class IFMapLink;
 class IFMapUpdate;
 
+// An IFMapMessage is built once per send-set and then addressed to each
+// client in the set. The body is assembled from the encoded fragment of each
+// update, which is cached in the IFMapUpdate itself so that an object that is
+// advertised to many clients, possibly in different messages, is serialized
+// only once. Only the 'to' header differs across the clients of a message.
 class IFMapMessage {
 public:
     static const int kObjectsPerMessage = 16;
+    static const size_t kMessageBytes = 64 * 1024;
     IFMapMessage();
 
     void Close();
     // set the 'to' field in the message
     void SetReceiverInMsg(const std::string &cli_identifier);
     void SetObjectsPerMessage(int num);
-    void EncodeUpdate(const IFMapUpdate *update);
+    void SetMessageBytes(size_t bytes);
+    void EncodeUpdate(IFMapUpdate *update);
     bool IsFull();
     bool IsEmpty();
     void Reset();
 
     const char *c_str() const;
+    const std::string &str() const { return str_; }
+
+    int objects_per_message() const { return objects_per_message_; }
+    size_t message_bytes() const { return message_bytes_; }
+    uint64_t encode_cache_hits() const { return encode_cache_hits_; }
+    uint64_t encode_cache_misses() const { return encode_cache_misses_; }
 
 private:
     enum Op {
@@ -33,17 +47,17 @@ private:
         UPDATE,
         DELETE
     };
-    void Open();
-    void EncodeNode(const IFMapUpdate *update);
-    void EncodeLink(const IFMapUpdate *update);
-
-    pugi::xml_document doc_;
-    pugi::xml_node config_;
-    Op op_type_;             // the current  type of op_node_
-    pugi::xml_node op_node_;
+    static void Encode(const IFMapUpdate *update, std::string *encoded);
+
+    std::string receiver_;
+    std::string body_;
+    Op op_type_;             // the current type of the open op element
     std::string str_;
     int node_count_;
     int objects_per_message_;
+    size_t message_bytes_;
+    uint64_t encode_cache_hits_;
+    uint64_t encode_cache_misses_;
 };
 
 #endif /* defined(__ctrlplane__ifmap_encoder__) */
@@ -4,12 +4,15 @@
 
 #include "ifmap/ifmap_exporter.h"
 
+#include <limits>
+#include <vector>
 #include <boost/bind.hpp>
 #include <boost/checked_delete.hpp>
 
 #include "db/db.h"
 #include "db/db_table_partition.h"
 #include "ifmap/ifmap_client.h"
+#include "ifmap/ifmap_encoder.h"
 #include "ifmap/ifmap_graph_walker.h"
 #include "ifmap/ifmap_link.h"
 #include "ifmap/ifmap_log.h"
@@ -162,6 +165,10 @@ bool IFMapExporter::UpdateAddChange(ObjectType *obj, IFMapState *state,
     IFMapUpdate *update = state->GetUpdate(IFMapListEntry::UPDATE);
     if (update != NULL) {
         update->AdvertiseReset(rm_set);
+        // The cached encoding is stale if the object itself has changed.
+        if (change) {
+            update->ClearEncoded();
+        }
     }
 
     if (state->interest().empty()) {
@@ -553,6 +560,100 @@ void IFMapExporter::StateUpdateOnDequeue(IFMapUpdate *update,
     }
 }
 
+static void SnapshotFlush(IFMapClient *client, IFMapMessage *message,
+                          list<string> *messages) {
+    message->SetReceiverInMsg(client->identifier());
+    message->Close();
+    messages->push_back(message->str());
+    message->Reset();
+}
+
+// Encode obj in the snapshot of the clients in bset and mark it advertised
+// to them. A pending positive update is superseded by the snapshot for these
+// clients and is only kept for the others.
+template <class ObjectType>
+void IFMapExporter::SnapshotEncode(ObjectType *obj, IFMapState *state,
+                                   const BitSet &bset, IFMapClient *client,
+                                   IFMapMessage *message,
+                                   list<string> *messages) {
+    IFMapUpdate *update = state->GetUpdate(IFMapListEntry::UPDATE);
+    if (update != NULL) {
+        // Use the cached encoding of the pending update, if any.
+        message->EncodeUpdate(update);
+        update->AdvertiseReset(bset);
+        if (update->advertise().empty()) {
+            queue()->Dequeue(update);
+            state->Remove(update);
+            delete update;
+        }
+    } else {
+        IFMapUpdate snapshot(obj, true);
+        message->EncodeUpdate(&snapshot);
+    }
+    state->AdvertisedOr(bset);
+
+    if (message->IsFull()) {
+        SnapshotFlush(client, message, messages);
+    }
+}
+
+void IFMapExporter::ClientSnapshot(IFMapNode *vr_node, IFMapClient *client,
+                                   list<string> *messages) {
+    BitSet bset;
+    bset.set(client->index());
+
+    vector<IFMapNode *> nodes;
+    walker_->JoinClient(vr_node, bset, &nodes);
+
+    // Messages are only bounded by size.
+    IFMapMessage message;
+    message.SetObjectsPerMessage(numeric_limits<int>::max());
+    message.SetMessageBytes(sender()->message()->message_bytes());
+
+    for (vector<IFMapNode *>::iterator iter = nodes.begin();
+         iter != nodes.end(); ++iter) {
+        IFMapNode *node = *iter;
+        IFMapNodeState *state = NodeStateLookup(node);
+        if (!IsFeasible(node) || !state->IsValid()) {
+            node->table()->Change(node);
+            continue;
+        }
+        SnapshotEncode(node, state, bset, client, &message, messages);
+        client->incr_nodes_sent();
+    }
+
+    // A link can only be advertised once both of its nodes are. Links are
+    // reached from both of their nodes; the interest of the link tells if it
+    // has already been taken care of.
+    for (vector<IFMapNode *>::iterator iter = nodes.begin();
+         iter != nodes.end(); ++iter) {
+        IFMapNodeState *state = NodeStateLookup(*iter);
+        for (IFMapNodeState::iterator link_iter = state->begin();
+             link_iter != state->end(); ++link_iter) {
+            IFMapLink *link = link_iter.operator->();
+            IFMapLinkState *ls = LinkStateLookup(link);
+            if ((ls == NULL) || ls->interest().Contains(bset) ||
+                !ls->left()->interest().Contains(bset) ||
+                !ls->right()->interest().Contains(bset)) {
+                continue;
+            }
+            if (link->IsDeleted() || !ls->IsValid() ||
+                !ls->left()->advertised().Contains(bset) ||
+                !ls->right()->advertised().Contains(bset)) {
+                link_table_->Change(link);
+                continue;
+            }
+            ls->InterestOr(bset);
+            SnapshotEncode(link, ls, bset, client, &message, messages);
+            client->incr_links_sent();
+        }
+    }
+
+    if (!message.IsEmpty()) {
+        SnapshotFlush(client, &message, messages);
+    }
+}
+
 struct IFMapUpdateDisposer {
     explicit IFMapUpdateDisposer(IFMapUpdateQueue *queue) : queue_(queue) { }
     void operator()(IFMapUpdate *ptr) {
@@ -20,6 +20,7 @@ class IFMapClient;
 class IFMapGraphWalker;
 class IFMapLink;
 class IFMapLinkState;
+class IFMapMessage;
 class IFMapNode;
 class IFMapNodeState;
 class IFMapServer;
@@ -47,6 +48,14 @@ public:
     void StateUpdateOnDequeue(IFMapUpdate *update, const BitSet &dequeue_set,
                               bool is_delete);
 
+    // Initial sync of a client that has just registered. Computes the
+    // interest of the client from its virtual-router node in one traversal
+    // and encodes every object of its config set, nodes before links, into
+    // messages that are sent ahead of the update queue. Objects that have
+    // not been exported yet are left to the update queue.
+    void ClientSnapshot(IFMapNode *vr_node, IFMapClient *client,
+                        std::list<std::string> *messages);
+
     // GraphWalker API
     DBTable::ListenerId TableListenerId(const DBTable *table) const;
 
@@ -78,6 +87,11 @@ private:
                       const BitSet &rm_set);
     template <class ObjectType>
     void EnqueueDelete(ObjectType *obj, IFMapState *state);
+    template <class ObjectType>
+    void SnapshotEncode(ObjectType *obj, IFMapState *state,
+                        const BitSet &bset, IFMapClient *client,
+                        IFMapMessage *message,
+                        std::list<std::string> *messages);
 
     void MoveDependentLinks(IFMapNodeState *state);
     void RemoveDependentLinks(DBTablePartBase *partition, IFMapNodeState *state,
@@ -7,6 +7,7 @@
 #include <boost/bind.hpp>
 #include "base/logging.h"
 #include "db/db_graph.h"
+#include "db/db_graph_edge.h"
 #include "db/db_table.h"
 #include "ifmap/ifmap_client.h"
 #include "ifmap/ifmap_exporter.h"
@@ -62,6 +63,8 @@ private:
     const BitSet &bset_;
 };
 
+bool IFMapGraphWalker::bitset_traversal_ = true;
+
 IFMapGraphWalker::IFMapGraphWalker(DBGraph *graph, IFMapExporter *exporter)
     : graph_(graph),
       exporter_(exporter),
@@ -101,6 +104,25 @@ void IFMapGraphWalker::ProcessLinkAdd(IFMapNode *lnode, IFMapNode *rnode,
                   filter);
 }
 
+void IFMapGraphWalker::SnapshotVertex(DBGraphVertex *vertex,
+                                      const BitSet &bset,
+                                      std::vector<IFMapNode *> *nodes) {
+    IFMapNode *node = static_cast<IFMapNode *>(vertex);
+    IFMapNodeState *state = exporter_->NodeStateLocate(node);
+    state->InterestOr(bset);
+    nodes->push_back(node);
+}
+
+void IFMapGraphWalker::JoinClient(IFMapNode *vr_node, const BitSet &bset,
+                                  std::vector<IFMapNode *> *nodes) {
+    GraphPropagateFilter filter(exporter_, traversal_white_list_.get(), bset);
+    graph_->Visit(vr_node,
+                  boost::bind(&IFMapGraphWalker::SnapshotVertex, this, _1,
+                              bset, nodes),
+                  0,
+                  filter);
+}
+
 void IFMapGraphWalker::LinkAdd(IFMapNode *lnode, const BitSet &lhs,
                                IFMapNode *rnode, const BitSet &rhs) {
     IFMAP_DEBUG(LinkOper, "LinkAdd", lnode->ToString(), rnode->ToString(),
@@ -139,7 +161,71 @@ void IFMapGraphWalker::RecomputeInterest(DBGraphVertex *vertex, int bit) {
     state->nmask_set(bit);
 }
 
+// Add the bits to the nmask of the node and queue the node to propagate them
+// to its neighbors, unless the node already has all of them.
+void IFMapGraphWalker::PropagateInterest(IFMapNode *node, const BitSet &bset,
+                                         std::deque<IFMapNode *> *queue,
+                                         std::set<IFMapNode *> *queued) {
+    IFMapNodeState *state = exporter_->NodeStateLocate(node);
+    if (state->nmask().Contains(bset)) {
+        return;
+    }
+    state->nmask_or(bset);
+    if (queued->insert(node).second) {
+        queue->push_back(node);
+    }
+}
+
+// Sets the nmask of every node to the clients in bset that reach the node
+// from their virtual-router node. Same result as one traversal per client,
+// with the same vertex and edge filters, but a node is only expanded again
+// when it gains bits, so shared nodes are not walked once per client.
+void IFMapGraphWalker::RecomputeInterest(const BitSet &bset) {
+    IFMapServer *server = exporter_->server();
+    IFMapTable *table = IFMapTable::FindTable(server->database(),
+                                              "virtual-router");
+    std::deque<IFMapNode *> queue;
+    std::set<IFMapNode *> queued;
+    for (size_t i = bset.find_first(); i != BitSet::npos;
+         i = bset.find_next(i)) {
+        IFMapClient *client = server->GetClient(i);
+        if (client == NULL) {
+            continue;
+        }
+        IFMapNode *node = table->FindNode(client->identifier());
+        if ((node != NULL) && node->IsVertexValid()) {
+            BitSet bit;
+            bit.set(i);
+            PropagateInterest(node, bit, &queue, &queued);
+        }
+    }
+
+    while (!queue.empty()) {
+        IFMapNode *node = queue.front();
+        queue.pop_front();
+        queued.erase(node);
+        const BitSet &nmask = exporter_->NodeStateLookup(node)->nmask();
+        for (DBGraphVertex::edge_iterator iter = node->edge_list_begin(graph_);
+             iter != node->edge_list_end(graph_); ++iter) {
+            const DBGraphEdge *edge = iter.operator->();
+            IFMapNode *target = static_cast<IFMapNode *>(iter.target());
+            if (edge->IsDeleted() || target->IsDeleted() ||
+                !traversal_white_list_->VertexFilter(target) ||
+                !traversal_white_list_->EdgeFilter(node, target, edge)) {
+                continue;
+            }
+            PropagateInterest(target, nmask, &queue, &queued);
+        }
+    }
+}
+
 bool IFMapGraphWalker::Worker(QueueEntry work_entry) {
+    // The interest is recomputed once for the whole batch.
+    if (bitset_traversal_) {
+        rm_mask_ |= work_entry.set;
+        return true;
+    }
+
     const BitSet &bset = work_entry.set;
     IFMapServer *server = exporter_->server();
     for (size_t i = bset.find_first(); i != BitSet::npos;
@@ -171,6 +257,11 @@ void IFMapGraphWalker::CleanupInterest(DBGraphVertex *vertex) {
         return;
     }
 
+    // Nothing to do for nodes not affected by the removals.
+    if (state->nmask().empty() && !state->interest().intersects(rm_mask_)) {
+        return;
+    }
+
     if (!state->interest().empty() && !state->nmask().empty()) {
         IFMAP_DEBUG(CleanupInterest, node->ToString(),
                     state->interest().ToString(), rm_mask_.ToString(),
@@ -198,6 +289,9 @@ void IFMapGraphWalker::CleanupInterest(DBGraphVertex *vertex) {
 // Cleanup all graph nodes that a bit set in the remove mask (rm_mask_) but
 // where not visited by the walker.
 void IFMapGraphWalker::WorkBatchEnd(bool done) {
+    if (bitset_traversal_) {
+        RecomputeInterest(rm_mask_);
+    }
     for (DBGraph::vertex_iterator iter = graph_->vertex_list_begin();
          iter != graph_->vertex_list_end(); ++iter) {
         DBGraphVertex *vertex = iter.operator->();
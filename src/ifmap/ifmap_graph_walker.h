@@ -5,6 +5,10 @@
 #ifndef __ctrlplane__ifmap_graph_walker__
 #define __ctrlplane__ifmap_graph_walker__
 
+#include <deque>
+#include <set>
+#include <vector>
+
 #include "base/bitset.h"
 #include "base/queue_task.h"
 
@@ -17,6 +21,12 @@ struct IFMapTypenameFilter;
 struct IFMapTypenameWhiteList;
 
 // Computes the interest graph for the ifmap clients (i.e. vnc agent).
+//
+// Link removals are batched in a WorkQueue. At the end of a batch, the
+// interest of all the clients that were affected is recomputed with a single
+// traversal that starts at the virtual-router nodes of these clients and
+// propagates BitSets of clients along the graph, rather than with one
+// traversal per client. A vertex is only revisited when it gains bits.
 class IFMapGraphWalker {
 public:
     IFMapGraphWalker(DBGraph *graph, IFMapExporter *exporter);
@@ -29,8 +39,20 @@ public:
                  IFMapNode *rnode, const BitSet &rhs);
     void LinkRemove(const BitSet &bset);
 
+    // Initial sync: add bset to the interest of every node reachable from
+    // the virtual-router node of a client and return these nodes in the
+    // order of the traversal. The exporter is not notified; the caller is
+    // responsible for advertising the nodes.
+    void JoinClient(IFMapNode *vr_node, const BitSet &bset,
+                    std::vector<IFMapNode *> *nodes);
+
     bool FilterNeighbor(IFMapNode *lnode, IFMapNode *rnode);
 
+    // Select the BitSet traversal (default) or a traversal per client.
+    static void set_bitset_traversal(bool enable) {
+        bitset_traversal_ = enable;
+    }
+
 private:
     struct QueueEntry {
         BitSet set;
@@ -41,7 +63,13 @@ private:
 
     void ProcessLinkAdd(IFMapNode *lnode, IFMapNode *rnode, const BitSet &bset);
     void JoinVertex(DBGraphVertex *vertex, const BitSet &bset);
+    void SnapshotVertex(DBGraphVertex *vertex, const BitSet &bset,
+                        std::vector<IFMapNode *> *nodes);
     void RecomputeInterest(DBGraphVertex *vertex, int bit);
+    void RecomputeInterest(const BitSet &bset);
+    void PropagateInterest(IFMapNode *node, const BitSet &bset,
+                           std::deque<IFMapNode *> *queue,
+                           std::set<IFMapNode *> *queued);
     void CleanupInterest(DBGraphVertex *vertex);
     void AddNodesToWhitelist();
     void AddLinksToWhitelist();
@@ -51,6 +79,7 @@ private:
     WorkQueue<QueueEntry> work_queue_;
     std::auto_ptr<IFMapTypenameWhiteList> traversal_white_list_;
     BitSet rm_mask_;
+    static bool bitset_traversal_;
 };
 
 #endif /* defined(__ctrlplane__ifmap_graph_walker__) */
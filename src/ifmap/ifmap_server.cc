@@ -192,7 +192,8 @@ IFMapServer::IFMapServer(DB *db, DBGraph *graph,
           io_service_(io_service),
           stale_cleanup_timer_(TimerManager::CreateTimer(*(io_service_),
                                          "Stale cleanup timer")),
-          ifmap_manager_(NULL), ifmap_channel_manager_(NULL) {
+          ifmap_manager_(NULL), ifmap_channel_manager_(NULL),
+          initial_sync_(false) {
 }
 
 IFMapServer::~IFMapServer() {
@@ -238,7 +239,11 @@ void IFMapServer::ClientUnregister(IFMapClient *client) {
 bool IFMapServer::ProcessClientWork(bool add, IFMapClient *client) {
     if (add) {
         ClientRegister(client);
-        ClientGraphDownload(client);
+        if (initial_sync_) {
+            ClientGraphSnapshot(client);
+        } else {
+            ClientGraphDownload(client);
+        }
     } else {
         ClientGraphCleanup(client);
         RemoveSelfAddedLinksAndObjects(client);
@@ -351,6 +356,34 @@ void IFMapServer::ClientGraphDownload(IFMapClient *client) {
     }
 }
 
+void IFMapServer::ClientGraphSnapshot(IFMapClient *client) {
+    IFMapTable *table = IFMapTable::FindTable(db_, "virtual-router");
+    assert(table);
+
+    IFMapNode *node = table->FindNode(client->identifier());
+    if ((node == NULL) || !node->IsVertexValid()) {
+        return;
+    }
+    // Same as ClientGraphDownload, there is nothing to send until the node
+    // has a neighbor that is part of the client's config.
+    bool has_neighbor = false;
+    for (DBGraphVertex::adjacency_iterator iter = node->begin(graph_);
+         iter != node->end(graph_); ++iter) {
+        IFMapNode *adj = static_cast<IFMapNode *>(iter.operator->());
+        if (!exporter_->FilterNeighbor(node, adj)) {
+            has_neighbor = true;
+            break;
+        }
+    }
+    if (!has_neighbor) {
+        return;
+    }
+
+    IFMapUpdateSender::MessageList messages;
+    exporter_->ClientSnapshot(node, client, &messages);
+    sender_->EnqueueSnapshot(client->index(), &messages);
+}
+
 void IFMapServer::ClientGraphCleanup(IFMapClient *client) {
     IFMapTable *table = IFMapTable::FindTable(db_, "virtual-router");
     assert(table);
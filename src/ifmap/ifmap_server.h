@@ -81,6 +81,13 @@ public:
         return ifmap_channel_manager_;
     }
 
+    // When enabled, a client that registers gets its whole config set in
+    // large pre-encoded messages built in a single pass over its interest,
+    // instead of one update at a time through the update queue. Changes that
+    // follow are sent incrementally.
+    void set_initial_sync(bool enable) { initial_sync_ = enable; }
+    bool initial_sync() const { return initial_sync_; }
+
     void ProcessVmSubscribe(std::string vr_name, std::string vm_uuid,
                             bool subscribe, bool has_vms);
     void ProcessVmSubscribe(std::string vr_name, std::string vm_uuid,
@@ -116,6 +123,7 @@ private:
     };
     bool ClientWorker(QueueEntry work_entry);
     void ClientGraphDownload(IFMapClient *client);
+    void ClientGraphSnapshot(IFMapClient *client);
     void ClientGraphCleanup(IFMapClient *client);
     void RemoveSelfAddedLinksAndObjects(IFMapClient *client);
     void CleanupUuidMapper(IFMapClient *client);
@@ -139,6 +147,7 @@ private:
     Timer *stale_cleanup_timer_;
     IFMapManager *ifmap_manager_;
     IFMapChannelManager *ifmap_channel_manager_;
+    bool initial_sync_;
 };
 
 #endif /* defined(__ctrlplane__ifmap_server__) */
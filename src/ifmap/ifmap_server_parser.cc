@@ -6,6 +6,7 @@
 #include "ifmap/ifmap_server_parser.h"
 
 #include <pugixml/pugixml.hpp>
+#include "base/util.h"
 #include "db/db.h"
 #include "ifmap/ifmap_server_table.h"
 #include "ifmap/ifmap_log.h"
@@ -26,6 +27,12 @@ static const char *NodeName(const xml_node &node) {
     return name;
 }
 
+IFMapServerParser::IFMapServerParser() {
+}
+
+IFMapServerParser::~IFMapServerParser() {
+}
+
 IFMapServerParser *IFMapServerParser::GetInstance(const string &module) {
     ModuleMap::iterator loc = module_map_.find(module);
     if (loc != module_map_.end()) {
@@ -213,6 +220,42 @@ void IFMapServerParser::ParseResults(
     }
 }
 
+static void EnqueueBatch(IFMapTable *table, vector<DBRequest *> *batch) {
+    if (batch->empty()) {
+        return;
+    }
+    table->EnqueueBulk(*batch);
+    STLDeleteValues(batch);
+}
+
+// Consecutive requests for the same table are handed to the table as one
+// batch, which keeps the requests in the order they were parsed.
+void IFMapServerParser::EnqueueRequests(DB *db, RequestList *requests,
+                                        uint64_t sequence_number) const {
+    IFMapTable *batch_table = NULL;
+    vector<DBRequest *> batch;
+    while (!requests->empty()) {
+        auto_ptr<DBRequest> req(requests->front());
+        requests->pop_front();
+
+        IFMapTable::RequestKey *key =
+                static_cast<IFMapTable::RequestKey *>(req->key.get());
+        key->id_seq_num = sequence_number;
+
+        IFMapTable *table = IFMapTable::FindTable(db, key->id_type);
+        if (table == NULL) {
+            IFMAP_TRACE(IFMapTblNotFoundTrace, "Cant find table", key->id_type);
+            continue;
+        }
+        if (table != batch_table) {
+            EnqueueBatch(batch_table, &batch);
+            batch_table = table;
+        }
+        batch.push_back(req.release());
+    }
+    EnqueueBatch(batch_table, &batch);
+}
+
 // Called in the context of the ifmap client thread.
 bool IFMapServerParser::Receive(DB *db, const char *data, size_t length,
                                 uint64_t sequence_number) {
@@ -225,21 +268,185 @@ bool IFMapServerParser::Receive(DB *db, const char *data, size_t length,
 
     IFMapServerParser::RequestList requests;
     ParseResults(xdoc, &requests);
+    EnqueueRequests(db, &requests, sequence_number);
+    return true;
+}
 
-    while (!requests.empty()) {
-        auto_ptr<DBRequest> req(requests.front());
-        requests.pop_front();
+// Called in the context of the ifmap client thread. The requests of the items
+// that preceded an error have already been enqueued by then; the client
+// starts a new session on failure, which resends the complete configuration.
+bool IFMapServerParser::ReceiveChunk(DB *db, const char *data, size_t length,
+                                     bool last, uint64_t sequence_number) {
+    if (stream_.get() == NULL) {
+        stream_.reset(new IFMapStreamParser(this));
+    }
 
-        IFMapTable::RequestKey *key =
-                static_cast<IFMapTable::RequestKey *>(req->key.get());
-        key->id_seq_num = sequence_number;
+    IFMapServerParser::RequestList requests;
+    bool success = stream_->Parse(data, length, &requests);
+    EnqueueRequests(db, &requests, sequence_number);
+    if (success && last) {
+        success = stream_->Finish();
+    }
+    if (!success) {
+        IFMAP_WARN(IFMapXmlLoadError, "Unable to parse poll result",
+                   stream_->bytes_received());
+    }
+    if (last || !success) {
+        stream_.reset();
+    }
+    return success;
+}
 
-        IFMapTable *table = IFMapTable::FindTable(db, key->id_type);
-        if (table != NULL) {
-            table->Enqueue(req.get());
-        } else {
-            IFMAP_TRACE(IFMapTblNotFoundTrace, "Cant find table", key->id_type);
+void IFMapServerParser::ResetChunks() {
+    stream_.reset();
+}
+
+IFMapStreamParser::IFMapStreamParser(const IFMapServerParser *parser)
+    : parser_(parser), scan_(0), item_start_(string::npos), in_result_(false),
+      add_change_(false), poll_result_(false), error_(false),
+      bytes_received_(0), max_buffered_(0), items_(0) {
+}
+
+// Returns the offset just past marker, searching from pos, or npos.
+size_t IFMapStreamParser::FindEnd(const char *marker, size_t pos) const {
+    size_t loc = buffer_.find(marker, pos);
+    if (loc == string::npos) {
+        return string::npos;
+    }
+    return loc + strlen(marker);
+}
+
+// Returns the offset just past the markup that starts with the '<' at pos, or
+// npos if it has not been received completely. A partial "<!--" or "<?" at
+// the end of the buffer has no '>' after it, so it is never mistaken for an
+// element tag.
+size_t IFMapStreamParser::MarkupEnd(size_t pos) const {
+    if (buffer_.compare(pos, 4, "<!--") == 0) {
+        return FindEnd("-->", pos + 4);
+    }
+    if (buffer_.compare(pos, 9, "<![CDATA[") == 0) {
+        return FindEnd("]]>", pos + 9);
+    }
+    if (buffer_.compare(pos, 2, "<?") == 0) {
+        return FindEnd("?>", pos + 2);
+    }
+
+    // Element tag or declaration. Attribute values may contain '>'.
+    char quote = '\0';
+    for (size_t i = pos + 1; i < buffer_.size(); ++i) {
+        char c = buffer_[i];
+        if (quote != '\0') {
+            if (c == quote) {
+                quote = '\0';
+            }
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '>') {
+            return i + 1;
+        }
+    }
+    return string::npos;
+}
+
+bool IFMapStreamParser::NameIs(size_t name, size_t stop,
+                               const char *str) const {
+    return buffer_.compare(name, stop - name, str) == 0;
+}
+
+bool IFMapStreamParser::ParseItem(size_t begin, size_t end,
+                                  IFMapServerParser::RequestList *list) {
+    xml_document xdoc;
+    pugi::xml_parse_result result =
+            xdoc.load_buffer(buffer_.data() + begin, end - begin);
+    if (!result) {
+        return false;
+    }
+    items_++;
+    parser_->ParseResultItem(xdoc.first_child(), add_change_, list);
+    return true;
+}
+
+bool IFMapStreamParser::Parse(const char *data, size_t length,
+                              IFMapServerParser::RequestList *list) {
+    if (error_) {
+        return false;
+    }
+    bytes_received_ += length;
+    buffer_.append(data, length);
+    max_buffered_ = max(max_buffered_, buffer_.size());
+
+    while (true) {
+        size_t pos = buffer_.find('<', scan_);
+        if (pos == string::npos) {
+            scan_ = buffer_.size();
+            break;
+        }
+        size_t end = MarkupEnd(pos);
+        if (end == string::npos) {
+            scan_ = pos;
+            break;
+        }
+        scan_ = end;
+        if (buffer_[pos + 1] == '!' || buffer_[pos + 1] == '?') {
+            continue;
+        }
+
+        // Local name of the element, without the namespace prefix.
+        bool end_tag = (buffer_[pos + 1] == '/');
+        bool empty = (buffer_[end - 2] == '/');
+        size_t name = pos + (end_tag ? 2 : 1);
+        size_t stop = buffer_.find_first_of(" \t\r\n/>:", name);
+        if (buffer_[stop] == ':') {
+            name = stop + 1;
+            stop = buffer_.find_first_of(" \t\r\n/>", name);
+        }
+
+        if (item_start_ != string::npos) {
+            if (end_tag && NameIs(name, stop, "resultItem")) {
+                if (!ParseItem(item_start_, end, list)) {
+                    error_ = true;
+                    return false;
+                }
+                item_start_ = string::npos;
+            }
+        } else if (end_tag) {
+            if (NameIs(name, stop, "updateResult") ||
+                NameIs(name, stop, "searchResult") ||
+                NameIs(name, stop, "deleteResult")) {
+                in_result_ = false;
+            }
+        } else if (NameIs(name, stop, "updateResult") ||
+                   NameIs(name, stop, "searchResult")) {
+            add_change_ = true;
+            in_result_ = !empty;
+        } else if (NameIs(name, stop, "deleteResult")) {
+            add_change_ = false;
+            in_result_ = !empty;
+        } else if (NameIs(name, stop, "resultItem")) {
+            if (in_result_ && !empty) {
+                item_start_ = pos;
+            }
+        } else if (NameIs(name, stop, "pollResult")) {
+            poll_result_ = true;
+        } else if (NameIs(name, stop, "errorResult") ||
+                   NameIs(name, stop, "endSessionResult")) {
+            error_ = true;
+            return false;
+        }
+    }
+
+    // Drop the data that has been consumed, except for the open item.
+    size_t consumed = min(scan_, item_start_);
+    if (consumed > 0) {
+        buffer_.erase(0, consumed);
+        scan_ -= consumed;
+        if (item_start_ != string::npos) {
+            item_start_ -= consumed;
         }
     }
     return true;
 }
+
+bool IFMapStreamParser::Finish() const {
+    return !error_ && poll_result_ && buffer_.empty();
+}
@@ -7,11 +7,16 @@
 
 #include <list>
 #include <map>
+#include <string>
 #include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "base/util.h"
 
 struct AutogenProperty;
 class DB;
 struct DBRequest;
+class IFMapStreamParser;
 
 namespace pugi {
 class xml_document;
@@ -26,6 +31,9 @@ public:
     typedef std::map<std::string, MetadataParseFn> MetadataParseMap;
     typedef std::list<struct DBRequest *> RequestList;
 
+    IFMapServerParser();
+    ~IFMapServerParser();
+
     // Called for each resultItem element in the IF-MAP notification.
     bool ParseResultItem(const pugi::xml_node &parent, bool add_change,
                          RequestList *list) const;
@@ -37,6 +45,14 @@ public:
 
     bool Receive(DB *db, const char *data, size_t length,
                  uint64_t sequence_number);
+    // Incremental alternative to Receive for a poll result that is delivered
+    // in chunks. The DB requests of each resultItem are enqueued as soon as
+    // the item is complete. last is set on the final chunk of the result.
+    bool ReceiveChunk(DB *db, const char *data, size_t length, bool last,
+                      uint64_t sequence_number);
+    // Drops the part of a chunked poll result received so far, when its last
+    // chunk will not be received.
+    void ResetChunks();
 
     static IFMapServerParser *GetInstance(const std::string &module);
     static void DeleteInstance(const std::string &module);
@@ -47,8 +63,58 @@ private:
 
     bool ParseMetadata(const pugi::xml_node &node,
                        struct DBRequest *result) const;
+    void EnqueueRequests(DB *db, RequestList *requests,
+                         uint64_t sequence_number) const;
 
     MetadataParseMap metadata_map_;
+    boost::scoped_ptr<IFMapStreamParser> stream_;
+
+    DISALLOW_COPY_AND_ASSIGN(IFMapServerParser);
+};
+
+// Parser for a poll result that is received in chunks. Loading the complete
+// document into a DOM takes hundreds of MB for the initial poll result of a
+// large configuration and delays the first DB request until all of it has
+// been read. Instead, the markup is scanned for the resultItem elements of
+// the update, search and delete results and each item is loaded on its own,
+// as soon as its end tag has been received. Only the part of the data that
+// does not yet form a complete item is buffered.
+class IFMapStreamParser {
+public:
+    explicit IFMapStreamParser(const IFMapServerParser *parser);
+
+    // Consume the next chunk of the document. The requests of the items that
+    // are completed by the chunk are appended to list. Returns false if the
+    // document is not a valid poll result.
+    bool Parse(const char *data, size_t length,
+               IFMapServerParser::RequestList *list);
+    // Returns false if the document received so far is not complete.
+    bool Finish() const;
+
+    uint64_t bytes_received() const { return bytes_received_; }
+    size_t max_buffered() const { return max_buffered_; }
+    uint64_t items() const { return items_; }
+
+private:
+    size_t MarkupEnd(size_t pos) const;
+    size_t FindEnd(const char *marker, size_t pos) const;
+    bool NameIs(size_t name, size_t stop, const char *str) const;
+    bool ParseItem(size_t begin, size_t end,
+                   IFMapServerParser::RequestList *list);
+
+    const IFMapServerParser *parser_;
+    std::string buffer_;
+    size_t scan_;           // offset from which to look for the next tag
+    size_t item_start_;     // offset of the open resultItem, if any
+    bool in_result_;
+    bool add_change_;
+    bool poll_result_;
+    bool error_;
+    uint64_t bytes_received_;
+    size_t max_buffered_;
+    uint64_t items_;
+
+    DISALLOW_COPY_AND_ASSIGN(IFMapStreamParser);
 };
 
 #endif
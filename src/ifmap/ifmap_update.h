@@ -84,11 +84,19 @@ public:
     bool IsNode() const { return data_.IsNode(); }
     bool IsLink() const { return data_.IsLink(); }
 
+    // Encoded form of data(), filled by the sender the first time the update
+    // is put in a message and shared by all the clients in advertise(). It
+    // must be cleared whenever the contents of the object change.
+    const std::string &encoded() const { return encoded_; }
+    std::string *mutable_encoded() { return &encoded_; }
+    void ClearEncoded() { encoded_.clear(); }
+
 private:
     friend class IFMapState;
     boost::intrusive::slist_member_hook<> node_;
     IFMapObjectPtr data_;
     BitSet advertise_;
+    std::string encoded_;
 };
 
 struct IFMapMarker : public IFMapListEntry {
@@ -171,6 +179,7 @@ public:
     const BitSet &nmask() const { return nmask_; }
     void nmask_clear() { nmask_.clear(); }
     void nmask_set(int bit) { nmask_.set(bit); }
+    void nmask_or(const BitSet &bset) { nmask_ |= bset; }
 
 private:
     DEPENDENCY_LIST(IFMapLink, IFMapNodeState, dependents_);
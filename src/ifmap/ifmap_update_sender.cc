@@ -18,7 +18,8 @@ using namespace std;
 IFMapUpdateSender::IFMapUpdateSender(IFMapServer *server,
                                      IFMapUpdateQueue *queue)
     : server_(server), queue_(queue), message_(new IFMapMessage()),
-      task_scheduled_(false), queue_active_(false) {
+      task_scheduled_(false), queue_active_(false), messages_built_(0),
+      messages_sent_(0), bytes_sent_(0), snapshot_messages_sent_(0) {
 }
 
 IFMapUpdateSender::~IFMapUpdateSender() {
@@ -37,6 +38,11 @@ public:
         sender_->send_blocked_.Reset(send_scheduled);
         for (size_t i = send_scheduled.find_first(); i != BitSet::npos;
              i = send_scheduled.find_next(i)) {
+            // A client in initial sync moves on to the update queue only
+            // after all the messages of its snapshot are sent.
+            if (!sender_->SendSnapshot(i)) {
+                continue;
+            }
             // Dequeue from client marker (i).
             sender_->Send(sender_->queue_->GetMarker(i));
         }
@@ -83,11 +89,56 @@ void IFMapUpdateSender::GetSendScheduled(BitSet *current) {
 }
 
 void IFMapUpdateSender::CleanupClient(int index) {
+    // Not protected by mutex_, see snapshot_map_.
+    snapshot_map_.erase(index);
     tbb::mutex::scoped_lock lock(mutex_);
     send_scheduled_.reset(index);
     send_blocked_.reset(index);
 }
 
+void IFMapUpdateSender::EnqueueSnapshot(int index, MessageList *messages) {
+    if (messages->empty()) {
+        return;
+    }
+    MessageList &pending = snapshot_map_[index];
+    pending.splice(pending.end(), *messages);
+    SetSendBlocked(index);
+    SendActive(index);
+}
+
+// Send the pending snapshot messages of the client until it blocks. Returns
+// true if the client is ready for the update queue.
+bool IFMapUpdateSender::SendSnapshot(int index) {
+    SnapshotMap::iterator loc = snapshot_map_.find(index);
+    if (loc == snapshot_map_.end()) {
+        return true;
+    }
+    IFMapClient *client = server_->GetClient(index);
+    if (client == NULL) {
+        snapshot_map_.erase(loc);
+        return true;
+    }
+
+    MessageList &pending = loc->second;
+    bool send_result = true;
+    while (send_result && !pending.empty()) {
+        send_result = client->SendUpdate(pending.front());
+        if (send_result) {
+            messages_sent_++;
+            snapshot_messages_sent_++;
+            bytes_sent_ += pending.front().size();
+        }
+        pending.pop_front();
+    }
+    if (pending.empty()) {
+        snapshot_map_.erase(loc);
+    }
+    if (!send_result) {
+        send_blocked_.set(index);
+    }
+    return send_result;
+}
+
 // We return only under 2 conditions:
 // 1. All the clients in the marker are blocked.
 // 2. We have finished traversing the Q.
@@ -231,6 +282,7 @@ void IFMapUpdateSender::SendUpdate(BitSet send_set, BitSet *blocked_set) {
     bool send_result;
 
     assert(!message_->IsEmpty());
+    messages_built_++;
 
     for (size_t i = send_set.find_first(); i != BitSet::npos;
          i = send_set.find_next(i)) {
@@ -240,14 +292,18 @@ void IFMapUpdateSender::SendUpdate(BitSet send_set, BitSet *blocked_set) {
             continue;
         }
         message_->SetReceiverInMsg(client->identifier());
-        // Close the message to save the document as string
+        // Close the message to assemble the header for this client and the
+        // encoded objects into a string.
         message_->Close();
 
         // Send the string version of the message to the client.
-        send_result = client->SendUpdate(message_->c_str());
+        send_result = client->SendUpdate(message_->str());
 
         // Keep track of all the clients whose buffers are full. 
-        if (!send_result) {
+        if (send_result) {
+            messages_sent_++;
+            bytes_sent_ += message_->str().size();
+        } else {
             blocked_set->set(i);
             send_blocked_.set(i);
         }
@@ -5,6 +5,9 @@
 #ifndef __ctrlplane__ifmap_update_sender__
 #define __ctrlplane__ifmap_update_sender__
 
+#include <list>
+#include <map>
+#include <string>
 #include <tbb/mutex.h>
 #include "base/bitset.h"
 #include "ifmap/ifmap_encoder.h"
@@ -18,6 +21,8 @@ class IFMapUpdateQueue;
 
 class IFMapUpdateSender {
 public:
+    typedef std::list<std::string> MessageList;
+
     IFMapUpdateSender(IFMapServer *server, IFMapUpdateQueue *queue);
     virtual ~IFMapUpdateSender();
 
@@ -32,12 +37,32 @@ public:
 
     void CleanupClient(int index);
 
+    // Initial sync: the messages are sent to the client before anything in
+    // the update queue. The client is handled as blocked by the traversal of
+    // the queue until all of them have been sent.
+    void EnqueueSnapshot(int index, MessageList *messages);
+    bool IsSnapshotPending(int index) const {
+        return snapshot_map_.find(index) != snapshot_map_.end();
+    }
+
     void SetServer(IFMapServer *srv) { server_ = srv; }
 
     void SetObjectsPerMessage(int num) {
         message_->SetObjectsPerMessage(num);
     }
 
+    // Byte budget of the encoded objects in a single message. A message is
+    // flushed once either this or the objects-per-message limit is reached.
+    void SetMessageBytes(size_t bytes) {
+        message_->SetMessageBytes(bytes);
+    }
+
+    const IFMapMessage *message() const { return message_; }
+    uint64_t messages_built() const { return messages_built_; }
+    uint64_t messages_sent() const { return messages_sent_; }
+    uint64_t bytes_sent() const { return bytes_sent_; }
+    uint64_t snapshot_messages_sent() const { return snapshot_messages_sent_; }
+
     bool IsClientBlocked(int client_index) {
         return send_blocked_.test(client_index);
     }
@@ -45,12 +70,14 @@ public:
 private:
     class SendTask;
     friend class IFMapUpdateSenderTest;
+    typedef std::map<int, MessageList> SnapshotMap;
 
     void StartTask();
 
     void Send(IFMapMarker *imarker);
 
     void SendUpdate(BitSet send_set, BitSet *blocked_set);
+    bool SendSnapshot(int index);
 
     IFMapMarker* ProcessMarker(IFMapMarker *marker, IFMapMarker *next_marker,
                                bool *done); 
@@ -70,6 +97,15 @@ private:
     BitSet send_scheduled_;     // client-set for which send active was called
     BitSet send_blocked_;       // client-set for clients that are blocked
 
+    uint64_t messages_built_;   // messages encoded, one per send-set
+    uint64_t messages_sent_;    // messages accepted by the clients
+    uint64_t bytes_sent_;
+    uint64_t snapshot_messages_sent_;
+    // Pending initial sync messages per client. Only used by the client
+    // work of the server and the send task, which both run as db::DBTable
+    // instance 0, so it needs no lock.
+    SnapshotMap snapshot_map_;
+
     void SetSendBlocked(int client_index) {
         send_blocked_.set(client_index);
     }
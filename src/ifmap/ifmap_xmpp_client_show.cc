@@ -13,6 +13,7 @@
 #include "ifmap/ifmap_client.h"
 #include "ifmap/ifmap_sandesh_context.h"
 #include "ifmap/ifmap_server.h"
+#include "ifmap/ifmap_update_sender.h"
 #include "ifmap/ifmap_xmpp.h"
 #include "ifmap/ifmap_server_show_types.h" // sandesh
 
@@ -164,3 +165,48 @@ void IFMapXmppClientInfoShowReq::HandleRequest() const {
     ps.stages_= list_of(s0)(s1);
     RequestPipeline rp(ps);
 }
+
+static bool IFMapUpdateSenderShowReqHandleRequest(const Sandesh *sr,
+                const RequestPipeline::PipeSpec ps, int stage, int instNum,
+                RequestPipeline::InstData *data) {
+    const IFMapUpdateSenderShowReq *request =
+        static_cast<const IFMapUpdateSenderShowReq *>(ps.snhRequest_.get());
+    IFMapSandeshContext *sctx =
+        static_cast<IFMapSandeshContext *>(request->module_context("IFMap"));
+    IFMapUpdateSender *sender = sctx->ifmap_server()->sender();
+    const IFMapMessage *message = sender->message();
+
+    IFMapUpdateSenderInfo info;
+    info.set_objects_per_message(message->objects_per_message());
+    info.set_message_bytes(message->message_bytes());
+    info.set_messages_built(sender->messages_built());
+    info.set_messages_sent(sender->messages_sent());
+    info.set_bytes_sent(sender->bytes_sent());
+    info.set_encode_cache_hits(message->encode_cache_hits());
+    info.set_encode_cache_misses(message->encode_cache_misses());
+    info.set_snapshot_messages_sent(sender->snapshot_messages_sent());
+
+    IFMapUpdateSenderShowResp *response = new IFMapUpdateSenderShowResp();
+    response->set_sender_stats(info);
+    response->set_context(request->context());
+    response->set_more(false);
+    response->Response();
+
+    // Return 'true' so that we are not called again
+    return true;
+}
+
+// The sender runs in db::DBTable instance 0, so read its counters there.
+void IFMapUpdateSenderShowReq::HandleRequest() const {
+
+    RequestPipeline::StageSpec s0;
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+
+    s0.taskId_ = scheduler->GetTaskId("db::DBTable");
+    s0.cbFn_ = IFMapUpdateSenderShowReqHandleRequest;
+    s0.instances_.push_back(0);
+
+    RequestPipeline::PipeSpec ps(this);
+    ps.stages_= list_of(s0);
+    RequestPipeline rp(ps);
+}
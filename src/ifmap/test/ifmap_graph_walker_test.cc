@@ -7,6 +7,9 @@
 #include <fstream>
 
 #include "base/logging.h"
+#include "base/string_util.h"
+#include "base/time_util.h"
+#include "base/util.h"
 #include "base/test/task_test_util.h"
 #include "control-node/control_node.h"
 #include "db/db.h"
@@ -54,6 +57,50 @@ protected:
         evm_.Shutdown();
     }
 
+    // Client i has vr<i> -> vm<i> -> vmi<i>, with all the vmis on the
+    // shared virtual-network blue.
+    void AddClients(vector<IFMapClientMock *> *clients, size_t count) {
+        for (size_t i = clients->size(); i < count; i++) {
+            string id = integerToString(i);
+            ifmap_test_util::IFMapMsgLink(&db_, "virtual-router", "vr" + id,
+                "virtual-machine", "vm" + id,
+                "virtual-router-virtual-machine");
+            ifmap_test_util::IFMapMsgLink(&db_, "virtual-machine", "vm" + id,
+                "virtual-machine-interface", "vmi" + id,
+                "virtual-machine-virtual-machine-interface");
+            ifmap_test_util::IFMapMsgLink(&db_,
+                "virtual-machine-interface", "vmi" + id,
+                "virtual-network", "blue",
+                "virtual-machine-interface-virtual-network");
+            IFMapClientMock *client = new IFMapClientMock("vr" + id);
+            clients->push_back(client);
+            server_.AddClient(client);
+        }
+        task_util::WaitForIdle();
+    }
+
+    // Remove and add back the link from blue to its routing-instance, which
+    // all the clients are interested in. Returns the time taken by the
+    // removal, in usec.
+    uint64_t ToggleRoutingInstance(const vector<IFMapClientMock *> &clients) {
+        uint64_t start = ClockMonotonicUsec();
+        ifmap_test_util::IFMapMsgUnlink(&db_, "virtual-network", "blue",
+            "routing-instance", "blue-ri", "virtual-network-routing-instance");
+        task_util::WaitForIdle();
+        uint64_t elapsed = ClockMonotonicUsec() - start;
+        for (size_t i = 0; i < clients.size(); i++) {
+            EXPECT_EQ(0, clients[i]->NodeKeyCount("routing-instance"));
+        }
+
+        ifmap_test_util::IFMapMsgLink(&db_, "virtual-network", "blue",
+            "routing-instance", "blue-ri", "virtual-network-routing-instance");
+        task_util::WaitForIdle();
+        for (size_t i = 0; i < clients.size(); i++) {
+            EXPECT_EQ(1, clients[i]->NodeKeyCount("routing-instance"));
+        }
+        return elapsed;
+    }
+
     string FileRead(const string &filename) {
         ifstream file(filename.c_str());
         string content((istreambuf_iterator<char>(file)),
@@ -656,6 +703,87 @@ TEST_F(IFMapGraphWalkerTest, VrsubConfignoprop) {
     c1.PrintNodes();
 }
 
+// Removal of a link that all the clients are interested in, with the
+// interest recomputed per client and with the BitSet traversal. The default
+// size is small; set IFMAP_GRAPH_WALKER_TEST_MAX_CLIENTS=2000 for a full run.
+TEST_F(IFMapGraphWalkerTest, ScaleLinkRemove) {
+    static const size_t kClientCounts[] = { 10, 100, 500, 1000, 2000 };
+    size_t max_clients = 100;
+    char *str = getenv("IFMAP_GRAPH_WALKER_TEST_MAX_CLIENTS");
+    if (str) max_clients = strtoul(str, NULL, 0);
+
+    ifmap_test_util::IFMapMsgLink(&db_, "virtual-network", "blue",
+        "routing-instance", "blue-ri", "virtual-network-routing-instance");
+    vector<IFMapClientMock *> clients;
+    for (size_t i = 0; i < sizeof(kClientCounts) / sizeof(kClientCounts[0]);
+         i++) {
+        if (kClientCounts[i] > max_clients) {
+            break;
+        }
+        AddClients(&clients, kClientCounts[i]);
+        for (size_t j = 0; j < clients.size(); j++) {
+            TASK_UTIL_EXPECT_EQ(1,
+                clients[j]->NodeKeyCount("routing-instance"));
+        }
+
+        IFMapGraphWalker::set_bitset_traversal(false);
+        uint64_t per_client = ToggleRoutingInstance(clients);
+        IFMapGraphWalker::set_bitset_traversal(true);
+        uint64_t bitset = ToggleRoutingInstance(clients);
+        LOG(DEBUG, clients.size() << " clients: per client traversal "
+            << per_client / 1000 << " msec, bitset traversal "
+            << bitset / 1000 << " msec");
+    }
+
+    STLDeleteValues(&clients);
+}
+
+// Removal of a link that all the clients are interested in, when the node
+// behind it is still reachable through another path by half of the clients.
+// Those clients keep the node with either traversal.
+TEST_F(IFMapGraphWalkerTest, LinkRemoveOtherPath) {
+    static const size_t kClientCount = 20;
+    ifmap_test_util::IFMapMsgLink(&db_, "virtual-network", "blue",
+        "routing-instance", "blue-ri", "virtual-network-routing-instance");
+    vector<IFMapClientMock *> clients;
+    AddClients(&clients, kClientCount);
+
+    // The even clients also reach blue-ri through the red network.
+    ifmap_test_util::IFMapMsgLink(&db_, "virtual-network", "red",
+        "routing-instance", "blue-ri", "virtual-network-routing-instance");
+    for (size_t i = 0; i < clients.size(); i += 2) {
+        ifmap_test_util::IFMapMsgLink(&db_,
+            "virtual-machine-interface", "vmi" + integerToString(i),
+            "virtual-network", "red",
+            "virtual-machine-interface-virtual-network");
+    }
+    task_util::WaitForIdle();
+    for (size_t i = 0; i < clients.size(); i++) {
+        TASK_UTIL_EXPECT_EQ(1, clients[i]->NodeKeyCount("routing-instance"));
+    }
+
+    bool traversals[] = { false, true };
+    for (size_t t = 0; t < sizeof(traversals) / sizeof(traversals[0]); t++) {
+        IFMapGraphWalker::set_bitset_traversal(traversals[t]);
+        ifmap_test_util::IFMapMsgUnlink(&db_, "virtual-network", "blue",
+            "routing-instance", "blue-ri", "virtual-network-routing-instance");
+        task_util::WaitForIdle();
+        for (size_t i = 0; i < clients.size(); i++) {
+            size_t expected = (i % 2 == 0) ? 1 : 0;
+            EXPECT_EQ(expected, clients[i]->NodeKeyCount("routing-instance"));
+        }
+
+        ifmap_test_util::IFMapMsgLink(&db_, "virtual-network", "blue",
+            "routing-instance", "blue-ri", "virtual-network-routing-instance");
+        task_util::WaitForIdle();
+        for (size_t i = 0; i < clients.size(); i++) {
+            EXPECT_EQ(1, clients[i]->NodeKeyCount("routing-instance"));
+        }
+    }
+
+    STLDeleteValues(&clients);
+}
+
 // Calculate the white list filter information based on the xsd.
 TEST_F(IFMapGraphWalkerTest, PopulateWhiteList) {
     // Populate 'filter_info' with information from the xsd
@@ -5,8 +5,11 @@
 #include "ifmap/ifmap_server_parser.h"
 
 #include <fstream>
+#include <sstream>
+#include <pugixml/pugixml.hpp>
 #include "base/logging.h"
 #include "base/test/task_test_util.h"
+#include "base/time_util.h"
 #include "control-node/control_node.h"
 #include "db/db.h"
 #include "db/db_graph.h"
@@ -1695,6 +1698,178 @@ TEST_F(IFMapServerParserTest, ServerParser16InParts) {
     EXPECT_TRUE(LinkLookup(vr1, vm1) != NULL);
 }
 
+// Same as ServerParser, with the message given to the parser in chunks.
+TEST_F(IFMapServerParserTest, ServerParserChunked) {
+    IFMapTable *table = IFMapTable::FindTable(&db_, "virtual-network");
+
+    string message =
+        FileRead("controller/src/ifmap/testdata/server_parser_test.xml");
+    assert(message.size() != 0);
+    static const size_t kChunkSize = 61;
+    for (size_t offset = 0; offset < message.size(); offset += kChunkSize) {
+        size_t length = min(kChunkSize, message.size() - offset);
+        bool last = ((offset + length) == message.size());
+        EXPECT_TRUE(parser_->ReceiveChunk(&db_, message.data() + offset,
+                                          length, last, 0));
+    }
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, table->Size());
+
+    IFMapNode *vn1 = NodeLookup("virtual-network", "vn1");
+    EXPECT_TRUE(vn1 != NULL);
+    IFMapObject *obj = vn1->Find(IFMapOrigin(IFMapOrigin::MAP_SERVER));
+    EXPECT_TRUE(obj != NULL);
+
+    IFMapNode *vn = NodeLookup("virtual-network", "vn2");
+    EXPECT_TRUE(vn == NULL);
+    vn = NodeLookup("virtual-network", "vn3");
+    EXPECT_TRUE(vn == NULL);
+    vn = NodeLookup("virtual-network", "vn4");
+    EXPECT_TRUE(vn == NULL);
+    vn = NodeLookup("virtual-network", "vn5");
+    EXPECT_TRUE(vn == NULL);
+}
+
+// An error result fails the chunked parse. The next poll result is parsed
+// from scratch.
+TEST_F(IFMapServerParserTest, ServerParserChunkedError) {
+    IFMapTable *table = IFMapTable::FindTable(&db_, "virtual-network");
+
+    string error("<pollResult><errorResult errorCode=\"InvalidSessionID\"/>");
+    EXPECT_FALSE(parser_->ReceiveChunk(&db_, error.data(), error.size(),
+                                       false, 0));
+
+    string message =
+        FileRead("controller/src/ifmap/testdata/server_parser_test.xml");
+    assert(message.size() != 0);
+    EXPECT_TRUE(parser_->ReceiveChunk(&db_, message.data(), message.size(),
+                                      true, 0));
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, table->Size());
+    EXPECT_TRUE(NodeLookup("virtual-network", "vn1") != NULL);
+}
+
+// A poll result whose last chunk is not received, because the connection went
+// down, is dropped on reset. The next poll result is parsed from scratch.
+TEST_F(IFMapServerParserTest, ServerParserChunkedReset) {
+    IFMapTable *table = IFMapTable::FindTable(&db_, "virtual-network");
+
+    string message =
+        FileRead("controller/src/ifmap/testdata/server_parser_test.xml");
+    assert(message.size() != 0);
+    size_t length = message.find("<resultItem");
+    ASSERT_NE(string::npos, length);
+    length += 5;
+    EXPECT_TRUE(parser_->ReceiveChunk(&db_, message.data(), length, false, 0));
+    parser_->ResetChunks();
+
+    EXPECT_TRUE(parser_->ReceiveChunk(&db_, message.data(), message.size(),
+                                      true, 0));
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, table->Size());
+    EXPECT_TRUE(NodeLookup("virtual-network", "vn1") != NULL);
+}
+
+// Resident set size of the process in kB.
+static size_t ResidentSetSize() {
+    ifstream file("/proc/self/status");
+    string line;
+    while (getline(file, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            return strtoul(line.c_str() + 6, NULL, 10);
+        }
+    }
+    return 0;
+}
+
+static const char kPollResultHeader[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<env:Envelope xmlns:env=\"http://www.w3.org/2003/05/soap-envelope\" "
+    "xmlns:ifmap=\"http://www.trustedcomputinggroup.org/2010/IFMAP/2\">"
+    "<env:Body><ifmap:response><pollResult><searchResult name=\"root\">\n";
+static const char kPollResultTrailer[] =
+    "</searchResult></pollResult></ifmap:response></env:Body>"
+    "</env:Envelope>\n";
+
+static void PollResultItemAppend(size_t index, string *result) {
+    ostringstream oss;
+    oss << "<resultItem><identity name=\"contrail:virtual-network:vn" << index
+        << "\" type=\"other\" other-type-definition=\"extended\"/>"
+        << "<metadata><contrail:id-perms "
+        << "xmlns:contrail=\"http://www.contrailsystems.com/vnc_cfg.xsd\" "
+        << "ifmap-cardinality=\"singleValue\"><uuid><uuid-mslong>" << index
+        << "</uuid-mslong><uuid-lslong>" << index << "</uuid-lslong></uuid>"
+        << "</contrail:id-perms></metadata></resultItem>\n";
+    result->append(oss.str());
+}
+
+// Parse a large poll result, as received on the initial sync of a large
+// config, both from a DOM of the complete document and in chunks as they are
+// read by the ifmap client. Compare the time until the first DB request is
+// available and the growth of the resident set size. The default size is
+// small; set IFMAP_SERVER_PARSER_TEST_POLL_RESULT_MB=500 for a full run.
+TEST_F(IFMapServerParserTest, LargePollResult) {
+    static const size_t kChunkSize = 1024 * 1024;
+    size_t result_mb = 4;
+    char *str = getenv("IFMAP_SERVER_PARSER_TEST_POLL_RESULT_MB");
+    if (str) result_mb = strtoul(str, NULL, 0);
+
+    string result(kPollResultHeader);
+    size_t item_count = 0;
+    while (result.size() < result_mb * 1024 * 1024) {
+        PollResultItemAppend(item_count++, &result);
+    }
+    result.append(kPollResultTrailer);
+
+    // The chunked parse runs first, so that the memory held by the DOM does
+    // not hide its own growth.
+    IFMapServerParser::RequestList requests;
+    IFMapStreamParser stream(parser_);
+    size_t rss_base = ResidentSetSize();
+    size_t stream_rss = rss_base;
+    uint64_t stream_first_usec = 0;
+    size_t stream_requests = 0;
+    uint64_t start = ClockMonotonicUsec();
+    for (size_t offset = 0; offset < result.size(); offset += kChunkSize) {
+        size_t length = min(kChunkSize, result.size() - offset);
+        EXPECT_TRUE(stream.Parse(result.data() + offset, length, &requests));
+        if (stream_first_usec == 0 && !requests.empty()) {
+            stream_first_usec = ClockMonotonicUsec() - start;
+        }
+        stream_requests += requests.size();
+        STLDeleteValues(&requests);
+        stream_rss = max(stream_rss, ResidentSetSize());
+    }
+    uint64_t stream_usec = ClockMonotonicUsec() - start;
+    EXPECT_TRUE(stream.Finish());
+    EXPECT_EQ(item_count, stream.items());
+    EXPECT_EQ(item_count, stream_requests);
+    EXPECT_GE(2 * kChunkSize, stream.max_buffered());
+    size_t stream_rss_mb = (stream_rss - rss_base) / 1024;
+
+    rss_base = ResidentSetSize();
+    size_t dom_rss;
+    start = ClockMonotonicUsec();
+    {
+        pugi::xml_document xdoc;
+        EXPECT_TRUE(xdoc.load_buffer(result.data(), result.size()));
+        parser_->ParseResults(xdoc, &requests);
+        dom_rss = ResidentSetSize();
+    }
+    uint64_t dom_usec = ClockMonotonicUsec() - start;
+    EXPECT_EQ(item_count, requests.size());
+    STLDeleteValues(&requests);
+    size_t dom_rss_mb = (max(dom_rss, rss_base) - rss_base) / 1024;
+
+    LOG(DEBUG, "Poll result of " << result.size() / (1024 * 1024) << " MB, "
+        << item_count << " items");
+    LOG(DEBUG, "  dom: first request after " << dom_usec / 1000 << " msec, "
+        << "rss +" << dom_rss_mb << " MB");
+    LOG(DEBUG, "  stream: first request after " << stream_first_usec / 1000
+        << " msec, done after " << stream_usec / 1000 << " msec, "
+        << "rss +" << stream_rss_mb << " MB, "
+        << stream.max_buffered() / 1024 << " KB buffered");
+}
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
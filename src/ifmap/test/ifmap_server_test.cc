@@ -7,6 +7,7 @@
 #include <fstream>
 #include "base/logging.h"
 #include "base/test/task_test_util.h"
+#include "base/time_util.h"
 #include "control-node/control_node.h"
 #include "db/db.h"
 #include "db/db_graph.h"
@@ -34,6 +35,28 @@ public:
 
 };
 
+// Client whose send buffer fills up with every message while blocked, as
+// the XMPP channel of an agent that is slow to read.
+class IFMapBlockingClientMock : public IFMapClientMock {
+public:
+    explicit IFMapBlockingClientMock(const string &addr)
+        : IFMapClientMock(addr), blocked_(true), messages_(0) {
+    }
+
+    virtual bool SendUpdate(const string &msg) {
+        IFMapClientMock::SendUpdate(msg);
+        messages_++;
+        return !blocked_;
+    }
+
+    void set_blocked(bool blocked) { blocked_ = blocked; }
+    int messages() const { return messages_; }
+
+private:
+    bool blocked_;
+    int messages_;
+};
+
 class IFMapServerTest : public ::testing::Test {
   protected:
     IFMapServerTest()
@@ -170,6 +193,161 @@ TEST_F(IFMapServerTest, ClientUnregister) {
     delete c1;
 }
 
+// Config of a virtual-router with vm_count virtual-machines, each with an
+// interface in one of net_count networks. That is 2 nodes and 3 links per
+// virtual-machine.
+static void IFMapVRouterConfig(DB *db, const string &vrouter, int vm_count,
+                               int net_count, int first_vm) {
+    ifmap_test_util::IFMapMsgLink(db, "config-root", "root",
+                                  "virtual-router", vrouter,
+                                  "config-root-virtual-router");
+    for (int i = first_vm; i < first_vm + vm_count; ++i) {
+        ostringstream oss;
+        oss << vrouter << ":vm" << i;
+        string vm_id(oss.str());
+        string vmi_id(vm_id + ":eth0");
+        oss.str("");
+        oss << vrouter << ":net" << (i % net_count);
+        string network(oss.str());
+        ifmap_test_util::IFMapMsgLink(db, "virtual-router", vrouter,
+                                      "virtual-machine", vm_id,
+                                      "virtual-router-virtual-machine");
+        ifmap_test_util::IFMapMsgLink(db, "virtual-machine", vm_id,
+            "virtual-machine-interface", vmi_id,
+            "virtual-machine-virtual-machine-interface");
+        ifmap_test_util::IFMapMsgLink(db, "virtual-machine-interface", vmi_id,
+            "virtual-network", network,
+            "virtual-machine-interface-virtual-network");
+    }
+}
+
+// Agents that connect after their config is in place, as after a restart of
+// the control-node. The first one gets its config through the update queue
+// and the second one through the initial sync. Both must end up with the
+// same config, and later changes must still be sent incrementally. The
+// default size is small; set IFMAP_SERVER_TEST_SYNC_OBJECT_COUNT=100000 for a
+// full run.
+TEST_F(IFMapServerTest, InitialSync) {
+    static const int kNetCount = 8;
+    int object_count = 500;
+    char *str = getenv("IFMAP_SERVER_TEST_SYNC_OBJECT_COUNT");
+    if (str) object_count = strtoul(str, NULL, 0);
+    int vm_count = object_count / 5;
+
+    IFMapVRouterConfig(&db_, "incremental", vm_count, kNetCount, 0);
+    IFMapVRouterConfig(&db_, "snapshot", vm_count, kNetCount, 0);
+    task_util::WaitForIdle();
+    int node_count = 1 + 2 * vm_count + kNetCount;
+    int link_count = 3 * vm_count;
+
+    IFMapClientMock *c1 = new IFMapClientMock("incremental");
+    uint64_t start = ClockMonotonicUsec();
+    server_.AddClient(c1);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_TRUE(server_.queue()->empty());
+    uint64_t incremental_usec = ClockMonotonicUsec() - start;
+    TASK_UTIL_EXPECT_EQ(node_count, c1->node_count());
+    TASK_UTIL_EXPECT_EQ(link_count, c1->link_count());
+
+    server_.set_initial_sync(true);
+    uint64_t snapshot_messages = server_.sender()->snapshot_messages_sent();
+    IFMapClientMock *c2 = new IFMapClientMock("snapshot");
+    start = ClockMonotonicUsec();
+    server_.AddClient(c2);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_TRUE(server_.queue()->empty());
+    uint64_t snapshot_usec = ClockMonotonicUsec() - start;
+    TASK_UTIL_EXPECT_EQ(node_count, c2->node_count());
+    TASK_UTIL_EXPECT_EQ(link_count, c2->link_count());
+    TASK_UTIL_EXPECT_EQ(node_count + link_count, c2->count());
+    EXPECT_TRUE(c2->NodeExists("virtual-router", "snapshot"));
+    EXPECT_TRUE(c2->LinkExists("virtual-router", "virtual-machine",
+                               "snapshot", "snapshot:vm0"));
+    EXPECT_LT(snapshot_messages, server_.sender()->snapshot_messages_sent());
+    EXPECT_FALSE(server_.sender()->IsSnapshotPending(c2->index()));
+
+    LOG(DEBUG, "Initial sync of " << (node_count + link_count) << " objects: "
+        << "incremental " << incremental_usec / 1000 << " msec, "
+        << "snapshot " << snapshot_usec / 1000 << " msec, "
+        << server_.sender()->snapshot_messages_sent() - snapshot_messages
+        << " messages");
+
+    // A virtual-machine added after the initial sync.
+    IFMapVRouterConfig(&db_, "snapshot", 1, kNetCount, vm_count);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_TRUE(server_.queue()->empty());
+    TASK_UTIL_EXPECT_EQ(node_count + 2, c2->node_count());
+    TASK_UTIL_EXPECT_EQ(link_count + 3, c2->link_count());
+    TASK_UTIL_EXPECT_EQ(node_count, c1->node_count());
+
+    server_.DeleteClient(c1);
+    server_.DeleteClient(c2);
+    task_util::WaitForIdle();
+    usleep(1000);
+    delete c2;
+    delete c1;
+}
+
+// A client that blocks during the initial sync gets the rest of the snapshot
+// each time its channel is ready again, and the update queue only after it.
+TEST_F(IFMapServerTest, InitialSyncBlocked) {
+    static const int kVmCount = 50;
+    static const int kNetCount = 4;
+    IFMapVRouterConfig(&db_, "blocked", kVmCount, kNetCount, 0);
+    task_util::WaitForIdle();
+    int node_count = 1 + 2 * kVmCount + kNetCount;
+    int link_count = 3 * kVmCount;
+
+    server_.set_initial_sync(true);
+    server_.sender()->SetMessageBytes(1024);
+    IFMapUpdateSender *sender = server_.sender();
+    uint64_t snapshot_messages = sender->snapshot_messages_sent();
+    IFMapBlockingClientMock *c1 = new IFMapBlockingClientMock("blocked");
+    server_.AddClient(c1);
+    task_util::WaitForIdle();
+
+    // The first message fills the buffer of the client.
+    EXPECT_EQ(1, c1->messages());
+    EXPECT_TRUE(sender->IsSnapshotPending(c1->index()));
+    EXPECT_TRUE(sender->IsClientBlocked(c1->index()));
+    EXPECT_EQ(snapshot_messages, sender->snapshot_messages_sent());
+
+    // Changes made in the meantime wait for the snapshot.
+    IFMapVRouterConfig(&db_, "blocked", 1, kNetCount, kVmCount);
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, c1->messages());
+
+    // Ready again, but blocks after one more message.
+    sender->SendActive(c1->index());
+    task_util::WaitForIdle();
+    EXPECT_EQ(2, c1->messages());
+    EXPECT_TRUE(sender->IsSnapshotPending(c1->index()));
+    EXPECT_EQ(snapshot_messages, sender->snapshot_messages_sent());
+
+    // Ready and no longer blocking: the rest of the snapshot is sent, and
+    // then the changes from the update queue.
+    c1->set_blocked(false);
+    sender->SendActive(c1->index());
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_TRUE(server_.queue()->empty());
+    EXPECT_FALSE(sender->IsSnapshotPending(c1->index()));
+    EXPECT_FALSE(sender->IsClientBlocked(c1->index()));
+    EXPECT_LT(snapshot_messages, sender->snapshot_messages_sent());
+    EXPECT_GT(c1->messages() - 2,
+              (int) (sender->snapshot_messages_sent() - snapshot_messages));
+    TASK_UTIL_EXPECT_EQ(node_count + 2, c1->node_count());
+    TASK_UTIL_EXPECT_EQ(link_count + 3, c1->link_count());
+    EXPECT_TRUE(c1->LinkExists("virtual-router", "virtual-machine",
+                               "blocked", "blocked:vm0"));
+    EXPECT_TRUE(c1->LinkExists("virtual-router", "virtual-machine", "blocked",
+                               "blocked:vm50"));
+
+    server_.DeleteClient(c1);
+    task_util::WaitForIdle();
+    usleep(1000);
+    delete c1;
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     LoggingInit();
@@ -22,6 +22,8 @@
 #include "schema/vnc_cfg_types.h"
 #include "testing/gunit.h"
 
+#include <pugixml/pugixml.hpp>
+
 using namespace std;
 
 class TestClient : public IFMapClient {
@@ -37,10 +39,12 @@ public:
     virtual bool SendUpdate(const std::string &msg) {
         cout << "Sending " << endl << msg << endl;
         send_update_cnt_++;
+        last_msg_ = msg;
         return send_success_;
     }
 
     int get_send_update_cnt() { return send_update_cnt_; }
+    const string &last_msg() const { return last_msg_; }
 
     // Control if you want to block or continue sending
     void set_send_success(bool succ) { send_success_ = succ; }
@@ -49,6 +53,7 @@ private:
     string identifier_;
     bool send_success_;
     int send_update_cnt_;
+    string last_msg_;
 };
 
 struct IFMapUpdateDeleter {
@@ -1205,6 +1210,101 @@ TEST_F(IFMapUpdateSenderTest, Bug228) {
     queue_->PrintQueue();
 }
 
+// An update advertised to clients that are at different points in the Q is
+// encoded only once and the cached encoding is used for the later client.
+TEST_F(IFMapUpdateSenderTest, EncodeCacheSharedAcrossClients) {
+    TestClient c0("c0");
+    TestClient c1("c1");
+    server_.ClientRegister(&c0);
+    server_.ClientRegister(&c1);
+
+    IFMapUpdate *u1 = CreateUpdate("u1", true);
+    BitSet cli_bs;
+    cli_bs.set(c0.index());
+    cli_bs.set(c1.index());
+    u1->AdvertiseOr(cli_bs);
+
+    queue_->Join(c0.index());
+    queue_->Join(c1.index());
+    queue_->Enqueue(u1);
+
+    // c1 is blocked and gets split out while c0 consumes u1.
+    SetSendBlocked(c1.index());
+    sender_->SendActive(c0.index());
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, c0.get_send_update_cnt());
+    TASK_UTIL_EXPECT_EQ(0, c1.get_send_update_cnt());
+    EXPECT_FALSE(u1->encoded().empty());
+    EXPECT_EQ(0U, sender_->message()->encode_cache_hits());
+    EXPECT_EQ(1U, sender_->message()->encode_cache_misses());
+
+    sender_->SendActive(c1.index());
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, c1.get_send_update_cnt());
+    TASK_UTIL_EXPECT_EQ(1, queue_->size());
+    EXPECT_EQ(1U, sender_->message()->encode_cache_hits());
+    EXPECT_EQ(1U, sender_->message()->encode_cache_misses());
+    EXPECT_EQ(2U, sender_->messages_built());
+    EXPECT_EQ(2U, sender_->messages_sent());
+    EXPECT_EQ(c0.last_msg().size() + c1.last_msg().size(),
+              sender_->bytes_sent());
+
+    // Both messages are well formed and differ only in the receiver.
+    pugi::xml_document doc;
+    ASSERT_TRUE(doc.load_buffer(c1.last_msg().data(), c1.last_msg().size()));
+    pugi::xml_node iq = doc.child("iq");
+    EXPECT_EQ(string("c1/config"), iq.attribute("to").value());
+    pugi::xml_node node = iq.child("config").child("update").child("node");
+    EXPECT_EQ(string("virtual-network"), node.attribute("type").value());
+    EXPECT_EQ(string("u1"), node.child("name").child_value());
+    string c0_msg(c0.last_msg());
+    c0_msg.replace(c0_msg.find("c0/config"), 2, "c1");
+    EXPECT_EQ(c1.last_msg(), c0_msg);
+
+    queue_->Leave(c0.index());
+    queue_->Leave(c1.index());
+}
+
+// The byte budget flushes the message before the objects-per-message limit.
+TEST_F(IFMapUpdateSenderTest, MessageByteBudget) {
+    TestClient c0("c0");
+    server_.ClientRegister(&c0);
+
+    IFMapUpdate *u1 = CreateUpdate("u1", true);
+    IFMapUpdate *u2 = CreateUpdate("u2", false);
+    IFMapUpdate *u3 = CreateUpdate("u3", true);
+    IFMapUpdate *u4 = CreateUpdate("u4", true);
+
+    BitSet cli_bs;
+    cli_bs.set(c0.index());
+    u1->AdvertiseOr(cli_bs);
+    u2->AdvertiseOr(cli_bs);
+    u3->AdvertiseOr(cli_bs);
+    u4->AdvertiseOr(cli_bs);
+
+    queue_->Join(c0.index());
+    queue_->Enqueue(u1);
+    queue_->Enqueue(u2);
+    queue_->Enqueue(u3);
+    queue_->Enqueue(u4);
+
+    // Every object exceeds the budget, so each goes in its own message.
+    sender_->SetMessageBytes(1);
+    sender_->SendActive(c0.index());
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, queue_->size());
+    TASK_UTIL_EXPECT_EQ(4, c0.get_send_update_cnt());
+    EXPECT_EQ(4U, sender_->messages_sent());
+
+    pugi::xml_document doc;
+    ASSERT_TRUE(doc.load_buffer(c0.last_msg().data(), c0.last_msg().size()));
+    pugi::xml_node node =
+        doc.child("iq").child("config").child("update").child("node");
+    EXPECT_EQ(string("u4"), node.child("name").child_value());
+
+    queue_->Leave(c0.index());
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     bool success = RUN_ALL_TESTS();
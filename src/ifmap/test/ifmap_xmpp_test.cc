@@ -28,6 +28,7 @@
 #include "ifmap/ifmap_update_sender.h"
 #include "ifmap/ifmap_uuid_mapper.h"
 #include "ifmap/ifmap_xmpp.h"
+#include "ifmap/test/ifmap_test_util.h"
 #include "schema/vnc_cfg_types.h"
 #include "io/event_manager.h"
 #include "io/test/event_manager_test.h"
@@ -241,8 +242,8 @@ public:
         return;
     }
 
-    // This logic works since we have SetObjectsPerMessage as 1. Otherwise, we
-    // will need another loop after accessing 'config'.
+    // Walks all the objects of the message, so that messages with more than
+    // one object, as sent in an initial sync, are handled too.
     void XmlDocWalk(pugi::xml_node xnode, ObjectSet *oset) {
         string node_name = xnode.name();
         assert(node_name.compare("iq") == 0);
@@ -251,20 +252,40 @@ public:
         node_name = cnode.name();
         assert(node_name.compare("config") == 0);
 
-        cnode = cnode.first_child();
-        node_name = cnode.name();
-        assert((node_name.compare("update") == 0) ||
-               (node_name.compare("delete") == 0));
+        for (pugi::xml_node onode = cnode.first_child(); onode;
+             onode = onode.next_sibling()) {
+            node_name = onode.name();
+            assert((node_name.compare("update") == 0) ||
+                   (node_name.compare("delete") == 0));
+
+            for (pugi::xml_node child = onode.first_child(); child;
+                 child = child.next_sibling()) {
+                node_name = child.name();
+                if (node_name.compare("node") == 0) {
+                    ProcessNodeTag(child, oset);
+                } else if (node_name.compare("link") == 0) {
+                    ProcessLinkTag(child);
+                } else {
+                    assert(0);
+                }
+            }
+        }
+    }
 
-        cnode = cnode.first_child();
-        node_name = cnode.name();
-        if (node_name.compare("node") == 0) {
-            ProcessNodeTag(cnode, oset);
-        } else if (node_name.compare("link") == 0) {
-            ProcessLinkTag(cnode);
-        } else {
-            assert(0);
+    // Whether a node of the given type and name was received
+    bool NodeReceived(const string &type, const string &name) {
+        pugi::xml_document doc;
+        ObjectSet oset;
+        pugi::xml_parse_result result =
+            doc.load_buffer(recv_buffer_.c_str(), recv_buffer_.size());
+        if (!result) {
+            return false;
+        }
+        for (pugi::xml_node child = doc.first_child(); child;
+            child = child.next_sibling()) {
+            XmlDocWalk(child, &oset);
         }
+        return oset.find(type + name) != oset.end();
     }
 
     void OutputRecvBufferToFile() {
@@ -4131,6 +4152,89 @@ TEST_F(XmppIfmapTest, NodePropertyChanges) {
     TASK_UTIL_EXPECT_TRUE(xmpp_server_->FindConnection(client_name) == NULL);
 }
 
+// Config of a virtual-machine with an interface in net0 on the
+// virtual-router.
+static void VRouterVmAdd(DB *db, const string &vrouter, const string &vm_id) {
+    string vmi_id(vm_id + ":eth0");
+    ifmap_test_util::IFMapMsgLink(db, "virtual-router", vrouter,
+                                  "virtual-machine", vm_id,
+                                  "virtual-router-virtual-machine");
+    ifmap_test_util::IFMapMsgLink(db, "virtual-machine", vm_id,
+                                  "virtual-machine-interface", vmi_id,
+                                  "virtual-machine-virtual-machine-interface");
+    ifmap_test_util::IFMapMsgLink(db, "virtual-machine-interface", vmi_id,
+                                  "virtual-network", "net0",
+                                  "virtual-machine-interface-virtual-network");
+}
+
+// With initial sync, the config in place when the agent subscribes is sent
+// in a snapshot over the XMPP channel, and the config added afterwards is
+// sent incrementally.
+TEST_F(XmppIfmapTest, InitialSync) {
+    ifmap_server_.set_initial_sync(true);
+    IFMapUpdateSender *sender = ifmap_server_.sender();
+    uint64_t snapshot_messages = sender->snapshot_messages_sent();
+
+    string client_name =
+        string("default-global-system-config:a1s27.contrail.juniper.net");
+    VRouterVmAdd(&db_, client_name, "aa01");
+    VRouterVmAdd(&db_, client_name, "aa02");
+    task_util::WaitForIdle();
+
+    XmppVnswMockPeer *vnsw_client =
+        new XmppVnswMockPeer(&evm_, xmpp_server_->GetPort(), client_name,
+                string("127.0.0.1"), string("/tmp/InitialSync.output"));
+    TASK_UTIL_EXPECT_EQ(true, vnsw_client->IsEstablished());
+    vnsw_client->RegisterWithXmpp();
+    TASK_UTIL_EXPECT_TRUE(ServerIsEstablished(xmpp_server_, client_name));
+
+    vnsw_client->SendConfigSubscribe();
+    TASK_UTIL_EXPECT_TRUE(ifmap_server_.FindClient(client_name) != NULL);
+    IFMapClient *client = ifmap_server_.FindClient(client_name);
+    TASK_UTIL_EXPECT_FALSE(sender->IsSnapshotPending(client->index()));
+    TASK_UTIL_EXPECT_NE(0, vnsw_client->Count());
+    TASK_UTIL_EXPECT_EQ(client->msgs_sent(), vnsw_client->Count());
+    uint64_t messages = vnsw_client->Count();
+    EXPECT_LT(snapshot_messages, sender->snapshot_messages_sent());
+    EXPECT_EQ(6U, client->nodes_sent());
+    EXPECT_EQ(6U, client->links_sent());
+    EXPECT_TRUE(vnsw_client->NodeReceived("virtual-router", client_name));
+    EXPECT_TRUE(vnsw_client->NodeReceived("virtual-machine", "aa01"));
+    EXPECT_TRUE(vnsw_client->NodeReceived("virtual-machine-interface",
+                                          "aa02:eth0"));
+    EXPECT_TRUE(vnsw_client->NodeReceived("virtual-network", "net0"));
+
+    // A virtual-machine added after the initial sync.
+    snapshot_messages = sender->snapshot_messages_sent();
+    VRouterVmAdd(&db_, client_name, "aa03");
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(8U, client->nodes_sent());
+    TASK_UTIL_EXPECT_EQ(9U, client->links_sent());
+    TASK_UTIL_EXPECT_EQ(client->msgs_sent(), vnsw_client->Count());
+    EXPECT_LT(messages, vnsw_client->Count());
+    EXPECT_EQ(snapshot_messages, sender->snapshot_messages_sent());
+    EXPECT_TRUE(vnsw_client->NodeReceived("virtual-machine", "aa03"));
+
+    // Client close generates a TcpClose event on server
+    ConfigUpdate(vnsw_client, new XmppConfigData());
+    TASK_UTIL_EXPECT_EQ(ifmap_server_.GetClientMapSize(), 0);
+    EXPECT_EQ(true, IsIFMapClientUnregistered(&ifmap_server_, client_name));
+
+    vnsw_client->UnRegisterWithXmpp();
+    vnsw_client->Shutdown();
+    task_util::WaitForIdle();
+    TcpServerManager::DeleteServer(vnsw_client);
+    vnsw_client = NULL;
+
+    // Delete xmpp-channel explicitly
+    XmppConnection *sconnection = xmpp_server_->FindConnection(client_name);
+    if (sconnection) {
+        sconnection->Shutdown();
+    }
+    TASK_UTIL_EXPECT_EQ(xmpp_server_->ConnectionCount(), 0);
+    EXPECT_TRUE(xmpp_server_->FindConnection(client_name) == NULL);
+}
+
 }
 
 static void SetUp() {
@@ -17,6 +17,7 @@
 #include <boost/bind.hpp>
 
 #include <base/logging.h>
+#include <base/time_util.h>
 #include <db/db.h>
 #include <db/db_entry.h>
 #include <db/db_table.h>
@@ -49,6 +50,9 @@ std::vector<KSyncSock *> KSyncSock::sock_table_;
 pid_t KSyncSock::pid_;
 tbb::atomic<bool> KSyncSock::shutdown_;
 
+// Upper bound on the netlink headers and padding added to a message
+static const uint32_t kBatchMsgOverhead = 32;
+
 const char* IoContext::io_wq_names[IoContext::MAX_WORK_QUEUES] = 
                                                 {"Agent::KSync", "Agent::Uve"};
 
@@ -202,6 +206,23 @@ size_t KSyncSockNetlink::SendTo(const char *data, uint32_t data_len,
     return ret_val;
 }
 
+// The kernel walks the messages in a buffer at NLMSG_ALIGN boundaries
+uint32_t KSyncSockNetlink::EncodeBatchMsg(char *buf, uint32_t buf_len,
+                                          IoContext *ioc) {
+    return EncodeNetlinkMsg(buf, buf_len, ioc->GetMsg(), ioc->GetMsgLen(),
+                            ioc->GetSeqno(), true);
+}
+
+void KSyncSockNetlink::AsyncSendBatch(char *buf, uint32_t len, HandlerCb cb) {
+    boost::asio::netlink::raw::endpoint ep;
+    sock_.async_send_to(buffer(buf, len), ep, cb);
+}
+
+size_t KSyncSockNetlink::SendBatchTo(const char *buf, uint32_t len) {
+    boost::asio::netlink::raw::endpoint ep;
+    return sock_.send_to(buffer(buf, len), ep);
+}
+
 void KSyncSockNetlink::AsyncReceive(mutable_buffers_1 buf, HandlerCb cb) {
     sock_.async_receive(buf, cb);
 }
@@ -437,6 +458,24 @@ size_t KSyncSockTcp::SendTo(const char *data, uint32_t data_len,
     return total_length;
 }
 
+// Messages are framed by nlmsg_len on the stream, no padding is added
+uint32_t KSyncSockTcp::EncodeBatchMsg(char *buf, uint32_t buf_len,
+                                      IoContext *ioc) {
+    return EncodeNetlinkMsg(buf, buf_len, ioc->GetMsg(), ioc->GetMsgLen(),
+                            ioc->GetSeqno(), false);
+}
+
+void KSyncSockTcp::AsyncSendBatch(char *buf, uint32_t len, HandlerCb cb) {
+    // TcpSession copies the data, so the buffer is released right away
+    session_->Send((const uint8_t *)buf, len, NULL);
+    cb(boost::system::error_code(), len);
+}
+
+size_t KSyncSockTcp::SendBatchTo(const char *buf, uint32_t len) {
+    session_->Send((const uint8_t *)buf, len, NULL);
+    return len;
+}
+
 void KSyncSockTcp::AsyncReceive(mutable_buffers_1 buf, HandlerCb cb) {
     //Data would be read from ksync tcp session
     //hence no socket operation would be required
@@ -551,7 +590,8 @@ int KSyncSockTcpSessionReader::MsgLength(Buffer buffer, int offset) {
     return nlh->nlmsg_len;
 }
 
-KSyncSock::KSyncSock() : tx_count_(0), err_count_(0), run_sync_mode_(true) {
+KSyncSock::KSyncSock() : tx_count_(0), err_count_(0), run_sync_mode_(true),
+    batch_mode_(false), tx_batch_bytes_(0) {
     for(int i = 0; i < IoContext::MAX_WORK_QUEUES; i++) {
         receive_work_queue[i] = new WorkQueue<char *>(TaskScheduler::GetInstance()->
                              GetTaskId(IoContext::io_wq_names[i]), 0,
@@ -568,6 +608,7 @@ KSyncSock::KSyncSock() : tx_count_(0), err_count_(0), run_sync_mode_(true) {
 
 KSyncSock::~KSyncSock() {
     assert(wait_tree_.size() == 0);
+    STLDeleteValues(&tx_batch_);
 
     if (rx_buff_) {
         delete [] rx_buff_;
@@ -584,10 +625,11 @@ KSyncSock::~KSyncSock() {
     }
 }
 
-void KSyncSock::Start(bool run_sync_mode) {
+void KSyncSock::Start(bool run_sync_mode, bool batch_mode) {
     for (std::vector<KSyncSock *>::iterator it = sock_table_.begin();
          it != sock_table_.end(); ++it) {
         (*it)->run_sync_mode_ = run_sync_mode;
+        (*it)->batch_mode_ = (batch_mode && (*it)->IsBatchSupported());
         if ((*it)->run_sync_mode_) {
             continue;
         }
@@ -601,6 +643,42 @@ void KSyncSock::Start(bool run_sync_mode) {
     }
 }
 
+uint32_t KSyncSock::EncodeNetlinkMsg(char *buf, uint32_t buf_len,
+                                     const char *data, uint32_t data_len,
+                                     uint32_t seq_no, bool align) {
+    struct nl_client cl;
+    unsigned char *nl_buf;
+    uint32_t nl_buf_len;
+    int ret;
+
+    nl_init_generic_client_req(&cl, GetNetlinkFamilyId());
+
+    if ((ret = nl_build_header(&cl, &nl_buf, &nl_buf_len)) < 0) {
+        LOG(ERROR, "Error creating netlink message. Error : " << ret);
+        free(cl.cl_buf);
+        return 0;
+    }
+
+    uint32_t header_len = cl.cl_buf_offset;
+    uint32_t msg_len = header_len + data_len;
+    uint32_t total_len = align ? NLMSG_ALIGN(msg_len) : msg_len;
+    if (total_len > buf_len) {
+        free(cl.cl_buf);
+        return 0;
+    }
+
+    nl_update_header(&cl, data_len);
+    struct nlmsghdr *nlh = (struct nlmsghdr *)cl.cl_buf;
+    nlh->nlmsg_pid = KSyncSock::GetPid();
+    nlh->nlmsg_seq = seq_no;
+
+    memcpy(buf, cl.cl_buf, header_len);
+    memcpy(buf + header_len, data, data_len);
+    memset(buf + msg_len, 0, total_len - msg_len);
+    free(cl.cl_buf);
+    return total_len;
+}
+
 void KSyncSock::SetSockTableEntry(int i, KSyncSock *sock) {
     sock_table_[i] = sock;
 }
@@ -703,6 +781,7 @@ bool KSyncSock::ProcessKernelData(char *data) {
     }
 
     if (!IsMoreData(data)) {
+        UpdateLatencyStats(context);
         context->Handler();
         {
             tbb::mutex::scoped_lock lock(mutex_);
@@ -716,6 +795,27 @@ bool KSyncSock::ProcessKernelData(char *data) {
     return true;
 }
     
+// Raise *max to value unless another thread raised it further meanwhile
+template <typename T>
+static void UpdateMaxStat(tbb::atomic<T> *max, T value) {
+    T current = *max;
+    while (value > current) {
+        T prev = max->compare_and_swap(value, current);
+        if (prev == current)
+            break;
+        current = prev;
+    }
+}
+
+void KSyncSock::UpdateLatencyStats(const IoContext *ioc) {
+    if (ioc->tx_time_ == 0)
+        return;
+    uint64_t latency = ClockMonotonicUsec() - ioc->tx_time_;
+    stats_.ack_count++;
+    stats_.total_latency_usecs += latency;
+    UpdateMaxStat(&stats_.max_latency_usecs, latency);
+}
+
 // Write handler registered with boost::asio
 void KSyncSock::WriteHandler(const boost::system::error_code& error,
                              size_t bytes_transferred) {
@@ -728,6 +828,14 @@ void KSyncSock::WriteHandler(const boost::system::error_code& error,
     }
 }
 
+// Write handler for batched transmissions. Releases the batch buffer
+void KSyncSock::BatchWriteHandler(char *buf,
+                                  const boost::system::error_code &error,
+                                  size_t bytes_transferred) {
+    delete [] buf;
+    WriteHandler(error, bytes_transferred);
+}
+
 KSyncSock *KSyncSock::Get(DBTablePartBase *partition) {
     int idx = partition->index();
     return sock_table_[idx];
@@ -776,10 +884,44 @@ void KSyncSock::GenericSend(IoContext *ioc) {
 }
 
 bool KSyncSock::SendAsyncImpl(IoContext *ioc) {
+    stats_.tx_msgs++;
+    if (batch_mode_) {
+        uint32_t bytes = ioc->GetMsgLen() + kBatchMsgOverhead;
+        // Flush first if the request does not fit in the current batch. A
+        // request larger than a whole batch then goes out on its own
+        if (!tx_batch_.empty() &&
+            tx_batch_bytes_ + bytes > KSYNC_BATCH_MAX_BYTES) {
+            SendBatch();
+        }
+        tx_batch_.push_back(ioc);
+        tx_batch_bytes_ += bytes;
+        // Send once the batch is full or nothing else is queued. Requests
+        // enqueued meanwhile are picked up by the next runner iteration, so
+        // a partial batch is never left behind
+        if (tx_batch_.size() >= KSYNC_BATCH_MAX_COUNT ||
+            tx_batch_bytes_ + kBufLen + kBatchMsgOverhead >
+                KSYNC_BATCH_MAX_BYTES ||
+            async_send_queue_->IsQueueEmpty()) {
+            SendBatch();
+        }
+        return true;
+    }
+
+    SendSingle(ioc);
+    return true;
+}
+
+// Send a request in a transmission of its own
+void KSyncSock::SendSingle(IoContext *ioc) {
     {
         tbb::mutex::scoped_lock lock(mutex_);
+        ioc->tx_time_ = ClockMonotonicUsec();
         wait_tree_.insert(*ioc);
     }
+    SendMsg(ioc);
+}
+
+void KSyncSock::SendMsg(IoContext *ioc) {
     if (!run_sync_mode_) {
         AsyncSendTo(ioc->GetMsg(), ioc->GetMsgLen(), ioc->GetSeqno(),
                     boost::bind(&KSyncSock::WriteHandler, this,
@@ -796,7 +938,129 @@ bool KSyncSock::SendAsyncImpl(IoContext *ioc) {
             ValidateAndEnqueue(rxbuf);
         } while(more_data);
     }
-    return true;
+}
+
+// Pack all requests collected in tx_batch_ into a single transmission. Each
+// request keeps its own seqno, so responses are correlated to the IoContext
+// through wait_tree_ exactly as for individual sends
+void KSyncSock::SendBatch() {
+    std::vector<IoContext *> pending;
+    pending.swap(tx_batch_);
+    tx_batch_bytes_ = 0;
+    if (pending.empty())
+        return;
+
+    if (pending.size() == 1) {
+        SendSingle(pending.front());
+        return;
+    }
+
+    // Requests that cannot be encoded into the batch buffer are sent
+    // individually once the batch is out
+    std::vector<IoContext *> batch;
+    std::vector<IoContext *> singles;
+    char *buf = new char[KSYNC_BATCH_MAX_BYTES];
+    uint32_t len = 0;
+    for (std::vector<IoContext *>::iterator it = pending.begin();
+         it != pending.end(); ++it) {
+        uint32_t msg_len = EncodeBatchMsg(buf + len,
+                                          KSYNC_BATCH_MAX_BYTES - len, *it);
+        if (msg_len == 0) {
+            LOG(DEBUG, "Ksync request with seqno " << (*it)->GetSeqno() <<
+                " and length " << (*it)->GetMsgLen() <<
+                " does not fit in batch, sending it individually");
+            singles.push_back(*it);
+            continue;
+        }
+        batch.push_back(*it);
+        len += msg_len;
+    }
+
+    if (batch.empty()) {
+        delete [] buf;
+    } else {
+        // Responses may arrive as soon as the buffer is sent, add all
+        // requests to wait_tree_ before that
+        {
+            tbb::mutex::scoped_lock lock(mutex_);
+            uint64_t now = ClockMonotonicUsec();
+            for (std::vector<IoContext *>::iterator it = batch.begin();
+                 it != batch.end(); ++it) {
+                (*it)->tx_time_ = now;
+                wait_tree_.insert(**it);
+            }
+        }
+
+        stats_.tx_batches++;
+        stats_.tx_batch_msgs += batch.size();
+        stats_.tx_batch_bytes += len;
+        UpdateMaxStat(&stats_.max_batch_msgs, (uint32_t)batch.size());
+        UpdateMaxStat(&stats_.max_batch_bytes, (uint32_t)len);
+
+        if (!run_sync_mode_) {
+            AsyncSendBatch(buf, len,
+                           boost::bind(&KSyncSock::BatchWriteHandler, this,
+                                       buf, placeholders::error,
+                                       placeholders::bytes_transferred));
+        } else {
+            SendBatchSync(buf, len, batch.size());
+            delete [] buf;
+        }
+    }
+
+    for (std::vector<IoContext *>::iterator it = singles.begin();
+         it != singles.end(); ++it) {
+        SendSingle(*it);
+    }
+}
+
+// Send a batch and wait for the responses to all of its requests. Every
+// request is answered by one or more messages, the last of which does not
+// have more data set
+void KSyncSock::SendBatchSync(const char *buf, uint32_t len, size_t count) {
+    SendBatchTo(buf, len);
+    size_t pending = count;
+    while (pending) {
+        char *rxbuf = new char[kBufLen];
+        Receive(boost::asio::buffer(rxbuf, kBufLen));
+        if (!IsMoreData(rxbuf))
+            pending--;
+        ValidateAndEnqueue(rxbuf);
+    }
+}
+
+void KSyncSockStatsReq::HandleRequest() const {
+    KSyncSockStatsResp *resp = new KSyncSockStatsResp();
+    std::vector<KSyncSockStats> list;
+    for (size_t i = 0; i < KSyncSock::sock_table_.size(); ++i) {
+        KSyncSock *sock = KSyncSock::sock_table_[i];
+        if (sock == NULL)
+            continue;
+        const KSyncSock::Stats &stats = sock->stats();
+        KSyncSockStats entry;
+        entry.set_index(i);
+        entry.set_batch_mode(sock->batch_mode());
+        entry.set_tx_msgs(stats.tx_msgs);
+        entry.set_tx_batches(stats.tx_batches);
+        entry.set_tx_batch_msgs(stats.tx_batch_msgs);
+        entry.set_tx_batch_bytes(stats.tx_batch_bytes);
+        entry.set_max_batch_msgs(stats.max_batch_msgs);
+        entry.set_max_batch_bytes(stats.max_batch_bytes);
+        uint64_t acks = stats.ack_count;
+        entry.set_ack_count(acks);
+        entry.set_average_latency_usecs(acks ?
+                                        stats.total_latency_usecs / acks : 0);
+        entry.set_max_latency_usecs(stats.max_latency_usecs);
+        {
+            tbb::mutex::scoped_lock lock(sock->mutex_);
+            entry.set_pending_acks(sock->wait_tree_.size());
+        }
+        list.push_back(entry);
+    }
+    resp->set_sock_list(list);
+    resp->set_context(context());
+    resp->set_more(false);
+    resp->Response();
 }
 
 KSyncIoContext::KSyncIoContext(KSyncEntry *sync_entry, int msg_len,
@@ -24,6 +24,10 @@
 #define KSYNC_DEFAULT_Q_ID_SEQ    0x00000001
 #define KSYNC_ACK_WAIT_THRESHOLD  200
 #define KSYNC_SOCK_RECV_BUFF_SIZE (256 * 1024)
+// Limits for a batched transmission. Responses to a batch are queued on the
+// socket until read, so the batch is bounded well within the receive buffer
+#define KSYNC_BATCH_MAX_COUNT     16
+#define KSYNC_BATCH_MAX_BYTES     (32 * 1024)
 
 class KSyncEntry;
 class KSyncIoContext;
@@ -71,14 +75,15 @@ public:
         MAX_WORK_QUEUES // This should always be last
     };
     static const char* io_wq_names[MAX_WORK_QUEUES];
-    IoContext() : ctx_(NULL), msg_(NULL), msg_len_(0), seqno_(0) { };
+    IoContext() : ctx_(NULL), msg_(NULL), msg_len_(0), seqno_(0),
+        tx_time_(0) { };
 
     IoContext(char *msg, uint32_t len, uint32_t seq, AgentSandeshContext *ctx) 
         : ctx_(ctx), msg_(msg), msg_len_(len), seqno_(seq), 
-          work_q_id_(DEFAULT_Q_ID) { };
+          work_q_id_(DEFAULT_Q_ID), tx_time_(0) { };
     IoContext(char *msg, uint32_t len, uint32_t seq, AgentSandeshContext *ctx, 
               IoContextWorkQId id) : ctx_(ctx), msg_(msg), msg_len_(len), 
-              seqno_(seq), work_q_id_(id) { };
+              seqno_(seq), work_q_id_(id), tx_time_(0) { };
     virtual ~IoContext() { 
         if (msg_ != NULL)
             free(msg_);
@@ -110,6 +115,8 @@ private:
     uint32_t msg_len_;
     uint32_t seqno_;
     IoContextWorkQId work_q_id_;
+    // Time the message was handed to the socket. Used for latency stats
+    uint64_t tx_time_;
 
     friend class KSyncSock;
 };
@@ -139,11 +146,32 @@ public:
     const static unsigned kBufLen = 4096;
 
     typedef boost::function<void(const boost::system::error_code &, size_t)> HandlerCb;
+
+    // Debug stats for batched transmissions and response latency. Updated
+    // from the send and receive paths and read by introspect concurrently
+    struct Stats {
+        Stats() {
+            tx_msgs = tx_batches = tx_batch_msgs = tx_batch_bytes = 0;
+            max_batch_msgs = max_batch_bytes = 0;
+            max_latency_usecs = ack_count = total_latency_usecs = 0;
+        }
+        tbb::atomic<uint64_t> tx_msgs;
+        tbb::atomic<uint64_t> tx_batches;
+        tbb::atomic<uint64_t> tx_batch_msgs;
+        tbb::atomic<uint64_t> tx_batch_bytes;
+        tbb::atomic<uint32_t> max_batch_msgs;
+        tbb::atomic<uint32_t> max_batch_bytes;
+        tbb::atomic<uint64_t> max_latency_usecs;
+        tbb::atomic<uint64_t> ack_count;
+        tbb::atomic<uint64_t> total_latency_usecs;
+    };
+
     KSyncSock();
     virtual ~KSyncSock();
 
-    // Start Ksync Asio operations
-    static void Start(bool run_sync_mode);
+    // Start Ksync Asio operations. In batch_mode, requests queued together
+    // are packed into a single transmission on transports that support it
+    static void Start(bool run_sync_mode, bool batch_mode = false);
     static void Shutdown();
 
     // Partition to KSyncSock mapping
@@ -175,9 +203,18 @@ public:
         agent_sandesh_ctx_ = ctx;
     }
     virtual void Decoder(char *data, SandeshContext *ctxt) = 0;
+
+    bool batch_mode() const { return batch_mode_; }
+    const Stats &stats() const { return stats_; }
 protected:
     static void Init(int count);
     static void SetSockTableEntry(int i, KSyncSock *sock);
+    // Encode data as a generic netlink request into buf. Returns the number
+    // of bytes used, including NLMSG_ALIGN padding if align is set, or 0 if
+    // the message does not fit in buf_len
+    static uint32_t EncodeNetlinkMsg(char *buf, uint32_t buf_len,
+                                     const char *data, uint32_t data_len,
+                                     uint32_t seq_no, bool align);
     // Tree of all KSyncEntries pending ack from Netlink socket
     Tree wait_tree_;
     WorkQueue<IoContext *> *async_send_queue_;
@@ -198,6 +235,13 @@ private:
 
     virtual bool Validate(char *data) = 0;
     bool SendAsyncImpl(IoContext *ioc);
+    void SendSingle(IoContext *ioc);
+    void SendMsg(IoContext *ioc);
+    void SendBatch();
+    void SendBatchSync(const char *buf, uint32_t len, size_t count);
+    void BatchWriteHandler(char *buf, const boost::system::error_code &error,
+                           size_t bytes_transferred);
+    void UpdateLatencyStats(const IoContext *ioc);
 
     bool SendAsyncStart() {
         tbb::mutex::scoped_lock lock(mutex_);
@@ -209,6 +253,16 @@ private:
     virtual std::size_t SendTo(const char *, uint32_t, uint32_t) = 0;
     virtual void Receive(boost::asio::mutable_buffers_1) = 0;
 
+    // Batched transmission. Only transports carrying netlink framed
+    // messages support it; others send each message individually
+    virtual bool IsBatchSupported() const { return false; }
+    virtual uint32_t EncodeBatchMsg(char *buf, uint32_t buf_len,
+                                    IoContext *ioc) { return 0; }
+    virtual void AsyncSendBatch(char *buf, uint32_t len, HandlerCb cb) { }
+    virtual std::size_t SendBatchTo(const char *buf, uint32_t len) {
+        return 0;
+    }
+
     virtual uint32_t GetSeqno(char *data) = 0;
     Tree::iterator GetIoContext(char *data);
     virtual bool IsMoreData(char *data) = 0;
@@ -228,6 +282,14 @@ private:
     int ack_count_;
     int err_count_;
     bool run_sync_mode_;
+    bool batch_mode_;
+
+    // Requests collected for the next batched transmission. Accessed only
+    // from the Ksync::AsyncSend task
+    std::vector<IoContext *> tx_batch_;
+    uint32_t tx_batch_bytes_;
+    Stats stats_;
+    friend class KSyncSockStatsReq;
     DISALLOW_COPY_AND_ASSIGN(KSyncSock);
 };
 
@@ -246,6 +308,10 @@ public:
     virtual void AsyncSendTo(char *, uint32_t, uint32_t,  HandlerCb);
     virtual std::size_t SendTo(const char*, uint32_t, uint32_t);
     virtual void Receive(boost::asio::mutable_buffers_1);
+    virtual bool IsBatchSupported() const { return true; }
+    virtual uint32_t EncodeBatchMsg(char *, uint32_t, IoContext *);
+    virtual void AsyncSendBatch(char *, uint32_t, HandlerCb);
+    virtual std::size_t SendBatchTo(const char *, uint32_t);
 private:
     boost::asio::netlink::raw::socket sock_;
 };
@@ -316,6 +382,10 @@ public:
     virtual void AsyncSendTo(char *, uint32_t, uint32_t, HandlerCb);
     virtual std::size_t SendTo(const char *, uint32_t, uint32_t);
     virtual void Receive(boost::asio::mutable_buffers_1);
+    virtual bool IsBatchSupported() const { return true; }
+    virtual uint32_t EncodeBatchMsg(char *, uint32_t, IoContext *);
+    virtual void AsyncSendBatch(char *, uint32_t, HandlerCb);
+    virtual std::size_t SendBatchTo(const char *, uint32_t);
     virtual TcpSession *AllocSession(Socket *socket);
     bool ReceiveMsg(const u_int8_t *msg, size_t size);
     void OnSessionEvent(TcpSession *session, TcpSession::Event event);
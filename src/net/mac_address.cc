@@ -55,13 +55,18 @@ string MacAddress::ToString() const {
 
 MacAddress MacAddress::FromString(const std::string &str,
                                   boost::system::error_code *errorp) {
+    return FromString(str.c_str(), errorp);
+}
+
+MacAddress MacAddress::FromString(const char *str,
+                                  boost::system::error_code *errorp) {
     struct ether_addr a;
     u_int8_t *p = (u_int8_t*)&a;
     char extra;
 
-    int ret = sscanf(str.c_str(), "%2hhx:%2hhx:%2hhx:%2hhx:%2hhx:%2hhx%c",
+    int ret = sscanf(str, "%2hhx:%2hhx:%2hhx:%2hhx:%2hhx:%2hhx%c",
         &p[0], &p[1], &p[2], &p[3], &p[4], &p[5], &extra);
-    if ((size_t)ret != size() || strchr(str.c_str(), 'x') || strchr(str.c_str(), 'X')) {
+    if ((size_t)ret != size() || strchr(str, 'x') || strchr(str, 'X')) {
         if (errorp != NULL)
             *errorp = make_error_code(boost::system::errc::invalid_argument);
         return MacAddress();
@@ -140,6 +140,8 @@ public:
     std::string ToString() const;
     static MacAddress FromString(const std::string &str,
         boost::system::error_code *error = NULL);
+    static MacAddress FromString(const char *str,
+        boost::system::error_code *error = NULL);
 
     static const MacAddress kZeroMac;
     static const MacAddress kBroadcastMac;
@@ -7,6 +7,7 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "query.h"
+#include "result_columns.h"
 
 using boost::assign::map_list_of;
 
@@ -25,31 +26,13 @@ bool PostProcessingQuery::flow_record_comparator(
     return false;
 }
 
-bool PostProcessingQuery::sort_field_comparator(
-        const QEOpServerProxy::ResultRowT& lhs,
-        const QEOpServerProxy::ResultRowT& rhs) {
-    std::map<std::string, std::string>::const_iterator lhs_it, rhs_it;
-    for (std::vector<sort_field_t>::iterator sort_it = sort_fields.begin();
-         sort_it != sort_fields.end(); sort_it++) {
-        lhs_it = lhs.first.find((*sort_it).name);
-        QE_ASSERT(lhs_it != lhs.first.end());
-        rhs_it = rhs.first.find((*sort_it).name);
-        QE_ASSERT(rhs_it != rhs.first.end());
-        if ((*sort_it).type == std::string("int") || 
-            (*sort_it).type == std::string("long") ||
-            (*sort_it).type == std::string("ipv4")) {
-            uint64_t lhs_val = 0, rhs_val = 0;
-            stringToInteger(lhs_it->second, lhs_val);
-            stringToInteger(rhs_it->second, rhs_val);
-            if (lhs_val < rhs_val) return true;
-            if (lhs_val > rhs_val) return false;
-        } else {
-            if (lhs_it->second < rhs_it->second) return true;
-            if (lhs_it->second > rhs_it->second) return false;
-        }
-    }
-
-    return false;
+void PostProcessingQuery::sort_result(QEOpServerProxy::BufferT *buffer,
+                                      size_t limit) {
+    ResultSortColumns columns(sort_fields, sorting_type == ASCENDING);
+    columns.Append(buffer->begin(), buffer->end());
+    ResultSortColumns::RowOrder order;
+    columns.Sort(&order, limit);
+    ResultSortColumns::Reorder(buffer, order);
 }
 
 bool PostProcessingQuery::flowseries_merge_processing(
@@ -218,19 +201,12 @@ bool PostProcessingQuery::merge_processing(
             copy(raw_result1->begin(), raw_result1->end(), 
                  std::back_inserter(*merged_result));
             if (merged_result_size) { 
-                if (sorting_type == ASCENDING) {
-                    std::inplace_merge(merged_result->begin(), 
-                        merged_result->begin() + merged_result_size,
-                        merged_result->end(),
-                        boost::bind(&PostProcessingQuery::sort_field_comparator, 
-                                    this, _1, _2));
-                } else {
-                    std::inplace_merge(merged_result->rbegin(),
-                        merged_result->rbegin() + raw_result1->size(),
-                        merged_result->rend(),
-                        boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                    this, _1, _2));
-                }
+                ResultSortColumns columns(sort_fields,
+                                          sorting_type == ASCENDING);
+                columns.Append(merged_result->begin(), merged_result->end());
+                ResultSortColumns::RowOrder order;
+                columns.Merge(&order, merged_result_size);
+                ResultSortColumns::Reorder(merged_result, order);
             }
         } else {
             QEOpServerProxy::BufferT *raw_result2 = result_.get();
@@ -239,18 +215,18 @@ bool PostProcessingQuery::merge_processing(
             QE_TRACE(DEBUG, "Merging results from vectors of size:" <<
                      size1 << " and " << size2);
             merged_result->reserve(raw_result1->size() + raw_result2->size());
-            if (sorting_type == ASCENDING) {
-                std::merge(raw_result1->begin(), raw_result1->end(),
-                           raw_result2->begin(), raw_result2->end(),
-                           std::back_inserter(*merged_result),
-                           boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                       this, _1, _2));
-            } else {
-                std::merge(raw_result1->rbegin(), raw_result1->rend(),
-                           raw_result2->rbegin(), raw_result2->rend(),
-                           std::back_inserter(*merged_result),
-                           boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                       this, _1, _2));
+            ResultSortColumns columns(sort_fields, sorting_type == ASCENDING);
+            columns.Append(raw_result1->begin(), raw_result1->end());
+            columns.Append(raw_result2->begin(), raw_result2->end());
+            ResultSortColumns::RowOrder order;
+            columns.Merge(&order, size1);
+            for (ResultSortColumns::RowOrder::const_iterator it =
+                 order.begin(); it != order.end(); ++it) {
+                if (*it < size1) {
+                    merged_result->push_back((*raw_result1)[*it]);
+                } else {
+                    merged_result->push_back((*raw_result2)[*it - size1]);
+                }
             }
         }
     } else {
@@ -371,16 +347,8 @@ const std::vector<boost::shared_ptr<QEOpServerProxy::BufferT> >& inputs,
     }
 
     if (sorted) {
-        QEOpServerProxy::BufferT *merged_result = &output;
-        if (sorting_type == ASCENDING) {
-            std::sort(merged_result->begin(), merged_result->end(),
-                      boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                  this, _1, _2));
-        } else {
-            std::sort(merged_result->rbegin(), merged_result->rend(),
-                      boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                  this, _1, _2));
-        }
+        // Only the rows within the limit need to be ordered
+        sort_result(&output, limit);
     }
    
     if (limit) {
@@ -492,7 +460,7 @@ query_status_t PostProcessingQuery::process_query() {
         // do filter operation
         QE_TRACE(DEBUG, "Doing filter operation");
         for (size_t i = 0; i < raw_result->size(); i++) {
-            QEOpServerProxy::ResultRowT row = (*raw_result)[i];
+            QEOpServerProxy::ResultRowT &row = (*raw_result)[i];
             bool delete_row = true;
 
             for (size_t j = 0; j < filter_list.size(); j++) {
@@ -578,31 +546,27 @@ query_status_t PostProcessingQuery::process_query() {
                 }
             }
             if (!delete_row) {
-                filtered_table.push_back(row);
+                filtered_table.push_back(QEOpServerProxy::ResultRowT());
+                filtered_table.back().first.swap(row.first);
+                filtered_table.back().second.swap(row.second);
             }
         }
-        *raw_result = filtered_table;
+        raw_result->swap(filtered_table);
     }
 
+    // If the flow series query is parallelized, we should apply the limit 
+    // only after the result from all the tasks are merged 
+    // (@ final_merge_processing).
+    bool apply_limit = (mquery->table() != g_viz_constants.FLOW_SERIES_TABLE ||
+        (mquery->table() == g_viz_constants.FLOW_SERIES_TABLE &&
+        !mquery->is_query_parallelized())) && limit;
+
     // Check if the result has to be sorted
     if (sorted) {
-        if (sorting_type == ASCENDING) {
-            std::sort(raw_result->begin(), raw_result->end(), 
-                      boost::bind(&PostProcessingQuery::sort_field_comparator, 
-                                  this, _1, _2)); 
-        } else {
-            std::sort(raw_result->rbegin(), raw_result->rend(), 
-                      boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                  this, _1, _2));
-        }
+        sort_result(raw_result, apply_limit ? limit : 0);
     }
 
-    // If the flow series query is parallelized, we should apply the limit 
-    // only after the result from all the tasks are merged 
-    // (@ final_merge_processing).
-    if ((mquery->table() != g_viz_constants.FLOW_SERIES_TABLE || 
-        (mquery->table() == g_viz_constants.FLOW_SERIES_TABLE && 
-        !mquery->is_query_parallelized())) && limit) {
+    if (apply_limit) {
         QE_TRACE(DEBUG, "Apply Limit [" << limit << "]");
         if (raw_result->size() > (size_t)limit) {
             raw_result->resize(limit);
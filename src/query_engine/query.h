@@ -691,8 +691,9 @@ public:
     std::auto_ptr<BufT> result_;
     std::auto_ptr<MapBufT> mresult_;
 
-    bool sort_field_comparator(const QEOpServerProxy::ResultRowT& lhs,
-                               const QEOpServerProxy::ResultRowT& rhs);
+    // sort the rows on sort_fields, ordering only the first limit rows if
+    // limit is non zero
+    void sort_result(QEOpServerProxy::BufferT *buffer, size_t limit);
 
     // compare flow records based on UUID
     static bool flow_record_comparator(const QEOpServerProxy::ResultRowT& lhs,
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "result_columns.h"
+
+#include <algorithm>
+#include "base/string_util.h"
+#include "query.h"
+
+ResultSortColumns::ResultSortColumns(
+        const std::vector<sort_field_t> &sort_fields, bool ascending) :
+    ascending_(ascending), row_count_(0) {
+    columns_.reserve(sort_fields.size());
+    for (std::vector<sort_field_t>::const_iterator it = sort_fields.begin();
+         it != sort_fields.end(); ++it) {
+        bool integer = (it->type == "int" || it->type == "long" ||
+                        it->type == "ipv4");
+        columns_.push_back(Column(it->name, integer));
+    }
+}
+
+void ResultSortColumns::Append(BufferT::const_iterator begin,
+                               BufferT::const_iterator end) {
+    size_t count = end - begin;
+    for (std::vector<Column>::iterator col = columns_.begin();
+         col != columns_.end(); ++col) {
+        if (col->integer) {
+            col->ivalues.reserve(row_count_ + count);
+        } else {
+            col->svalues.reserve(row_count_ + count);
+        }
+        for (BufferT::const_iterator row = begin; row != end; ++row) {
+            QEOpServerProxy::OutRowT::const_iterator it =
+                row->first.find(col->name);
+            QE_ASSERT(it != row->first.end());
+            if (col->integer) {
+                uint64_t value = 0;
+                stringToInteger(it->second, value);
+                col->ivalues.push_back(value);
+            } else {
+                col->svalues.push_back(&it->second);
+            }
+        }
+    }
+    row_count_ += count;
+}
+
+bool ResultSortColumns::Less(size_t lhs, size_t rhs) const {
+    for (std::vector<Column>::const_iterator col = columns_.begin();
+         col != columns_.end(); ++col) {
+        int result;
+        if (col->integer) {
+            uint64_t lval = col->ivalues[lhs];
+            uint64_t rval = col->ivalues[rhs];
+            result = (lval < rval) ? -1 : ((lval > rval) ? 1 : 0);
+        } else {
+            result = col->svalues[lhs]->compare(*col->svalues[rhs]);
+        }
+        if (result != 0) {
+            return ascending_ ? (result < 0) : (result > 0);
+        }
+    }
+    return false;
+}
+
+void ResultSortColumns::Sort(RowOrder *order, size_t limit) const {
+    order->resize(row_count_);
+    for (size_t i = 0; i < row_count_; i++) {
+        (*order)[i] = i;
+    }
+    if (limit && limit < row_count_) {
+        std::partial_sort(order->begin(), order->begin() + limit,
+                          order->end(), RowLess(this));
+        order->resize(limit);
+    } else {
+        std::sort(order->begin(), order->end(), RowLess(this));
+    }
+}
+
+void ResultSortColumns::Merge(RowOrder *order, size_t middle) const {
+    order->resize(row_count_);
+    for (size_t i = 0; i < row_count_; i++) {
+        (*order)[i] = i;
+    }
+    std::inplace_merge(order->begin(), order->begin() + middle, order->end(),
+                       RowLess(this));
+}
+
+void ResultSortColumns::Reorder(BufferT *buffer, const RowOrder &order) {
+    // Swap the row contents rather than copying the column maps
+    BufferT ordered(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        QEOpServerProxy::ResultRowT &row((*buffer)[order[i]]);
+        ordered[i].first.swap(row.first);
+        ordered[i].second.swap(row.second);
+    }
+    buffer->swap(ordered);
+}
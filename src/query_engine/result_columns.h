@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef RESULT_COLUMNS_H_
+#define RESULT_COLUMNS_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "base/util.h"
+#include "QEOpServerProxy.h"
+
+struct sort_field_t;
+
+//
+// Columnar view of the sort fields of result rows.
+//
+// Result rows are maps keyed by column name, so comparing two rows on the
+// sort fields costs a map lookup per field and, for integer fields, a
+// string to integer conversion on every comparison. ResultSortColumns looks
+// up each sort field once per row and keeps the values in typed column
+// vectors, indexed by row, with the field names held once for all rows.
+// Sort, merge and limit then work on row indexes and the rows are moved
+// only once, into their final order.
+//
+// The columns point into the rows, which must not be modified or moved
+// while the columns are in use.
+//
+class ResultSortColumns {
+public:
+    typedef QEOpServerProxy::BufferT BufferT;
+    typedef std::vector<size_t> RowOrder;
+
+    ResultSortColumns(const std::vector<sort_field_t> &sort_fields,
+                      bool ascending);
+
+    // Add the rows in [begin, end) after the rows added so far
+    void Append(BufferT::const_iterator begin, BufferT::const_iterator end);
+
+    size_t size() const { return row_count_; }
+
+    // Returns true if row lhs is ordered before row rhs
+    bool Less(size_t lhs, size_t rhs) const;
+
+    // Fill order with the indexes of all rows in sorted order. If limit is
+    // non zero, only the first limit rows are ordered and returned.
+    void Sort(RowOrder *order, size_t limit) const;
+
+    // Rows [0, middle) and [middle, size()) are each sorted, fill order
+    // with the indexes of all rows in merged order
+    void Merge(RowOrder *order, size_t middle) const;
+
+    // Rearrange buffer so that row i is the row order[i] of the original
+    // buffer. Rows not in order are dropped.
+    static void Reorder(BufferT *buffer, const RowOrder &order);
+
+private:
+    struct Column {
+        Column(const std::string &field_name, bool is_integer) :
+            name(field_name), integer(is_integer) {
+        }
+        std::string name;
+        bool integer;
+        std::vector<uint64_t> ivalues;
+        std::vector<const std::string *> svalues;
+    };
+
+    struct RowLess {
+        explicit RowLess(const ResultSortColumns *columns) :
+            columns_(columns) {
+        }
+        bool operator()(size_t lhs, size_t rhs) const {
+            return columns_->Less(lhs, rhs);
+        }
+        const ResultSortColumns *columns_;
+    };
+
+    std::vector<Column> columns_;
+    bool ascending_;
+    size_t row_count_;
+
+    DISALLOW_COPY_AND_ASSIGN(ResultSortColumns);
+};
+
+#endif  // RESULT_COLUMNS_H_
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "testing/gunit.h"
+
+#include "base/logging.h"
+#include "base/string_util.h"
+#include "base/time_util.h"
+#include "query.h"
+#include "result_columns.h"
+
+using std::string;
+using std::vector;
+
+class ResultSortColumnsTest : public ::testing::Test {
+protected:
+    typedef QEOpServerProxy::BufferT BufferT;
+
+    ResultSortColumnsTest() {
+        sort_fields_.push_back(sort_field_t("sourcevn", "string"));
+        sort_fields_.push_back(sort_field_t("sport", "int"));
+    }
+
+    void AddRows(BufferT *buffer, size_t count, uint32_t seed) {
+        srand(seed);
+        buffer->reserve(buffer->size() + count);
+        for (size_t i = 0; i < count; i++) {
+            QEOpServerProxy::OutRowT row;
+            row["sourcevn"] = "default-domain:demo:vn" +
+                integerToString(rand() % 16);
+            row["sport"] = integerToString(rand() % 65536);
+            row["destvn"] = "default-domain:demo:vn" +
+                integerToString(rand() % 16);
+            row["sum(bytes)"] = integerToString(rand());
+            buffer->push_back(std::make_pair(row,
+                QEOpServerProxy::MetadataT()));
+        }
+    }
+
+    // Row comparison on the sort fields through the row maps, as done
+    // before the columnar representation
+    static bool MapLess(const vector<sort_field_t> *fields, bool ascending,
+                        const QEOpServerProxy::ResultRowT &lhs,
+                        const QEOpServerProxy::ResultRowT &rhs) {
+        for (vector<sort_field_t>::const_iterator it = fields->begin();
+             it != fields->end(); ++it) {
+            const string &lval(lhs.first.find(it->name)->second);
+            const string &rval(rhs.first.find(it->name)->second);
+            int result;
+            if (it->type == "int") {
+                uint64_t lnum = 0, rnum = 0;
+                stringToInteger(lval, lnum);
+                stringToInteger(rval, rnum);
+                result = (lnum < rnum) ? -1 : ((lnum > rnum) ? 1 : 0);
+            } else {
+                result = lval.compare(rval);
+            }
+            if (result != 0) {
+                return ascending ? (result < 0) : (result > 0);
+            }
+        }
+        return false;
+    }
+
+    void MapSort(BufferT *buffer, bool ascending) {
+        std::sort(buffer->begin(), buffer->end(),
+            boost::bind(&ResultSortColumnsTest::MapLess, &sort_fields_,
+                        ascending, _1, _2));
+    }
+
+    void ColumnSort(BufferT *buffer, bool ascending, size_t limit) {
+        ResultSortColumns columns(sort_fields_, ascending);
+        columns.Append(buffer->begin(), buffer->end());
+        ResultSortColumns::RowOrder order;
+        columns.Sort(&order, limit);
+        ResultSortColumns::Reorder(buffer, order);
+    }
+
+    // Rows may be ordered differently only if they have the same sort keys
+    void VerifySameOrder(const BufferT &expected, const BufferT &actual,
+                         bool ascending) {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            EXPECT_FALSE(MapLess(&sort_fields_, ascending, expected[i],
+                                 actual[i]));
+            EXPECT_FALSE(MapLess(&sort_fields_, ascending, actual[i],
+                                 expected[i]));
+        }
+    }
+
+    vector<sort_field_t> sort_fields_;
+};
+
+TEST_F(ResultSortColumnsTest, Sort) {
+    for (int ascending = 0; ascending < 2; ascending++) {
+        BufferT expected, actual;
+        AddRows(&expected, 1000, 1);
+        actual = expected;
+        MapSort(&expected, ascending);
+        ColumnSort(&actual, ascending, 0);
+        VerifySameOrder(expected, actual, ascending);
+    }
+}
+
+TEST_F(ResultSortColumnsTest, SortLimit) {
+    for (int ascending = 0; ascending < 2; ascending++) {
+        BufferT expected, actual;
+        AddRows(&expected, 1000, 2);
+        actual = expected;
+        MapSort(&expected, ascending);
+        expected.resize(50);
+        ColumnSort(&actual, ascending, 50);
+        VerifySameOrder(expected, actual, ascending);
+    }
+}
+
+TEST_F(ResultSortColumnsTest, Merge) {
+    for (int ascending = 0; ascending < 2; ascending++) {
+        BufferT first, second;
+        AddRows(&first, 300, 3);
+        AddRows(&second, 700, 4);
+        MapSort(&first, ascending);
+        MapSort(&second, ascending);
+        BufferT expected(first);
+        expected.insert(expected.end(), second.begin(), second.end());
+        BufferT actual(expected);
+        MapSort(&expected, ascending);
+
+        ResultSortColumns columns(sort_fields_, ascending);
+        columns.Append(actual.begin(), actual.end());
+        ResultSortColumns::RowOrder order;
+        columns.Merge(&order, first.size());
+        ResultSortColumns::Reorder(&actual, order);
+        VerifySameOrder(expected, actual, ascending);
+    }
+}
+
+//
+// Compare sorting through the row maps with sorting on the columns,
+// including moving the rows into place.
+//
+TEST_F(ResultSortColumnsTest, Benchmark) {
+    size_t row_count = 100000;
+    char *str = getenv("QE_RESULT_COLUMNS_TEST_ROW_COUNT");
+    if (str) row_count = strtoul(str, NULL, 0);
+
+    BufferT map_buffer;
+    AddRows(&map_buffer, row_count, 5);
+    BufferT column_buffer(map_buffer);
+
+    uint64_t start = ClockMonotonicUsec();
+    MapSort(&map_buffer, true);
+    uint64_t map_usecs = ClockMonotonicUsec() - start + 1;
+
+    start = ClockMonotonicUsec();
+    ColumnSort(&column_buffer, true, 0);
+    uint64_t column_usecs = ClockMonotonicUsec() - start + 1;
+
+    VerifySameOrder(map_buffer, column_buffer, true);
+    LOG(DEBUG, "Sort " << row_count << " rows: map " << map_usecs <<
+        " usecs, columns " << column_usecs << " usecs");
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
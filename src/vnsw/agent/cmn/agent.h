@@ -197,6 +197,8 @@ public:
     static const uint32_t kMaxOtherOpenFds = 64;
     // default timeout zero means, this timeout is not used
     static const uint32_t kDefaultFlowCacheTimeout = 0;
+    // default number of flow setup partitions (Agent::FlowHandler instances)
+    static const uint16_t kDefaultFlowThreadCount = 1;
     enum VxLanNetworkIdentifierMode {
         AUTOMATIC,
         CONFIGURED
@@ -151,6 +151,10 @@ void Pkt0Interface::InitControlInterface() {
     boost::system::error_code ec;
     input_.assign(tap_fd_, ec);
     assert(ec == 0);
+    // Reads are drained and writes flushed directly on the descriptor
+    boost::asio::posix::descriptor_base::non_blocking_io non_blocking(true);
+    input_.io_control(non_blocking, ec);
+    assert(ec == 0);
     
     VrouterControlInterface::InitControlInterface();  
     AsyncRead();
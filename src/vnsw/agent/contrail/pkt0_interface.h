@@ -5,16 +5,26 @@
 #ifndef vnsw_agent_contrail_pkt0_interface_hpp
 #define vnsw_agent_contrail_pkt0_interface_hpp
 
+#include <deque>
 #include <string>
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
 #include <boost/asio.hpp>
 
+#include <tbb/mutex.h>
 #include <pkt/vrouter_interface.h>
 
 // pkt0 interface implementation of VrouterControlInterface
+//
+// Each read event drains up to kMaxReadBatch packets from the descriptor
+// into pooled packet buffers. Packets sent are queued, and the queue is
+// written out by a single sender at a time, so that concurrent senders
+// share a flush. When the descriptor is full, the queue waits for it to
+// become writable.
 class Pkt0Interface: public VrouterControlInterface {
 public:
+    static const int kMaxReadBatch = 32;
+
     Pkt0Interface(const std::string &name, boost::asio::io_service *io);
     virtual ~Pkt0Interface();
     
@@ -26,18 +36,39 @@ public:
     int Send(uint8_t *buff, uint16_t buff_len, const PacketBufferPtr &pkt);
     const unsigned char *mac_address() const { return mac_address_; }
 protected:
+    struct PendingWrite {
+        PendingWrite(uint8_t *buff, uint16_t buff_len,
+                     const PacketBufferPtr &pkt)
+            : buff(buff), buff_len(buff_len), pkt(pkt), data(pkt->data()),
+              data_len(pkt->data_len()) {
+        }
+        uint8_t *buff;
+        uint16_t buff_len;
+        PacketBufferPtr pkt;
+        uint8_t *data;
+        uint16_t data_len;
+    };
+    typedef std::deque<PendingWrite> WriteQueue;
+
+    void AllocReadBuffer();
+    void ProcessReadBuffer(std::size_t length);
     void AsyncRead();
     void ReadHandler(const boost::system::error_code &err, std::size_t length);
-    void WriteHandler(const boost::system::error_code &error,
-                      std::size_t length, PacketBufferPtr pkt, uint8_t *buff);
+    void FlushWrites();
+    void WriteReadyHandler(const boost::system::error_code &error);
 
     std::string name_;
     int tap_fd_;
     unsigned char mac_address_[ETHER_ADDR_LEN];
     boost::asio::posix::stream_descriptor input_;
     
-    uint8_t *read_buff_;
+    PacketBufferPtr read_buff_;
     PktHandler *pkt_handler_;
+
+    tbb::mutex write_mutex_;
+    WriteQueue write_queue_;
+    bool write_flushing_;       // A sender is writing the queue
+    bool write_blocked_;        // Waiting for the descriptor to be writable
     DISALLOW_COPY_AND_ASSIGN(Pkt0Interface);
 };
 
@@ -69,6 +100,10 @@ public:
 
     int Send(uint8_t *buff, uint16_t buff_len, const PacketBufferPtr &pkt);
 private:
+    friend class TestPkt0ReadSocket;
+
+    void AllocReadBuffer();
+    void ProcessReadBuffer(std::size_t length);
     void AsyncRead();
     void ReadHandler(const boost::system::error_code &err, std::size_t length);
     void WriteHandler(const boost::system::error_code &error,
@@ -79,7 +114,7 @@ private:
     bool connected_;
     boost::asio::local::datagram_protocol::socket socket_;
     boost::scoped_ptr<Timer> timer_;
-    uint8_t *read_buff_;
+    PacketBufferPtr read_buff_;
     PktHandler *pkt_handler_;
     std::string name_;
     DISALLOW_COPY_AND_ASSIGN(Pkt0Socket);
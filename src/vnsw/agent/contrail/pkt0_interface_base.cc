@@ -5,10 +5,13 @@
 #include <boost/filesystem.hpp>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 #include <fcntl.h>
 #include <assert.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <net/if.h>
 
@@ -19,6 +22,7 @@
 #include "sandesh/sandesh_trace.h"
 #include "pkt/pkt_types.h"
 #include "pkt/pkt_init.h"
+#include "pkt/packet_buffer.h"
 #include "pkt0_interface.h"
 
 using namespace boost::asio;
@@ -36,13 +40,15 @@ const string Pkt0Socket::kVrouterSocketPath = Pkt0Socket::kSocketDir
 
 Pkt0Interface::Pkt0Interface(const std::string &name,
                              boost::asio::io_service *io) :
-    name_(name), tap_fd_(-1), input_(*io), read_buff_(NULL), pkt_handler_(NULL) {
+    name_(name), tap_fd_(-1), input_(*io), pkt_handler_(NULL),
+    write_flushing_(false), write_blocked_(false) {
     memset(mac_address_, 0, sizeof(mac_address_));
 }
 
 Pkt0Interface::~Pkt0Interface() {
-    if (read_buff_) {
-        delete [] read_buff_;
+    for (WriteQueue::iterator it = write_queue_.begin();
+         it != write_queue_.end(); ++it) {
+        delete [] it->buff;
     }
 }
 
@@ -55,20 +61,26 @@ void Pkt0Interface::IoShutdownControlInterface() {
 void Pkt0Interface::ShutdownControlInterface() {
 }
 
-void Pkt0Interface::WriteHandler(const boost::system::error_code &error,
-                                 std::size_t length, PacketBufferPtr pkt,
-                                 uint8_t *buff) {
-    if (error)
-        TAP_TRACE(Err,
-                  "Packet Tap Error <" + error.message() + "> sending packet");
-    delete [] buff;
+void Pkt0Interface::AllocReadBuffer() {
+    Agent *agent = pkt_handler()->agent();
+    read_buff_ = agent->pkt()->packet_buffer_manager()->Allocate
+        (PktHandler::RX_PACKET, kMaxPacketSize, 0);
 }
 
+// Hand the packet in the read buffer to the packet handler
+void Pkt0Interface::ProcessReadBuffer(std::size_t length) {
+    PacketBufferPtr pkt;
+    pkt.swap(read_buff_);
+    pkt->set_len(length);
+    VrouterControlInterface::Process(pkt);
+}
 
 void Pkt0Interface::AsyncRead() {
-    read_buff_ = new uint8_t[kMaxPacketSize];
+    if (read_buff_.get() == NULL) {
+        AllocReadBuffer();
+    }
     input_.async_read_some(
-            boost::asio::buffer(read_buff_, kMaxPacketSize),
+            boost::asio::buffer(read_buff_->data(), kMaxPacketSize),
             boost::bind(&Pkt0Interface::ReadHandler, this,
                         boost::asio::placeholders::error,
                         boost::asio::placeholders::bytes_transferred));
@@ -85,11 +97,18 @@ void Pkt0Interface::ReadHandler(const boost::system::error_code &error,
     }
 
     if (!error) {
-        Agent *agent = pkt_handler()->agent();
-        PacketBufferPtr pkt(agent->pkt()->packet_buffer_manager()->Allocate
-            (PktHandler::RX_PACKET, read_buff_, kMaxPacketSize, 0, length,
-             0));
-        VrouterControlInterface::Process(pkt);
+        ProcessReadBuffer(length);
+
+        // Read the packets already queued on the descriptor before going
+        // back to the reactor.
+        for (int count = 1; count < kMaxReadBatch && tap_fd_ >= 0; count++) {
+            AllocReadBuffer();
+            ssize_t len = read(tap_fd_, read_buff_->data(), kMaxPacketSize);
+            if (len <= 0) {
+                break;
+            }
+            ProcessReadBuffer(len);
+        }
     }
 
     AsyncRead();
@@ -97,16 +116,97 @@ void Pkt0Interface::ReadHandler(const boost::system::error_code &error,
 
 int Pkt0Interface::Send(uint8_t *buff, uint16_t buff_len,
                         const PacketBufferPtr &pkt) {
-    std::vector<boost::asio::const_buffer> buff_list;
-    buff_list.push_back(boost::asio::buffer(buff, buff_len));
-    buff_list.push_back(boost::asio::buffer(pkt->data(), pkt->data_len()));
+    int len = buff_len + pkt->data_len();
+    {
+        tbb::mutex::scoped_lock lock(write_mutex_);
+        write_queue_.push_back(PendingWrite(buff, buff_len, pkt));
+        if (write_flushing_ || write_blocked_) {
+            return len;
+        }
+        write_flushing_ = true;
+    }
+    FlushWrites();
+    return len;
+}
 
-    input_.async_write_some(buff_list,
-                            boost::bind(&Pkt0Interface::WriteHandler, this,
-                                        boost::asio::placeholders::error,
-                                        boost::asio::placeholders::bytes_transferred,
-                                        pkt, buff));
-    return (buff_len + pkt->data_len());
+//
+// Write the queued packets until the queue is empty or the descriptor is
+// full. Only one thread flushes at a time, other senders just queue their
+// packets. The queue is taken in batches so that the mutex is not held
+// across the writes.
+//
+void Pkt0Interface::FlushWrites() {
+    WriteQueue batch;
+    while (true) {
+        {
+            tbb::mutex::scoped_lock lock(write_mutex_);
+            if (write_queue_.empty()) {
+                write_flushing_ = false;
+                return;
+            }
+            batch.swap(write_queue_);
+        }
+
+        while (!batch.empty()) {
+            PendingWrite &write = batch.front();
+            struct iovec iov[2];
+            int iovcnt = 0;
+            if (write.buff_len) {
+                iov[iovcnt].iov_base = write.buff;
+                iov[iovcnt].iov_len = write.buff_len;
+                iovcnt++;
+            }
+            iov[iovcnt].iov_base = write.data;
+            iov[iovcnt].iov_len = write.data_len;
+            iovcnt++;
+
+            if (writev(tap_fd_, iov, iovcnt) < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                TAP_TRACE(Err, "Packet Tap Error <" +
+                          std::string(strerror(errno)) + "> sending packet");
+            }
+            if (write.buff == NULL) {
+                write.pkt->ReleaseHeadroom();
+            }
+            delete [] write.buff;
+            batch.pop_front();
+        }
+
+        if (!batch.empty()) {
+            // Put the unsent packets back ahead of the ones queued since,
+            // and resume once the descriptor is writable.
+            tbb::mutex::scoped_lock lock(write_mutex_);
+            write_queue_.insert(write_queue_.begin(), batch.begin(),
+                                batch.end());
+            write_flushing_ = false;
+            write_blocked_ = true;
+            input_.async_write_some(boost::asio::null_buffers(),
+                boost::bind(&Pkt0Interface::WriteReadyHandler, this,
+                            boost::asio::placeholders::error));
+            return;
+        }
+    }
+}
+
+void Pkt0Interface::WriteReadyHandler(const boost::system::error_code &error) {
+    {
+        tbb::mutex::scoped_lock lock(write_mutex_);
+        write_blocked_ = false;
+        if (error) {
+            TAP_TRACE(Err, "Packet Tap Error <" + error.message() +
+                      "> sending packet");
+            if (error == boost::system::errc::operation_canceled) {
+                return;
+            }
+        }
+        if (write_flushing_) {
+            return;
+        }
+        write_flushing_ = true;
+    }
+    FlushWrites();
 }
 
 Pkt0RawInterface::Pkt0RawInterface(const std::string &name,
@@ -115,21 +215,15 @@ Pkt0RawInterface::Pkt0RawInterface(const std::string &name,
 }
 
 Pkt0RawInterface::~Pkt0RawInterface() {
-    if (read_buff_) {
-        delete [] read_buff_;
-    }
 }
 
 Pkt0Socket::Pkt0Socket(const std::string &name,
     boost::asio::io_service *io):
     connected_(false), socket_(*io), timer_(NULL),
-    read_buff_(NULL), pkt_handler_(NULL), name_(name){
+    pkt_handler_(NULL), name_(name){
 }
 
 Pkt0Socket::~Pkt0Socket() {
-    if (read_buff_) {
-        delete [] read_buff_;
-    }
 }
 
 void Pkt0Socket::CreateUnixSocket() {
@@ -155,10 +249,6 @@ void Pkt0Socket::InitControlInterface() {
 }
 
 void Pkt0Socket::IoShutdownControlInterface() {
-    if (read_buff_) {
-        delete [] read_buff_;
-    }
-
     boost::system::error_code ec;
     socket_.close(ec);
 }
@@ -166,10 +256,26 @@ void Pkt0Socket::IoShutdownControlInterface() {
 void Pkt0Socket::ShutdownControlInterface() {
 }
 
+void Pkt0Socket::AllocReadBuffer() {
+    Agent *agent = pkt_handler()->agent();
+    read_buff_ = agent->pkt()->packet_buffer_manager()->Allocate
+        (PktHandler::RX_PACKET, kMaxPacketSize, 0);
+}
+
+// Hand the packet in the read buffer to the packet handler
+void Pkt0Socket::ProcessReadBuffer(std::size_t length) {
+    PacketBufferPtr pkt;
+    pkt.swap(read_buff_);
+    pkt->set_len(length);
+    VrouterControlInterface::Process(pkt);
+}
+
 void Pkt0Socket::AsyncRead() {
-    read_buff_ = new uint8_t[kMaxPacketSize];
+    if (read_buff_.get() == NULL) {
+        AllocReadBuffer();
+    }
     socket_.async_receive(
-            boost::asio::buffer(read_buff_, kMaxPacketSize), 
+            boost::asio::buffer(read_buff_->data(), kMaxPacketSize),
             boost::bind(&Pkt0Socket::ReadHandler, this,
                 boost::asio::placeholders::error,
                 boost::asio::placeholders::bytes_transferred));
@@ -201,6 +307,9 @@ int Pkt0Socket::Send(uint8_t *buff, uint16_t buff_len,
                       const PacketBufferPtr &pkt) {
     if (connected_ == false) {
         //queue the data?
+        if (buff == NULL) {
+            pkt->ReleaseHeadroom();
+        }
         return (pkt->data_len());
     }
 
@@ -227,11 +336,20 @@ void Pkt0Socket::ReadHandler(const boost::system::error_code &error,
     }
 
     if (!error) {
-        Agent *agent = pkt_handler()->agent();
-        PacketBufferPtr pkt(agent->pkt()->packet_buffer_manager()->Allocate
-            (PktHandler::RX_PACKET, read_buff_, kMaxPacketSize, 0, length,
-             0));
-        VrouterControlInterface::Process(pkt);
+        ProcessReadBuffer(length);
+
+        // Read the datagrams already queued on the socket before going back
+        // to the reactor.
+        int fd = socket_.native_handle();
+        for (int count = 1; count < Pkt0Interface::kMaxReadBatch; count++) {
+            AllocReadBuffer();
+            ssize_t len = recv(fd, read_buff_->data(), kMaxPacketSize,
+                               MSG_DONTWAIT);
+            if (len <= 0) {
+                break;
+            }
+            ProcessReadBuffer(len);
+        }
     }
 
     AsyncRead();
@@ -243,5 +361,8 @@ void Pkt0Socket::WriteHandler(const boost::system::error_code &error,
     if (error)
         TAP_TRACE(Err,
                   "Packet Error <" + error.message() + "> sending packet");
+    if (buff == NULL) {
+        pkt->ReleaseHeadroom();
+    }
     delete [] buff;
 }
@@ -38,6 +38,9 @@ using namespace autogen;
 
 SandeshTraceBufferPtr AclTraceBuf(SandeshTraceBufferCreate("Acl", 32000));
 
+bool AclDBEntry::classifier_enabled_ = true;
+tbb::atomic<uint64_t> AclDBEntry::generation_counter_;
+
 FlowPolicyInfo::FlowPolicyInfo(const std::string &u)
     : uuid(u), drop(false), terminal(false), other(false) {
 }
@@ -114,6 +117,7 @@ DBEntry *AclTable::Add(const DBRequest *req) {
          ++it) {
         acl->AddAclEntry(*it, acl->acl_entries_);
     }
+    acl->BuildClassifier();
     return acl;
 }
 
@@ -124,6 +128,7 @@ bool AclTable::OnChange(DBEntry *entry, const DBRequest *req) {
 
     if (data->ace_id_to_del_) {
         acl->DeleteAclEntry(data->ace_id_to_del_);
+        acl->BuildClassifier();
         return true;
     }
 
@@ -152,7 +157,9 @@ bool AclTable::OnChange(DBEntry *entry, const DBRequest *req) {
         }
     }
 
-    if (changed == false) {
+    if (changed) {
+        acl->BuildClassifier();
+    } else {
         //Remove temporary create acl entries
         AclDBEntry::AclEntries::iterator iter;
         iter = entries.begin();
@@ -499,6 +506,9 @@ bool AclDBEntry::DeleteAclEntry(const uint32_t acl_entry_id)
          iter != acl_entries_.end(); ++iter) {
         if (acl_entry_id == iter->id()) {
             AclEntry *ae = iter.operator->();
+            // The classifier refers to the entry
+            classifier_.reset();
+            generation_ = NextGeneration();
             acl_entries_.erase(acl_entries_.iterator_to(*iter));
             ACL_TRACE(Info, "acl entry " + integerToString(acl_entry_id) + " deleted");
             delete ae;
@@ -511,6 +521,8 @@ bool AclDBEntry::DeleteAclEntry(const uint32_t acl_entry_id)
 
 void AclDBEntry::DeleteAllAclEntries()
 {
+    classifier_.reset();
+    generation_ = NextGeneration();
     AclEntries::iterator iter;
     iter = acl_entries_.begin();
     while (iter != acl_entries_.end()) {
@@ -521,70 +533,136 @@ void AclDBEntry::DeleteAllAclEntries()
     return;
 }
 
+bool AclDBEntry::ApplyEntryMatch(const AclEntry &entry,
+                                 const AclEntry::ActionList &al,
+                                 MatchAclParams &m_acl,
+                                 FlowPolicyInfo *info) const {
+    AclEntry::ActionList::const_iterator al_it;
+    for (al_it = al.begin(); al_it != al.end(); ++al_it) {
+        TrafficAction *ta = static_cast<TrafficAction *>(*al_it.operator->());
+        m_acl.action_info.action |= 1 << ta->GetAction();
+        if (ta->GetActionType() == TrafficAction::MIRROR_ACTION) {
+            MirrorAction *a = static_cast<MirrorAction *>(*al_it.operator->());
+            MirrorActionSpec as;
+            as.ip = a->GetIp();
+            as.port = a->GetPort();
+            as.vrf_name = a->vrf_name();
+            as.analyzer_name = a->GetAnalyzerName();
+            as.encap = a->GetEncap();
+            m_acl.action_info.mirror_l.push_back(as);
+        }
+        if (ta->GetActionType() == TrafficAction::VRF_TRANSLATE_ACTION) {
+            const VrfTranslateAction *a =
+                static_cast<VrfTranslateAction *>(*al_it.operator->());
+            VrfTranslateActionSpec vrf_translate_action(a->vrf_name(),
+                                                        a->ignore_acl());
+            m_acl.action_info.vrf_translate_action_ = vrf_translate_action;
+        }
+        if (info && ta->IsDrop()) {
+            if (!info->drop) {
+                info->drop = true;
+                info->terminal = false;
+                info->other = false;
+                info->uuid = entry.uuid();
+            }
+        }
+    }
+
+    m_acl.ace_id_list.push_back((int32_t)(entry.id()));
+    if (entry.IsTerminal()) {
+        m_acl.terminal_rule = true;
+        /* Set uuid only if it is NOT already set as
+         * drop/terminal uuid */
+        if (info && !info->drop && !info->terminal) {
+            info->terminal = true;
+            info->other = false;
+            info->uuid = entry.uuid();
+        }
+        return true;
+    }
+    /* If the ace action is not drop and if ace is not terminal rule
+     * then set the uuid with the first matching uuid */
+    if (info && !info->drop && !info->terminal && !info->other) {
+        info->other = true;
+        info->uuid = entry.uuid();
+    }
+    return false;
+}
+
 bool AclDBEntry::PacketMatch(const PacketHeader &packet_header, 
-			                 MatchAclParams &m_acl, FlowPolicyInfo *info) const
+                             MatchAclParams &m_acl, FlowPolicyInfo *info) const
 {
+    EntryList entries;
+    MatchEntries(packet_header, &entries);
+    return ApplyMatch(entries, m_acl, info);
+}
+
+void AclDBEntry::MatchEntries(const PacketHeader &packet_header,
+                              EntryList *entries) const {
+    if (classifier_.get()) {
+        classifier_->Match(packet_header, entries);
+        return;
+    }
+
     AclEntries::const_iterator iter;
-    bool ret_val = false;
-    m_acl.terminal_rule = false;
-	m_acl.action_info.action = 0;
     for (iter = acl_entries_.begin();
          iter != acl_entries_.end();
          ++iter) {
-        const AclEntry::ActionList &al = iter->PacketMatch(packet_header);
-	AclEntry::ActionList::const_iterator al_it;
-	for (al_it = al.begin(); al_it != al.end(); ++al_it) {
-	     TrafficAction *ta = static_cast<TrafficAction *>(*al_it.operator->());
-	     m_acl.action_info.action |= 1 << ta->GetAction();
-	     if (ta->GetActionType() == TrafficAction::MIRROR_ACTION) {
-	         MirrorAction *a = static_cast<MirrorAction *>(*al_it.operator->());
-                 MirrorActionSpec as;
-		 as.ip = a->GetIp();
-		 as.port = a->GetPort();
-                 as.vrf_name = a->vrf_name();
-                 as.analyzer_name = a->GetAnalyzerName();
-                 as.encap = a->GetEncap();
-                 m_acl.action_info.mirror_l.push_back(as);
-	     }
-         if (ta->GetActionType() == TrafficAction::VRF_TRANSLATE_ACTION) {
-             const VrfTranslateAction *a =
-                 static_cast<VrfTranslateAction *>(*al_it.operator->());
-             VrfTranslateActionSpec vrf_translate_action(a->vrf_name(),
-                                                         a->ignore_acl());
-             m_acl.action_info.vrf_translate_action_ = vrf_translate_action;
-         }
-         if (info && ta->IsDrop()) {
-             if (!info->drop) {
-                 info->drop = true;
-                 info->terminal = false;
-                 info->other = false;
-                 info->uuid = iter->uuid();
-             }
-         }
-	}
-        if (!(al.empty())) {
-            ret_val = true;
-            m_acl.ace_id_list.push_back((int32_t)(iter->id()));
-            if (iter->IsTerminal()) {
-                m_acl.terminal_rule = true;
-                /* Set uuid only if it is NOT already set as
-                 * drop/terminal uuid */
-                if (info && !info->drop && !info->terminal) {
-                    info->terminal = true;
-                    info->other = false;
-                    info->uuid = iter->uuid();
-                }
-                return ret_val;
-            }
-            /* If the ace action is not drop and if ace is not terminal rule
-             * then set the uuid with the first matching uuid */
-            if (info && !info->drop && !info->terminal && !info->other) {
-                info->other = true;
-                info->uuid = iter->uuid();
-            }
+        if (iter->PacketMatch(packet_header).empty())
+            continue;
+        entries->push_back(iter.operator->());
+        if (iter->IsTerminal())
+            return;
+    }
+}
+
+bool AclDBEntry::ApplyMatch(const EntryList &entries, MatchAclParams &m_acl,
+                            FlowPolicyInfo *info) const {
+    m_acl.terminal_rule = false;
+    m_acl.action_info.action = 0;
+
+    EntryList::const_iterator it;
+    for (it = entries.begin(); it != entries.end(); ++it) {
+        if (ApplyEntryMatch(**it, (*it)->Actions(), m_acl, info))
+            break;
+    }
+    return !entries.empty();
+}
+
+void AclDBEntry::UpdatePortMatch() {
+    src_port_match_ = false;
+    dst_port_match_ = false;
+    AclEntries::const_iterator iter;
+    for (iter = acl_entries_.begin(); iter != acl_entries_.end(); ++iter) {
+        std::vector<AclEntryMatch *>::const_iterator it;
+        for (it = iter->matches().begin(); it != iter->matches().end(); ++it) {
+            if ((*it)->type() == AclEntryMatch::SOURCE_PORT_MATCH)
+                src_port_match_ = true;
+            if ((*it)->type() == AclEntryMatch::DESTINATION_PORT_MATCH)
+                dst_port_match_ = true;
+        }
+    }
+}
+
+void AclDBEntry::BuildClassifier() {
+    classifier_.reset();
+    generation_ = NextGeneration();
+    UpdatePortMatch();
+    if (!classifier_enabled_ || acl_entries_.empty())
+        return;
+
+    boost::scoped_ptr<AclClassifier> classifier(new AclClassifier());
+    AclEntries::const_iterator iter;
+    for (iter = acl_entries_.begin(); iter != acl_entries_.end(); ++iter) {
+        if (!classifier->AddEntry(iter.operator->())) {
+            ACL_TRACE(Info, "acl " + name_ + " entry " +
+                      integerToString(iter->id()) +
+                      " not compiled, using linear match");
+            return;
         }
     }
-    return ret_val;
+    classifier->Build();
+    classifier_.swap(classifier);
 }
 
 bool AclDBEntry::Changed(const AclEntries &new_entries) const {
@@ -8,12 +8,14 @@
 #include <boost/intrusive/list.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/intrusive_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <tbb/atomic.h>
 
 #include <filter/traffic_action.h>
 #include <filter/acl_entry_match.h>
 #include <filter/acl_entry_spec.h>
 #include <filter/acl_entry.h>
+#include <filter/acl_classifier.h>
 
 struct FlowKey;
 
@@ -81,7 +83,11 @@ public:
             &AclEntry::acl_list_node> AclEntryNode;
     typedef boost::intrusive::list<AclEntry, AclEntryNode> AclEntries;
     
-    AclDBEntry(uuid id) : uuid_(id), dynamic_acl_(false) { };
+    typedef AclClassifier::EntryList EntryList;
+
+    AclDBEntry(uuid id) : uuid_(id), dynamic_acl_(false),
+        generation_(NextGeneration()), src_port_match_(true),
+        dst_port_match_(true) { };
     ~AclDBEntry() { };
 
     bool IsLess(const DBEntry &rhs) const;
@@ -110,15 +116,55 @@ public:
     // Packet Match
     bool PacketMatch(const PacketHeader &packet_header, MatchAclParams &m_acl,
                      FlowPolicyInfo *info) const;
+    // PacketMatch in two steps, so that the entries matching a packet can
+    // be kept and applied again to packets with the same ACL fields.
+    // Entries matching the packet, in order, up to the first terminal one.
+    void MatchEntries(const PacketHeader &packet_header,
+                      EntryList *entries) const;
+    bool ApplyMatch(const EntryList &entries, MatchAclParams &m_acl,
+                    FlowPolicyInfo *info) const;
     bool Changed(const AclEntries &new_acl_entries) const;
     uint32_t ace_count() const { return acl_entries_.size();}
     bool IsRulePresent(const std::string &uuid) const;
+
+    // Compile the entries for PacketMatch. Must be called after the entries
+    // change. Without a classifier, PacketMatch evaluates every entry.
+    void BuildClassifier();
+    bool classifier_active() const { return classifier_.get() != NULL; }
+    static void set_classifier_enabled(bool enabled) {
+        classifier_enabled_ = enabled;
+    }
+
+    // Changes whenever the entries change. Unique across ACLs, so that
+    // results kept for an ACL are never mistaken for another one.
+    uint64_t generation() const { return generation_; }
+    // Whether any entry matches on source or destination port
+    bool src_port_match() const { return src_port_match_; }
+    bool dst_port_match() const { return dst_port_match_; }
 private:
     friend class AclTable;
+    // Apply the actions of an entry matching the packet. Returns true if
+    // the entry is terminal.
+    bool ApplyEntryMatch(const AclEntry &entry,
+                         const AclEntry::ActionList &al,
+                         MatchAclParams &m_acl, FlowPolicyInfo *info) const;
+
+    static uint64_t NextGeneration() {
+        return generation_counter_.fetch_and_increment();
+    }
+    void UpdatePortMatch();
+
+    static bool classifier_enabled_;
+    static tbb::atomic<uint64_t> generation_counter_;
+
     uuid uuid_;
     bool dynamic_acl_;
     std::string name_;
     AclEntries acl_entries_;
+    boost::scoped_ptr<AclClassifier> classifier_;
+    uint64_t generation_;
+    bool src_port_match_;
+    bool dst_port_match_;
     DISALLOW_COPY_AND_ASSIGN(AclDBEntry);
 };
 
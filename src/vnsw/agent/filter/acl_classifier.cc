@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+
+#include <cmn/agent_cmn.h>
+#include <agent_types.h>
+
+#include <filter/acl_entry_match.h>
+#include <filter/acl_entry.h>
+#include <filter/packet_header.h>
+#include <filter/acl_classifier.h>
+
+static const size_t kWordBits = 64;
+static const uint32_t kMaxProtocol = 0xff;
+static const uint32_t kMaxPort = 0xffff;
+static const size_t kMaxWords =
+    (AclClassifier::kMaxEntries + kWordBits - 1) / kWordBits;
+
+template <typename T>
+void AclClassifier::RangeField<T>::Add(size_t entry, const T &min,
+                                       const T &max) {
+    if (max < min)
+        return;
+    Item item;
+    item.entry = entry;
+    item.min = min;
+    item.max = max;
+    items_.push_back(item);
+}
+
+template <typename T>
+void AclClassifier::RangeField<T>::Build(size_t words) {
+    words_ = words;
+    bounds_.clear();
+    bounds_.push_back(T());
+    for (typename std::vector<Item>::const_iterator it = items_.begin();
+         it != items_.end(); ++it) {
+        bounds_.push_back(it->min);
+        if (!IsMax(it->max))
+            bounds_.push_back(Next(it->max));
+    }
+    std::sort(bounds_.begin(), bounds_.end());
+    bounds_.erase(std::unique(bounds_.begin(), bounds_.end()), bounds_.end());
+
+    bits_.assign(bounds_.size() * words_, 0);
+    for (typename std::vector<Item>::const_iterator it = items_.begin();
+         it != items_.end(); ++it) {
+        size_t first = std::lower_bound(bounds_.begin(), bounds_.end(),
+                                        it->min) - bounds_.begin();
+        size_t last = bounds_.size();
+        if (!IsMax(it->max)) {
+            last = std::lower_bound(bounds_.begin(), bounds_.end(),
+                                    Next(it->max)) - bounds_.begin();
+        }
+        Word mask = 1ULL << (it->entry % kWordBits);
+        for (size_t i = first; i < last; i++) {
+            bits_[i * words_ + it->entry / kWordBits] |= mask;
+        }
+    }
+    items_.clear();
+}
+
+template <typename T>
+const AclClassifier::Word *AclClassifier::RangeField<T>::Find(
+    const T &value) const {
+    size_t index = std::upper_bound(bounds_.begin(), bounds_.end(), value) -
+        bounds_.begin() - 1;
+    return &bits_[index * words_];
+}
+
+AclClassifier::AclClassifier() : words_(0) {
+}
+
+AclClassifier::~AclClassifier() {
+}
+
+AclClassifier::Ip6Key AclClassifier::ToIp6Key(const Ip6Address &addr) {
+    Ip6Address::bytes_type bytes = addr.to_bytes();
+    Ip6Key key;
+    for (int i = 0; i < 8; i++) {
+        key.upper = (key.upper << 8) | bytes[i];
+        key.lower = (key.lower << 8) | bytes[i + 8];
+    }
+    return key;
+}
+
+void AclClassifier::SetBit(std::vector<Word> *bits, size_t entry) {
+    if (bits->size() <= entry / kWordBits)
+        bits->resize(entry / kWordBits + 1, 0);
+    (*bits)[entry / kWordBits] |= 1ULL << (entry % kWordBits);
+}
+
+// Same semantics as AddressMatch::Match
+bool AclClassifier::AddAddress(AddressField *field, size_t entry,
+                               const AddressMatch *match) {
+    if (match->policy_id_s() == "any") {
+        SetBit(&field->any, entry);
+        return true;
+    }
+
+    switch (match->addr_type()) {
+    case AddressMatch::IP_ADDR: {
+        const IpAddress &ip = match->ip_addr();
+        const IpAddress &mask = match->ip_mask();
+        if (ip.is_v4() && mask.is_v4()) {
+            uint32_t addr = ip.to_v4().to_ulong();
+            uint32_t host = ~mask.to_v4().to_ulong();
+            // Only contiguous masks map to a single range
+            if (host & (host + 1))
+                return false;
+            // Address with bits outside the mask never matches
+            if ((addr & host) == 0) {
+                field->ip4.Add(entry, addr, addr | host);
+            }
+            return true;
+        }
+        if (ip.is_v6() && mask.is_v6()) {
+            Ip6Key addr = ToIp6Key(ip.to_v6());
+            Ip6Key host = ToIp6Key(mask.to_v6());
+            host.upper = ~host.upper;
+            host.lower = ~host.lower;
+            if (host.upper ? (host.lower != ~0ULL ||
+                              (host.upper & (host.upper + 1)))
+                           : (host.lower & (host.lower + 1))) {
+                return false;
+            }
+            if ((addr.upper & host.upper) == 0 &&
+                (addr.lower & host.lower) == 0) {
+                field->ip6.Add(entry, addr,
+                               Ip6Key(addr.upper | host.upper,
+                                      addr.lower | host.lower));
+            }
+            return true;
+        }
+        return false;
+    }
+
+    case AddressMatch::NETWORK_ID:
+        SetBit(&field->networks[match->policy_id_s()], entry);
+        return true;
+
+    case AddressMatch::SG:
+        if (match->sg_id() == AddressMatch::kAny) {
+            SetBit(&field->sg_any, entry);
+        } else {
+            SetBit(&field->sgs[match->sg_id()], entry);
+        }
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool AclClassifier::AddEntry(const AclEntry *entry) {
+    if (entry->Actions().empty())
+        return true;
+
+    size_t index = entries_.size();
+    if (index >= kMaxEntries)
+        return false;
+    bool protocol = false, src_port = false, dst_port = false;
+    bool src_addr = false, dst_addr = false;
+    std::vector<AclEntryMatch *>::const_iterator it;
+    for (it = entry->matches().begin(); it != entry->matches().end(); ++it) {
+        const AclEntryMatch *match = *it;
+        switch (match->type()) {
+        case AclEntryMatch::PROTOCOL_MATCH: {
+            if (protocol)
+                return false;
+            protocol = true;
+            const RangeSList &ranges =
+                static_cast<const ProtocolMatch *>(match)->protocol_ranges();
+            for (RangeSList::const_iterator range = ranges.begin();
+                 range != ranges.end(); ++range) {
+                protocol_.Add(index, range->min,
+                              std::min<uint32_t>(range->max, kMaxProtocol));
+            }
+            break;
+        }
+
+        case AclEntryMatch::SOURCE_PORT_MATCH:
+        case AclEntryMatch::DESTINATION_PORT_MATCH: {
+            bool src = (match->type() == AclEntryMatch::SOURCE_PORT_MATCH);
+            bool &present = src ? src_port : dst_port;
+            if (present)
+                return false;
+            present = true;
+            const RangeSList &ranges =
+                static_cast<const PortMatch *>(match)->port_ranges();
+            for (RangeSList::const_iterator range = ranges.begin();
+                 range != ranges.end(); ++range) {
+                (src ? src_port_ : dst_port_).Add(index, range->min,
+                                                  range->max);
+            }
+            break;
+        }
+
+        case AclEntryMatch::ADDRESS_MATCH: {
+            const AddressMatch *address =
+                static_cast<const AddressMatch *>(match);
+            bool &present = address->is_source() ? src_addr : dst_addr;
+            if (present)
+                return false;
+            present = true;
+            if (!AddAddress(address->is_source() ? &src_addr_ : &dst_addr_,
+                            index, address)) {
+                return false;
+            }
+            break;
+        }
+
+        default:
+            return false;
+        }
+    }
+
+    if (!protocol)
+        protocol_.Add(index, 0, kMaxProtocol);
+    if (!src_port)
+        src_port_.Add(index, 0, kMaxPort);
+    if (!dst_port)
+        dst_port_.Add(index, 0, kMaxPort);
+    if (!src_addr)
+        SetBit(&src_addr_.any, index);
+    if (!dst_addr)
+        SetBit(&dst_addr_.any, index);
+
+    entries_.push_back(entry);
+    return true;
+}
+
+void AclClassifier::BuildAddress(AddressField *field) {
+    field->any.resize(words_, 0);
+    field->sg_any.resize(words_, 0);
+    for (AddressField::NetworkMap::iterator it = field->networks.begin();
+         it != field->networks.end(); ++it) {
+        it->second.resize(words_, 0);
+    }
+    for (AddressField::SgMap::iterator it = field->sgs.begin();
+         it != field->sgs.end(); ++it) {
+        it->second.resize(words_, 0);
+    }
+    field->ip4.Build(words_);
+    field->ip6.Build(words_);
+}
+
+void AclClassifier::Build() {
+    words_ = (entries_.size() + kWordBits - 1) / kWordBits;
+    protocol_.Build(words_);
+    src_port_.Build(words_);
+    dst_port_.Build(words_);
+    BuildAddress(&src_addr_);
+    BuildAddress(&dst_addr_);
+}
+
+static void OrBits(AclClassifier::Word *bits, const AclClassifier::Word *rhs,
+                   size_t words) {
+    for (size_t i = 0; i < words; i++) {
+        bits[i] |= rhs[i];
+    }
+}
+
+void AclClassifier::AddressBits(const AddressField &field,
+                                const IpAddress &ip,
+                                const std::string *policy_id,
+                                const std::vector<int> *sg_list,
+                                Word *bits) const {
+    std::copy(field.any.begin(), field.any.end(), bits);
+    if (ip.is_v4()) {
+        OrBits(bits, field.ip4.Find(ip.to_v4().to_ulong()), words_);
+    } else if (ip.is_v6()) {
+        OrBits(bits, field.ip6.Find(ToIp6Key(ip.to_v6())), words_);
+    }
+
+    if (policy_id && !field.networks.empty()) {
+        AddressField::NetworkMap::const_iterator it =
+            field.networks.find(*policy_id);
+        if (it != field.networks.end())
+            OrBits(bits, &it->second[0], words_);
+    }
+
+    if (sg_list) {
+        OrBits(bits, &field.sg_any[0], words_);
+        for (std::vector<int>::const_iterator id = sg_list->begin();
+             !field.sgs.empty() && id != sg_list->end(); ++id) {
+            AddressField::SgMap::const_iterator it = field.sgs.find(*id);
+            if (it != field.sgs.end())
+                OrBits(bits, &it->second[0], words_);
+        }
+    }
+}
+
+void AclClassifier::Match(const PacketHeader &packet_header,
+                          EntryList *entries) const {
+    if (entries_.empty())
+        return;
+
+    const Word *protocol = protocol_.Find(packet_header.protocol);
+    // Port matches only apply to TCP and UDP
+    const Word *src_port = NULL;
+    const Word *dst_port = NULL;
+    if (packet_header.protocol == IPPROTO_TCP ||
+        packet_header.protocol == IPPROTO_UDP) {
+        src_port = src_port_.Find(packet_header.src_port);
+        dst_port = dst_port_.Find(packet_header.dst_port);
+    }
+
+    Word src_addr[kMaxWords];
+    Word dst_addr[kMaxWords];
+    AddressBits(src_addr_, packet_header.src_ip, packet_header.src_policy_id,
+                packet_header.src_sg_id_l, src_addr);
+    AddressBits(dst_addr_, packet_header.dst_ip, packet_header.dst_policy_id,
+                packet_header.dst_sg_id_l, dst_addr);
+
+    for (size_t i = 0; i < words_; i++) {
+        Word word = protocol[i] & src_addr[i] & dst_addr[i];
+        if (src_port)
+            word &= src_port[i] & dst_port[i];
+        while (word) {
+            size_t bit = __builtin_ctzll(word);
+            word &= word - 1;
+            const AclEntry *entry = entries_[i * kWordBits + bit];
+            entries->push_back(entry);
+            if (entry->IsTerminal())
+                return;
+        }
+    }
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __AGENT_ACL_CLASSIFIER_H__
+#define __AGENT_ACL_CLASSIFIER_H__
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/util.h>
+#include <net/address.h>
+
+class AclEntry;
+class AddressMatch;
+struct PacketHeader;
+
+//
+// Compiled form of the entries of an ACL, used to find the entries matching
+// a packet without evaluating every entry.
+//
+// Each entry gets a bit, in ACL order. For every field matched by the
+// entries (protocol, ports, source and destination address), the classifier
+// splits the range of values into intervals with the same set of matching
+// entries, and keeps the bitmap of the entries for each interval. A packet
+// looks up the interval of each field, and the entries matching the packet
+// are the bits set in all the bitmaps found.
+//
+// Entries without actions are left out, since they never contribute to the
+// result of a match.
+//
+class AclClassifier {
+public:
+    typedef uint64_t Word;
+    typedef std::vector<const AclEntry *> EntryList;
+
+    // Bound on the entries of a classifier, so that a lookup keeps the
+    // address bitmaps on the stack. Larger ACLs use the linear match.
+    static const size_t kMaxEntries = 1024;
+
+    AclClassifier();
+    ~AclClassifier();
+
+    // Entries are added in ACL order. Returns false if a match of the
+    // entry can not be compiled or the ACL has more than kMaxEntries
+    // entries, in which case the classifier must not be used.
+    bool AddEntry(const AclEntry *entry);
+    void Build();
+
+    // Entries matching the packet, in ACL order, up to the first terminal
+    // entry.
+    void Match(const PacketHeader &packet_header, EntryList *entries) const;
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct Ip6Key {
+        Ip6Key() : upper(0), lower(0) { }
+        Ip6Key(uint64_t upper, uint64_t lower) : upper(upper), lower(lower) { }
+        bool operator<(const Ip6Key &rhs) const {
+            return upper < rhs.upper ||
+                (upper == rhs.upper && lower < rhs.lower);
+        }
+        bool operator==(const Ip6Key &rhs) const {
+            return upper == rhs.upper && lower == rhs.lower;
+        }
+        uint64_t upper;
+        uint64_t lower;
+    };
+
+    // Bitmap of the entries matching each interval of values of a field.
+    template <typename T>
+    class RangeField {
+    public:
+        RangeField() : words_(0) { }
+        // Entry matches the values from min to max, inclusive
+        void Add(size_t entry, const T &min, const T &max);
+        void Build(size_t words);
+        const Word *Find(const T &value) const;
+
+    private:
+        struct Item {
+            size_t entry;
+            T min;
+            T max;
+        };
+        std::vector<Item> items_;
+        std::vector<T> bounds_;     // Start of each interval
+        std::vector<Word> bits_;    // Bitmap of each interval
+        size_t words_;
+    };
+
+    struct AddressField {
+        typedef std::map<std::string, std::vector<Word> > NetworkMap;
+        typedef std::map<int, std::vector<Word> > SgMap;
+
+        std::vector<Word> any;          // Entries matching any address
+        RangeField<uint32_t> ip4;
+        RangeField<Ip6Key> ip6;
+        NetworkMap networks;
+        SgMap sgs;
+        std::vector<Word> sg_any;       // Entries matching any SG list
+    };
+
+    static bool IsMax(uint32_t value) { return value == 0xffffffff; }
+    static uint32_t Next(uint32_t value) { return value + 1; }
+    static bool IsMax(const Ip6Key &value) {
+        return value.upper == ~0ULL && value.lower == ~0ULL;
+    }
+    static Ip6Key Next(const Ip6Key &value) {
+        return Ip6Key(value.upper + (value.lower == ~0ULL ? 1 : 0),
+                      value.lower + 1);
+    }
+    static Ip6Key ToIp6Key(const Ip6Address &addr);
+    static void SetBit(std::vector<Word> *bits, size_t entry);
+
+    bool AddAddress(AddressField *field, size_t entry,
+                    const AddressMatch *match);
+    void BuildAddress(AddressField *field);
+    void AddressBits(const AddressField &field, const IpAddress &ip,
+                     const std::string *policy_id,
+                     const std::vector<int> *sg_list, Word *bits) const;
+
+    std::vector<const AclEntry *> entries_;
+    size_t words_;
+    RangeField<uint32_t> protocol_;
+    RangeField<uint32_t> src_port_;
+    RangeField<uint32_t> dst_port_;
+    AddressField src_addr_;
+    AddressField dst_addr_;
+
+    DISALLOW_COPY_AND_ASSIGN(AclClassifier);
+};
+
+#endif
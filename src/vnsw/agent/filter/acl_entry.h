@@ -49,6 +49,7 @@ public:
     // Match packet header
     const ActionList &PacketMatch(const PacketHeader &packet_header) const;
     const ActionList &Actions() const {return actions_;};
+    const std::vector<AclEntryMatch *> &matches() const { return matches_; }
 
     void SetAclEntrySandeshData(AclEntrySandeshData &data) const;
 
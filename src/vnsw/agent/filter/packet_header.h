@@ -13,7 +13,7 @@
 struct PacketHeader {
     //typedef std::vector<uint32_t> sgl;
   PacketHeader() : vrf(-1), src_ip(), src_policy_id(NULL),
-        dst_ip(), dst_policy_id(NULL),
+        src_sg_id_l(NULL), dst_ip(), dst_policy_id(NULL), dst_sg_id_l(NULL),
         protocol(0), src_port(0), dst_port(0) {};
     uint32_t vrf;
     IpAddress src_ip;
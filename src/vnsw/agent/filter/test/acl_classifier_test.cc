@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/os.h"
+#include <stdlib.h>
+#include <iostream>
+#include <test_cmn_util.h>
+#include <base/time_util.h>
+#include <filter/packet_header.h>
+#include "filter/test/acl_test_util.h"
+
+using namespace std;
+
+void RouterIdDepInit(Agent *agent) {
+}
+
+namespace {
+
+static const char *kNetworks[] = { "vn1", "vn2", "vn3", "vn4" };
+
+class AclClassifierTest : public AclTestBase {
+protected:
+    AclClassifierTest()
+        : AclTestBase("ACL_CLASSIFIER_TEST_LOOKUP_COUNT", 100000) {
+    }
+
+    static IpAddress PrefixMask(int plen) {
+        return Ip4Address(plen ? (0xffffffff << (32 - plen)) : 0);
+    }
+
+    // Rules over 10.0.0.0/16, with a mix of subnets, networks, security
+    // groups, protocols and port ranges. The last rule is terminal.
+    AclEntrySpec RandomEntry(uint32_t id, bool last) {
+        AclEntrySpec ae_spec;
+        ae_spec.id = id;
+        ae_spec.terminal = last || (rand() % 4 == 0);
+
+        if (!last) {
+            int plen = 16 + rand() % 17;
+            uint32_t addr = (0x0a000000 | (rand() & 0xffff)) &
+                PrefixMask(plen).to_v4().to_ulong();
+            switch (rand() % 4) {
+            case 0:
+                ae_spec.src_addr_type = AddressMatch::IP_ADDR;
+                ae_spec.src_ip_addr = Ip4Address(addr);
+                ae_spec.src_ip_mask = PrefixMask(plen);
+                ae_spec.src_ip_plen = plen;
+                break;
+            case 1:
+                ae_spec.src_addr_type = AddressMatch::NETWORK_ID;
+                ae_spec.src_policy_id_str = kNetworks[rand() % 4];
+                break;
+            case 2:
+                ae_spec.src_addr_type = AddressMatch::SG;
+                ae_spec.src_sg_id = 1 + rand() % 8;
+                break;
+            default:
+                break;
+            }
+            plen = 16 + rand() % 17;
+            addr = (0x0a000000 | (rand() & 0xffff)) &
+                PrefixMask(plen).to_v4().to_ulong();
+            if (rand() % 2) {
+                ae_spec.dst_addr_type = AddressMatch::IP_ADDR;
+                ae_spec.dst_ip_addr = Ip4Address(addr);
+                ae_spec.dst_ip_mask = PrefixMask(plen);
+                ae_spec.dst_ip_plen = plen;
+            } else if (rand() % 2) {
+                ae_spec.dst_addr_type = AddressMatch::NETWORK_ID;
+                ae_spec.dst_policy_id_str = kNetworks[rand() % 4];
+            }
+            if (rand() % 2) {
+                uint16_t proto = (rand() % 2) ? IPPROTO_TCP : IPPROTO_UDP;
+                AddRange(&ae_spec.protocol, proto, proto);
+            }
+            if (rand() % 2) {
+                uint16_t port = rand() % 1024;
+                AddRange(&ae_spec.dst_port, port, port + rand() % 64);
+            }
+            if (rand() % 4 == 0) {
+                AddRange(&ae_spec.src_port, 1024, 65535);
+            }
+        }
+
+        ActionSpec action;
+        action.ta_type = TrafficAction::SIMPLE_ACTION;
+        action.simple_action = (rand() % 2) ? TrafficAction::PASS :
+            TrafficAction::DENY;
+        ae_spec.action_l.push_back(action);
+        return ae_spec;
+    }
+
+    AclDBEntry *AddAcl(int id, int rule_count) {
+        AclSpec acl_spec;
+        acl_spec.acl_id = MakeUuid(id);
+        for (int i = 0; i < rule_count; i++) {
+            acl_spec.acl_entry_specs_.push_back(
+                RandomEntry(i + 1, i == rule_count - 1));
+        }
+        return AddAclSpec(acl_spec);
+    }
+
+    void RandomPacket(PacketHeader *hdr) {
+        hdr->src_ip = Ip4Address(0x0a000000 | (rand() & 0xffff));
+        hdr->dst_ip = Ip4Address(0x0a000000 | (rand() & 0xffff));
+        hdr->src_policy_id = &networks_[rand() % 4];
+        hdr->dst_policy_id = &networks_[rand() % 4];
+        hdr->src_sg_id_l = &sg_list_[rand() % 3];
+        hdr->dst_sg_id_l = &sg_list_[rand() % 3];
+        switch (rand() % 3) {
+        case 0: hdr->protocol = IPPROTO_TCP; break;
+        case 1: hdr->protocol = IPPROTO_UDP; break;
+        default: hdr->protocol = IPPROTO_ICMP; break;
+        }
+        hdr->src_port = rand() % 2 ? rand() % 1024 : 1024 + rand() % 64512;
+        hdr->dst_port = rand() % 1100;
+    }
+
+    // Matches each packet with and without the classifier, and returns the
+    // lookup rate of each.
+    void Compare(AclDBEntry *acl, const std::vector<PacketHeader> &packets,
+                 uint64_t *linear_rate, uint64_t *classifier_rate) {
+        ASSERT_TRUE(acl->classifier_active());
+        std::vector<MatchAclParams> expected(packets.size());
+        AclDBEntry::set_classifier_enabled(false);
+        acl->BuildClassifier();
+        EXPECT_FALSE(acl->classifier_active());
+        for (size_t i = 0; i < packets.size(); i++) {
+            acl->PacketMatch(packets[i], expected[i], NULL);
+        }
+        *linear_rate = Run(acl, packets);
+
+        AclDBEntry::set_classifier_enabled(true);
+        acl->BuildClassifier();
+        EXPECT_TRUE(acl->classifier_active());
+        for (size_t i = 0; i < packets.size(); i++) {
+            MatchAclParams m_acl;
+            acl->PacketMatch(packets[i], m_acl, NULL);
+            EXPECT_EQ(expected[i].action_info.action,
+                      m_acl.action_info.action);
+            EXPECT_TRUE(expected[i].ace_id_list == m_acl.ace_id_list);
+            EXPECT_EQ(expected[i].terminal_rule, m_acl.terminal_rule);
+        }
+        *classifier_rate = Run(acl, packets);
+    }
+
+    uint64_t Run(AclDBEntry *acl, const std::vector<PacketHeader> &packets) {
+        uint64_t start = ClockMonotonicUsec();
+        for (size_t i = 0; i < count_; i++) {
+            MatchAclParams m_acl;
+            acl->PacketMatch(packets[i % packets.size()], m_acl, NULL);
+        }
+        uint64_t elapsed = ClockMonotonicUsec() - start;
+        return elapsed ? count_ * 1000000 / elapsed : 0;
+    }
+
+    void TestScale(int rule_count) {
+        networks_.clear();
+        for (int i = 0; i < 4; i++) {
+            networks_.push_back(kNetworks[i]);
+        }
+        sg_list_[0].clear();
+        sg_list_[1].clear();
+        sg_list_[1].push_back(1 + rand() % 8);
+        sg_list_[2] = sg_list_[1];
+        sg_list_[2].push_back(1 + rand() % 8);
+
+        AclDBEntry *acl = AddAcl(rule_count, rule_count);
+        ASSERT_TRUE(acl != NULL);
+        std::vector<PacketHeader> packets(4096);
+        for (size_t i = 0; i < packets.size(); i++) {
+            RandomPacket(&packets[i]);
+        }
+
+        uint64_t linear_rate, classifier_rate;
+        Compare(acl, packets, &linear_rate, &classifier_rate);
+        std::cout << rule_count << " rules: linear " << linear_rate
+                  << " lookups/sec, classifier " << classifier_rate
+                  << " lookups/sec" << std::endl;
+        DelAcl(rule_count);
+    }
+
+    std::vector<std::string> networks_;
+    SecurityGroupList sg_list_[3];
+};
+
+TEST_F(AclClassifierTest, Scale10) {
+    TestScale(10);
+}
+
+TEST_F(AclClassifierTest, Scale100) {
+    TestScale(100);
+}
+
+TEST_F(AclClassifierTest, Scale1000) {
+    TestScale(1000);
+}
+
+// ACLs with more than kMaxEntries entries use the linear match.
+TEST_F(AclClassifierTest, MaxEntries) {
+    AclDBEntry *acl = AddAcl(1, AclClassifier::kMaxEntries);
+    ASSERT_TRUE(acl != NULL);
+    EXPECT_TRUE(acl->classifier_active());
+    DelAcl(1);
+
+    acl = AddAcl(2, AclClassifier::kMaxEntries + 1);
+    ASSERT_TRUE(acl != NULL);
+    EXPECT_FALSE(acl->classifier_active());
+
+    PacketHeader hdr;
+    hdr.src_ip = Ip4Address(0x0a000001);
+    hdr.dst_ip = Ip4Address(0x0a000002);
+    hdr.protocol = IPPROTO_TCP;
+    MatchAclParams m_acl;
+    EXPECT_TRUE(acl->PacketMatch(hdr, m_acl, NULL));
+    DelAcl(2);
+}
+
+// Non contiguous masks are not compiled, the ACL uses the linear match.
+TEST_F(AclClassifierTest, NonContiguousMask) {
+    AclSpec acl_spec;
+    acl_spec.acl_id = MakeUuid(1);
+    AclEntrySpec ae_spec;
+    ae_spec.id = 1;
+    ae_spec.src_addr_type = AddressMatch::IP_ADDR;
+    ae_spec.src_ip_addr = Ip4Address(0x0a000001);
+    ae_spec.src_ip_mask = Ip4Address(0xff0000ff);
+    ActionSpec action;
+    action.ta_type = TrafficAction::SIMPLE_ACTION;
+    action.simple_action = TrafficAction::PASS;
+    ae_spec.action_l.push_back(action);
+    acl_spec.acl_entry_specs_.push_back(ae_spec);
+
+    AclDBEntry *acl = AddAclSpec(acl_spec);
+    ASSERT_TRUE(acl != NULL);
+    EXPECT_FALSE(acl->classifier_active());
+
+    PacketHeader hdr;
+    hdr.src_ip = Ip4Address(0x0a010201);
+    MatchAclParams m_acl;
+    EXPECT_TRUE(acl->PacketMatch(hdr, m_acl, NULL));
+    EXPECT_EQ((uint32_t)(1 << TrafficAction::PASS), m_acl.action_info.action);
+    DelAcl(1);
+}
+
+} //namespace
+
+int main (int argc, char **argv) {
+    GETUSERARGS();
+    client = TestInit(init_file, ksync_init);
+
+    int ret = RUN_ALL_TESTS();
+    TestShutdown();
+    delete client;
+    return ret;
+}
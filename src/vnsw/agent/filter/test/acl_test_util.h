@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+#ifndef __acl_test_util__
+#define __acl_test_util__
+
+#include <stdlib.h>
+#include <test_cmn_util.h>
+
+// Fixture for tests adding ACLs directly to the oper DB. The number of
+// iterations of the test is read from the environment variable count_env,
+// and the random number generator is seeded so runs are repeatable.
+class AclTestBase : public ::testing::Test {
+protected:
+    AclTestBase(const char *count_env, size_t count)
+        : table_(Agent::GetInstance()->acl_table()), count_(count) {
+        char *str = getenv(count_env);
+        if (str) count_ = strtoul(str, NULL, 0);
+        srand(1);
+    }
+
+    static void AddRange(std::vector<RangeSpec> *list, uint16_t min,
+                         uint16_t max) {
+        RangeSpec range;
+        range.min = min;
+        range.max = max;
+        list->push_back(range);
+    }
+
+    AclDBEntry *AddAclSpec(const AclSpec &acl_spec) {
+        DBRequest req;
+        req.key.reset(new AclKey(acl_spec.acl_id));
+        req.data.reset(new AclData(acl_spec));
+        req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        table_->Enqueue(&req);
+        client->WaitForIdle();
+
+        AclKey key(acl_spec.acl_id);
+        return static_cast<AclDBEntry *>(table_->FindActiveEntry(&key));
+    }
+
+    void DelAcl(int id) {
+        DBRequest req;
+        req.key.reset(new AclKey(MakeUuid(id)));
+        req.oper = DBRequest::DB_ENTRY_DELETE;
+        table_->Enqueue(&req);
+        client->WaitForIdle();
+    }
+
+    AclTable *table_;
+    size_t count_;
+};
+
+#endif
@@ -449,6 +449,10 @@ void AgentParam::ParseFlows() {
         "FLOWS.max_vm_linklocal_flows")) {
         linklocal_vm_flows_ = Agent::kDefaultMaxLinkLocalOpenFds;
     }
+    if (!GetValueFromTree<uint16_t>(flow_thread_count_,
+        "FLOWS.thread_count")) {
+        flow_thread_count_ = Agent::kDefaultFlowThreadCount;
+    }
 }
 
 void AgentParam::ParseHeadlessMode() {
@@ -463,6 +467,13 @@ void AgentParam::ParseDhcpRelayMode() {
     }
 }
 
+void AgentParam::ParseKSyncBatchMode() {
+    if (!GetValueFromTree<bool>(ksync_batch_mode_,
+                                "DEFAULT.ksync_batch_mode")) {
+        ksync_batch_mode_ = false;
+    }
+}
+
 void AgentParam::ParseAgentMode() {
     std::string mode;
     GetValueFromTree<string>(mode, "DEFAULT.agent_mode");
@@ -633,6 +644,7 @@ void AgentParam::ParseFlowArguments
                           "FLOWS.max_system_linklocal_flows");
     GetOptValue<uint16_t>(var_map, linklocal_vm_flows_,
                           "FLOWS.max_vm_linklocal_flows");
+    GetOptValue<uint16_t>(var_map, flow_thread_count_, "FLOWS.thread_count");
 }
 
 void AgentParam::ParseHeadlessModeArguments
@@ -645,6 +657,11 @@ void AgentParam::ParseDhcpRelayModeArguments
     GetOptValue<bool>(var_map, dhcp_relay_mode_, "DEFAULT.dhcp_relay_mode");
 }
 
+void AgentParam::ParseKSyncBatchModeArguments
+    (const boost::program_options::variables_map &var_map) {
+    GetOptValue<bool>(var_map, ksync_batch_mode_, "DEFAULT.ksync_batch_mode");
+}
+
 void AgentParam::ParseAgentModeArguments
     (const boost::program_options::variables_map &var_map) {
     std::string mode;
@@ -740,6 +757,7 @@ void AgentParam::InitFromConfig() {
     ParseFlows();
     ParseHeadlessMode();
     ParseDhcpRelayMode();
+    ParseKSyncBatchMode();
     ParseSimulateEvpnTor();
     ParseServiceInstance();
     ParseAgentMode();
@@ -763,6 +781,7 @@ void AgentParam::InitFromArguments() {
     ParseMetadataProxyArguments(var_map_);
     ParseHeadlessModeArguments(var_map_);
     ParseDhcpRelayModeArguments(var_map_);
+    ParseKSyncBatchModeArguments(var_map_);
     ParseServiceInstanceArguments(var_map_);
     ParseAgentModeArguments(var_map_);
     ParseNexthopServerArguments(var_map_);
@@ -771,10 +790,15 @@ void AgentParam::InitFromArguments() {
 }
 
 // Update max_vm_flows_ if it is greater than 100.
+// Use at least one flow setup partition.
 // Update linklocal max flows if they are greater than the max allowed for the
 // process. Also, ensure that the process is allowed to open upto
 // linklocal_system_flows + kMaxOtherOpenFds files
 void AgentParam::ComputeFlowLimits() {
+    if (flow_thread_count_ == 0) {
+        cout << "Updating flows configuration thread-count to : 1\n";
+        flow_thread_count_ = 1;
+    }
     if (max_vm_flows_ > 100) {
         cout << "Updating flows configuration max-vm-flows to : 100%\n";
         max_vm_flows_ = 100;
@@ -969,6 +993,7 @@ void AgentParam::LogConfig() const {
     LOG(DEBUG, "Linklocal Max System Flows  : " << linklocal_system_flows_);
     LOG(DEBUG, "Linklocal Max Vm Flows      : " << linklocal_vm_flows_);
     LOG(DEBUG, "Flow cache timeout          : " << flow_cache_timeout_);
+    LOG(DEBUG, "Flow thread count           : " << flow_thread_count_);
 
     if (agent_mode_ == VROUTER_AGENT)
         LOG(DEBUG, "Agent Mode                  : Vrouter");
@@ -979,6 +1004,7 @@ void AgentParam::LogConfig() const {
 
     LOG(DEBUG, "Headless Mode               : " << headless_mode_);
     LOG(DEBUG, "DHCP Relay Mode             : " << dhcp_relay_mode_);
+    LOG(DEBUG, "KSync Batch Mode            : " << ksync_batch_mode_);
     if (simulate_evpn_tor_) {
         LOG(DEBUG, "Simulate EVPN TOR           : " << simulate_evpn_tor_);
     }
@@ -1059,7 +1085,9 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
         mgmt_ip_(), hypervisor_mode_(MODE_KVM), xen_ll_(),
         tunnel_type_(), metadata_shared_secret_(), max_vm_flows_(),
         linklocal_system_flows_(), linklocal_vm_flows_(),
-        flow_cache_timeout_(), config_file_(), program_name_(),
+        flow_cache_timeout_(),
+        flow_thread_count_(Agent::kDefaultFlowThreadCount),
+        config_file_(), program_name_(),
         log_file_(), log_local_(false), log_flow_(false), log_level_(),
         log_category_(), use_syslog_(false),
         http_server_port_(), host_name_(),
@@ -1068,6 +1096,7 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
         vrouter_stats_interval_(kVrouterStatsInterval),
         vmware_physical_port_(""), test_mode_(false), debug_(false), tree_(),
         headless_mode_(false), dhcp_relay_mode_(false),
+        ksync_batch_mode_(false),
         simulate_evpn_tor_(false), si_netns_command_(),
         si_docker_command_(), si_netns_workers_(0),
         si_netns_timeout_(0), si_haproxy_ssl_cert_path_(),
@@ -1102,6 +1131,8 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
          "Run compute-node in headless mode")
         ("DEFAULT.dhcp_relay_mode", opt::value<bool>(),
          "Enable / Disable DHCP relay of DHCP packets from virtual instance")
+        ("DEFAULT.ksync_batch_mode", opt::value<bool>(),
+         "Pack multiple KSync requests into one vrouter transmission")
         ("DEFAULT.http_server_port", 
          opt::value<uint16_t>()->default_value(ContrailPorts::HttpPortAgent()), 
          "Sandesh HTTP listener port")
@@ -1155,6 +1186,8 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
              "Maximum number of link-local flows allowed across all VMs")
             ("FLOWS.max_vm_linklocal_flows", opt::value<uint16_t>(), 
              "Maximum number of link-local flows allowed per VM")
+            ("FLOWS.thread_count", opt::value<uint16_t>(),
+             "Number of partitions (threads) used for flow setup")
             ;
         options_.add(flow);
     }
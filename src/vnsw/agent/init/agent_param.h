@@ -107,8 +107,11 @@ public:
     uint32_t linklocal_system_flows() const { return linklocal_system_flows_; }
     uint32_t linklocal_vm_flows() const { return linklocal_vm_flows_; }
     uint32_t flow_cache_timeout() const {return flow_cache_timeout_;}
+    uint16_t flow_thread_count() const { return flow_thread_count_; }
+    void set_flow_thread_count(uint16_t count) { flow_thread_count_ = count; }
     bool headless_mode() const {return headless_mode_;}
     bool dhcp_relay_mode() const {return dhcp_relay_mode_;}
+    bool ksync_batch_mode() const {return ksync_batch_mode_;}
     bool simulate_evpn_tor() const {return simulate_evpn_tor_;}
     std::string si_netns_command() const {return si_netns_command_;}
     std::string si_docker_command() const {return si_docker_command_;}
@@ -273,6 +276,7 @@ private:
     void ParseFlows();
     void ParseHeadlessMode();
     void ParseDhcpRelayMode();
+    void ParseKSyncBatchMode();
     void ParseSimulateEvpnTor();
     void ParseServiceInstance();
     void ParseAgentMode();
@@ -300,6 +304,8 @@ private:
         (const boost::program_options::variables_map &v);
     void ParseDhcpRelayModeArguments
         (const boost::program_options::variables_map &var_map);
+    void ParseKSyncBatchModeArguments
+        (const boost::program_options::variables_map &var_map);
     void ParseServiceInstanceArguments
         (const boost::program_options::variables_map &v);
     void ParseAgentModeArguments
@@ -340,6 +346,7 @@ private:
     uint16_t linklocal_system_flows_;
     uint16_t linklocal_vm_flows_;
     uint16_t flow_cache_timeout_;
+    uint16_t flow_thread_count_;
 
     // Parameters configured from command line arguments only (for now)
     std::string config_file_;
@@ -367,6 +374,7 @@ private:
     std::auto_ptr<VirtualGatewayConfigTable> vgw_config_table_;
     bool headless_mode_;
     bool dhcp_relay_mode_;
+    bool ksync_batch_mode_;
     //Simulate EVPN TOR mode moves agent into L2 mode. This mode is required
     //only for testing where MX and bare metal are simulated. VM on the
     //simulated compute node behaves as bare metal.
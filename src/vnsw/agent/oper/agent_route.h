@@ -11,6 +11,7 @@
 #include <net/address.h>
 
 #include <base/lifetime.h>
+#include <base/multibit_trie.h>
 #include <base/patricia.h>
 #include <base/task_annotations.h>
 
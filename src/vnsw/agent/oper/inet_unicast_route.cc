@@ -38,6 +38,9 @@ AgentRouteKey *InetUnicastRouteKey::Clone() const {
 /////////////////////////////////////////////////////////////////////////////
 // InetUnicastAgentRouteTable functions
 /////////////////////////////////////////////////////////////////////////////
+std::size_t InetUnicastAgentRouteTable::lpm_index_threshold_ =
+    InetUnicastAgentRouteTable::kDefaultLpmIndexThreshold;
+
 InetUnicastAgentRouteTable::InetUnicastAgentRouteTable(DB *db,
                                                        const std::string &name) :
     AgentRouteTable(db, name), walkid_(DBTableWalker::kInvalidWalkerId) {
@@ -64,8 +67,49 @@ InetUnicastAgentRouteTable::CreateTable(DB *db, const std::string &name) {
     return table;
 }
 
+void InetUnicastAgentRouteTable::ProcessAdd(AgentRoute *rt) {
+    InetUnicastRouteEntry *entry = static_cast<InetUnicastRouteEntry *>(rt);
+    if (tree_.Insert(entry) == false)
+        return;
+
+    if (lpm_index_.get()) {
+        lpm_index_->Insert(entry);
+    } else if (lpm_index_threshold_ &&
+               tree_.Size() >= lpm_index_threshold_) {
+        lpm_index_.reset(new InetRouteIndex());
+        for (InetRouteTree::Iterator it = tree_.begin(); it != tree_.end();
+             ++it) {
+            lpm_index_->Insert(*it);
+        }
+    }
+}
+
+void InetUnicastAgentRouteTable::ProcessDelete(AgentRoute *rt) {
+    InetUnicastRouteEntry *entry = static_cast<InetUnicastRouteEntry *>(rt);
+    if (tree_.Remove(entry) == false)
+        return;
+
+    if (lpm_index_.get() == NULL)
+        return;
+    if (tree_.Size() < lpm_index_threshold_ / 2 ||
+        lpm_index_threshold_ == 0) {
+        lpm_index_.reset();
+    } else {
+        lpm_index_->Remove(entry);
+    }
+}
+
 InetUnicastRouteEntry *
 InetUnicastAgentRouteTable::FindLPM(const IpAddress &ip) {
+    if (lpm_index_.get()) {
+        if (ip.is_v4()) {
+            Ip4Address::bytes_type bytes = ip.to_v4().to_bytes();
+            return lpm_index_->LPMFind(bytes.data(), bytes.size());
+        }
+        Ip6Address::bytes_type bytes = ip.to_v6().to_bytes();
+        return lpm_index_->LPMFind(bytes.data(), bytes.size());
+    }
+
     uint32_t plen = 128;
     if (ip.is_v4()) {
         plen = 32;
@@ -76,6 +120,11 @@ InetUnicastAgentRouteTable::FindLPM(const IpAddress &ip) {
 
 InetUnicastRouteEntry *
 InetUnicastAgentRouteTable::FindLPM(const InetUnicastRouteEntry &rt_key) {
+    // The trie only answers lookups of complete addresses
+    uint8_t host_plen = rt_key.addr().is_v4() ? 32 : 128;
+    if (lpm_index_.get() && rt_key.plen() == host_plen) {
+        return lpm_index_->LPMFind(&rt_key);
+    }
     return tree_.LPMFind(&rt_key);
 }
 
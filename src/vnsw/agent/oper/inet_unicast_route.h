@@ -141,6 +141,13 @@ public:
     typedef Patricia::Tree<InetUnicastRouteEntry,
                            &InetUnicastRouteEntry::rtnode_,
                            InetUnicastRouteEntry::Rtkey> InetRouteTree;
+    typedef MultibitTrie<InetUnicastRouteEntry,
+                         InetUnicastRouteEntry::Rtkey> InetRouteIndex;
+
+    // Tables with at least this many routes also keep the routes in a
+    // multibit trie, used for longest prefix match of host addresses. The
+    // trie is released when the table shrinks below half the threshold.
+    static const std::size_t kDefaultLpmIndexThreshold = 1024;
 
     InetUnicastAgentRouteTable(DB *db, const std::string &name);
     virtual ~InetUnicastAgentRouteTable() { }
@@ -159,12 +166,8 @@ public:
     virtual Agent::RouteTableType GetTableType() const {
         return type_;
     }
-    virtual void ProcessAdd(AgentRoute *rt) { 
-        tree_.Insert(static_cast<InetUnicastRouteEntry *>(rt));
-    }
-    virtual void ProcessDelete(AgentRoute *rt) { 
-        tree_.Remove(static_cast<InetUnicastRouteEntry *>(rt));
-    }
+    virtual void ProcessAdd(AgentRoute *rt);
+    virtual void ProcessDelete(AgentRoute *rt);
     InetUnicastRouteEntry *FindRouteUsingKey(InetUnicastRouteEntry &key) {
         return FindLPM(key);
     }
@@ -309,9 +312,19 @@ public:
     bool ResyncSubnetRoutes(const InetUnicastRouteEntry *rt,
                             bool add_change);
 
+    bool lpm_index_enabled() const { return lpm_index_.get() != NULL; }
+    static std::size_t lpm_index_threshold() { return lpm_index_threshold_; }
+    // Takes effect on the next change of each table. 0 disables the trie.
+    static void set_lpm_index_threshold(std::size_t threshold) {
+        lpm_index_threshold_ = threshold;
+    }
+
 private:
+    static std::size_t lpm_index_threshold_;
+
     Agent::RouteTableType type_;
     InetRouteTree tree_;
+    boost::scoped_ptr<InetRouteIndex> lpm_index_;
     Patricia::Node rtnode_;
     DBTableWalker::WalkId walkid_;
     DISALLOW_COPY_AND_ASSIGN(InetUnicastAgentRouteTable);
@@ -59,6 +59,11 @@ void AgentStatsReq::HandleRequest() const {
             stats->flow_drop_due_to_linklocal_limit());
     flow->set_flow_max_system_flows(agent->flow_table_size());
     flow->set_flow_max_vm_flows(agent->pkt()->flow_table()->max_vm_flows());
+    const FlowPolicyCache::Stats &cache_stats =
+        agent->pkt()->flow_table()->policy_cache_stats();
+    flow->set_flow_policy_cache_hits(cache_stats.hits);
+    flow->set_flow_policy_cache_misses(cache_stats.misses);
+    flow->set_flow_policy_cache_flushes(cache_stats.flushes);
     flow->set_context(context());
     flow->set_more(true);
     flow->Response();
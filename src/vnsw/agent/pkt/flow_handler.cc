@@ -20,18 +20,31 @@ static const VmEntry *InterfaceToVm(const Interface *intf) {
     return vm_port->vm();
 }
 
+//
+// Runs in the Agent::FlowHandler task instance of the flow's partition.
+// Classification of the packet runs concurrently with other partitions;
+// the FlowTable and its flows are only accessed with its mutex held. The
+// fields of a recomputed flow are copied to the packet before the mutex is
+// released, and the flow is checked again before it is updated, as it may
+// have been deleted meanwhile. The reference on the flow carried by a
+// recompute message is also released with the mutex held since releasing
+// the last reference removes the flow from the table.
+//
 bool FlowHandler::Run() {
     PktControlInfo in;
     PktControlInfo out;
-    PktFlowInfo info(pkt_info_, agent_->pkt()->flow_table());
+    FlowTable *table = agent_->pkt()->flow_table();
+    PktFlowInfo info(pkt_info_, table);
     std::auto_ptr<FlowTaskMsg> ipc;
 
     if (pkt_info_->type == PktType::MESSAGE) {
+        tbb::mutex::scoped_lock lock(table->mutex());
         ipc = std::auto_ptr<FlowTaskMsg>(static_cast<FlowTaskMsg *>(pkt_info_->ipc));
         pkt_info_->ipc = NULL;
         FlowEntry *fe = ipc->fe_ptr.get();
         assert(fe->set_pending_recompute(false));
         if (fe->deleted() || fe->is_flags_set(FlowEntry::ShortFlow)) {
+            ipc.reset();
             return true;
         }
         info.flow_entry = fe;
@@ -75,6 +88,13 @@ bool FlowHandler::Run() {
         out.vm_ = InterfaceToVm(out.intf_);
     }
 
+    tbb::mutex::scoped_lock lock(table->mutex());
+    if (info.flow_entry && (info.flow_entry->deleted() ||
+        info.flow_entry->is_flags_set(FlowEntry::ShortFlow))) {
+        ipc.reset();
+        return true;
+    }
     info.Add(pkt_info_.get(), &in, &out);
+    ipc.reset();
     return true;
 }
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <boost/functional/hash.hpp>
+
+#include <filter/packet_header.h>
+#include <pkt/flow_policy_cache.h>
+
+static const std::string kEmptyVn;
+static const SecurityGroupList kEmptySgList;
+
+static void HashCombineAddress(std::size_t *seed, const IpAddress &addr) {
+    if (addr.is_v4()) {
+        boost::hash_combine(*seed, addr.to_v4().to_ulong());
+    } else {
+        const Ip6Address::bytes_type bytes = addr.to_v6().to_bytes();
+        boost::hash_range(*seed, bytes.begin(), bytes.end());
+    }
+}
+
+FlowPolicyCache::Key::Key(const AclDBEntry *acl,
+                          const PacketHeader &packet_header)
+    : acl(acl), acl_generation(acl->generation()),
+      src_ip(packet_header.src_ip), dst_ip(packet_header.dst_ip),
+      protocol(packet_header.protocol),
+      src_port(acl->src_port_match() ? packet_header.src_port : 0),
+      dst_port(acl->dst_port_match() ? packet_header.dst_port : 0),
+      src_vn(packet_header.src_policy_id ? packet_header.src_policy_id :
+             &kEmptyVn),
+      dst_vn(packet_header.dst_policy_id ? packet_header.dst_policy_id :
+             &kEmptyVn),
+      src_sg_l(packet_header.src_sg_id_l ? packet_header.src_sg_id_l :
+               &kEmptySgList),
+      dst_sg_l(packet_header.dst_sg_id_l ? packet_header.dst_sg_id_l :
+               &kEmptySgList),
+      hash(0) {
+    boost::hash_combine(hash, acl);
+    boost::hash_combine(hash, acl_generation);
+    HashCombineAddress(&hash, src_ip);
+    HashCombineAddress(&hash, dst_ip);
+    boost::hash_combine(hash, protocol);
+    boost::hash_combine(hash, src_port);
+    boost::hash_combine(hash, dst_port);
+    boost::hash_combine(hash, *src_vn);
+    boost::hash_combine(hash, *dst_vn);
+    boost::hash_range(hash, src_sg_l->begin(), src_sg_l->end());
+    boost::hash_range(hash, dst_sg_l->begin(), dst_sg_l->end());
+}
+
+bool FlowPolicyCache::Key::operator==(const Key &rhs) const {
+    return hash == rhs.hash && acl == rhs.acl &&
+        acl_generation == rhs.acl_generation &&
+        src_ip == rhs.src_ip && dst_ip == rhs.dst_ip &&
+        protocol == rhs.protocol && src_port == rhs.src_port &&
+        dst_port == rhs.dst_port &&
+        (src_vn == rhs.src_vn || *src_vn == *rhs.src_vn) &&
+        (dst_vn == rhs.dst_vn || *dst_vn == *rhs.dst_vn) &&
+        (src_sg_l == rhs.src_sg_l || *src_sg_l == *rhs.src_sg_l) &&
+        (dst_sg_l == rhs.dst_sg_l || *dst_sg_l == *rhs.dst_sg_l);
+}
+
+FlowPolicyCache::FlowPolicyCache(Stats *table_stats)
+    : table_stats_(table_stats) {
+}
+
+FlowPolicyCache::~FlowPolicyCache() {
+}
+
+bool FlowPolicyCache::PacketMatch(const AclDBEntry *acl,
+                                  const PacketHeader &packet_header,
+                                  MatchAclParams &m_acl,
+                                  FlowPolicyInfo *info) {
+    Key key(acl, packet_header);
+    Map::const_iterator it = map_.find(key);
+    if (it != map_.end()) {
+        stats_.hits++;
+        if (table_stats_)
+            table_stats_->hits++;
+        return acl->ApplyMatch(it->second, m_acl, info);
+    }
+
+    stats_.misses++;
+    if (table_stats_)
+        table_stats_->misses++;
+    // Results of ACLs no longer in use, or of previous generations of an
+    // ACL, are only dropped when the cache fills up
+    if (map_.size() >= kMaxEntries) {
+        Clear();
+        stats_.flushes++;
+        if (table_stats_)
+            table_stats_->flushes++;
+    }
+
+    // The stored key must not refer to the packet
+    key.src_vn = &*vns_.insert(*key.src_vn).first;
+    key.dst_vn = &*vns_.insert(*key.dst_vn).first;
+    key.src_sg_l = &*sg_lists_.insert(*key.src_sg_l).first;
+    key.dst_sg_l = &*sg_lists_.insert(*key.dst_sg_l).first;
+    AclDBEntry::EntryList &entries = map_[key];
+    acl->MatchEntries(packet_header, &entries);
+    return acl->ApplyMatch(entries, m_acl, info);
+}
+
+void FlowPolicyCache::Clear() {
+    map_.clear();
+    vns_.clear();
+    sg_lists_.clear();
+}
+
+void FlowPolicyCache::Invalidate() {
+    Clear();
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __AGENT_FLOW_POLICY_CACHE_H__
+#define __AGENT_FLOW_POLICY_CACHE_H__
+
+#include <stdint.h>
+#include <set>
+#include <string>
+#include <boost/unordered_map.hpp>
+
+#include <base/util.h>
+#include <net/address.h>
+#include <cmn/agent_cmn.h>
+#include <filter/acl.h>
+
+struct PacketHeader;
+
+//
+// Results of ACL matches for the flows of an interface.
+//
+// Flows of an interface mostly differ in fields the ACLs don't look at,
+// typically the ephemeral source port. The cache keeps the entries of an
+// ACL matching a packet, keyed by the ACL and the packet fields the ACL
+// matches on, and applies them again to the next packet with the same
+// fields instead of evaluating the ACL.
+//
+// Ports are left out of the key when no entry of the ACL matches on them.
+// Lookups refer to the VN names and SG lists of the packet without copying
+// them; a stored key refers to copies interned by the cache, shared by all
+// the results for the same VN or SG list.
+// The key holds the generation of the ACL, so results are not used after
+// the entries of the ACL change. Invalidate() drops all the results when
+// the ACL or SG set of the interface changes.
+//
+// Not thread safe: used from the flow setup path with the FlowTable mutex
+// held, or from tasks mutually exclusive with it.
+//
+class FlowPolicyCache {
+public:
+    static const size_t kMaxEntries = 4096;
+
+    struct Stats {
+        Stats() : hits(0), misses(0), flushes(0) { }
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t flushes;
+    };
+
+    // Counters are also added to table_stats, if not NULL
+    explicit FlowPolicyCache(Stats *table_stats);
+    ~FlowPolicyCache();
+
+    // Same result as acl->PacketMatch(packet_header, m_acl, info)
+    bool PacketMatch(const AclDBEntry *acl, const PacketHeader &packet_header,
+                     MatchAclParams &m_acl, FlowPolicyInfo *info);
+    void Invalidate();
+
+    size_t size() const { return map_.size(); }
+    const Stats &stats() const { return stats_; }
+
+private:
+    // Hash is computed once, when the key is built from the packet
+    struct Key {
+        Key(const AclDBEntry *acl, const PacketHeader &packet_header);
+        bool operator==(const Key &rhs) const;
+
+        const AclDBEntry *acl;
+        uint64_t acl_generation;
+        IpAddress src_ip;
+        IpAddress dst_ip;
+        uint8_t protocol;
+        uint16_t src_port;
+        uint16_t dst_port;
+        const std::string *src_vn;
+        const std::string *dst_vn;
+        const SecurityGroupList *src_sg_l;
+        const SecurityGroupList *dst_sg_l;
+        std::size_t hash;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const { return key.hash; }
+    };
+
+    typedef boost::unordered_map<Key, AclDBEntry::EntryList, KeyHash> Map;
+
+    void Clear();
+
+    Map map_;
+    std::set<std::string> vns_;
+    std::set<SecurityGroupList> sg_lists_;
+    Stats stats_;
+    Stats *table_stats_;
+    DISALLOW_COPY_AND_ASSIGN(FlowPolicyCache);
+};
+
+#endif
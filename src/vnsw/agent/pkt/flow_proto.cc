@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <boost/functional/hash.hpp>
+
+#include "pkt/flow_proto.h"
+#include "init/agent_param.h"
+#include <vrouter/ksync/flowtable_ksync.h>
+#include <vrouter/ksync/ksync_init.h>
+
+FlowProto::FlowProto(Agent *agent, boost::asio::io_service &io) :
+    Proto(agent, "Agent::FlowHandler", PktHandler::FLOW, io) {
+    agent->SetFlowProto(this);
+
+    uint16_t count = Agent::kDefaultFlowThreadCount;
+    if (agent->params() && agent->params()->flow_thread_count() > 0) {
+        count = agent->params()->flow_thread_count();
+    }
+    int task_id = TaskScheduler::GetInstance()->GetTaskId("Agent::FlowHandler");
+    for (uint16_t i = 0; i < count; i++) {
+        flow_work_queue_.push_back(new FlowWorkQueue(task_id, i,
+            boost::bind(&FlowProto::ProcessProto, this, _1)));
+    }
+}
+
+FlowProto::~FlowProto() {
+    for (size_t i = 0; i < flow_work_queue_.size(); i++) {
+        flow_work_queue_[i]->Shutdown();
+    }
+    STLDeleteValues(&flow_work_queue_);
+}
+
+static std::size_t AddressHash(const IpAddress &addr) {
+    if (addr.is_v4()) {
+        return boost::hash_value(addr.to_v4().to_ulong());
+    }
+    std::size_t seed = 0;
+    const Ip6Address::bytes_type bytes = addr.to_v6().to_bytes();
+    boost::hash_range(seed, bytes.begin(), bytes.end());
+    return seed;
+}
+
+// Combine the source and destination with commutative operations so that
+// the forward and reverse direction of a flow get the same hash.
+uint32_t FlowProto::FlowHash(const IpAddress &sip, const IpAddress &dip,
+                             uint8_t proto, uint16_t sport, uint16_t dport) {
+    std::size_t seed = AddressHash(sip) ^ AddressHash(dip);
+    boost::hash_combine(seed, proto);
+    boost::hash_combine(seed, sport ^ dport);
+    return seed;
+}
+
+// Key of the forward flow of the pair fe belongs to. Called with the
+// FlowTable mutex held.
+static const FlowKey &ForwardFlowKey(const FlowEntry *fe) {
+    const FlowEntry *rflow = fe->reverse_flow_entry();
+    if (fe->is_flags_set(FlowEntry::ReverseFlow) && rflow != NULL) {
+        return rflow->key();
+    }
+    return fe->key();
+}
+
+// Requests for an existing flow go to the partition of its forward flow.
+// The header of an ECMP resolve packet may have been rewritten by NAT, so
+// the flow is found from the flow index of the packet instead.
+uint32_t FlowProto::FlowPartition(const PktInfo *msg) const {
+    if (flow_work_queue_.size() == 1) {
+        return 0;
+    }
+
+    FlowTable *table = agent()->pkt()->flow_table();
+    FlowKey key;
+    bool found = false;
+    if (msg->type == PktType::MESSAGE) {
+        const FlowTaskMsg *ipc = static_cast<const FlowTaskMsg *>(msg->ipc);
+        tbb::mutex::scoped_lock lock(table->mutex());
+        key = ForwardFlowKey(ipc->fe_ptr.get());
+        found = true;
+    } else if (msg->agent_hdr.cmd == AgentHdr::TRAP_ECMP_RESOLVE) {
+        FlowTableKSyncObject *obj = agent()->ksync()->flowtable_ksync_obj();
+        if (obj->GetFlowKey(msg->agent_hdr.cmd_param, &key)) {
+            tbb::mutex::scoped_lock lock(table->mutex());
+            FlowEntry *fe = table->Find(key);
+            if (fe != NULL) {
+                key = ForwardFlowKey(fe);
+                found = true;
+            }
+        }
+    }
+
+    uint32_t hash;
+    if (found) {
+        hash = FlowHash(key.src_addr, key.dst_addr, key.protocol,
+                        key.src_port, key.dst_port);
+    } else {
+        hash = FlowHash(msg->ip_saddr, msg->ip_daddr, msg->ip_proto,
+                        msg->sport, msg->dport);
+    }
+    return hash % flow_work_queue_.size();
+}
+
+bool FlowProto::Enqueue(boost::shared_ptr<PktInfo> msg) {
+    return flow_work_queue_[FlowPartition(msg.get())]->Enqueue(msg);
+}
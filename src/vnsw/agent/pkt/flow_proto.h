@@ -13,13 +13,22 @@
 #include "pkt/flow_table.h"
 #include "pkt/flow_handler.h"
 
+//
+// Flow setup requests are spread on a hash of the flow key over several
+// work queues, each served by a separate instance of the Agent::FlowHandler
+// task. The hash is symmetric in source and destination so that the packets
+// in both directions of a flow are processed by the same instance.
+//
+// Only the classification of the packet (route lookups, policy, NAT) runs in
+// parallel. There is a single FlowTable, and FlowHandler adds, updates and
+// deletes flows with FlowTable::mutex held, so those remain serialized.
+//
 class FlowProto : public Proto {
 public:
-    FlowProto(Agent *agent, boost::asio::io_service &io) :
-        Proto(agent, "Agent::FlowHandler", PktHandler::FLOW, io) {
-        agent->SetFlowProto(this);
-    }
-    virtual ~FlowProto() {}
+    typedef WorkQueue<boost::shared_ptr<PktInfo> > FlowWorkQueue;
+
+    FlowProto(Agent *agent, boost::asio::io_service &io);
+    virtual ~FlowProto();
     void Init() {}
     void Shutdown() {}
 
@@ -43,6 +52,20 @@ public:
     bool RemovePktBuff() {
         return true;
     }
+
+    virtual bool Enqueue(boost::shared_ptr<PktInfo> msg);
+
+    static uint32_t FlowHash(const IpAddress &sip, const IpAddress &dip,
+                             uint8_t proto, uint16_t sport, uint16_t dport);
+    uint32_t FlowPartition(const PktInfo *msg) const;
+    uint32_t partition_count() const { return flow_work_queue_.size(); }
+    const FlowWorkQueue *flow_work_queue(uint32_t partition) const {
+        return flow_work_queue_[partition];
+    }
+
+private:
+    std::vector<FlowWorkQueue *> flow_work_queue_;
+    DISALLOW_COPY_AND_ASSIGN(FlowProto);
 };
 
 extern SandeshTraceBufferPtr PktFlowTraceBuf;
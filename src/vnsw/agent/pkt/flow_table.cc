@@ -7,6 +7,7 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/unordered_map.hpp>
 #include <sandesh/sandesh_types.h>
 #include <sandesh/sandesh.h>
@@ -144,6 +145,8 @@ uint32_t FlowEntry::MatchAcl(const PacketHeader &hdr,
                              bool add_implicit_deny, bool add_implicit_allow,
                              FlowPolicyInfo *info) {
     PktHandler *pkt_handler = Agent::GetInstance()->pkt()->pkt_handler();
+    FlowPolicyCache *cache = Agent::GetInstance()->pkt()->flow_table()->
+        policy_cache(data_.intf_entry.get());
 
     // If there are no ACL to match, make it pass
     if (acl.size() == 0 &&  add_implicit_allow) {
@@ -193,7 +196,13 @@ uint32_t FlowEntry::MatchAcl(const PacketHeader &hdr,
             continue;
         }
 
-        if (it->acl->PacketMatch(hdr, *it, info)) {
+        bool match;
+        if (cache) {
+            match = cache->PacketMatch(it->acl.get(), hdr, *it, info);
+        } else {
+            match = it->acl->PacketMatch(hdr, *it, info);
+        }
+        if (match) {
             action |= it->action_info.action;
             if (it->action_info.action & (1 << TrafficAction::MIRROR)) {
                 data_.match_p.action_info.mirror_l.insert
@@ -1484,32 +1493,137 @@ void FlowEntry::InitAuditFlow(uint32_t flow_idx) {
     data_.dest_sg_id_l = FlowTable::default_sg_list();
 }
 
+static void HashCombineAddress(std::size_t *seed, const IpAddress &addr) {
+    if (addr.is_v4()) {
+        boost::hash_combine(*seed, addr.to_v4().to_ulong());
+    } else {
+        const Ip6Address::bytes_type bytes = addr.to_v6().to_bytes();
+        boost::hash_range(*seed, bytes.begin(), bytes.end());
+    }
+}
+
+std::size_t FlowKey::Hash() const {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, static_cast<int>(family));
+    boost::hash_combine(seed, nh);
+    HashCombineAddress(&seed, src_addr);
+    HashCombineAddress(&seed, dst_addr);
+    boost::hash_combine(seed, protocol);
+    boost::hash_combine(seed, src_port);
+    boost::hash_combine(seed, dst_port);
+    return seed;
+}
+
+FlowEntryIndex::FlowEntryIndex()
+    : slots_(kMinCapacity), mask_(kMinCapacity - 1), count_(0) {
+}
+
+FlowEntryIndex::~FlowEntryIndex() {
+}
+
+// Return the slot holding the flow with the given key, or the empty slot
+// that ends its probe sequence.
+size_t FlowEntryIndex::Probe(const FlowKey &key, std::size_t hash) const {
+    size_t idx = hash & mask_;
+    while (true) {
+        const Slot &slot = slots_[idx];
+        if (slot.flow == NULL)
+            return idx;
+        if (slot.hash == hash && slot.flow->key().IsEqual(key))
+            return idx;
+        idx = (idx + 1) & mask_;
+    }
+}
+
+FlowEntry *FlowEntryIndex::Find(const FlowKey &key) const {
+    return slots_[Probe(key, key.Hash())].flow;
+}
+
+void FlowEntryIndex::Insert(FlowEntry *flow) {
+    // Keep the load factor at or below 1/2.
+    if ((count_ + 1) * 2 > slots_.size()) {
+        Resize(slots_.size() * 2);
+    }
+    std::size_t hash = flow->key().Hash();
+    Slot &slot = slots_[Probe(flow->key(), hash)];
+    assert(slot.flow == NULL);
+    slot.hash = hash;
+    slot.flow = flow;
+    count_++;
+}
+
+bool FlowEntryIndex::Remove(const FlowEntry *flow) {
+    size_t idx = Probe(flow->key(), flow->key().Hash());
+    if (slots_[idx].flow != flow)
+        return false;
+
+    // Move back entries that follow in the probe sequence and whose home
+    // slot is not in the cyclic range (idx, next].
+    size_t next = idx;
+    while (true) {
+        next = (next + 1) & mask_;
+        Slot &slot = slots_[next];
+        if (slot.flow == NULL)
+            break;
+        size_t home = slot.hash & mask_;
+        bool movable = (idx <= next) ?
+            (home <= idx || home > next) : (home <= idx && home > next);
+        if (movable) {
+            slots_[idx] = slot;
+            idx = next;
+        }
+    }
+    slots_[idx] = Slot();
+    count_--;
+
+    if (slots_.size() > kMinCapacity && count_ * 8 < slots_.size()) {
+        Resize(slots_.size() / 2);
+    }
+    return true;
+}
+
+void FlowEntryIndex::Resize(size_t capacity) {
+    std::vector<Slot> slots(capacity);
+    slots_.swap(slots);
+    mask_ = capacity - 1;
+    for (std::vector<Slot>::const_iterator it = slots.begin();
+         it != slots.end(); ++it) {
+        if (it->flow == NULL)
+            continue;
+        size_t idx = it->hash & mask_;
+        while (slots_[idx].flow != NULL) {
+            idx = (idx + 1) & mask_;
+        }
+        slots_[idx] = *it;
+    }
+}
+
 FlowEntry *FlowTable::Allocate(const FlowKey &key) {
-    FlowEntry *flow = new FlowEntry(key);
-    std::pair<FlowEntryMap::iterator, bool> ret;
-    ret = flow_entry_map_.insert(std::pair<FlowKey, FlowEntry*>(key, flow));
-    if (ret.second == false) {
-        delete flow;
-        flow = ret.first->second;
+    FlowEntry *flow = flow_entry_index_.Find(key);
+    if (flow != NULL) {
         flow->set_deleted(false);
         DeleteFlowInfo(flow);
-    } else {
-        flow->stats_.setup_time = UTCTimestampUsec();
-        agent_->stats()->incr_flow_created();
+        return flow;
     }
 
+    flow = new FlowEntry(key);
+    flow_entry_list_.push_back(*flow);
+    flow_entry_index_.Insert(flow);
+    flow->stats_.setup_time = UTCTimestampUsec();
+    agent_->stats()->incr_flow_created();
     return flow;
 }
 
 FlowEntry *FlowTable::Find(const FlowKey &key) {
-    FlowEntryMap::iterator it;
+    return flow_entry_index_.Find(key);
+}
 
-    it = flow_entry_map_.find(key);
-    if (it != flow_entry_map_.end()) {
-        return it->second;
-    } else {
-        return NULL;
+FlowTable::FlowEntryList::iterator FlowTable::IteratorFind(const FlowKey &key) {
+    FlowEntry *flow = flow_entry_index_.Find(key);
+    if (flow == NULL) {
+        return flow_entry_list_.end();
     }
+    return flow_entry_list_.iterator_to(*flow);
 }
 
 RouteFlowInfo *FlowTable::RouteFlowInfoFind(RouteFlowKey &key) {
@@ -1517,10 +1631,9 @@ RouteFlowInfo *FlowTable::RouteFlowInfoFind(RouteFlowKey &key) {
     return route_flow_tree_.Find(&rt_key);
 }
 
-void FlowTable::DeleteInternal(FlowEntryMap::iterator &it)
+void FlowTable::DeleteInternal(FlowEntry *fe)
 {
     FlowInfo flow_info;
-    FlowEntry *fe = it->second;
     if (fe->deleted()) {
         /* Already deleted return from here. */
         return;
@@ -1557,14 +1670,10 @@ void FlowTable::DeleteInternal(FlowEntryMap::iterator &it)
 
 bool FlowTable::Delete(const FlowKey &key, bool del_reverse_flow)
 {
-    FlowEntryMap::iterator it;
-    FlowEntry *fe;
-
-    it = flow_entry_map_.find(key);
-    if (it == flow_entry_map_.end()) {
+    FlowEntry *fe = flow_entry_index_.Find(key);
+    if (fe == NULL) {
         return false;
     }
-    fe = it->second;
 
     FlowEntry *reverse_flow = NULL;
     if (del_reverse_flow) {
@@ -1577,15 +1686,14 @@ bool FlowTable::Delete(const FlowKey &key, bool del_reverse_flow)
      * either of forward or reverse flow is deleted */
     SendFlows(fe, reverse_flow);
     /* Delete the forward flow */
-    DeleteInternal(it);
+    DeleteInternal(fe);
 
     if (!reverse_flow) {
         return true;
     }
 
-    it = flow_entry_map_.find(reverse_flow->key());
-    if (it != flow_entry_map_.end()) {
-        DeleteInternal(it);
+    if (flow_entry_index_.Find(reverse_flow->key()) != NULL) {
+        DeleteInternal(reverse_flow);
         return true;
     }
     return false;
@@ -1620,14 +1728,14 @@ void FlowTable::SendFlows(FlowEntry *flow, FlowEntry *rflow)
 
 void FlowTable::DeleteAll()
 {
-    FlowEntryMap::iterator it;
+    FlowEntryList::iterator it;
 
-    it = flow_entry_map_.begin();
-    while (it != flow_entry_map_.end()) {
-        FlowEntry *entry = it->second;
+    it = flow_entry_list_.begin();
+    while (it != flow_entry_list_.end()) {
+        FlowEntry *entry = &(*it);
         ++it;
-        if (it != flow_entry_map_.end() &&
-            it->second == entry->reverse_flow_entry()) {
+        if (it != flow_entry_list_.end() &&
+            &(*it) == entry->reverse_flow_entry()) {
             ++it;
         }
         Delete(entry->key(), true);
@@ -1719,7 +1827,7 @@ void FlowTable::IntfNotify(DBTablePartBase *part, DBEntryBase *e) {
     bool changed = false;
 
     if (state == NULL) {
-        state = new VmIntfFlowHandlerState(NULL);
+        state = new VmIntfFlowHandlerState(NULL, &policy_cache_stats_);
         e->SetState(part->parent(), intf_listener_id_, state);
         // Force change for first time
         state->policy_ = !vm_port->policy_enabled();
@@ -1742,10 +1850,24 @@ void FlowTable::IntfNotify(DBTablePartBase *part, DBEntryBase *e) {
     }
 
     if (changed) {
+        state->policy_cache_.Invalidate();
         ResyncVmPortFlows(vm_port);
     }
 }
 
+FlowPolicyCache *FlowTable::policy_cache(const Interface *intf) const {
+    if (!policy_cache_enabled_ || intf == NULL ||
+        intf->type() != Interface::VM_INTERFACE) {
+        return NULL;
+    }
+    const VmIntfFlowHandlerState *state =
+        static_cast<const VmIntfFlowHandlerState *>
+        (intf->GetState(agent_->interface_table(), intf_listener_id_));
+    if (state == NULL)
+        return NULL;
+    return &state->policy_cache_;
+}
+
 void FlowTable::VnNotify(DBTablePartBase *part, DBEntryBase *e) 
 {
     // Add/Delete Acl:
@@ -3046,15 +3168,17 @@ AgentRoute *FlowTable::GetL2Route(const VrfEntry *vrf,
     return table->FindRoute(mac);
 }
 
+// The lookup key is built on the stack since flow setup partitions look up
+// routes concurrently.
 AgentRoute *FlowTable::GetUcRoute(const VrfEntry *entry,
                                   const IpAddress &addr) {
     AgentRoute *rt = NULL;
     if (addr.is_v4()) {
-        inet4_route_key_.set_addr(addr.to_v4());
-        rt = entry->GetUcRoute(inet4_route_key_);
+        InetUnicastRouteEntry key(NULL, addr.to_v4(), 32, false);
+        rt = entry->GetUcRoute(key);
     } else {
-        inet6_route_key_.set_addr(addr.to_v6());
-        rt = entry->GetUcRoute(inet6_route_key_);
+        InetUnicastRouteEntry key(NULL, addr.to_v6(), 128, false);
+        rt = entry->GetUcRoute(key);
     }
     if (rt != NULL && rt->IsRPFInvalid()) {
         return NULL;
@@ -3275,12 +3399,11 @@ void FlowTable::SetAclFlowSandeshData(const AclDBEntry *acl, AclFlowResp &data,
 }
 
 FlowTable::FlowTable(Agent *agent) : 
-    agent_(agent), flow_entry_map_(), acl_flow_tree_(),
-    linklocal_flow_count_(), acl_listener_id_(),
+    agent_(agent), flow_entry_list_(), acl_flow_tree_(),
+    linklocal_flow_count_(), policy_cache_enabled_(true),
+    policy_cache_stats_(), acl_listener_id_(),
     intf_listener_id_(), vn_listener_id_(), vm_listener_id_(),
-    vrf_listener_id_(), nh_listener_(NULL),
-    inet4_route_key_(NULL, Ip4Address(), 32, false),
-    inet6_route_key_(NULL, Ip6Address(), 128, false) {
+    vrf_listener_id_(), nh_listener_(NULL) {
     max_vm_flows_ = (uint32_t)
         (agent->ksync()->flowtable_ksync_obj()->flow_table_entries_count() *
          agent->params()->max_vm_flows()) / 100;
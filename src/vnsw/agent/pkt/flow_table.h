@@ -20,6 +20,7 @@
 
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/intrusive_ptr.hpp>
+#include <boost/intrusive/list.hpp>
 #include <tbb/atomic.h>
 #include <tbb/mutex.h>
 #include <base/util.h>
@@ -34,6 +35,7 @@
 #include <pkt/pkt_handler.h>
 #include <pkt/pkt_init.h>
 #include <pkt/pkt_flow_info.h>
+#include <pkt/flow_policy_cache.h>
 #include <sandesh/sandesh_trace.h>
 #include <oper/vn.h>
 #include <oper/vm.h>
@@ -115,6 +117,15 @@ struct FlowKey {
         return dst_port < key.dst_port;
     }
 
+    bool IsEqual(const FlowKey &key) const {
+        return (family == key.family && nh == key.nh &&
+                src_addr == key.src_addr && dst_addr == key.dst_addr &&
+                protocol == key.protocol && src_port == key.src_port &&
+                dst_port == key.dst_port);
+    }
+
+    std::size_t Hash() const;
+
     void Reset() {
         family = Address::UNSPEC;
         nh = -1;
@@ -466,6 +477,8 @@ private:
     uint16_t underlay_source_port_;
     // atomic refcount
     tbb::atomic<int> refcount_;
+    // Node in FlowTable::flow_entry_list_
+    boost::intrusive::list_member_hook<> flow_list_node_;
 };
  
 struct FlowEntryCmp {
@@ -564,10 +577,56 @@ struct RouteFlowInfo {
     Patricia::Node node;
 };
 
+////////////////////////////////////////////////////////////////////////////
+// Hash index of the flows in FlowTable, keyed by FlowKey.
+//
+// All the lookups by key go through this index, which is an open addressing
+// table with linear probing. Each slot holds the flow and the hash of its
+// key, so that probing only dereferences flows whose hash matches. Removal
+// shifts back the following entries of the probe sequence, so there are no
+// tombstones and lookups never degrade with churn.
+////////////////////////////////////////////////////////////////////////////
+class FlowEntryIndex {
+public:
+    FlowEntryIndex();
+    ~FlowEntryIndex();
+
+    FlowEntry *Find(const FlowKey &key) const;
+    void Insert(FlowEntry *flow);
+    bool Remove(const FlowEntry *flow);
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    struct Slot {
+        Slot() : hash(0), flow(NULL) { }
+        std::size_t hash;
+        FlowEntry *flow;
+    };
+
+    static const size_t kMinCapacity = 1024;
+
+    size_t Probe(const FlowKey &key, std::size_t hash) const;
+    void Resize(size_t capacity);
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t count_;
+    DISALLOW_COPY_AND_ASSIGN(FlowEntryIndex);
+};
+
 class FlowTable {
 public:
     static const int MaxResponses = 100;
-    typedef std::map<FlowKey, FlowEntry *, Inet4FlowKeyCmp> FlowEntryMap;
+    // Flows in the order they were added. Flow introspect and
+    // FlowStatsCollector iterate it, and resume from the flow found in the
+    // index by key.
+    typedef boost::intrusive::member_hook<FlowEntry,
+        boost::intrusive::list_member_hook<>,
+        &FlowEntry::flow_list_node_> FlowEntryListHook;
+    typedef boost::intrusive::list<FlowEntry, FlowEntryListHook,
+        boost::intrusive::constant_time_size<true> > FlowEntryList;
 
     typedef std::map<int, int> AceIdFlowCntMap;
     typedef std::map<const AclDBEntry *, AclFlowInfo *> AclFlowTree;
@@ -598,12 +657,16 @@ public:
         virtual ~VnFlowHandlerState() { }
     };
     struct VmIntfFlowHandlerState : public DBState {
-        VmIntfFlowHandlerState(const VnEntry *vn) : vn_(vn) { }
+        VmIntfFlowHandlerState(const VnEntry *vn,
+                               FlowPolicyCache::Stats *cache_stats) :
+            vn_(vn), policy_cache_(cache_stats) { }
         virtual ~VmIntfFlowHandlerState() { }
 
         VnEntryConstRef vn_;
         bool policy_;
         VmInterface::SecurityGroupEntryList sg_l_;
+        // Updated by flow setup on a const interface
+        mutable FlowPolicyCache policy_cache_;
     };
 
     struct VrfFlowHandlerState : public DBState {
@@ -636,7 +699,12 @@ public:
     FlowEntry *Find(const FlowKey &key);
     bool Delete(const FlowKey &key, bool del_reverse_flow);
 
-    size_t Size() { return flow_entry_map_.size(); }
+    size_t Size() { return flow_entry_list_.size(); }
+    const FlowEntryIndex &flow_entry_index() const { return flow_entry_index_; }
+    // Serializes updates to the table from the flow setup partitions
+    // (Agent::FlowHandler task instances). Tasks that are mutually exclusive
+    // with Agent::FlowHandler don't need to take it.
+    tbb::mutex &mutex() { return mutex_; }
     void VnFlowCounters(const VnEntry *vn, uint32_t *in_count, 
                         uint32_t *out_count);
     uint32_t VmFlowCount(const VmEntry *vm);
@@ -646,6 +714,16 @@ public:
     uint32_t linklocal_flow_count() const { return linklocal_flow_count_; }
     Agent *agent() const { return agent_; }
 
+    // ACL match results cached for the flows of a VM interface. NULL if
+    // the interface has none or the cache is disabled.
+    FlowPolicyCache *policy_cache(const Interface *intf) const;
+    const FlowPolicyCache::Stats &policy_cache_stats() const {
+        return policy_cache_stats_;
+    }
+    void set_policy_cache_enabled(bool enabled) {
+        policy_cache_enabled_ = enabled;
+    }
+
     // Test code only used method
     RouteFlowInfo *RouteFlowInfoFind(RouteFlowKey &key);
     void DeleteFlow(const AclDBEntry *acl, const FlowKey &key, AclEntryIDList &id_list);
@@ -657,14 +735,17 @@ public:
     void SetAceSandeshData(const AclDBEntry *acl, AclFlowCountResp &data, 
                            int ace_id);
    
-    FlowTable::FlowEntryMap::iterator begin() {
-        return flow_entry_map_.begin();
+    FlowTable::FlowEntryList::iterator begin() {
+        return flow_entry_list_.begin();
     }
 
-    FlowTable::FlowEntryMap::iterator end() {
-        return flow_entry_map_.end(); 
+    FlowTable::FlowEntryList::iterator end() {
+        return flow_entry_list_.end();
     }
 
+    // Iterator to the flow with the given key, or end() if there is none
+    FlowTable::FlowEntryList::iterator IteratorFind(const FlowKey &key);
+
     DBTableBase::ListenerId nh_listener_id();
     AgentRoute *GetL2Route(const VrfEntry *entry, const MacAddress &mac);
     AgentRoute *GetUcRoute(const VrfEntry *entry, const IpAddress &addr);
@@ -693,7 +774,9 @@ private:
     static SecurityGroupList default_sg_list_;
 
     Agent *agent_;
-    FlowEntryMap flow_entry_map_;
+    tbb::mutex mutex_;
+    FlowEntryList flow_entry_list_;
+    FlowEntryIndex flow_entry_index_;
 
     AclFlowTree acl_flow_tree_;
     VnFlowTree vn_flow_tree_;
@@ -703,6 +786,8 @@ private:
 
     uint32_t max_vm_flows_;     // maximum flow count allowed per vm
     uint32_t linklocal_flow_count_;  // total linklocal flows in the agent
+    bool policy_cache_enabled_;
+    FlowPolicyCache::Stats policy_cache_stats_;
 
     DBTableBase::ListenerId acl_listener_id_;
     DBTableBase::ListenerId intf_listener_id_;
@@ -711,9 +796,6 @@ private:
     DBTableBase::ListenerId vrf_listener_id_;
     NhListener *nh_listener_;
 
-    InetUnicastRouteEntry inet4_route_key_;
-    InetUnicastRouteEntry inet6_route_key_;
-
     void AclNotify(DBTablePartBase *part, DBEntryBase *e);
     void IntfNotify(DBTablePartBase *part, DBEntryBase *e);
     void VnNotify(DBTablePartBase *part, DBEntryBase *e);
@@ -756,7 +838,7 @@ private:
     void AddRouteFlowInfo(FlowEntry *fe);
 
     void DeleteAclFlows(const AclDBEntry *acl);
-    void DeleteInternal(FlowEntryMap::iterator &it);
+    void DeleteInternal(FlowEntry *fe);
     void SendFlows(FlowEntry *flow, FlowEntry *rflow);
     void SendFlowInternal(FlowEntry *fe);
 
@@ -774,9 +856,9 @@ inline void intrusive_ptr_release(FlowEntry *fe) {
     int prev = fe->refcount_.fetch_and_decrement();
     if (prev == 1) {
         FlowTable *table = Agent::GetInstance()->pkt()->flow_table();
-        FlowTable::FlowEntryMap::iterator it = table->flow_entry_map_.find(fe->key());
-        assert(it != table->flow_entry_map_.end());
-        table->flow_entry_map_.erase(it);
+        table->flow_entry_list_.erase(table->flow_entry_list_.iterator_to(*fe));
+        bool removed = table->flow_entry_index_.Remove(fe);
+        assert(removed);
         delete fe;
     }
 }
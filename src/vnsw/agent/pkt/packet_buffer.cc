@@ -6,16 +6,117 @@
 #include <pkt/packet_buffer.h>
 #include <pkt/control_interface.h>
 
+const uint16_t PacketBufferManager::kSizeClasses[kSizeClassCount] = {
+    512, 1024, 2048, 4096, 9216
+};
+
 PacketBufferManager::PacketBufferManager(PktModule *pkt_module) :
-    alloc_(0), free_(0), pkt_module_(pkt_module) {
+    max_free_blocks_(kDefaultMaxFreeBlocks), pkt_module_(pkt_module) {
+    alloc_ = 0;
+    free_ = 0;
 }
 
 PacketBufferManager::~PacketBufferManager() {
+    set_max_free_blocks(0);
+}
+
+// Smallest size class that can hold len bytes, -1 if none can.
+int PacketBufferManager::SizeClassIndex(uint16_t len) {
+    for (int i = 0; i < kSizeClassCount; i++) {
+        if (len <= kSizeClasses[i])
+            return i;
+    }
+    return -1;
+}
+
+uint32_t PacketBufferManager::BlockSize(int size_class, uint16_t len) {
+    if (size_class < 0)
+        return PacketBuffer::kHeadRoom + len;
+    return PacketBuffer::kHeadRoom + kSizeClasses[size_class];
+}
+
+uint8_t *PacketBufferManager::AllocateBlock(int size_class, uint16_t len) {
+    if (size_class >= 0) {
+        SizeClass &sc = size_classes_[size_class];
+        sc.allocs++;
+        tbb::mutex::scoped_lock lock(sc.mutex);
+        if (!sc.free_list.empty()) {
+            uint8_t *block = sc.free_list.back();
+            sc.free_list.pop_back();
+            sc.pool_allocs++;
+            return block;
+        }
+    }
+    return new uint8_t[BlockSize(size_class, len)];
+}
+
+void PacketBufferManager::FreeBlock(uint8_t *block, int size_class) {
+    if (size_class >= 0) {
+        SizeClass &sc = size_classes_[size_class];
+        tbb::mutex::scoped_lock lock(sc.mutex);
+        if (sc.free_list.size() < max_free_blocks_) {
+            sc.free_list.push_back(block);
+            return;
+        }
+    }
+    delete [] block;
+}
+
+void PacketBufferManager::set_max_free_blocks(size_t count) {
+    max_free_blocks_ = count;
+    for (int i = 0; i < kSizeClassCount; i++) {
+        SizeClass &sc = size_classes_[i];
+        tbb::mutex::scoped_lock lock(sc.mutex);
+        while (sc.free_list.size() > count) {
+            delete [] sc.free_list.back();
+            sc.free_list.pop_back();
+        }
+    }
+}
+
+PacketBufferManager::SizeClassStats
+PacketBufferManager::size_class_stats(int size_class) const {
+    const SizeClass &sc = size_classes_[size_class];
+    SizeClassStats stats;
+    stats.allocs = sc.allocs;
+    stats.pool_allocs = sc.pool_allocs;
+    stats.free_blocks = sc.free_list.size();
+    return stats;
+}
+
+PacketBufferManager::ModuleStats *
+PacketBufferManager::GetModuleStats(uint32_t module) {
+    if (module >= kMaxModules)
+        module = kMaxModules - 1;
+    return &module_stats_[module];
+}
+
+const PacketBufferManager::ModuleStats &
+PacketBufferManager::module_stats(uint32_t module) const {
+    if (module >= kMaxModules)
+        module = kMaxModules - 1;
+    return module_stats_[module];
+}
+
+void PacketBufferManager::AddModule(PacketBuffer *pkt) {
+    ModuleStats *stats = GetModuleStats(pkt->module_);
+    stats->allocs++;
+    stats->bytes += pkt->buffer_len_;
+}
+
+void PacketBufferManager::RemoveModule(PacketBuffer *pkt) {
+    ModuleStats *stats = GetModuleStats(pkt->module_);
+    stats->frees++;
+    stats->bytes -= pkt->buffer_len_;
 }
 
 PacketBufferPtr PacketBufferManager::Allocate(uint32_t module, uint16_t len,
                                               uint32_t mdata) {
-    PacketBufferPtr ptr(new PacketBuffer(this, module, len, mdata));
+    int size_class = SizeClassIndex(len);
+    uint8_t *block = AllocateBlock(size_class, len);
+    PacketBufferPtr ptr(new PacketBuffer(this, module, block, size_class, len,
+                                         mdata));
+    AddModule(ptr.get());
     alloc_++;
     return ptr;
 }
@@ -27,25 +128,34 @@ PacketBufferPtr PacketBufferManager::Allocate(uint32_t module, uint8_t *buff,
                                               uint32_t mdata) {
     PacketBufferPtr ptr(new PacketBuffer(this, module, buff, len, data_offset,
                                          data_len, mdata));
+    AddModule(ptr.get());
     alloc_++;
     return ptr;
 }
 
 void PacketBufferManager::FreeIndication(PacketBuffer *pkt) {
+    RemoveModule(pkt);
+    FreeBlock(pkt->block_, pkt->size_class_);
     free_++;
 }
 
 PacketBuffer::PacketBuffer(PacketBufferManager *mgr, uint32_t module,
-                           uint16_t len, uint32_t mdata) :
-    buffer_(new uint8_t[len]), buffer_len_(len), data_(buffer_.get()),
-    data_len_(len), module_(module), mdata_(mdata), mgr_(mgr) {
+                           uint8_t *block, int size_class, uint16_t len,
+                           uint32_t mdata) :
+    block_(block), size_class_(size_class), buffer_(block + kHeadRoom),
+    buffer_len_(len), data_(buffer_), data_len_(len), module_(module),
+    mdata_(mdata), mgr_(mgr) {
+    headroom_reserved_ = false;
 }
 
+// The memory passed is owned by the PacketBuffer and released with it
 PacketBuffer::PacketBuffer(PacketBufferManager *mgr, uint32_t module,
                            uint8_t *buff, uint16_t len, uint16_t data_offset,
                            uint16_t data_len, uint32_t mdata) :
-    buffer_(buff), buffer_len_(len), data_(buffer_.get() + data_offset),
-    data_len_(data_len), module_(module), mdata_(mdata), mgr_(mgr) {
+    block_(buff), size_class_(-1), buffer_(buff), buffer_len_(len),
+    data_(buff + data_offset), data_len_(data_len), module_(module),
+    mdata_(mdata), mgr_(mgr) {
+    headroom_reserved_ = false;
 }
 
 PacketBuffer::~PacketBuffer() {
@@ -61,6 +171,12 @@ uint16_t PacketBuffer::data_len() const {
     return data_len_;
 }
 
+void PacketBuffer::set_module(uint32_t module) {
+    mgr_->RemoveModule(this);
+    module_ = module;
+    mgr_->AddModule(this);
+}
+
 // Move data pointer to offset specified
 bool PacketBuffer::SetOffset(uint16_t offset) {
     if (offset > data_len_)
@@ -70,11 +186,28 @@ bool PacketBuffer::SetOffset(uint16_t offset) {
     return true;
 }
 
+uint8_t *PacketBuffer::Push(uint16_t len) {
+    if (len > headroom())
+        return NULL;
+    data_ -= len;
+    data_len_ += len;
+    return data_;
+}
+
+bool PacketBuffer::ReserveHeadroom() {
+    return headroom_reserved_.compare_and_swap(true, false) == false;
+}
+
+void PacketBuffer::ReleaseHeadroom() {
+    headroom_reserved_ = false;
+}
+
 // Set data_len in packet buffer
 void PacketBuffer::set_len(uint32_t len) {
-    uint32_t offset = data_ - buffer_.get();
+    uint32_t offset = data_ - block_;
+    uint32_t size = (buffer_ - block_) + buffer_len_;
 
     // Check if there is enough space first
-    assert((buffer_len_ - offset) >= len);
+    assert((size - offset) >= len);
     data_len_ = len;
 }
@@ -6,8 +6,11 @@
 #define vnsw_agent_pkt_packet_buffer_hpp
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <boost/shared_ptr.hpp>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
 #include <base/util.h>
 
 class PacketBuffer;
@@ -20,30 +23,53 @@ typedef boost::shared_ptr<PacketBuffer> PacketBufferPtr;
 class PacketBuffer {
 public:
     static const uint32_t kDefaultBufferLen = 1024;
+    // Room reserved ahead of the data of buffers allocated by the manager,
+    // so that headers can be added on transmit without another buffer
+    static const uint16_t kHeadRoom = 64;
+
     virtual ~PacketBuffer();
 
-    uint8_t *buffer() const { return buffer_.get(); }
+    uint8_t *buffer() const { return buffer_; }
     uint16_t buffer_len() const { return buffer_len_; }
 
     uint8_t *data() const;
     uint16_t data_len() const;
 
+    // Number of bytes available ahead of data
+    uint16_t headroom() const { return data_ - block_; }
+
     uint32_t module() const { return module_; }
-    void set_module(uint32_t module) { module_ = module; }
+    void set_module(uint32_t module);
 
     void set_len(uint32_t len);
     bool SetOffset(uint16_t offset);
+
+    // Move data pointer back by len bytes, into the headroom. Returns the
+    // new data pointer, or NULL if there is not enough headroom.
+    uint8_t *Push(uint16_t len);
+
+    // Headers of a transmit are written in the headroom only while no other
+    // transmit of the buffer that may still be pending uses it. Returns false
+    // if the headroom is in use. ReleaseHeadroom is called once the write of
+    // the headers is complete.
+    bool ReserveHeadroom();
+    void ReleaseHeadroom();
 private:
     friend class PacketBufferManager;
-    PacketBuffer(PacketBufferManager *mgr, uint32_t module, uint16_t len,
-                 uint32_t mdata);
+    PacketBuffer(PacketBufferManager *mgr, uint32_t module, uint8_t *block,
+                 int size_class, uint16_t len, uint32_t mdata);
 
     // Create PacketBuffer from existing memory
     PacketBuffer(PacketBufferManager *mgr, uint32_t module, uint8_t *buff,
                  uint16_t len, uint16_t data_offset, uint16_t data_len,
                  uint32_t mdata);
 
-    boost::shared_ptr<uint8_t> buffer_;
+    // Start of the memory, including headroom, and its size class in the
+    // manager pool. -1 if the memory is not from the pool.
+    uint8_t *block_;
+    int size_class_;
+
+    uint8_t *buffer_;
     uint16_t buffer_len_;
 
     uint8_t *data_;
@@ -52,11 +78,44 @@ private:
     uint32_t module_;
     uint32_t mdata_;
     PacketBufferManager *mgr_;
+    tbb::atomic<bool> headroom_reserved_;
     DISALLOW_COPY_AND_ASSIGN(PacketBuffer);
 };
 
+//
+// Allocates packet buffers from a pool of recycled memory blocks.
+//
+// Blocks come in a few size classes, each with kHeadRoom bytes ahead of the
+// data. A freed block is kept on the free list of its class, up to
+// max_free_blocks() blocks per class, and handed out again by the next
+// allocation of that class. Requests larger than the biggest class are
+// served from the heap.
+//
+// Buffers in use are accounted to the module owning them.
+//
 class PacketBufferManager {
 public:
+    static const int kSizeClassCount = 5;
+    static const uint16_t kSizeClasses[kSizeClassCount];
+    static const size_t kDefaultMaxFreeBlocks = 1024;
+    // Modules beyond kMaxModules are accounted together in the last entry
+    static const uint32_t kMaxModules = 16;
+
+    struct SizeClassStats {
+        uint64_t allocs;            // Allocations of the class
+        uint64_t pool_allocs;       // Allocations served by the free list
+        uint64_t free_blocks;       // Blocks on the free list
+    };
+
+    struct ModuleStats {
+        ModuleStats() { allocs = frees = bytes = 0; }
+        // Buffers allocated to, or moved to the module by set_module, and
+        // buffers released by or moved away from the module
+        tbb::atomic<uint64_t> allocs;
+        tbb::atomic<uint64_t> frees;
+        tbb::atomic<uint64_t> bytes;    // Bytes held by buffers in use
+    };
+
     PacketBufferManager(PktModule *pkt_module);
     virtual ~PacketBufferManager();
 
@@ -65,12 +124,43 @@ public:
     PacketBufferPtr Allocate(uint32_t module, uint8_t *buff, uint16_t len,
                              uint16_t data_offset, uint16_t data_len,
                              uint32_t mdata);
+
+    uint64_t alloc_count() const { return alloc_; }
+    uint64_t free_count() const { return free_; }
+    SizeClassStats size_class_stats(int size_class) const;
+    const ModuleStats &module_stats(uint32_t module) const;
+
+    size_t max_free_blocks() const { return max_free_blocks_; }
+    // Limit the blocks kept per size class. 0 disables recycling.
+    void set_max_free_blocks(size_t count);
+
 private:
     friend class PacketBuffer;
+
+    struct SizeClass {
+        SizeClass() { allocs = pool_allocs = 0; }
+        tbb::mutex mutex;
+        std::vector<uint8_t *> free_list;
+        tbb::atomic<uint64_t> allocs;
+        tbb::atomic<uint64_t> pool_allocs;
+    };
+
+    static int SizeClassIndex(uint16_t len);
+    static uint32_t BlockSize(int size_class, uint16_t len);
+
+    uint8_t *AllocateBlock(int size_class, uint16_t len);
+    void FreeBlock(uint8_t *block, int size_class);
     void FreeIndication(PacketBuffer *);
 
-    uint64_t alloc_;
-    uint64_t free_;
+    ModuleStats *GetModuleStats(uint32_t module);
+    void AddModule(PacketBuffer *pkt);
+    void RemoveModule(PacketBuffer *pkt);
+
+    tbb::atomic<uint64_t> alloc_;
+    tbb::atomic<uint64_t> free_;
+    size_t max_free_blocks_;
+    SizeClass size_classes_[kSizeClassCount];
+    ModuleStats module_stats_[kMaxModules];
     PktModule *pkt_module_;
 
     DISALLOW_COPY_AND_ASSIGN(PacketBufferManager);
@@ -536,6 +536,7 @@ void PktFlowInfo::SetEcmpFlowInfo(const PktInfo *pkt, const PktControlInfo *in,
 
 // For link local services, we bind to a local port & use it as NAT source port.
 // The socket is closed when the flow entry is deleted.
+// Called from Add, which runs with the FlowTable mutex held.
 uint32_t PktFlowInfo::LinkLocalBindPort(const VmEntry *vm, uint8_t proto) {
     if (vm == NULL)
         return 0;
@@ -1436,7 +1437,9 @@ void PktFlowInfo::RewritePktInfo(uint32_t flow_index) {
         return;
     }
 
-    FlowEntry *flow = Agent::GetInstance()->pkt()->flow_table()->Find(key);
+    FlowTable *table = Agent::GetInstance()->pkt()->flow_table();
+    tbb::mutex::scoped_lock lock(table->mutex());
+    FlowEntry *flow = table->Find(key);
     if (!flow) {
         std::ostringstream ostr;  
         ostr << "ECMP Resolve: unable to find flow index " << flow_index;
@@ -291,8 +291,11 @@ bool PktSandeshFlow::SetFlowKey(string key) {
     return true;
 }
 
+// The flow key of a response is the key of the first flow of the next page.
+// Flows are listed in the order they were added, so if that flow is deleted
+// meanwhile, listing starts over from the first flow.
 bool PktSandeshFlow::Run() {
-    FlowTable::FlowEntryMap::iterator it;
+    FlowTable::FlowEntryList::iterator it;
     std::vector<SandeshFlowData>& list =
         const_cast<std::vector<SandeshFlowData>&>(resp_obj_->get_flow_list());
     int count = 0;
@@ -306,20 +309,23 @@ bool PktSandeshFlow::Run() {
     }
 
     if (key_valid_) {
-        it = flow_obj->flow_entry_map_.upper_bound(flow_iteration_key_);
+        it = flow_obj->IteratorFind(flow_iteration_key_);
+        if (it == flow_obj->end()) {
+            it = flow_obj->begin();
+        }
     } else {
         FlowErrorResp *resp = new FlowErrorResp();
         SendResponse(resp);
         return true;
     }
-    while (it != flow_obj->flow_entry_map_.end()) {
-        FlowEntry *fe = it->second;
+    while (it != flow_obj->end()) {
+        FlowEntry *fe = &(*it);
         SetSandeshFlowData(list, fe);
         ++it;
         count++;
         if (count == kMaxFlowResponse) {
-            if (it != flow_obj->flow_entry_map_.end()) {
-                resp_obj_->set_flow_key(GetFlowKey(fe->key()));
+            if (it != flow_obj->end()) {
+                resp_obj_->set_flow_key(GetFlowKey(it->key()));
                 flow_key_set = true;
             }
             break;
@@ -373,13 +379,11 @@ void FetchFlowRecord::HandleRequest() const {
     key.dst_port = (unsigned)get_dst_port();
     key.protocol = get_protocol();
 
-    FlowTable::FlowEntryMap::iterator it;
     FlowTable *flow_obj = Agent::GetInstance()->pkt()->flow_table();
-    it = flow_obj->flow_entry_map_.find(key);
+    FlowEntry *fe = flow_obj->Find(key);
     SandeshResponse *resp;
-    if (it != flow_obj->flow_entry_map_.end()) {
+    if (fe != NULL) {
         FlowRecordResp *flow_resp = new FlowRecordResp();
-        FlowEntry *fe = it->second;
         SandeshFlowData data;
         SET_SANDESH_FLOW_DATA(data, fe);
         flow_resp->set_record(data);
@@ -30,6 +30,10 @@ public:
     virtual ProtoHandler *AllocProtoHandler(boost::shared_ptr<PktInfo> info,
                                             boost::asio::io_service &io) = 0;
     virtual bool ValidateAndEnqueueMessage(boost::shared_ptr<PktInfo> msg);
+    // Queue a validated message for processing. Protocols that process
+    // messages in more than one task instance override this to pick the
+    // queue.
+    virtual bool Enqueue(boost::shared_ptr<PktInfo> msg);
     bool ProcessProto(boost::shared_ptr<PktInfo> msg_info);
 
 protected:
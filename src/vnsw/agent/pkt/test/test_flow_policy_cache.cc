@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/os.h"
+#include <algorithm>
+#include <iostream>
+#include <test_cmn_util.h>
+#include <base/time_util.h>
+#include <filter/packet_header.h>
+#include <pkt/flow_policy_cache.h>
+#include <pkt/flow_table.h>
+#include "filter/test/acl_test_util.h"
+#include "pkt/test/test_pkt_util.h"
+
+void RouterIdDepInit(Agent *agent) {
+}
+
+namespace {
+
+static const uint16_t kServicePorts[] = { 22, 80, 443, 8080 };
+
+struct PortInfo input[] = {
+    {"vnet1", 1, "1.1.1.1", "00:00:01:01:01:01", 1, 1},
+    {"vnet2", 2, "1.1.1.2", "00:00:01:01:01:02", 1, 2},
+};
+
+//
+// The ports are in vn1, with acl1 on the network. Tests replace the entries
+// of acl1 in the oper DB, so the rules don't need to match on ports as the
+// ones from the config do.
+//
+class FlowPolicyCacheTest : public AclTestBase {
+protected:
+    FlowPolicyCacheTest()
+        : AclTestBase("FLOW_POLICY_CACHE_TEST_FLOW_COUNT", 1000),
+        flow_table_(Agent::GetInstance()->pkt()->flow_table()),
+        cache_(&table_stats_), src_vn_("vn1"), dst_vn_("vn2") {
+    }
+
+    virtual void SetUp() {
+        CreateVmportEnv(input, 2, 1);
+        client->WaitForIdle();
+        EXPECT_TRUE(VmPortPolicyEnable(input, 0));
+        EXPECT_TRUE(VmPortPolicyEnable(input, 1));
+        vnet1_ = VmInterfaceGet(input[0].intf_id);
+        assert(vnet1_);
+    }
+
+    virtual void TearDown() {
+        FlushFlowTable();
+        DeleteVmportEnv(input, 2, true, 1);
+        client->WaitForIdle();
+    }
+
+    // Non terminal rules on destination subnets and ports of 10.1.0.0/16,
+    // followed by a terminal rule with the given action. Source port rules
+    // only if src_port.
+    AclDBEntry *AddAcl(int rule_count, bool src_port,
+                       TrafficAction::Action last = TrafficAction::PASS) {
+        AclSpec acl_spec;
+        acl_spec.acl_id = MakeUuid(1);
+        for (int i = 0; i < rule_count; i++) {
+            AclEntrySpec ae_spec;
+            ae_spec.id = i + 1;
+            ae_spec.terminal = (i == rule_count - 1);
+            ActionSpec action;
+            action.ta_type = TrafficAction::SIMPLE_ACTION;
+            action.simple_action = (i % 2) ? TrafficAction::PASS :
+                TrafficAction::DENY;
+            if (!ae_spec.terminal) {
+                ae_spec.dst_addr_type = AddressMatch::IP_ADDR;
+                ae_spec.dst_ip_addr = Ip4Address(0x0a010000 | (i & 0xff) << 8);
+                ae_spec.dst_ip_mask = Ip4Address(0xffffff00);
+                ae_spec.dst_ip_plen = 24;
+                AddRange(&ae_spec.protocol, IPPROTO_TCP, IPPROTO_TCP);
+                uint16_t port = kServicePorts[rand() % 4];
+                AddRange(&ae_spec.dst_port, port, port + rand() % 2);
+                if (src_port) {
+                    AddRange(&ae_spec.src_port, 1024, 32767);
+                }
+            } else {
+                action.simple_action = last;
+            }
+            ae_spec.action_l.push_back(action);
+            acl_spec.acl_entry_specs_.push_back(ae_spec);
+        }
+        return AddAclSpec(acl_spec);
+    }
+
+    // Flows between a few VM addresses, differing in the source port
+    void FlowHeader(PacketHeader *hdr) {
+        hdr->src_ip = Ip4Address(0x0a000001 + rand() % 8);
+        hdr->dst_ip = Ip4Address(0x0a010001 + (rand() % 8) * 0x100);
+        hdr->protocol = IPPROTO_TCP;
+        hdr->src_port = 1024 + rand() % 64512;
+        hdr->dst_port = kServicePorts[rand() % 4];
+        hdr->src_policy_id = &src_vn_;
+        hdr->dst_policy_id = &dst_vn_;
+        hdr->src_sg_id_l = &sg_l_;
+        hdr->dst_sg_id_l = &sg_l_;
+    }
+
+    void ExpectSame(const MatchAclParams &lhs, const MatchAclParams &rhs) {
+        EXPECT_EQ(lhs.action_info.action, rhs.action_info.action);
+        EXPECT_TRUE(lhs.ace_id_list == rhs.ace_id_list);
+        EXPECT_EQ(lhs.terminal_rule, rhs.terminal_rule);
+    }
+
+    // Match a packet directly and through the cache
+    void Match(AclDBEntry *acl, const PacketHeader &hdr) {
+        const std::string value("uuid");
+        MatchAclParams expected, m_acl;
+        FlowPolicyInfo expected_info(value), info(value);
+        bool expected_match = acl->PacketMatch(hdr, expected, &expected_info);
+        EXPECT_EQ(expected_match, cache_.PacketMatch(acl, hdr, m_acl, &info));
+        ExpectSame(expected, m_acl);
+        EXPECT_EQ(expected_info.uuid, info.uuid);
+        EXPECT_EQ(expected_info.drop, info.drop);
+        EXPECT_EQ(expected_info.terminal, info.terminal);
+        EXPECT_EQ(expected_info.other, info.other);
+    }
+
+    // TCP flow from vnet1 to vnet2 port 80
+    void TxFlow(uint16_t sport) {
+        TxTcpPacket(vnet1_->id(), "1.1.1.1", "1.1.1.2", sport, 80, false);
+        client->WaitForIdle();
+    }
+
+    uint32_t FlowAction(uint16_t sport) {
+        FlowEntry *fe = FlowGet(vnet1_->vrf()->vrf_id(), "1.1.1.1",
+                                "1.1.1.2", IPPROTO_TCP, sport, 80,
+                                GetFlowKeyNH(input[0].intf_id));
+        EXPECT_TRUE(fe != NULL);
+        return fe ? fe->data().match_p.action_info.action : 0;
+    }
+
+    // Flow setup rate for count flows from vnet1, in flows/sec
+    uint64_t SetupRate(size_t count) {
+        FlushFlowTable();
+        uint64_t start = ClockMonotonicUsec();
+        for (size_t i = 0; i < count; i++) {
+            TxTcpPacket(vnet1_->id(), "1.1.1.1", "1.1.1.2", 1024 + i, 80,
+                        false);
+        }
+        WAIT_FOR((int)count * 100, 100, (count * 2 == flow_table_->Size()));
+        uint64_t usecs = ClockMonotonicUsec() - start + 1;
+        return count * 1000000ULL / usecs;
+    }
+
+    FlowTable *flow_table_;
+    VmInterface *vnet1_;
+    FlowPolicyCache::Stats table_stats_;
+    FlowPolicyCache cache_;
+    std::string src_vn_;
+    std::string dst_vn_;
+    SecurityGroupList sg_l_;
+};
+
+// Flows differing in the source port share the result when no rule
+// matches on it.
+TEST_F(FlowPolicyCacheTest, SourcePort) {
+    AclDBEntry *acl = AddAcl(10, false);
+    ASSERT_TRUE(acl != NULL);
+    EXPECT_FALSE(acl->src_port_match());
+    EXPECT_TRUE(acl->dst_port_match());
+
+    PacketHeader hdr;
+    FlowHeader(&hdr);
+    Match(acl, hdr);
+    hdr.src_port++;
+    Match(acl, hdr);
+    EXPECT_EQ(1U, cache_.stats().misses);
+    EXPECT_EQ(1U, cache_.stats().hits);
+    hdr.dst_port++;
+    Match(acl, hdr);
+    EXPECT_EQ(2U, cache_.stats().misses);
+    EXPECT_EQ(1U, table_stats_.hits);
+    EXPECT_EQ(2U, table_stats_.misses);
+
+    acl = AddAcl(10, true);
+    EXPECT_TRUE(acl->src_port_match());
+    Match(acl, hdr);
+    hdr.src_port++;
+    Match(acl, hdr);
+    EXPECT_EQ(4U, cache_.stats().misses);
+    Match(acl, hdr);
+    EXPECT_EQ(2U, cache_.stats().hits);
+}
+
+// Results are not used once the entries of the ACL change.
+TEST_F(FlowPolicyCacheTest, AclChange) {
+    AclDBEntry *acl = AddAcl(10, false);
+    PacketHeader hdr;
+    FlowHeader(&hdr);
+    Match(acl, hdr);
+    uint64_t generation = acl->generation();
+
+    EXPECT_EQ(acl, AddAcl(20, false));
+    EXPECT_NE(generation, acl->generation());
+    Match(acl, hdr);
+    EXPECT_EQ(2U, cache_.stats().misses);
+    EXPECT_EQ(0U, cache_.stats().hits);
+    EXPECT_EQ(2U, cache_.size());
+
+    cache_.Invalidate();
+    EXPECT_EQ(0U, cache_.size());
+    Match(acl, hdr);
+    EXPECT_EQ(3U, cache_.stats().misses);
+}
+
+// Keys compare the VN names and SG lists by value, and the cache keeps its
+// own copy of them, so results outlive the flow data of the first packet.
+TEST_F(FlowPolicyCacheTest, FlowData) {
+    AclDBEntry *acl = AddAcl(10, false);
+    PacketHeader hdr;
+    FlowHeader(&hdr);
+    {
+        std::string src_vn(src_vn_), dst_vn(dst_vn_);
+        SecurityGroupList sg_l(1, 1);
+        hdr.src_policy_id = &src_vn;
+        hdr.dst_policy_id = &dst_vn;
+        hdr.src_sg_id_l = &sg_l;
+        Match(acl, hdr);
+    }
+
+    std::string src_vn(src_vn_), dst_vn(dst_vn_);
+    SecurityGroupList sg_l(1, 1);
+    hdr.src_policy_id = &src_vn;
+    hdr.dst_policy_id = &dst_vn;
+    hdr.src_sg_id_l = &sg_l;
+    Match(acl, hdr);
+    EXPECT_EQ(1U, cache_.stats().misses);
+    EXPECT_EQ(1U, cache_.stats().hits);
+
+    sg_l.push_back(2);
+    Match(acl, hdr);
+    dst_vn = "vn3";
+    Match(acl, hdr);
+    EXPECT_EQ(3U, cache_.stats().misses);
+    EXPECT_EQ(3U, cache_.size());
+}
+
+TEST_F(FlowPolicyCacheTest, Random) {
+    AclDBEntry *acl = AddAcl(100, false);
+    for (int i = 0; i < 10000; i++) {
+        PacketHeader hdr;
+        FlowHeader(&hdr);
+        if (i % 3 == 0)
+            hdr.protocol = IPPROTO_UDP;
+        Match(acl, hdr);
+    }
+    size_t max_entries = FlowPolicyCache::kMaxEntries;
+    EXPECT_LE(cache_.size(), max_entries);
+    EXPECT_NE(0U, cache_.stats().hits);
+}
+
+// Flows of an interface differing in the source port are set up with the
+// result of the first one.
+TEST_F(FlowPolicyCacheTest, FlowSetup) {
+    AddAcl(10, false);
+    FlowPolicyCache *cache = flow_table_->policy_cache(vnet1_);
+    ASSERT_TRUE(cache != NULL);
+
+    TxFlow(1000);
+    uint64_t misses = cache->stats().misses;
+    uint64_t hits = cache->stats().hits;
+    EXPECT_NE(0U, misses);
+    for (uint16_t sport = 1001; sport <= 1010; sport++) {
+        TxFlow(sport);
+    }
+    EXPECT_EQ(misses, cache->stats().misses);
+    EXPECT_LE(hits + 10, cache->stats().hits);
+    EXPECT_LE(cache->stats().hits, flow_table_->policy_cache_stats().hits);
+    for (uint16_t sport = 1000; sport <= 1010; sport++) {
+        EXPECT_NE(0U, FlowAction(sport) & (1 << TrafficAction::PASS));
+    }
+
+    // Flows are set up without the cache once it is disabled
+    hits = cache->stats().hits;
+    flow_table_->set_policy_cache_enabled(false);
+    EXPECT_TRUE(flow_table_->policy_cache(vnet1_) == NULL);
+    TxFlow(1011);
+    EXPECT_NE(0U, FlowAction(1011) & (1 << TrafficAction::PASS));
+    EXPECT_EQ(hits, cache->stats().hits);
+    EXPECT_EQ(misses, cache->stats().misses);
+    flow_table_->set_policy_cache_enabled(true);
+}
+
+// Flows are set up again with the new entries when the ACL changes.
+TEST_F(FlowPolicyCacheTest, FlowAclChange) {
+    AddAcl(10, false);
+    TxFlow(1000);
+    TxFlow(1001);
+    EXPECT_NE(0U, FlowAction(1000) & (1 << TrafficAction::PASS));
+
+    AddAcl(10, false, TrafficAction::DENY);
+    client->WaitForIdle();
+    EXPECT_NE(0U, FlowAction(1000) & (1 << TrafficAction::DENY));
+    EXPECT_NE(0U, FlowAction(1001) & (1 << TrafficAction::DENY));
+
+    AddAcl(10, false);
+    client->WaitForIdle();
+    EXPECT_NE(0U, FlowAction(1000) & (1 << TrafficAction::PASS));
+    EXPECT_NE(0U, FlowAction(1001) & (1 << TrafficAction::PASS));
+}
+
+// The results of an interface are dropped when its policy changes.
+TEST_F(FlowPolicyCacheTest, FlowPolicyChange) {
+    AddAcl(10, false, TrafficAction::DENY);
+    FlowPolicyCache *cache = flow_table_->policy_cache(vnet1_);
+    ASSERT_TRUE(cache != NULL);
+    TxFlow(1000);
+    EXPECT_NE(0U, FlowAction(1000) & (1 << TrafficAction::DENY));
+    EXPECT_NE(0U, cache->size());
+
+    DelLink("virtual-network", "vn1", "access-control-list", "acl1");
+    client->WaitForIdle();
+    EXPECT_FALSE(VmPortPolicyEnable(input, 0));
+    EXPECT_EQ(0U, cache->size());
+    EXPECT_NE(0U, FlowAction(1000) & (1 << TrafficAction::PASS));
+
+    AddLink("virtual-network", "vn1", "access-control-list", "acl1");
+    client->WaitForIdle();
+    EXPECT_TRUE(VmPortPolicyEnable(input, 0));
+    EXPECT_NE(0U, FlowAction(1000) & (1 << TrafficAction::DENY));
+    EXPECT_NE(0U, cache->size());
+}
+
+//
+// Flow setup rate with a 1000 rule ACL on the network, with and without the
+// cache. Flows go between the two VMs with a new source port each, so the
+// ACL fields repeat while the flow keys don't.
+//
+TEST_F(FlowPolicyCacheTest, Benchmark) {
+    AddAcl(1000, false);
+    size_t count = std::min(count_, (size_t)64000);
+
+    flow_table_->set_policy_cache_enabled(false);
+    uint64_t linear_rate = SetupRate(count);
+    flow_table_->set_policy_cache_enabled(true);
+    uint64_t cache_rate = SetupRate(count);
+    const FlowPolicyCache::Stats &stats = flow_table_->policy_cache_stats();
+    EXPECT_NE(0U, stats.hits);
+
+    std::cout << count << " flow setups: linear " << linear_rate
+              << " setups/sec, cache " << cache_rate << " setups/sec, "
+              << stats.hits << " hits, " << stats.misses << " misses"
+              << std::endl;
+}
+
+} //namespace
+
+int main (int argc, char **argv) {
+    GETUSERARGS();
+    client = TestInit(init_file, ksync_init);
+
+    int ret = RUN_ALL_TESTS();
+    TestShutdown();
+    delete client;
+    return ret;
+}
@@ -3,6 +3,7 @@
  */
 
 #include "base/os.h"
+#include "base/time_util.h"
 #include "test/test_cmn_util.h"
 #include "test_pkt_util.h"
 #include "pkt/flow_proto.h"
@@ -75,6 +76,72 @@ TEST_F(FlowTest, FlowScaling_1) {
              (count == flow_count + (int) Agent::GetInstance()->pkt()->flow_table()->Size()));
 }
 
+// Both directions of a flow must be set up in the same partition.
+TEST_F(FlowTest, FlowPartitionHash) {
+    boost::system::error_code ec;
+    IpAddress sip = IpAddress::from_string("1.1.1.1", ec);
+    IpAddress dip = IpAddress::from_string("5.0.0.1", ec);
+    EXPECT_EQ(FlowProto::FlowHash(sip, dip, IPPROTO_TCP, 1000, 80),
+              FlowProto::FlowHash(dip, sip, IPPROTO_TCP, 80, 1000));
+
+    IpAddress sip6 = IpAddress::from_string("fd00::1", ec);
+    IpAddress dip6 = IpAddress::from_string("fd00::5", ec);
+    EXPECT_EQ(FlowProto::FlowHash(sip6, dip6, IPPROTO_UDP, 5000, 53),
+              FlowProto::FlowHash(dip6, sip6, IPPROTO_UDP, 53, 5000));
+}
+
+// Measure the rate of flow setups for synthetic packets trapped from a VM.
+// Packets go through PktHandler and are processed by PktFlowInfo in the
+// Agent::FlowHandler partitions.
+TEST_F(FlowTest, FlowSetupRate) {
+    int count = 1000;
+    char *str = getenv("AGENT_FLOW_SETUP_RATE_COUNT");
+    if (str) count = strtoul(str, NULL, 0);
+    FlowTable *table = Agent::GetInstance()->pkt()->flow_table();
+    FlowProto *proto = Agent::GetInstance()->GetFlowProto();
+    int flow_count = table->Size();
+
+    uint64_t start = ClockMonotonicUsec();
+    for (int i = 0; i < count; i++) {
+        Ip4Address addr(0x05010000 + i);
+        TxIpPacket(vnet->id(), vnet_addr, addr.to_string().c_str(), 1);
+    }
+    WAIT_FOR(count * 100, 100,
+             (flow_count + count * 2 == (int) table->Size()));
+    uint64_t usecs = ClockMonotonicUsec() - start + 1;
+
+    std::cout << count << " flow setups with " << proto->partition_count()
+              << " partitions: " << count * 1000000ULL / usecs
+              << " setups/sec" << std::endl;
+}
+
+// A link-local flow binds a local source port for the NAT while the
+// partition holds the FlowTable mutex for PktFlowInfo::Add.
+TEST_F(FlowTest, LinkLocalFlowSetup) {
+    Agent *agent = Agent::GetInstance();
+    agent->set_router_id(Ip4Address::from_string("10.1.2.1"));
+    std::vector<std::string> fabric_ip_list;
+    fabric_ip_list.push_back("1.2.3.4");
+    TestLinkLocalService service = { "test_service", "169.254.1.10", 4000,
+                                     "", fabric_ip_list, 8000 };
+    AddLinkLocalConfig(&service, 1);
+    client->WaitForIdle();
+
+    TxTcpPacket(vnet->id(), vnet_addr, "169.254.1.10", 3000, 4000, false);
+    client->WaitForIdle();
+    WAIT_FOR(1000, 1000, (2U == agent->pkt()->flow_table()->Size()));
+    FlowEntry *fe = FlowGet(vnet->vrf()->vrf_id(), vnet_addr, "169.254.1.10",
+                            IPPROTO_TCP, 3000, 4000, GetFlowKeyNH(1));
+    EXPECT_TRUE(fe != NULL);
+    if (fe != NULL) {
+        EXPECT_TRUE(fe->is_flags_set(FlowEntry::LinkLocalBindLocalSrcPort));
+        EXPECT_NE(0, fe->linklocal_src_port());
+    }
+
+    DelLinkLocalConfig();
+    client->WaitForIdle();
+}
+
 int main(int argc, char *argv[]) {
     int ret = 0;
 
@@ -3,6 +3,7 @@
  */
 
 #include "base/os.h"
+#include "base/time_util.h"
 #include "test/test_cmn_util.h"
 #include "ksync/ksync_sock_user.h"
 
@@ -478,6 +479,63 @@ TEST_F(FlowTableTest, RevFlowDelete_before_KSyncAck) {
 
 }
 
+// Compare the latency of flow lookups in FlowEntryIndex against an ordered
+// map of flows. The default size is small; set AGENT_FLOW_LOOKUP_COUNT=524288
+// for a full run.
+TEST(FlowEntryIndexTest, LookupBenchmark) {
+    int count = 16 * 1024;
+    char *str = getenv("AGENT_FLOW_LOOKUP_COUNT");
+    if (str) count = strtoul(str, NULL, 0);
+
+    std::vector<FlowEntry *> flows;
+    FlowEntryIndex index;
+    std::map<FlowKey, FlowEntry *, Inet4FlowKeyCmp> map;
+    for (int i = 0; i < count; i++) {
+        FlowKey key(i % 64, Ip4Address(0x0A000000 + i),
+                    Ip4Address(0x14000000 + (i * 7)), IPPROTO_TCP,
+                    1024 + (i % 30000), 80);
+        FlowEntry *flow = new FlowEntry(key);
+        flows.push_back(flow);
+        index.Insert(flow);
+        map.insert(std::make_pair(key, flow));
+    }
+    EXPECT_EQ((size_t) count, index.size());
+
+    // Look the flows up in an order unrelated to the key order.
+    std::vector<FlowKey> keys;
+    for (int i = 0; i < count; i++) {
+        keys.push_back(flows[(i * 7919) % count]->key());
+    }
+
+    int found = 0;
+    uint64_t start = ClockMonotonicUsec();
+    for (int i = 0; i < count; i++) {
+        if (index.Find(keys[i]) != NULL)
+            found++;
+    }
+    uint64_t index_usecs = ClockMonotonicUsec() - start;
+    EXPECT_EQ(count, found);
+
+    found = 0;
+    start = ClockMonotonicUsec();
+    for (int i = 0; i < count; i++) {
+        if (map.find(keys[i]) != map.end())
+            found++;
+    }
+    uint64_t map_usecs = ClockMonotonicUsec() - start;
+    EXPECT_EQ(count, found);
+
+    LOG(DEBUG, count << " flows: index lookup "
+        << index_usecs * 1000 / count << " ns, map lookup "
+        << map_usecs * 1000 / count << " ns");
+
+    for (int i = 0; i < count; i++) {
+        EXPECT_TRUE(index.Remove(flows[i]));
+    }
+    EXPECT_EQ(0U, index.size());
+    STLDeleteValues(&flows);
+}
+
 int main(int argc, char *argv[]) {
     GETUSERARGS();
 
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/time_util.h"
+#include "pkt/packet_buffer.h"
+#include "pkt/pkt_handler.h"
+#include "testing/gunit.h"
+
+class PacketBufferTest : public ::testing::Test {
+protected:
+    PacketBufferTest() : mgr_(NULL) {
+    }
+
+    PacketBufferManager mgr_;
+};
+
+// A freed block is handed out again by the next allocation of its class.
+TEST_F(PacketBufferTest, Recycle) {
+    PacketBufferPtr pkt = mgr_.Allocate(PktHandler::RX_PACKET, 1500, 0);
+    uint8_t *buffer = pkt->buffer();
+    pkt.reset();
+    EXPECT_EQ(1U, mgr_.size_class_stats(2).free_blocks);
+
+    pkt = mgr_.Allocate(PktHandler::RX_PACKET, 2000, 0);
+    EXPECT_EQ(buffer, pkt->buffer());
+    EXPECT_EQ(2000, pkt->data_len());
+    EXPECT_EQ(0U, mgr_.size_class_stats(2).free_blocks);
+    EXPECT_EQ(2U, mgr_.size_class_stats(2).allocs);
+    EXPECT_EQ(1U, mgr_.size_class_stats(2).pool_allocs);
+    pkt.reset();
+
+    // Buffers larger than the biggest class are not recycled
+    pkt = mgr_.Allocate(PktHandler::RX_PACKET, 10000, 0);
+    pkt.reset();
+    for (int i = 0; i < PacketBufferManager::kSizeClassCount; i++) {
+        EXPECT_GE(1U, mgr_.size_class_stats(i).free_blocks);
+    }
+    EXPECT_EQ(3U, mgr_.alloc_count());
+    EXPECT_EQ(3U, mgr_.free_count());
+}
+
+TEST_F(PacketBufferTest, MaxFreeBlocks) {
+    std::vector<PacketBufferPtr> list;
+    for (int i = 0; i < 8; i++) {
+        list.push_back(mgr_.Allocate(PktHandler::RX_PACKET, 100, 0));
+    }
+    mgr_.set_max_free_blocks(4);
+    list.clear();
+    EXPECT_EQ(4U, mgr_.size_class_stats(0).free_blocks);
+
+    mgr_.set_max_free_blocks(0);
+    EXPECT_EQ(0U, mgr_.size_class_stats(0).free_blocks);
+    PacketBufferPtr pkt = mgr_.Allocate(PktHandler::RX_PACKET, 100, 0);
+    pkt.reset();
+    EXPECT_EQ(0U, mgr_.size_class_stats(0).free_blocks);
+}
+
+// Buffers are accounted to the module owning them.
+TEST_F(PacketBufferTest, ModuleStats) {
+    const PacketBufferManager::ModuleStats &rx =
+        mgr_.module_stats(PktHandler::RX_PACKET);
+    const PacketBufferManager::ModuleStats &flow =
+        mgr_.module_stats(PktHandler::FLOW);
+
+    PacketBufferPtr pkt = mgr_.Allocate(PktHandler::RX_PACKET, 1000, 0);
+    EXPECT_EQ(1U, rx.allocs);
+    EXPECT_EQ(1000U, rx.bytes);
+
+    pkt->set_module(PktHandler::FLOW);
+    EXPECT_EQ(1U, rx.frees);
+    EXPECT_EQ(0U, rx.bytes);
+    EXPECT_EQ(1U, flow.allocs);
+    EXPECT_EQ(1000U, flow.bytes);
+
+    pkt.reset();
+    EXPECT_EQ(1U, flow.frees);
+    EXPECT_EQ(0U, flow.bytes);
+}
+
+// Headers are prepended in the headroom of the buffer.
+TEST_F(PacketBufferTest, Push) {
+    PacketBufferPtr pkt = mgr_.Allocate(PktHandler::RX_PACKET, 100, 0);
+    uint8_t *data = pkt->data();
+    uint16_t headroom = PacketBuffer::kHeadRoom;
+    EXPECT_EQ(headroom, pkt->headroom());
+
+    uint8_t *hdr = pkt->Push(14);
+    EXPECT_EQ(data - 14, hdr);
+    EXPECT_EQ(114, pkt->data_len());
+    EXPECT_EQ(headroom - 14, pkt->headroom());
+
+    EXPECT_TRUE(pkt->SetOffset(14));
+    EXPECT_EQ(data, pkt->data());
+    EXPECT_EQ(100, pkt->data_len());
+
+    EXPECT_TRUE(pkt->Push(headroom + 1) == NULL);
+    EXPECT_EQ(data, pkt->data());
+
+    // Buffers created from external memory have no headroom
+    PacketBufferPtr ext = mgr_.Allocate(PktHandler::RX_PACKET,
+                                        new uint8_t[100], 100, 0, 100, 0);
+    EXPECT_EQ(0, ext->headroom());
+    EXPECT_TRUE(ext->Push(1) == NULL);
+}
+
+// The headroom is used by one pending transmit at a time.
+TEST_F(PacketBufferTest, ReserveHeadroom) {
+    PacketBufferPtr pkt = mgr_.Allocate(PktHandler::RX_PACKET, 100, 0);
+    EXPECT_TRUE(pkt->ReserveHeadroom());
+    EXPECT_FALSE(pkt->ReserveHeadroom());
+    pkt->ReleaseHeadroom();
+    EXPECT_TRUE(pkt->ReserveHeadroom());
+}
+
+//
+// Receive rate over a datagram socket pair, standing in for the pkt0
+// descriptor. The baseline waits for and reads one packet per event into a
+// heap buffer. The batched receiver reads up to kMaxReadBatch packets per
+// event into pooled buffers. The default packet count is small; set
+// PKT_BUFFER_TEST_PACKET_COUNT=200000 for a full run.
+//
+class PacketBufferBenchmarkTest : public PacketBufferTest {
+protected:
+    static const size_t kMaxReadBatch = 32;
+    static const uint16_t kPacketSize = 1500;
+
+    PacketBufferBenchmarkTest() : packet_count_(2000) {
+        char *str = getenv("PKT_BUFFER_TEST_PACKET_COUNT");
+        if (str) packet_count_ = strtoul(str, NULL, 0);
+    }
+
+    virtual void SetUp() {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fd_));
+        int size = 4 * 1024 * 1024;
+        setsockopt(fd_[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        setsockopt(fd_[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+
+    virtual void TearDown() {
+        close(fd_[0]);
+        close(fd_[1]);
+    }
+
+    // Send up to count packets without blocking
+    size_t Send(size_t count) {
+        uint8_t buff[kPacketSize];
+        memset(buff, 0, sizeof(buff));
+        size_t sent = 0;
+        while (sent < count) {
+            if (send(fd_[0], buff, sizeof(buff), MSG_DONTWAIT) < 0)
+                break;
+            sent++;
+        }
+        return sent;
+    }
+
+    bool WaitReadable() {
+        struct pollfd pfd;
+        pfd.fd = fd_[1];
+        pfd.events = POLLIN;
+        return poll(&pfd, 1, 1000) == 1;
+    }
+
+    // Returns the packets received in one read event
+    size_t ReadHeap() {
+        if (!WaitReadable())
+            return 0;
+        uint8_t *buff = new uint8_t[kPacketSize];
+        ssize_t len = recv(fd_[1], buff, kPacketSize, MSG_DONTWAIT);
+        if (len <= 0) {
+            delete [] buff;
+            return 0;
+        }
+        PacketBufferPtr pkt = mgr_.Allocate(PktHandler::RX_PACKET, buff,
+                                            kPacketSize, 0, len, 0);
+        return 1;
+    }
+
+    size_t ReadBatch() {
+        if (!WaitReadable())
+            return 0;
+        size_t count = 0;
+        while (count < kMaxReadBatch) {
+            PacketBufferPtr pkt = mgr_.Allocate(PktHandler::RX_PACKET,
+                                                kPacketSize, 0);
+            ssize_t len = recv(fd_[1], pkt->data(), kPacketSize,
+                               MSG_DONTWAIT);
+            if (len <= 0)
+                break;
+            pkt->set_len(len);
+            count++;
+        }
+        return count;
+    }
+
+    uint64_t Run(bool batch) {
+        size_t sent = 0, received = 0;
+        uint64_t start = ClockMonotonicUsec();
+        while (received < packet_count_) {
+            if (sent < packet_count_) {
+                sent += Send(std::min(packet_count_ - sent, (size_t) 256));
+            }
+            size_t count = batch ? ReadBatch() : ReadHeap();
+            if (count == 0 && sent == received)
+                break;
+            received += count;
+        }
+        uint64_t elapsed = ClockMonotonicUsec() - start;
+        EXPECT_EQ(packet_count_, received);
+        return elapsed ? received * 1000000 / elapsed : 0;
+    }
+
+    size_t packet_count_;
+    int fd_[2];
+};
+
+TEST_F(PacketBufferBenchmarkTest, Receive) {
+    uint64_t heap_pps = Run(false);
+    uint64_t batch_pps = Run(true);
+    LOG(DEBUG, "Received " << packet_count_ << " packets: "
+        << heap_pps << " pps single read, "
+        << batch_pps << " pps batched read, "
+        << mgr_.size_class_stats(2).pool_allocs << " pooled allocations");
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/os.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <boost/asio.hpp>
+#include <test_cmn_util.h>
+#include <contrail/pkt0_interface.h>
+#include <pkt/pkt_init.h>
+
+void RouterIdDepInit(Agent *agent) {
+}
+
+// Packets received by the control interfaces below are shorter than the
+// agent header, so each one only increments the invalid agent header count.
+static const size_t kPacketCount = 3 * Pkt0Interface::kMaxReadBatch + 5;
+static const size_t kPacketSize = 8;
+
+// Pkt0Interface reading from a datagram socket instead of the tap interface
+class TestPkt0ReadInterface : public Pkt0Interface {
+public:
+    TestPkt0ReadInterface(boost::asio::io_service *io, int fd) :
+        Pkt0Interface("pkt0-read", io), fd_(fd) {
+    }
+
+    virtual void InitControlInterface() {
+        VrouterControlInterface::InitControlInterface();
+        tap_fd_ = fd_;
+        input_.assign(fd_);
+        AsyncRead();
+    }
+
+private:
+    int fd_;
+};
+
+// Pkt0Socket reading from a datagram socket instead of the vrouter socket
+class TestPkt0ReadSocket : public Pkt0Socket {
+public:
+    TestPkt0ReadSocket(boost::asio::io_service *io, int fd) :
+        Pkt0Socket("pkt0-read", io), fd_(fd) {
+    }
+
+    virtual void InitControlInterface() {
+        VrouterControlInterface::InitControlInterface();
+        socket_.assign(boost::asio::local::datagram_protocol(), fd_);
+        AsyncRead();
+    }
+
+private:
+    int fd_;
+};
+
+// Reads of the control interfaces are driven from the test thread with an
+// io_service of their own, so the read handlers run one at a time.
+class Pkt0ReadTest : public ::testing::Test {
+protected:
+    Pkt0ReadTest() : agent_(Agent::GetInstance()), start_(0) {
+    }
+
+    virtual void SetUp() {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fd_));
+        int size = 1024 * 1024;
+        setsockopt(fd_[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+
+    virtual void TearDown() {
+        close(fd_[0]);
+    }
+
+    uint64_t processed() const {
+        return agent_->stats()->pkt_invalid_agent_hdr() - start_;
+    }
+
+    // Queue all packets before the interface reads any of them, and read
+    // until each has been handed to the control interface.
+    void Run(ControlInterface *intf) {
+        uint8_t buff[kPacketSize];
+        memset(buff, 0, sizeof(buff));
+        for (size_t i = 0; i < kPacketCount; i++) {
+            ASSERT_EQ((ssize_t)sizeof(buff),
+                      send(fd_[0], buff, sizeof(buff), 0));
+        }
+
+        start_ = agent_->stats()->pkt_invalid_agent_hdr();
+        intf->Init(agent_->pkt()->pkt_handler());
+        for (int i = 0; i < 100 && processed() < kPacketCount; i++) {
+            io_.poll();
+        }
+        EXPECT_EQ(kPacketCount, processed());
+
+        // Stop the pending read
+        intf->IoShutdown();
+        io_.poll();
+        EXPECT_EQ(kPacketCount, processed());
+    }
+
+    Agent *agent_;
+    uint64_t start_;
+    boost::asio::io_service io_;
+    int fd_[2];
+};
+
+// Every packet of a burst longer than kMaxReadBatch is processed
+TEST_F(Pkt0ReadTest, Interface) {
+    TestPkt0ReadInterface intf(&io_, fd_[1]);
+    Run(&intf);
+}
+
+TEST_F(Pkt0ReadTest, Socket) {
+    TestPkt0ReadSocket intf(&io_, fd_[1]);
+    Run(&intf);
+}
+
+int main(int argc, char **argv) {
+    GETUSERARGS();
+    client = TestInit(init_file, ksync_init);
+
+    int ret = RUN_ALL_TESTS();
+    TestShutdown();
+    delete client;
+    return ret;
+}
@@ -107,7 +107,7 @@ public:
     }
 
     int EncodeAgentHdr(uint8_t *buff, const AgentHdr &hdr) {
-        bzero(buff, sizeof(agent_hdr));
+        bzero(buff, kAgentHdrLen);
 
         // Add outer ethernet header
         struct ether_header *eth = (struct ether_header *)buff;
@@ -126,18 +126,34 @@ public:
 
     // Transmit packet on VrouterControlInterface.
     // Format of packet after encapsulation is OUTER_ETH - AGENT_HDR - PAYLOAD
+    // The headers are encoded in the headroom of the packet buffer if there
+    // is enough of it, and in a separate buffer otherwise. The write may
+    // still be pending when Send returns, so the headroom is not used while
+    // an earlier send of the same buffer may still be reading it.
     virtual int Send(const AgentHdr &hdr, const PacketBufferPtr &pkt) {
         uint16_t agent_hdr_len = kAgentHdrLen;
-        uint8_t *agent_hdr_buff = new uint8_t [agent_hdr_len];
-        EncodeAgentHdr(agent_hdr_buff, hdr);
-
-        int ret = Send(agent_hdr_buff, agent_hdr_len, pkt);
+        int ret;
+        if (pkt->headroom() >= agent_hdr_len && pkt->ReserveHeadroom()) {
+            uint8_t *agent_hdr_buff = pkt->Push(agent_hdr_len);
+            EncodeAgentHdr(agent_hdr_buff, hdr);
+            ret = Send(NULL, 0, pkt);
+            // Restore the payload view of the buffer for the caller
+            pkt->SetOffset(agent_hdr_len);
+        } else {
+            uint8_t *agent_hdr_buff = new uint8_t [agent_hdr_len];
+            EncodeAgentHdr(agent_hdr_buff, hdr);
+            ret = Send(agent_hdr_buff, agent_hdr_len, pkt);
+        }
         if (ret <= 0)
             return ret;
 
         return ret - sizeof(agent_hdr);
     }
 
+    // Transmit buff followed by the data of pkt. buff may be NULL when the
+    // headers are already part of pkt, in the headroom reserved by
+    // Send(hdr, pkt); the headroom is released once the write is complete.
+    // Takes ownership of buff.
     virtual int Send(uint8_t *buff, uint16_t buf_len,
                      const PacketBufferPtr &pkt) = 0;
 private:
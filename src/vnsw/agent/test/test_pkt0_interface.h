@@ -108,6 +108,9 @@ public:
             LOG(ERROR, "Packet Test Tap Error <" <<
                 err.message() << "> sending packet");
         }
+        if (buff == NULL) {
+            pkt->ReleaseHeadroom();
+        }
         delete [] buff;
     }
 
@@ -887,6 +887,49 @@ TEST_F(RouteTest, FindLPM) {
     client->WaitForIdle();
 }
 
+// Same lookups with the multibit trie index of the table enabled
+TEST_F(RouteTest, FindLPM_Index) {
+    InetUnicastAgentRouteTable *table =
+        Agent::GetInstance()->fabric_inet4_unicast_table();
+    InetUnicastAgentRouteTable::set_lpm_index_threshold(1);
+    InetUnicastRouteEntry *rt;
+    AddResolveRoute(lpm1_ip_, 8);
+    client->WaitForIdle();
+    AddResolveRoute(lpm2_ip_, 16);
+    client->WaitForIdle();
+    AddResolveRoute(lpm3_ip_, 24);
+    client->WaitForIdle();
+    AddArp(lpm4_ip_.to_string().c_str(), "0d:0b:0c:0d:0e:0f", eth_name_.c_str());
+    client->WaitForIdle();
+    EXPECT_TRUE(table->lpm_index_enabled());
+
+    rt = table->FindLPM(lpm4_ip_);
+    EXPECT_EQ(lpm4_ip_, rt->addr());
+    DeleteRoute(Agent::GetInstance()->local_peer(), Agent::GetInstance()->fabric_vrf_name(), lpm4_ip_, 32);
+    client->WaitForIdle();
+    rt = table->FindLPM(lpm4_ip_);
+    EXPECT_EQ(lpm3_ip_, rt->addr());
+    DeleteRoute(Agent::GetInstance()->local_peer(), Agent::GetInstance()->fabric_vrf_name(), lpm3_ip_, 24);
+    client->WaitForIdle();
+    rt = table->FindLPM(lpm4_ip_);
+    EXPECT_EQ(lpm2_ip_, rt->addr());
+    // Lookups of a prefix use the Patricia tree
+    InetUnicastRouteEntry key(NULL, lpm4_ip_, 8, false);
+    rt = table->FindLPM(key);
+    EXPECT_EQ(lpm1_ip_, rt->addr());
+    DeleteRoute(Agent::GetInstance()->local_peer(), Agent::GetInstance()->fabric_vrf_name(), lpm2_ip_, 16);
+    client->WaitForIdle();
+    rt = table->FindLPM(lpm4_ip_);
+    EXPECT_EQ(lpm1_ip_, rt->addr());
+    DeleteRoute(Agent::GetInstance()->local_peer(), Agent::GetInstance()->fabric_vrf_name(), lpm1_ip_, 8);
+    client->WaitForIdle();
+    DelArp(lpm4_ip_.to_string().c_str(), "0d:0b:0c:0d:0e:0f", eth_name_.c_str());
+    client->WaitForIdle();
+
+    InetUnicastAgentRouteTable::set_lpm_index_threshold(
+        InetUnicastAgentRouteTable::kDefaultLpmIndexThreshold);
+}
+
 TEST_F(RouteTest, VlanNHRoute_1) {
     struct PortInfo input[] = {
         {"vnet1", 1, "1.1.1.10", "00:00:00:01:01:01", 1, 1},
@@ -224,7 +224,7 @@ void FlowStatsCollector::UpdateFlowStats(FlowEntry *flow, uint64_t &diff_bytes,
 }
 
 bool FlowStatsCollector::Run() {
-    FlowTable::FlowEntryMap::iterator it;
+    FlowTable::FlowEntryList::iterator it;
     FlowEntry *entry = NULL, *reverse_flow;
     FlowStats *stats = NULL;
     uint32_t count = 0;
@@ -237,15 +237,17 @@ bool FlowStatsCollector::Run() {
         return true;
     }
     uint64_t curr_time = UTCTimestampUsec();
-    it = flow_obj->flow_entry_map_.upper_bound(flow_iteration_key_);
-    if (it == flow_obj->flow_entry_map_.end()) {
-        it = flow_obj->flow_entry_map_.begin();
+    // Resume from the flow the previous pass stopped at. Start over if it
+    // was deleted meanwhile.
+    it = flow_obj->IteratorFind(flow_iteration_key_);
+    if (it == flow_obj->end()) {
+        it = flow_obj->begin();
     }
     FlowTableKSyncObject *ksync_obj =
         Agent::GetInstance()->ksync()->flowtable_ksync_obj();
 
-    while (it != flow_obj->flow_entry_map_.end()) {
-        entry = it->second;
+    while (it != flow_obj->end()) {
+        entry = &(*it);
         stats = &(entry->stats_);
         it++;
         assert(entry);
@@ -255,7 +257,6 @@ bool FlowStatsCollector::Run() {
             continue;
         }
 
-        flow_iteration_key_ = entry->key();
         const vr_flow_entry *k_flow = ksync_obj->GetKernelFlowEntry
             (entry->flow_handle(), false);
         reverse_flow = entry->reverse_flow_entry();
@@ -276,8 +277,8 @@ bool FlowStatsCollector::Run() {
         }
 
         if (deleted == true) {
-            if (it != flow_obj->flow_entry_map_.end()) {
-                if (it->second == reverse_flow) {
+            if (it != flow_obj->end()) {
+                if (&(*it) == reverse_flow) {
                     it++;
                 }
             }
@@ -329,8 +330,8 @@ bool FlowStatsCollector::Run() {
 
         if ((!deleted) && (delete_short_flow_ == true) &&
             entry->is_flags_set(FlowEntry::ShortFlow)) {
-            if (it != flow_obj->flow_entry_map_.end()) {
-                if (it->second == reverse_flow) {
+            if (it != flow_obj->end()) {
+                if (&(*it) == reverse_flow) {
                     it++;
                 }
             }
@@ -352,7 +353,8 @@ bool FlowStatsCollector::Run() {
     }
 
     if (count == flow_count_per_pass_) {
-        if (it != flow_obj->flow_entry_map_.end()) {
+        if (it != flow_obj->end()) {
+            flow_iteration_key_ = it->key();
             key_updation_reqd = false;
         }
     }
@@ -24,6 +24,7 @@
 #include <db/db_table.h>
 #include <db/db_table_partition.h>
 #include <cmn/agent_cmn.h>
+#include <init/agent_param.h>
 #include <ksync/ksync_index.h>
 #include <ksync/ksync_entry.h>
 #include <ksync/ksync_object.h>
@@ -144,7 +145,7 @@ void KSync::ResetVRouter(bool run_sync_mode) {
         return;
     }
 
-    KSyncSock::Start(run_sync_mode);
+    KSyncSock::Start(run_sync_mode, agent_->params()->ksync_batch_mode());
 }
 
 void KSync::VnswInterfaceListenerInit() {
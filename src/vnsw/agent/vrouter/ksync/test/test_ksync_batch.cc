@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/os.h"
+#include <deque>
+#include <vector>
+#include <cmn/agent_cmn.h>
+#include <tbb/atomic.h>
+
+#include "base/logging.h"
+#include "testing/gunit.h"
+#include "base/test/task_test_util.h"
+#include "ksync/ksync_index.h"
+#include "ksync/ksync_entry.h"
+#include "ksync/ksync_sock.h"
+
+void RouterIdDepInit(Agent *agent) {
+}
+
+class MockSandeshContext : public AgentSandeshContext {
+public:
+    MockSandeshContext() : AgentSandeshContext() { }
+    virtual ~MockSandeshContext() { }
+
+    virtual void IfMsgHandler(vr_interface_req *req) { }
+    virtual void NHMsgHandler(vr_nexthop_req *req) { }
+    virtual void RouteMsgHandler(vr_route_req *req) { }
+    virtual void MplsMsgHandler(vr_mpls_req *req) { }
+    virtual int VrResponseMsgHandler(vr_response *r) { return 0; }
+    virtual void MirrorMsgHandler(vr_mirror_req *req) { }
+    virtual void FlowMsgHandler(vr_flow_req *req) { }
+    virtual void VrfAssignMsgHandler(vr_vrf_assign_req *req) { }
+    virtual void VrfStatsMsgHandler(vr_vrf_stats_req *req) { }
+    virtual void DropStatsMsgHandler(vr_drop_stats_req *req) { }
+    virtual void VxLanMsgHandler(vr_vxlan_req *req) { }
+};
+
+class TestIoContext : public IoContext {
+public:
+    TestIoContext(uint32_t len, uint32_t seq, AgentSandeshContext *ctx)
+        : IoContext(static_cast<char *>(calloc(1, len)), len, seq, ctx) { }
+    virtual ~TestIoContext() { }
+
+    virtual void Handler() { done_count_++; }
+
+    static tbb::atomic<int> done_count_;
+};
+tbb::atomic<int> TestIoContext::done_count_;
+
+// KSync socket that loops every request back as a response. Messages are
+// framed with a MsgHdr and, like a transport with a per-message limit, any
+// message longer than kBufLen cannot be encoded into a batch
+class MockBatchSock : public KSyncSock {
+public:
+    struct MsgHdr {
+        uint32_t seq;
+        uint32_t len;
+        uint32_t more;
+    };
+
+    explicit MockBatchSock(bool sync_mode)
+        : KSyncSock(), sync_mode_(sync_mode), response_count_(1) { }
+    virtual ~MockBatchSock() {
+        for (std::deque<char *>::iterator it = rx_queue_.begin();
+             it != rx_queue_.end(); ++it) {
+            delete [] *it;
+        }
+    }
+
+    static MockBatchSock *Init(bool sync_mode) {
+        KSyncSock::Init(1);
+        MockBatchSock *sock = new MockBatchSock(sync_mode);
+        SetSockTableEntry(0, sock);
+        return sock;
+    }
+
+    virtual uint32_t GetSeqno(char *data) {
+        return reinterpret_cast<MsgHdr *>(data)->seq;
+    }
+    virtual bool IsMoreData(char *data) {
+        return reinterpret_cast<MsgHdr *>(data)->more != 0;
+    }
+    virtual void Decoder(char *data, SandeshContext *ctxt) { }
+    virtual bool Validate(char *data) { return true; }
+
+    virtual void AsyncReceive(boost::asio::mutable_buffers_1, HandlerCb) { }
+    virtual void AsyncSendTo(char *data, uint32_t len, uint32_t seq,
+                             HandlerCb cb) {
+        tx_list_.push_back(1);
+        single_list_.push_back(len);
+        Respond(seq);
+        cb(boost::system::error_code(), len);
+    }
+    virtual std::size_t SendTo(const char *data, uint32_t len,
+                               uint32_t seq) {
+        tx_list_.push_back(1);
+        single_list_.push_back(len);
+        Respond(seq);
+        return len;
+    }
+    virtual void Receive(boost::asio::mutable_buffers_1 buf) {
+        assert(!rx_queue_.empty());
+        char *data = rx_queue_.front();
+        rx_queue_.pop_front();
+        memcpy(boost::asio::buffer_cast<char *>(buf), data, sizeof(MsgHdr));
+        delete [] data;
+    }
+
+    virtual bool IsBatchSupported() const { return true; }
+    virtual uint32_t EncodeBatchMsg(char *buf, uint32_t buf_len,
+                                    IoContext *ioc) {
+        uint32_t len = sizeof(MsgHdr) + ioc->GetMsgLen();
+        if (ioc->GetMsgLen() > kBufLen || len > buf_len)
+            return 0;
+        MsgHdr *hdr = reinterpret_cast<MsgHdr *>(buf);
+        hdr->seq = ioc->GetSeqno();
+        hdr->len = len;
+        hdr->more = 0;
+        memcpy(buf + sizeof(MsgHdr), ioc->GetMsg(), ioc->GetMsgLen());
+        return len;
+    }
+    virtual void AsyncSendBatch(char *buf, uint32_t len, HandlerCb cb) {
+        SendBatchTo(buf, len);
+        cb(boost::system::error_code(), len);
+    }
+    virtual std::size_t SendBatchTo(const char *buf, uint32_t len) {
+        uint32_t count = 0;
+        for (uint32_t offset = 0; offset < len; count++) {
+            const MsgHdr *hdr = reinterpret_cast<const MsgHdr *>(buf + offset);
+            Respond(hdr->seq);
+            offset += hdr->len;
+        }
+        tx_list_.push_back(count);
+        return len;
+    }
+
+    // Number of messages in each transmission, in the order sent
+    const std::vector<uint32_t> &tx_list() const { return tx_list_; }
+    // Length of each message sent on its own
+    const std::vector<uint32_t> &single_list() const { return single_list_; }
+    void set_response_count(int count) { response_count_ = count; }
+
+private:
+    // In sync mode responses are queued for Receive, otherwise they are
+    // handed to the socket directly as if read from it. The last of
+    // response_count_ messages for a request has more data reset
+    void Respond(uint32_t seq) {
+        for (int i = 0; i < response_count_; i++) {
+            char *data = new char[kBufLen];
+            MsgHdr *hdr = reinterpret_cast<MsgHdr *>(data);
+            hdr->seq = seq;
+            hdr->len = sizeof(MsgHdr);
+            hdr->more = (i < response_count_ - 1);
+            if (sync_mode_) {
+                rx_queue_.push_back(data);
+            } else {
+                ValidateAndEnqueue(data);
+            }
+        }
+    }
+
+    bool sync_mode_;
+    int response_count_;
+    std::vector<uint32_t> tx_list_;
+    std::vector<uint32_t> single_list_;
+    std::deque<char *> rx_queue_;
+    DISALLOW_COPY_AND_ASSIGN(MockBatchSock);
+};
+
+class KSyncBatchTest : public ::testing::TestWithParam<bool> {
+protected:
+    virtual void SetUp() {
+        TestIoContext::done_count_ = 0;
+        sock_ = MockBatchSock::Init(GetParam());
+        KSyncSock::Start(GetParam(), true);
+        EXPECT_TRUE(sock_->batch_mode());
+    }
+
+    virtual void TearDown() {
+        task_util::WaitForIdle();
+        KSyncSock::Shutdown();
+        sock_ = NULL;
+    }
+
+    // Queue requests of the given lengths while the scheduler is stopped,
+    // so the send task sees all of them back to back
+    void Send(const std::vector<uint32_t> &lengths) {
+        task_util::TaskSchedulerStop();
+        for (std::vector<uint32_t>::const_iterator it = lengths.begin();
+             it != lengths.end(); ++it) {
+            sock_->GenericSend(new TestIoContext(*it, sock_->AllocSeqNo(false),
+                                                 &ctx_));
+        }
+        task_util::TaskSchedulerStart();
+        task_util::WaitForIdle();
+        TASK_UTIL_EXPECT_EQ((int)lengths.size(),
+                            (int)TestIoContext::done_count_);
+    }
+
+    MockSandeshContext ctx_;
+    MockBatchSock *sock_;
+};
+
+// Batches are closed at KSYNC_BATCH_MAX_COUNT requests
+TEST_P(KSyncBatchTest, CountLimit) {
+    std::vector<uint32_t> lengths(2 * KSYNC_BATCH_MAX_COUNT + 8, 64);
+    Send(lengths);
+
+    std::vector<uint32_t> expected;
+    expected.push_back(KSYNC_BATCH_MAX_COUNT);
+    expected.push_back(KSYNC_BATCH_MAX_COUNT);
+    expected.push_back(8);
+    EXPECT_TRUE(expected == sock_->tx_list());
+    EXPECT_EQ(3U, (uint64_t)sock_->stats().tx_batches);
+    EXPECT_EQ(lengths.size(), (uint64_t)sock_->stats().tx_batch_msgs);
+    EXPECT_EQ((uint32_t)KSYNC_BATCH_MAX_COUNT,
+              (uint32_t)sock_->stats().max_batch_msgs);
+}
+
+// Batches are closed once another request of up to kBufLen may not fit
+TEST_P(KSyncBatchTest, ByteLimit) {
+    std::vector<uint32_t> lengths(20, 3000);
+    Send(lengths);
+
+    std::vector<uint32_t> expected(2, 10);
+    EXPECT_TRUE(expected == sock_->tx_list());
+    EXPECT_GE((uint32_t)KSYNC_BATCH_MAX_BYTES,
+              (uint32_t)sock_->stats().max_batch_bytes);
+}
+
+// A request larger than a whole batch closes the current batch and is sent
+// on its own
+TEST_P(KSyncBatchTest, Oversize) {
+    uint32_t big = KSYNC_BATCH_MAX_BYTES + 1024;
+    std::vector<uint32_t> lengths;
+    lengths.push_back(64);
+    lengths.push_back(64);
+    lengths.push_back(big);
+    lengths.push_back(64);
+    lengths.push_back(64);
+    Send(lengths);
+
+    std::vector<uint32_t> expected;
+    expected.push_back(2);
+    expected.push_back(1);
+    expected.push_back(2);
+    EXPECT_TRUE(expected == sock_->tx_list());
+    ASSERT_EQ(1U, sock_->single_list().size());
+    EXPECT_EQ(big, sock_->single_list()[0]);
+    EXPECT_EQ(2U, (uint64_t)sock_->stats().tx_batches);
+}
+
+// A request the transport cannot encode into the batch buffer is sent on its
+// own after the rest of the batch
+TEST_P(KSyncBatchTest, EncodeFailure) {
+    uint32_t medium = 2 * KSyncSock::kBufLen;
+    std::vector<uint32_t> lengths;
+    lengths.push_back(64);
+    lengths.push_back(medium);
+    lengths.push_back(64);
+    Send(lengths);
+
+    std::vector<uint32_t> expected;
+    expected.push_back(2);
+    expected.push_back(1);
+    EXPECT_TRUE(expected == sock_->tx_list());
+    ASSERT_EQ(1U, sock_->single_list().size());
+    EXPECT_EQ(medium, sock_->single_list()[0]);
+}
+
+// Requests answered by several messages complete only on the last one
+TEST_P(KSyncBatchTest, MultiPartResponse) {
+    sock_->set_response_count(3);
+    std::vector<uint32_t> lengths(KSYNC_BATCH_MAX_COUNT + 4, 64);
+    Send(lengths);
+
+    std::vector<uint32_t> expected;
+    expected.push_back(KSYNC_BATCH_MAX_COUNT);
+    expected.push_back(4);
+    EXPECT_TRUE(expected == sock_->tx_list());
+    EXPECT_EQ(lengths.size(), (uint64_t)sock_->stats().ack_count);
+}
+
+INSTANTIATE_TEST_CASE_P(SyncMode, KSyncBatchTest, ::testing::Bool());
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    LoggingInit();
+    int ret = RUN_ALL_TESTS();
+    TaskScheduler::GetInstance()->Terminate();
+    return ret;
+}
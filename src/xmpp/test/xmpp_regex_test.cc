@@ -2,8 +2,13 @@
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
 
+#include <fstream>
+#include <boost/regex.hpp>
+
 #include "control-node/control_node.h"
 #include "base/test/task_test_util.h"
+#include "base/time_util.h"
+#include "xmpp/xmpp_framer.h"
 #include "xmpp/xmpp_state_machine.h"
 #include "xmpp/xmpp_session.h"
 #include "xmpp/xmpp_str.h"
@@ -16,13 +21,17 @@
 
 using namespace std;
 
-class XmppRegexMock : public XmppSession {
+//
+// Regex based matching on a copy of the received data, as XmppSession used
+// to frame messages before XmppStanzaFramer.
+//
+class XmppRegexMock {
 public:
-    XmppRegexMock(TcpServer *server, Socket *sock) : 
-                  XmppSession(server, sock), p1("<(iq|message)"), bufx_("") { }
+    XmppRegexMock() : p1("<(iq|message)"), bufx_(""), tag_known_(0) {
+        ReplaceBuf("");
+    }
     ~XmppRegexMock() { }
 
-    //boost::regex Regex() { return p1; }
     void SetRegex(const char *ss) { p1 = ss; }
 
     void AppendString(const string &str) {
@@ -57,16 +66,114 @@ public:
         return tag_.c_str();
     }
 
+    //
+    // Regex based stanza framing of a received buffer in the ESTABLISHED
+    // state. Returns the number of complete messages.
+    //
+    size_t RegexRead(const uint8_t *data, size_t size) {
+        size_t count = 0;
+        SetBuf(string(data, data + size));
+        while (true) {
+            if (!tag_known_) {
+                size_t pos = buf_.find_first_not_of(sXMPP_VALIDWS);
+                if (pos != 0) {
+                    if (pos == string::npos) pos = buf_.size();
+                    offset_ = buf_.begin() + pos;
+                    count++;
+                    if (!NextMessage())
+                        break;
+                    continue;
+                }
+            }
+            int m = MatchRegex(tag_known_ ?
+                               tag_to_pattern(begin_tag_.c_str()) : patt_);
+            if (m != 0)
+                break;
+            tag_known_ ^= 1;
+            if (tag_known_)
+                continue;
+            count++;
+            if (!NextMessage())
+                break;
+        }
+        return count;
+    }
+
 private:
+    static boost::regex tag_to_pattern(const char *tag) {
+        std::string token("</");
+        token += ++tag;
+        token += "[\\s\\t\\r\\n]*>";
+        return boost::regex(token.c_str());
+    }
+
+    void SetBuf(const string &str) {
+        if (buf_.empty()) {
+            ReplaceBuf(str);
+        } else {
+            int pos = offset_ - buf_.begin();
+            buf_ += str;
+            offset_ = buf_.begin() + pos;
+        }
+    }
+
+    void ReplaceBuf(const string &str) {
+        buf_ = str;
+        buf_.reserve(XmppSession::kMaxMessageSize + 8);
+        offset_ = buf_.begin();
+    }
+
+    bool LeftOver() const {
+        if (buf_.empty())
+            return false;
+        return (buf_.end() != offset_);
+    }
+
+    // Match a pattern in the buffer. Partially matched string is
+    // kept in buf_ for use in conjunction with next buffer read.
+    int MatchRegex(const boost::regex &patt) {
+        string::const_iterator end = buf_.end();
+        if (regex_search(offset_, end, res_, patt,
+                         boost::match_default | boost::match_partial) == 0) {
+            return -1;
+        }
+        if (res_[0].matched == false) {
+            // partial match
+            offset_ = res_[0].first;
+            return 1;
+        }
+        begin_tag_ = string(res_[0].first, res_[0].second);
+        offset_ = res_[0].second;
+        return 0;
+    }
+
+    bool NextMessage() {
+        if (!LeftOver()) {
+            buf_.clear();
+            return false;
+        }
+        ReplaceBuf(string(offset_, string::const_iterator(buf_.end())));
+        return true;
+    }
+
+    static const boost::regex patt_;
+
     boost::regex p1;
     string bufx_;
     string tag_;
+    int tag_known_;
+    string begin_tag_;
+    string buf_;
+    string::const_iterator offset_;
+    boost::match_results<string::const_iterator> res_;
 };
 
+const boost::regex XmppRegexMock::patt_(rXMPP_MESSAGE);
+
 class XmppRegexTest : public ::testing::Test {
 protected:
     virtual void SetUp() {
-        regex_.reset(new XmppRegexMock(NULL, NULL));
+        regex_.reset(new XmppRegexMock());
     }
 
     virtual void TearDown() {
@@ -168,7 +275,186 @@ TEST_F(XmppRegexTest, Connection) {
     ASSERT_STREQ(regex_->Buf(), "<message a = '2'> <item> blah blah </item></message>");
 }
 
+
+class XmppFramerTest : public ::testing::Test {
+protected:
+    XmppFramerTest() {
+    }
+
+    string FileRead(const string &filename) {
+        string content;
+        fstream file(filename.c_str(), fstream::in);
+        if (!file) {
+            LOG(DEBUG, "File not found : " << filename);
+            return content;
+        }
+        while (!file.eof()) {
+            char piece[256];
+            file.read(piece, sizeof(piece));
+            content.append(piece, file.gcount());
+        }
+        file.close();
+        return content;
+    }
+
+    // Feed str to the framer in chunks of the given size and collect the
+    // frames.
+    void Frame(const string &str, size_t chunk) {
+        const uint8_t *data = reinterpret_cast<const uint8_t *>(str.data());
+        for (size_t pos = 0; pos < str.size(); pos += chunk) {
+            size_t size = std::min(chunk, str.size() - pos);
+            size_t offset = 0;
+            while (offset < size) {
+                bool complete;
+                const uint8_t *start = data + pos + offset;
+                size_t len = framer_.Scan(start, size - offset, &complete);
+                frame_.append(start, start + len);
+                offset += len;
+                if (complete) {
+                    frames_.push_back(frame_);
+                    frame_.clear();
+                }
+            }
+        }
+    }
+
+    size_t RegexFrame(const string &str, size_t chunk) {
+        const uint8_t *data = reinterpret_cast<const uint8_t *>(str.data());
+        size_t count = 0;
+        for (size_t pos = 0; pos < str.size(); pos += chunk) {
+            size_t size = std::min(chunk, str.size() - pos);
+            count += regex_.RegexRead(data + pos, size);
+        }
+        return count;
+    }
+
+    XmppStanzaFramer framer_;
+    XmppRegexMock regex_;
+    string frame_;
+    vector<string> frames_;
+};
+
+TEST_F(XmppFramerTest, StreamHeader) {
+    framer_.set_mode(XmppStanzaFramer::STREAM_HEADER);
+    string hdr("<?xml version='1.0'?><stream:stream from='a' to='b' "
+               "xmlns:stream='http://etherx.jabber.org/streams'>");
+    Frame(hdr + "<iq", 4096);
+    ASSERT_EQ(1, frames_.size());
+    EXPECT_EQ(hdr, frames_[0]);
+    EXPECT_EQ("<iq", frame_);
+
+    // Empty element form, split at every byte.
+    frames_.clear();
+    frame_.clear();
+    framer_.Reset();
+    Frame(sXMPP_STREAM_OPEN, 1);
+    ASSERT_EQ(1, frames_.size());
+    EXPECT_EQ(sXMPP_STREAM_OPEN, frames_[0]);
+    EXPECT_TRUE(frame_.empty());
+}
+
+//
+// The stream close is framed on its own in both modes, e.g. when the peer
+// closes the stream before sending its stream header.
+//
+TEST_F(XmppFramerTest, StreamClose) {
+    XmppStanzaFramer::Mode modes[] = {
+        XmppStanzaFramer::STREAM_HEADER, XmppStanzaFramer::STANZA
+    };
+    string close("</stream:stream>");
+    for (size_t idx = 0; idx < sizeof(modes) / sizeof(modes[0]); idx++) {
+        for (size_t chunk = 1; chunk <= close.size() + 1; chunk++) {
+            frames_.clear();
+            frame_.clear();
+            framer_.Reset();
+            framer_.set_mode(modes[idx]);
+            Frame(close + "<iq", chunk);
+            ASSERT_EQ(1, frames_.size());
+            EXPECT_EQ(close, frames_[0]);
+            EXPECT_EQ("<iq", frame_);
+        }
+    }
+
+    // After a complete stanza.
+    frames_.clear();
+    frame_.clear();
+    framer_.Reset();
+    framer_.set_mode(XmppStanzaFramer::STANZA);
+    Frame("<iq></iq>" + close, 4096);
+    ASSERT_EQ(2, frames_.size());
+    EXPECT_EQ("<iq></iq>", frames_[0]);
+    EXPECT_EQ(close, frames_[1]);
+    EXPECT_FALSE(framer_.InFrame());
+}
+
+TEST_F(XmppFramerTest, Stanza) {
+    framer_.set_mode(XmppStanzaFramer::STANZA);
+    string iq("<iq a='>'><item> <x/> blah </item></iq>");
+    string msg("<message a = \"</message>\"> <iq></iq> </message>");
+    string ws(" \n");
+    for (size_t chunk = 1; chunk <= 64; chunk++) {
+        frames_.clear();
+        frame_.clear();
+        Frame(iq + ws + msg + iq, chunk);
+        ASSERT_LE(3, frames_.size());
+        EXPECT_EQ(iq, frames_[0]);
+        EXPECT_EQ(msg, frames_[frames_.size() - 2]);
+        EXPECT_EQ(iq, frames_[frames_.size() - 1]);
+        for (size_t i = 1; i < frames_.size() - 2; i++) {
+            EXPECT_EQ(string::npos, frames_[i].find_first_not_of(ws));
+        }
+        EXPECT_FALSE(framer_.InFrame());
+    }
+
+    // Partial stanza carries its depth across reads.
+    frames_.clear();
+    frame_.clear();
+    Frame("<iq><pubsub><item>", 4096);
+    EXPECT_TRUE(frames_.empty());
+    EXPECT_TRUE(framer_.InFrame());
+    EXPECT_EQ(3, framer_.depth());
+    Frame("</item></pubsub></iq>", 4096);
+    ASSERT_EQ(1, frames_.size());
+    EXPECT_EQ("<iq><pubsub><item></item></pubsub></iq>", frames_[0]);
+}
+
+//
+// Compare the time taken to frame recorded agent messages using the
+// streaming framer and the regex match on a copy of the buffer.
+//
+TEST_F(XmppFramerTest, Benchmark) {
+    string iq = FileRead("controller/src/xmpp/testdata/iq-large.xml");
+    string msg = FileRead("controller/src/xmpp/testdata/message.xml");
+    if (iq.empty() || msg.empty())
+        return;
+
+    int repeat = 100;
+    char *str = getenv("XMPP_FRAMER_TEST_REPEAT");
+    if (str) repeat = strtoul(str, NULL, 0);
+
+    string stream;
+    for (int i = 0; i < repeat; i++) {
+        stream += iq;
+        stream += msg;
+    }
+
+    framer_.set_mode(XmppStanzaFramer::STANZA);
+    uint64_t start = ClockMonotonicUsec();
+    Frame(stream, TcpSession::kDefaultBufferSize);
+    uint64_t framer_usecs = ClockMonotonicUsec() - start;
+
+    start = ClockMonotonicUsec();
+    size_t count = RegexFrame(stream, TcpSession::kDefaultBufferSize);
+    uint64_t regex_usecs = ClockMonotonicUsec() - start;
+
+    EXPECT_EQ(count, frames_.size());
+    LOG(DEBUG, "Framed " << stream.size() << " bytes, " << frames_.size()
+        << " messages: framer " << framer_usecs << " usec, regex "
+        << regex_usecs << " usec");
+}
+
 }
+
 static void SetUp() {
     LoggingInit();
     ControlNode::SetDefaultSchedulingPolicy();
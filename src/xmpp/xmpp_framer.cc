@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "xmpp/xmpp_framer.h"
+
+#include <string.h>
+
+#include "xmpp/xmpp_str.h"
+
+XmppStanzaFramer::XmppStanzaFramer()
+    : mode_(STREAM_HEADER), state_(FRAME_START), quote_(0), depth_(0),
+      tag_name_len_(0) {
+}
+
+void XmppStanzaFramer::Reset() {
+    state_ = FRAME_START;
+    quote_ = 0;
+    depth_ = 0;
+    tag_name_len_ = 0;
+}
+
+//
+// Same character set as sXMPP_VALIDWS. The whitespace keepalive U+0200 is
+// encoded as 0xC8 0x80 and each of those bytes is treated as whitespace.
+//
+bool XmppStanzaFramer::IsWhitespace(uint8_t c) {
+    return (c == ' ' || c == '\n' || c == '\r' || c == '\t' ||
+            c == 0xC8 || c == 0x80);
+}
+
+bool XmppStanzaFramer::IsStreamTag() const {
+    static const size_t kStreamTagLen = sizeof(sXMPP_STREAM_O) - 1;
+    return (tag_name_len_ == kStreamTagLen &&
+            memcmp(tag_name_, sXMPP_STREAM_O, kStreamTagLen) == 0);
+}
+
+//
+// Called on the '>' that closes a start tag. Returns true if the tag ends
+// the current frame.
+//
+bool XmppStanzaFramer::StartTagDone() {
+    if (mode_ == STREAM_HEADER && IsStreamTag())
+        return true;
+    depth_++;
+    state_ = TEXT;
+    return false;
+}
+
+bool XmppStanzaFramer::FrameDone() {
+    state_ = FRAME_START;
+    depth_ = 0;
+    tag_name_len_ = 0;
+    return true;
+}
+
+size_t XmppStanzaFramer::Scan(const uint8_t *data, size_t len,
+                              bool *complete) {
+    *complete = false;
+    for (size_t i = 0; i < len; ++i) {
+        uint8_t c = data[i];
+        switch (state_) {
+        case FRAME_START:
+            if (IsWhitespace(c)) {
+                state_ = WHITESPACE;
+            } else {
+                state_ = (c == '<') ? TAG_OPEN : TEXT;
+            }
+            break;
+
+        case WHITESPACE:
+            // The whitespace run ends at the first other character, which
+            // is the start of the next frame.
+            if (!IsWhitespace(c)) {
+                *complete = FrameDone();
+                return i;
+            }
+            break;
+
+        case TEXT:
+            if (c == '<')
+                state_ = TAG_OPEN;
+            break;
+
+        case TAG_OPEN:
+            if (c == '/') {
+                state_ = END_TAG;
+            } else if (c == '?') {
+                state_ = PROC_INSTR;
+            } else if (c == '!') {
+                state_ = DECLARATION;
+            } else {
+                state_ = START_TAG_NAME;
+                tag_name_[0] = c;
+                tag_name_len_ = 1;
+            }
+            break;
+
+        case START_TAG_NAME:
+            if (c == '>') {
+                if (StartTagDone()) {
+                    *complete = FrameDone();
+                    return i + 1;
+                }
+            } else if (c == '/') {
+                state_ = EMPTY_TAG_SLASH;
+            } else if (IsWhitespace(c)) {
+                state_ = START_TAG;
+            } else {
+                if (tag_name_len_ < kMaxTagNameMatch)
+                    tag_name_[tag_name_len_] = c;
+                tag_name_len_++;
+            }
+            break;
+
+        case START_TAG:
+            if (c == '\'' || c == '"') {
+                quote_ = c;
+                state_ = START_TAG_QUOTE;
+            } else if (c == '/') {
+                state_ = EMPTY_TAG_SLASH;
+            } else if (c == '>') {
+                if (StartTagDone()) {
+                    *complete = FrameDone();
+                    return i + 1;
+                }
+            }
+            break;
+
+        case START_TAG_QUOTE:
+            if (c == quote_)
+                state_ = START_TAG;
+            break;
+
+        case EMPTY_TAG_SLASH:
+            if (c == '>') {
+                if ((mode_ == STREAM_HEADER && IsStreamTag()) ||
+                    (mode_ == STANZA && depth_ == 0)) {
+                    *complete = FrameDone();
+                    return i + 1;
+                }
+                state_ = TEXT;
+            } else if (c == '\'' || c == '"') {
+                quote_ = c;
+                state_ = START_TAG_QUOTE;
+            } else {
+                state_ = START_TAG;
+            }
+            break;
+
+        case END_TAG:
+            if (c == '>') {
+                // An end tag without a matching start tag closes the stream
+                // and is a frame of its own, whatever the mode.
+                if (depth_ == 0) {
+                    *complete = FrameDone();
+                    return i + 1;
+                }
+                depth_--;
+                if (mode_ == STANZA && depth_ == 0) {
+                    *complete = FrameDone();
+                    return i + 1;
+                }
+                state_ = TEXT;
+            }
+            break;
+
+        case PROC_INSTR:
+            if (c == '?')
+                state_ = PROC_INSTR_END;
+            break;
+
+        case PROC_INSTR_END:
+            if (c == '>') {
+                state_ = TEXT;
+            } else if (c != '?') {
+                state_ = PROC_INSTR;
+            }
+            break;
+
+        case DECLARATION:
+            if (c == '>')
+                state_ = TEXT;
+            break;
+        }
+    }
+
+    // A whitespace run that reaches the end of the buffer is delivered
+    // right away, as it carries no state that the next read could extend
+    // in a meaningful way.
+    if (state_ == WHITESPACE)
+        *complete = FrameDone();
+    return len;
+}
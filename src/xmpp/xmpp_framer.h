@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __XMPP_FRAMER_H__
+#define __XMPP_FRAMER_H__
+
+#include <stdint.h>
+#include <string>
+
+#include "base/util.h"
+
+//
+// Streaming XMPP stanza boundary scanner.
+//
+// The framer is fed the raw bytes received on an XmppSession, buffer by
+// buffer, and reports where each complete frame ends. It never copies the
+// data it scans: all the state required to resume in the middle of a frame
+// (lexical state, element depth and the first few bytes of the current tag
+// name) is carried across calls to Scan.
+//
+// A frame is one of:
+// - a run of whitespace keepalive characters.
+// - in STREAM_HEADER mode, everything up to and including the start tag of
+//   the <stream:stream> element.
+// - in STANZA mode, a complete top level element, i.e. everything up to the
+//   end tag that brings the element depth back to zero.
+// - in either mode, a stray end tag at depth zero (e.g. </stream:stream>).
+//
+// Any non-whitespace text preceding the first tag of a frame is returned as
+// part of that frame.
+//
+class XmppStanzaFramer {
+public:
+    enum Mode {
+        STREAM_HEADER,
+        STANZA
+    };
+
+    XmppStanzaFramer();
+
+    // Scan up to len bytes from data. Returns the number of bytes consumed.
+    // If a frame is completed, *complete is set to true and the return value
+    // is the offset just past the end of the frame; the remaining bytes must
+    // be passed to a subsequent call. Otherwise all bytes are consumed and
+    // belong to a frame that is still in progress.
+    size_t Scan(const uint8_t *data, size_t len, bool *complete);
+
+    // Discard any partially scanned frame.
+    void Reset();
+
+    void set_mode(Mode mode) { mode_ = mode; }
+    Mode mode() const { return mode_; }
+
+    // True if the framer is in the middle of a frame.
+    bool InFrame() const { return state_ != FRAME_START; }
+    int depth() const { return depth_; }
+
+private:
+    enum State {
+        FRAME_START,
+        WHITESPACE,
+        TEXT,
+        TAG_OPEN,
+        START_TAG_NAME,
+        START_TAG,
+        START_TAG_QUOTE,
+        EMPTY_TAG_SLASH,
+        END_TAG,
+        PROC_INSTR,
+        PROC_INSTR_END,
+        DECLARATION
+    };
+
+    static const size_t kMaxTagNameMatch = 16;
+
+    static bool IsWhitespace(uint8_t c);
+    bool IsStreamTag() const;
+    bool StartTagDone();
+    bool FrameDone();
+
+    Mode mode_;
+    State state_;
+    uint8_t quote_;
+    int depth_;
+    size_t tag_name_len_;
+    char tag_name_[kMaxTagNameMatch];
+
+    DISALLOW_COPY_AND_ASSIGN(XmppStanzaFramer);
+};
+
+#endif // __XMPP_FRAMER_H__